@@ -22,12 +22,15 @@
 #include <osquery/logger/logger.h>
 #include <osquery/remote/serializers/json.h>
 #include <osquery/utils/conversions/split.h>
+#include <osquery/utils/conversions/tryto.h>
 #include <osquery/core/system.h>
 #include <osquery/utils/base64.h>
 #include <osquery/utils/json/json.h>
 #include <osquery/utils/system/system.h>
 #include <osquery/utils/system/time.h>
 
+#include <boost/filesystem/operations.hpp>
+
 namespace fs = boost::filesystem;
 
 namespace osquery {
@@ -65,9 +68,94 @@ CLI_FLAG(uint32,
          86400,
          "Seconds to store successful carve result metadata (in carves table)");
 
+/// Boolean if carves should be streamed instead of archived to disk.
+CLI_FLAG(bool,
+         carver_streaming,
+         false,
+         "Stream carves to the remote endpoints without temporary files, "
+         "resuming interrupted uploads (default false)");
+
 DECLARE_bool(disable_carver);
 DECLARE_uint64(read_max);
 
+namespace {
+
+/// Number of blocks posted between two saves of a streamed carve progress.
+const std::size_t kCarverProgressBlocks{64};
+
+/// Upload state of a streamed carve, kept in its database entry.
+struct CarveProgress {
+  std::string session_id;
+  std::size_t block_size{0};
+  std::size_t block_count{0};
+  std::uint64_t carve_size{0};
+  bool compression{false};
+
+  /// Blocks before this one have been posted.
+  std::size_t block_id{0};
+
+  /// Fingerprint of the carved files when the upload started.
+  std::string files;
+};
+
+std::uint64_t getCarveNumber(const JSON& tree, const std::string& key) {
+  auto it = tree.doc().FindMember(key);
+  if (it == tree.doc().MemberEnd() || !it->value.IsString()) {
+    return 0;
+  }
+  return tryTo<std::uint64_t>(std::string(it->value.GetString()))
+      .takeOr(std::uint64_t{0});
+}
+
+/// Get the progress of a streamed carve, if its upload has started.
+bool getCarveProgress(const std::string& guid, CarveProgress& progress) {
+  std::string carve;
+  auto s = getDatabaseValue(kCarves, kCarverDBPrefix + guid, carve);
+  if (!s.ok()) {
+    return false;
+  }
+
+  JSON tree;
+  s = tree.fromString(carve);
+  if (!s.ok() || !tree.doc().IsObject()) {
+    return false;
+  }
+
+  auto it = tree.doc().FindMember("session_id");
+  if (it == tree.doc().MemberEnd() || !it->value.IsString()) {
+    return false;
+  }
+
+  progress.session_id = it->value.GetString();
+  progress.block_size = getCarveNumber(tree, "block_size");
+  progress.block_count = getCarveNumber(tree, "block_count");
+  progress.carve_size = getCarveNumber(tree, "size");
+  progress.compression = getCarveNumber(tree, "compression") != 0;
+  progress.block_id = getCarveNumber(tree, "block_id");
+
+  it = tree.doc().FindMember("files");
+  if (it != tree.doc().MemberEnd() && it->value.IsString()) {
+    progress.files = it->value.GetString();
+  }
+  return !progress.session_id.empty() && progress.block_size > 0;
+}
+
+/// Identify the carved files by their paths, sizes and modification times.
+std::string getCarveFingerprint(
+    const std::vector<CarveStream::Entry>& entries) {
+  std::string files;
+  for (const auto& entry : entries) {
+    boost::system::error_code ec;
+    auto mtime = fs::last_write_time(entry.path, ec);
+    files += entry.path.string() + '\0' + std::to_string(entry.size) + '\0' +
+             std::to_string(ec ? 0 : mtime) + '\0';
+  }
+
+  return hashFromBuffer(HASH_TYPE_SHA256, files.data(), files.size());
+}
+
+} // namespace
+
 std::atomic<bool> CarverRunnable::running_{false};
 
 void CarverRunnable::start() {
@@ -110,7 +198,9 @@ void CarverRunnable::start() {
       }
     }
 
-    if (status != kCarverStatusScheduled) {
+    // Streamed carves interrupted while uploading are resumed.
+    auto resume = FLAGS_carver_streaming && status == kCarverStatusUploading;
+    if (status != kCarverStatusScheduled && !resume) {
       continue;
     }
 
@@ -174,6 +264,10 @@ Carver::~Carver() {
 }
 
 Status Carver::carve() {
+  if (FLAGS_carver_streaming) {
+    return streamCarve();
+  }
+
   auto s = createPaths();
   if (!s.ok()) {
     updateCarveValue(carveGuid_, "status", "CREATE PATHS FAILED");
@@ -267,22 +361,160 @@ Status Carver::blockwiseCopy(PlatformFile& src, PlatformFile& dst) {
   return Status::success();
 };
 
-Status Carver::postCarve(const boost::filesystem::path& path) {
+Status Carver::streamCarve() {
+  updateCarveValue(carveGuid_, "status", "PENDING");
+  auto entries = getCarveEntries();
+  auto files = getCarveFingerprint(entries);
+
+  CarveProgress progress;
+  if (getCarveProgress(carveGuid_, progress)) {
+    // The posted blocks cannot be checked, they must be produced again.
+    if (progress.files != files) {
+      VLOG(1) << "Carved files changed since carve " << carveGuid_
+              << " was interrupted";
+      updateCarveValue(carveGuid_, "status", "ARCHIVE FAILED");
+      return Status::failure("Carved files changed during the carve");
+    }
+
+    VLOG(1) << "Resuming carve " << carveGuid_ << " at block "
+            << progress.block_id;
+  } else {
+    progress.block_size = FLAGS_carver_block_size;
+    progress.compression = FLAGS_carver_compression;
+    progress.block_id = 0;
+
+    // The size of a compressed archive depends on the content of the files.
+    CarveStream sizing(entries,
+                       progress.block_size,
+                       progress.compression,
+                       progress.compression);
+    auto s = sizing.open();
+
+    std::string block;
+    while (s.ok()) {
+      s = sizing.read(block);
+      if (block.empty()) {
+        break;
+      }
+    }
+
+    if (!s.ok()) {
+      VLOG(1) << "Failed to create carve archive: " << s.getMessage();
+      updateCarveValue(carveGuid_, "status", "ARCHIVE FAILED");
+      return s;
+    }
+
+    progress.carve_size = sizing.size();
+    progress.block_count = static_cast<std::size_t>(
+        (progress.carve_size + progress.block_size - 1) / progress.block_size);
+
+    s = startCarveSession(
+        progress.block_count, progress.carve_size, progress.session_id);
+    if (!s.ok()) {
+      VLOG(1) << "Failed to post carve: " << s.getMessage();
+      updateCarveValue(carveGuid_, "status", "DATA POST FAILED");
+      return s;
+    }
+
+    updateCarveValue(carveGuid_, "size", std::to_string(progress.carve_size));
+    updateCarveValue(
+        carveGuid_, "block_size", std::to_string(progress.block_size));
+    updateCarveValue(
+        carveGuid_, "block_count", std::to_string(progress.block_count));
+    updateCarveValue(
+        carveGuid_, "compression", progress.compression ? "1" : "0");
+    updateCarveValue(carveGuid_, "block_id", "0");
+    updateCarveValue(carveGuid_, "session_id", progress.session_id);
+    updateCarveValue(carveGuid_, "files", files);
+  }
+
+  updateCarveValue(carveGuid_, "status", kCarverStatusUploading);
+
+  CarveStream stream(entries, progress.block_size, progress.compression);
+  auto s = stream.open();
+
+  std::string block;
+  for (std::size_t i = 0; s.ok(); i++) {
+    s = stream.read(block);
+    if (!s.ok() || block.empty()) {
+      break;
+    }
+
+    if (i >= progress.block_count) {
+      s = Status::failure("Carved files changed during the carve");
+      break;
+    }
+
+    // Blocks posted before the carve was interrupted are only hashed.
+    if (i < progress.block_id) {
+      continue;
+    }
+
+    s = postCarveBlock(i, progress.session_id, block);
+    if (!s.ok()) {
+      VLOG(1) << "Post of carved block " << i
+              << " failed: " << s.getMessage();
+      updateCarveValue(carveGuid_, "status", "DATA POST FAILED");
+      return s;
+    }
+
+    if ((i + 1) % kCarverProgressBlocks == 0) {
+      updateCarveValue(carveGuid_, "block_id", std::to_string(i + 1));
+    }
+  }
+
+  if (s.ok() && stream.size() != progress.carve_size) {
+    s = Status::failure("Carved files changed during the carve");
+  }
+
+  if (!s.ok()) {
+    VLOG(1) << "Failed to stream carve archive: " << s.getMessage();
+    updateCarveValue(carveGuid_, "status", "ARCHIVE FAILED");
+    return s;
+  }
+
+  updateCarveValue(
+      carveGuid_, "block_id", std::to_string(progress.block_count));
+  updateCarveValue(carveGuid_, "sha256", stream.digest());
+  updateCarveValue(carveGuid_, "status", kCarverStatusSuccess);
+  return Status::success();
+}
+
+std::vector<CarveStream::Entry> Carver::getCarveEntries() {
+  std::vector<CarveStream::Entry> entries;
+  std::set<std::string> names;
+  for (const auto& srcPath : carvePaths_) {
+    // Ensure the file is a flat file on disk before carving
+    PlatformFile src(srcPath, PF_OPEN_EXISTING | PF_READ);
+    if (!src.isValid() || isDirectory(srcPath)) {
+      VLOG(1) << "File does not exist on disk or is subdirectory: " << srcPath;
+      continue;
+    }
+
+    auto name = srcPath.leaf().string();
+    if (!names.insert(name).second) {
+      VLOG(1) << "File name was already carved: " << srcPath;
+      continue;
+    }
+
+    entries.push_back({srcPath, name, src.size()});
+  }
+  return entries;
+}
+
+Status Carver::startCarveSession(std::size_t block_count,
+                                 std::uint64_t carve_size,
+                                 std::string& session_id) {
   // Construct the uri we post our data back to:
   auto startUri = TLSRequestHelper::makeURI(FLAGS_carver_start_endpoint);
   Request<TLSTransport, JSONSerializer> startRequest(startUri);
   startRequest.setOption("hostname", FLAGS_tls_hostname);
 
-  // Perform the start request to get the session id
-  PlatformFile pFile(path, PF_OPEN_EXISTING | PF_READ);
-  auto blkCount =
-      static_cast<size_t>(ceil(static_cast<double>(pFile.size()) /
-                               static_cast<double>(FLAGS_carver_block_size)));
   JSON startParams;
 
-  startParams.add("block_count", blkCount);
+  startParams.add("block_count", block_count);
   startParams.add("block_size", size_t(FLAGS_carver_block_size));
-  startParams.add("carve_size", pFile.size());
+  startParams.add("carve_size", carve_size);
   startParams.add("carve_id", carveGuid_);
   startParams.add("request_id", requestId_);
   startParams.add("node_key", getNodeKey("tls"));
@@ -307,10 +539,41 @@ Status Carver::postCarve(const boost::filesystem::path& path) {
     return Status(1, "Invalid session_id received from remote endpoint");
   }
 
-  std::string session_id = it->value.GetString();
+  session_id = it->value.GetString();
   if (session_id.empty()) {
     return Status(1, "Empty session_id received from remote endpoint");
   }
+  return Status::success();
+}
+
+Status Carver::postCarveBlock(std::size_t block_id,
+                              const std::string& session_id,
+                              const std::string& block) {
+  auto contUri = TLSRequestHelper::makeURI(FLAGS_carver_continue_endpoint);
+  Request<TLSTransport, JSONSerializer> contRequest(contUri);
+  contRequest.setOption("hostname", FLAGS_tls_hostname);
+
+  JSON params;
+  params.add("block_id", block_id);
+  params.add("session_id", session_id);
+  params.add("request_id", requestId_);
+  params.add("data", base64::encode(block));
+
+  return contRequest.call(params);
+}
+
+Status Carver::postCarve(const boost::filesystem::path& path) {
+  // Perform the start request to get the session id
+  PlatformFile pFile(path, PF_OPEN_EXISTING | PF_READ);
+  auto blkCount =
+      static_cast<size_t>(ceil(static_cast<double>(pFile.size()) /
+                               static_cast<double>(FLAGS_carver_block_size)));
+
+  std::string session_id;
+  auto status = startCarveSession(blkCount, pFile.size(), session_id);
+  if (!status.ok()) {
+    return status;
+  }
 
   auto contUri = TLSRequestHelper::makeURI(FLAGS_carver_continue_endpoint);
   Request<TLSTransport, JSONSerializer> contRequest(contUri);
@@ -9,6 +9,7 @@
 
 #pragma once
 
+#include <osquery/carver/carver_stream.h>
 #include <osquery/dispatcher/dispatcher.h>
 #include <osquery/filesystem/filesystem.h>
 #include <osquery/utils/status/status.h>
@@ -16,6 +17,7 @@
 #include <atomic>
 #include <set>
 #include <string>
+#include <vector>
 
 namespace osquery {
 
@@ -122,6 +124,36 @@ class Carver {
    */
   Status blockwiseCopy(PlatformFile& src, PlatformFile& dst);
 
+  /**
+   * @brief Carve by streaming the archive straight into uploaded blocks.
+   *
+   * This is used instead of the carve, archive, compress and post steps when
+   * carver_streaming is set. The archive is produced twice without touching
+   * the disk: once to size it, as the session start announces its size and
+   * block count, and once to upload it. The session and the number of
+   * uploaded blocks are kept in the carve database entry, so an interrupted
+   * upload resumes where it stopped.
+   */
+  Status streamCarve();
+
+  /**
+   * @brief A helper function listing the files to carve with their size.
+   *
+   * Like carveAll, this skips files that do not exist and directories, as
+   * well as files sharing the name of a previous file.
+   */
+  std::vector<CarveStream::Entry> getCarveEntries();
+
+  /// Start a carve session on the carver_start_endpoint.
+  virtual Status startCarveSession(std::size_t block_count,
+                                   std::uint64_t carve_size,
+                                   std::string& session_id);
+
+  /// POST a block of a carve session to the carver_continue_endpoint.
+  virtual Status postCarveBlock(std::size_t block_id,
+                                const std::string& session_id,
+                                const std::string& block);
+
   /**
    * @brief Helper function to POST a carve to the graph endpoint.
    *
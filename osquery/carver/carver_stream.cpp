@@ -0,0 +1,250 @@
+/**
+ * Copyright (c) 2014-present, The osquery authors
+ *
+ * This source code is licensed as defined by the LICENSE file found in the
+ * root directory of this source tree.
+ *
+ * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
+ */
+
+#include <osquery/utils/system/system.h>
+
+// This define is required for Windows static linking of libarchive
+#define LIBARCHIVE_STATIC
+#include <archive.h>
+#include <archive_entry.h>
+#include <zstd.h>
+
+#include <osquery/carver/carver_stream.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace osquery {
+
+CarveStream::CarveStream(std::vector<Entry> entries,
+                         std::size_t block_size,
+                         bool compress,
+                         bool read_data)
+    : entries_(std::move(entries)),
+      block_size_(block_size),
+      compress_(compress),
+      read_data_(read_data) {}
+
+CarveStream::~CarveStream() {
+  if (archive_ != nullptr) {
+    archive_write_free(archive_);
+  }
+
+  if (cstream_ != nullptr) {
+    ZSTD_freeCCtx(cstream_);
+  }
+}
+
+Status CarveStream::open() {
+  if (block_size_ == 0U) {
+    return Status::failure("Invalid carve block size");
+  }
+
+  if (compress_) {
+    cstream_ = ZSTD_createCCtx();
+    if (cstream_ == nullptr) {
+      return Status::failure("Couldn't create compression stream");
+    }
+
+    // Use the compression level of the file based carves.
+    auto ret = ZSTD_CCtx_setParameter(cstream_, ZSTD_c_compressionLevel, 1);
+    if (ZSTD_isError(ret)) {
+      return Status::failure("Couldn't initialize compression stream");
+    }
+
+    compressed_.resize(ZSTD_CStreamOutSize());
+  }
+
+  archive_ = archive_write_new();
+  if (archive_ == nullptr) {
+    return Status::failure("Failed to create tar archive");
+  }
+
+  archive_write_set_format_pax_restricted(archive_);
+
+  // Do not pad the archive to 10K records, hand every write to the callback.
+  archive_write_set_bytes_per_block(archive_, 0);
+
+  auto on_write = [](struct archive*,
+                     void* context,
+                     const void* buffer,
+                     size_t length) -> la_ssize_t {
+    auto stream = static_cast<CarveStream*>(context);
+    stream->write_status_ = stream->append(buffer, length);
+    if (!stream->write_status_.ok()) {
+      return -1;
+    }
+
+    return static_cast<la_ssize_t>(length);
+  };
+
+  auto ret = archive_write_open(archive_, this, nullptr, on_write, nullptr);
+  if (ret != ARCHIVE_OK) {
+    return Status::failure("Failed to open tar archive for writing");
+  }
+
+  input_.resize(block_size_);
+  return Status::success();
+}
+
+Status CarveStream::read(std::string& block) {
+  block.clear();
+  if (archive_ == nullptr) {
+    return Status::failure("The carve stream is not open");
+  }
+
+  while (output_.size() < block_size_ && !finished_) {
+    auto s = writeNext();
+    if (!s.ok()) {
+      return s;
+    }
+  }
+
+  auto length = std::min(block_size_, output_.size());
+  block.assign(output_, 0, length);
+  output_.erase(0, length);
+
+  hash_.update(block.data(), block.size());
+  size_ += block.size();
+  return Status::success();
+}
+
+std::string CarveStream::digest() {
+  return hash_.digest();
+}
+
+Status CarveStream::writeNext() {
+  if (file_ == nullptr) {
+    if (entry_index_ == entries_.size()) {
+      // Write the tar trailer, then end the compressed frame.
+      if (archive_write_close(archive_) != ARCHIVE_OK) {
+        return write_status_.ok()
+                   ? Status::failure("Failed to close tar archive")
+                   : write_status_;
+      }
+
+      finished_ = true;
+      return compress_ ? finishCompression() : Status::success();
+    }
+
+    const auto& entry = entries_[entry_index_];
+    file_ = std::make_unique<PlatformFile>(entry.path,
+                                           PF_OPEN_EXISTING | PF_READ);
+
+    auto arch_entry = archive_entry_new();
+    archive_entry_set_pathname(arch_entry, entry.name.c_str());
+    archive_entry_set_size(arch_entry, static_cast<la_int64_t>(entry.size));
+    archive_entry_set_filetype(arch_entry, AE_IFREG);
+    archive_entry_set_perm(arch_entry, 0644);
+    auto ret = archive_write_header(archive_, arch_entry);
+    archive_entry_free(arch_entry);
+
+    if (ret != ARCHIVE_OK) {
+      return write_status_.ok()
+                 ? Status::failure("Failed to write tar header for " +
+                                   entry.name)
+                 : write_status_;
+    }
+
+    remaining_ = entry.size;
+    return Status::success();
+  }
+
+  if (remaining_ == 0U) {
+    // The tar header records the size, a file that grew cannot be archived.
+    char extra = 0;
+    if (read_data_ && file_->isValid() && file_->read(&extra, 1) > 0) {
+      return Status::failure("Carved file grew during the carve: " +
+                             entries_[entry_index_].name);
+    }
+
+    auto ret = archive_write_finish_entry(archive_);
+    file_.reset();
+    ++entry_index_;
+
+    if (ret != ARCHIVE_OK && write_status_.ok()) {
+      return Status::failure("Failed to finish tar entry");
+    }
+    return write_status_;
+  }
+
+  auto length = static_cast<std::size_t>(
+      std::min(static_cast<std::uint64_t>(block_size_), remaining_));
+
+  if (!read_data_) {
+    std::memset(input_.data(), 0, length);
+
+  } else {
+    std::size_t valid = 0U;
+    while (valid < length && file_->isValid()) {
+      auto bytes_read = file_->read(input_.data() + valid, length - valid);
+      if (bytes_read <= 0) {
+        break;
+      }
+      valid += static_cast<std::size_t>(bytes_read);
+    }
+
+    if (valid < length) {
+      return Status::failure("Carved file shrank during the carve: " +
+                             entries_[entry_index_].name);
+    }
+  }
+
+  auto written = archive_write_data(archive_, input_.data(), length);
+  if (written < 0 || static_cast<std::size_t>(written) != length) {
+    return write_status_.ok()
+               ? Status::failure("Failed to write tar data for " +
+                                 entries_[entry_index_].name)
+               : write_status_;
+  }
+
+  remaining_ -= length;
+  return Status::success();
+}
+
+Status CarveStream::append(const void* buffer, std::size_t length) {
+  if (!compress_) {
+    output_.append(static_cast<const char*>(buffer), length);
+    return Status::success();
+  }
+
+  ZSTD_inBuffer input = {buffer, length, 0};
+  while (input.pos < input.size) {
+    ZSTD_outBuffer output = {compressed_.data(), compressed_.size(), 0};
+    auto ret =
+        ZSTD_compressStream2(cstream_, &output, &input, ZSTD_e_continue);
+    if (ZSTD_isError(ret)) {
+      return Status::failure("ZSTD_compressStream2() error : " +
+                             std::string(ZSTD_getErrorName(ret)));
+    }
+
+    output_.append(compressed_.data(), output.pos);
+  }
+
+  return Status::success();
+}
+
+Status CarveStream::finishCompression() {
+  ZSTD_inBuffer input = {nullptr, 0, 0};
+  std::size_t remaining = 0U;
+  do {
+    ZSTD_outBuffer output = {compressed_.data(), compressed_.size(), 0};
+    remaining = ZSTD_compressStream2(cstream_, &output, &input, ZSTD_e_end);
+    if (ZSTD_isError(remaining)) {
+      return Status::failure("ZSTD_compressStream2() error : " +
+                             std::string(ZSTD_getErrorName(remaining)));
+    }
+
+    output_.append(compressed_.data(), output.pos);
+  } while (remaining != 0U);
+
+  return Status::success();
+}
+
+} // namespace osquery
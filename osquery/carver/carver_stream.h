@@ -0,0 +1,130 @@
+/**
+ * Copyright (c) 2014-present, The osquery authors
+ *
+ * This source code is licensed as defined by the LICENSE file found in the
+ * root directory of this source tree.
+ *
+ * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
+ */
+
+#pragma once
+
+#include <osquery/filesystem/fileops.h>
+#include <osquery/hashing/hashing.h>
+#include <osquery/utils/status/status.h>
+
+#include <boost/filesystem/path.hpp>
+#include <boost/noncopyable.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct archive;
+struct ZSTD_CCtx_s;
+
+namespace osquery {
+
+/**
+ * @brief A carve archive, produced one upload block at a time.
+ *
+ * The carved files are read block by block and framed as a tar archive,
+ * optionally compressed with zstd, without writing anything to disk. Every
+ * block returned by read() is carver_block_size bytes long, except for the
+ * last one, and is accounted for in the size and SHA-256 digest of the
+ * archive. Only a few blocks are buffered at any time.
+ *
+ * The archive only depends on the entries and the content of the files: two
+ * streams over unchanged files produce the same blocks, which allows sizing
+ * an archive before uploading it, or resuming an upload.
+ */
+class CarveStream : private boost::noncopyable {
+ public:
+  /// A file to carve, with the size recorded in the archive.
+  struct Entry final {
+    boost::filesystem::path path;
+    std::string name;
+    std::uint64_t size{0U};
+  };
+
+  /**
+   * @brief Create a stream over the given files.
+   *
+   * @param entries the files to carve, in archive order.
+   * @param block_size the size of the blocks returned by read().
+   * @param compress compress the archive with zstd.
+   * @param read_data read the content of the files. When false, the files
+   * are archived as zeros, which is enough to size an uncompressed archive.
+   * When true, reading fails if a file is not as large as its entry size.
+   */
+  CarveStream(std::vector<Entry> entries,
+              std::size_t block_size,
+              bool compress,
+              bool read_data = true);
+
+  ~CarveStream();
+
+  /// Prepare the archive and the compression stream.
+  Status open();
+
+  /**
+   * @brief Get the next block of the archive.
+   *
+   * @param block [output] the block, empty once the archive is complete.
+   */
+  Status read(std::string& block);
+
+  /// Number of bytes returned so far.
+  std::uint64_t size() const {
+    return size_;
+  }
+
+  /// The SHA-256 digest of the bytes returned so far, once complete.
+  std::string digest();
+
+ private:
+  /// Feed the archive with the next header, data block, or trailer.
+  Status writeNext();
+
+  /// Receive the tar framed archive, compressing it if needed.
+  Status append(const void* buffer, std::size_t length);
+
+  /// Flush the compression stream at the end of the archive.
+  Status finishCompression();
+
+ private:
+  std::vector<Entry> entries_;
+  std::size_t block_size_{0U};
+  bool compress_{false};
+  bool read_data_{true};
+
+  struct archive* archive_{nullptr};
+  struct ZSTD_CCtx_s* cstream_{nullptr};
+
+  /// Index of the entry being archived.
+  std::size_t entry_index_{0U};
+
+  /// The entry file being read, if its header has been written.
+  std::unique_ptr<PlatformFile> file_;
+
+  /// Bytes of the current entry left to archive.
+  std::uint64_t remaining_{0U};
+
+  /// Set once the archive trailer has been written.
+  bool finished_{false};
+
+  /// Failure reported from within the archive write callback.
+  Status write_status_;
+
+  std::vector<char> input_;
+  std::vector<char> compressed_;
+
+  /// Archive bytes produced but not yet returned.
+  std::string output_;
+
+  std::uint64_t size_{0U};
+  Hash hash_{HASH_TYPE_SHA256};
+};
+
+} // namespace osquery
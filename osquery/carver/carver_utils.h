@@ -32,6 +32,9 @@ const std::string kCarverStatusSuccess = "SUCCESS";
 /// Internal carver 'status' indicating a carve request scheduled.
 const std::string kCarverStatusScheduled = "SCHEDULED";
 
+/// Internal carver 'status' indicating a streamed carve being uploaded.
+const std::string kCarverStatusUploading = "UPLOADING";
+
 /**
  * @brief This flag is an optimization attempt used by the CarverRunner.
  *
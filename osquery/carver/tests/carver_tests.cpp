@@ -13,6 +13,7 @@
 
 #include <osquery/carver/carver.h>
 #include <osquery/carver/carver_utils.h>
+#include <osquery/core/flags.h>
 #include <osquery/core/system.h>
 #include <osquery/database/database.h>
 #include <osquery/filesystem/fileops.h>
@@ -24,6 +25,10 @@ namespace osquery {
 
 namespace fs = boost::filesystem;
 
+DECLARE_bool(carver_streaming);
+DECLARE_bool(carver_compression);
+DECLARE_uint32(carver_block_size);
+
 /// Prefix used for posix tar archive.
 const std::string kTestCarveNamePrefix = "carve_";
 
@@ -43,10 +48,45 @@ class FakeCarver : public Carver {
  private:
   friend class CarverTests;
   FRIEND_TEST(CarverTests, test_carve_files_locally);
+  FRIEND_TEST(CarverTests, test_carve_streaming);
   FRIEND_TEST(CarverTests, test_carve_start);
   FRIEND_TEST(CarverTests, test_carve_files_not_exists);
 };
 
+class FakeStreamingCarver : public Carver {
+ public:
+  FakeStreamingCarver(const std::set<std::string>& paths,
+                      const std::string& guid,
+                      const std::string& requestId)
+      : Carver(paths, guid, requestId) {}
+
+  /// Number of sessions started.
+  static size_t sessions;
+
+  /// The blocks posted, by block ID.
+  static std::map<size_t, std::string> blocks;
+
+ protected:
+  Status startCarveSession(size_t,
+                           std::uint64_t,
+                           std::string& session_id) override {
+    sessions++;
+    session_id = "session";
+    return Status::success();
+  }
+
+  Status postCarveBlock(size_t block_id,
+                        const std::string& session_id,
+                        const std::string& block) override {
+    EXPECT_EQ(session_id, "session");
+    blocks[block_id] = block;
+    return Status::success();
+  }
+};
+
+size_t FakeStreamingCarver::sessions{0};
+std::map<size_t, std::string> FakeStreamingCarver::blocks;
+
 class FakeCarverRunner : public CarverRunner<FakeCarver> {
  public:
   FakeCarverRunner() : CarverRunner() {}
@@ -103,6 +143,41 @@ class CarverTests : public testing::Test {
     fs::remove_all(working_dir_);
   }
 
+  /// Stream a new carve, returning the posted archive.
+  std::string streamCarve(std::string& guid) {
+    auto s = osquery::carvePaths(getCarvePaths(), "request-id", guid);
+    EXPECT_TRUE(s.ok());
+
+    FakeStreamingCarver::sessions = 0;
+    FakeStreamingCarver::blocks.clear();
+
+    FakeStreamingCarver carve(getCarvePaths(), guid, "request-id");
+    s = carve.carve();
+    EXPECT_TRUE(s.ok()) << s.getMessage();
+    EXPECT_EQ(FakeStreamingCarver::sessions, 1U);
+
+    std::string data;
+    for (const auto& block : FakeStreamingCarver::blocks) {
+      EXPECT_EQ(block.first * FLAGS_carver_block_size, data.size());
+      data += block.second;
+    }
+    return data;
+  }
+
+  /// Get a value of a carve database entry.
+  std::string getCarveValue(const std::string& guid, const std::string& key) {
+    std::string carve;
+    getDatabaseValue(kCarves, kCarverDBPrefix + guid, carve);
+
+    JSON tree;
+    tree.fromString(carve);
+    auto it = tree.doc().FindMember(key);
+    if (it == tree.doc().MemberEnd() || !it->value.IsString()) {
+      return "";
+    }
+    return it->value.GetString();
+  }
+
  private:
   fs::path working_dir_;
   fs::path files_to_carve_dir_;
@@ -290,4 +365,119 @@ oqADd9Ckcdtplx3k7bcLU[U04j8WWUtUccmB+4e2KS]i3x7WDKviPY/sWy9xFapv
                    (getWorkingDir() / fs::path("test.data.extract")).string()),
       hashFromFile(HashType::HASH_TYPE_SHA256, test_data_file.string()));
 }
+
+TEST_F(CarverTests, test_carve_streaming) {
+  auto streaming = FLAGS_carver_streaming;
+  auto block_size = FLAGS_carver_block_size;
+  FLAGS_carver_streaming = true;
+  FLAGS_carver_block_size = 512;
+
+  std::string guid;
+  auto data = streamCarve(guid);
+  EXPECT_EQ(getCarveValue(guid, "status"), kCarverStatusSuccess);
+  EXPECT_EQ(getCarveValue(guid, "size"), std::to_string(data.size()));
+  EXPECT_EQ(getCarveValue(guid, "sha256"),
+            hashFromBuffer(HASH_TYPE_SHA256, data.data(), data.size()));
+  EXPECT_EQ(getCarveValue(guid, "block_count"),
+            std::to_string(FakeStreamingCarver::blocks.size()));
+
+  // The archive is the one built from the carved files, without padding.
+  FakeCarver carve(getCarvePaths(), guid, "request-id");
+  ASSERT_TRUE(carve.createPaths());
+  const auto tarPath = carve.getCarveDir() / "archive.tar";
+  ASSERT_TRUE(archive(carve.carveAll(), tarPath, FLAGS_carver_block_size));
+
+  std::string tar;
+  ASSERT_TRUE(readFile(tarPath, tar).ok());
+  ASSERT_LE(data.size(), tar.size());
+  EXPECT_EQ(tar.substr(0, data.size()), data);
+  EXPECT_EQ(tar.find_first_not_of('\0', data.size()), std::string::npos);
+
+  FLAGS_carver_streaming = streaming;
+  FLAGS_carver_block_size = block_size;
+}
+
+TEST_F(CarverTests, test_carve_streaming_compression) {
+  auto streaming = FLAGS_carver_streaming;
+  auto compression = FLAGS_carver_compression;
+  auto block_size = FLAGS_carver_block_size;
+  FLAGS_carver_streaming = true;
+  FLAGS_carver_block_size = 64;
+
+  std::string guid;
+  auto tar = streamCarve(guid);
+
+  FLAGS_carver_compression = true;
+  auto data = streamCarve(guid);
+  EXPECT_EQ(getCarveValue(guid, "status"), kCarverStatusSuccess);
+  EXPECT_EQ(getCarveValue(guid, "sha256"),
+            hashFromBuffer(HASH_TYPE_SHA256, data.data(), data.size()));
+
+  const auto zstdPath = getWorkingDir() / "carve.tar.zst";
+  const auto tarPath = getWorkingDir() / "carve.tar";
+  ASSERT_TRUE(writeTextFile(zstdPath, data).ok());
+  ASSERT_TRUE(osquery::decompress(zstdPath, tarPath).ok());
+
+  std::string decompressed;
+  ASSERT_TRUE(readFile(tarPath, decompressed).ok());
+  EXPECT_EQ(decompressed, tar);
+
+  FLAGS_carver_streaming = streaming;
+  FLAGS_carver_compression = compression;
+  FLAGS_carver_block_size = block_size;
+}
+
+TEST_F(CarverTests, test_carve_streaming_resume) {
+  auto streaming = FLAGS_carver_streaming;
+  auto block_size = FLAGS_carver_block_size;
+  FLAGS_carver_streaming = true;
+  FLAGS_carver_block_size = 512;
+
+  std::string guid;
+  auto data = streamCarve(guid);
+  auto blocks = FakeStreamingCarver::blocks;
+  ASSERT_GT(blocks.size(), 3U);
+
+  // Pretend the upload was interrupted after the first 3 blocks.
+  updateCarveValue(guid, "status", kCarverStatusUploading);
+  updateCarveValue(guid, "block_id", "3");
+  updateCarveValue(guid, "sha256", "");
+
+  FakeStreamingCarver::sessions = 0;
+  FakeStreamingCarver::blocks.clear();
+  {
+    CarverRunner<FakeStreamingCarver> runner;
+    runner.start();
+    EXPECT_EQ(runner.carves(), 1U);
+  }
+
+  // The session is reused, and only the remaining blocks are posted.
+  EXPECT_EQ(FakeStreamingCarver::sessions, 0U);
+  EXPECT_EQ(FakeStreamingCarver::blocks.size(), blocks.size() - 3);
+  for (const auto& block : FakeStreamingCarver::blocks) {
+    EXPECT_EQ(block.second, blocks[block.first]);
+  }
+
+  EXPECT_EQ(FakeStreamingCarver::blocks.begin()->first, 3U);
+  EXPECT_EQ(getCarveValue(guid, "status"), kCarverStatusSuccess);
+  EXPECT_EQ(getCarveValue(guid, "sha256"),
+            hashFromBuffer(HASH_TYPE_SHA256, data.data(), data.size()));
+
+  // The upload is not resumed once the carved files have changed.
+  updateCarveValue(guid, "status", kCarverStatusUploading);
+  updateCarveValue(guid, "block_id", "3");
+  writeTextFileToCarve(getFilesToCarveDir() / "secrets.txt", "Changed.");
+
+  FakeStreamingCarver::blocks.clear();
+  {
+    CarverRunner<FakeStreamingCarver> runner;
+    runner.start();
+  }
+
+  EXPECT_TRUE(FakeStreamingCarver::blocks.empty());
+  EXPECT_EQ(getCarveValue(guid, "status"), "ARCHIVE FAILED");
+
+  FLAGS_carver_streaming = streaming;
+  FLAGS_carver_block_size = block_size;
+}
 } // namespace osquery
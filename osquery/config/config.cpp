@@ -15,6 +15,7 @@
 #include <string>
 #include <vector>
 
+#include <boost/algorithm/string/predicate.hpp>
 #include <boost/algorithm/string/replace.hpp>
 #include <boost/iterator/filter_iterator.hpp>
 
@@ -22,6 +23,7 @@
 #include <osquery/config/packs.h>
 #include <osquery/core/flagalias.h>
 #include <osquery/core/flags.h>
+#include <osquery/core/query.h>
 #include <osquery/core/shutdown.h>
 #include <osquery/core/system.h>
 #include <osquery/core/tables.h>
@@ -285,13 +287,27 @@ class ConfigRefreshRunner : public InternalRunnable {
 void restoreScheduleDenylist(std::map<std::string, uint64_t>& denylist) {
   std::string content;
   getDatabaseValue(kPersistentSettings, kFailedQueries, content);
+
+  uint64_t current_time = getUnixTime();
+  JSON doc;
+  if (!content.empty() && content.front() == '{' &&
+      doc.fromString(content).ok() && doc.doc().IsObject()) {
+    // Fill in a mapping of query name to time the denylist expires.
+    for (const auto& query : doc.doc().GetObject()) {
+      if (query.value.IsUint64() && current_time < query.value.GetUint64()) {
+        denylist[query.name.GetString()] = query.value.GetUint64();
+      }
+    }
+    return;
+  }
+
+  // Previous versions stored "name:expire" pairs.
   auto denylist_pairs = osquery::split(content, ":");
   if (denylist_pairs.size() == 0 || denylist_pairs.size() % 2 != 0) {
     // Nothing in the denylist, or malformed data.
     return;
   }
 
-  uint64_t current_time = getUnixTime();
   for (size_t i = 0; i < denylist_pairs.size() / 2; i++) {
     // Fill in a mapping of query name to time the denylist expires.
     auto expire = tryTo<long long>(denylist_pairs[(i * 2) + 1], 10).takeOr(0ll);
@@ -302,16 +318,60 @@ void restoreScheduleDenylist(std::map<std::string, uint64_t>& denylist) {
 }
 
 void saveScheduleDenylist(const std::map<std::string, uint64_t>& denylist) {
-  std::string content;
+  // Query names may contain the pack delimiter, store them as JSON keys.
+  auto doc = JSON::newObject();
   for (const auto& query : denylist) {
-    if (!content.empty()) {
-      content += ":";
-    }
-    content += query.first + ":" + std::to_string(query.second);
+    doc.add(query.first, static_cast<unsigned long long>(query.second));
+  }
+
+  std::string content;
+  if (!denylist.empty()) {
+    doc.toString(content);
   }
   setDatabaseValue(kPersistentSettings, kFailedQueries, content);
 }
 
+std::string serializeExecutingQueries(const std::vector<std::string>& names) {
+  if (names.empty()) {
+    return "";
+  }
+
+  if (names.size() == 1 && names[0].rfind('[', 0) != 0) {
+    return names[0];
+  }
+
+  auto doc = JSON::newArray();
+  for (const auto& name : names) {
+    doc.pushCopy(name);
+  }
+
+  std::string value;
+  doc.toString(value);
+  return value;
+}
+
+std::vector<std::string> parseExecutingQueries(const std::string& value) {
+  std::vector<std::string> names;
+  if (value.empty()) {
+    return names;
+  }
+
+  JSON doc;
+  if (value.front() == '[' && doc.fromString(value).ok() &&
+      doc.doc().IsArray()) {
+    for (const auto& name : doc.doc().GetArray()) {
+      if (name.IsString()) {
+        names.push_back(name.GetString());
+      }
+    }
+    return names;
+  }
+
+  // A single query name, also the format of previous versions.
+  names.push_back(value);
+  return names;
+}
+
 Schedule::Schedule() {
   if (RegistryFactory::get().external()) {
     // Extensions should not restore or save schedule details.
@@ -325,8 +385,10 @@ Schedule::Schedule() {
   if (!failed_query_.empty()) {
     LOG(WARNING) << "Scheduled query may have failed: " << failed_query_;
     setDatabaseValue(kPersistentSettings, kExecutingQuery, "");
-    // Add this query name to the denylist and save the denylist.
-    denylist_[failed_query_] = getUnixTime() + 86400;
+    // Concurrent executions are all suspects, denylist each of them.
+    for (const auto& name : parseExecutingQueries(failed_query_)) {
+      denylist_[name] = getUnixTime() + 86400;
+    }
     saveScheduleDenylist(denylist_);
   }
 }
@@ -944,6 +1006,11 @@ void Config::purge() {
       continue;
     }
 
+    // Fingerprinted rows are expired alongside their scheduled query.
+    if (boost::starts_with(saved_query, kQueryFingerprintPrefix)) {
+      continue;
+    }
+
     std::string content;
     getDatabaseValue(kPersistentSettings, "timestamp." + saved_query, content);
     if (content.empty()) {
@@ -967,6 +1034,7 @@ void Config::purge() {
 
     if (last_executed < getUnixTime() - 592200) {
       // Query has not run in the last week, expire results and interval.
+      Query::removeFingerprintRows(saved_query);
       deleteDatabaseValue(kQueries, saved_query);
       deleteDatabaseValue(kQueries, saved_query + "epoch");
       deleteDatabaseValue(kPersistentSettings, "interval." + saved_query);
@@ -981,6 +1049,7 @@ void Config::reset() {
 
   schedule_ = std::make_unique<Schedule>();
   std::map<std::string, QueryPerformance>().swap(performance_);
+  executing_queries_.clear();
   std::map<std::string, FileCategories>().swap(files_);
   std::map<std::string, std::string>().swap(hash_);
   valid_ = false;
@@ -1021,8 +1090,8 @@ void ConfigParserPlugin::reset() {
 void Config::recordQueryPerformance(const std::string& name,
                                     uint64_t delay_ms,
                                     uint64_t size,
-                                    const Row& r0,
-                                    const Row& r1) {
+                                    const ResourceUsage& r0,
+                                    const ResourceUsage& r1) {
   RecursiveLock lock(config_performance_mutex_);
   if (performance_.count(name) == 0) {
     performance_[name] = QueryPerformance();
@@ -1030,38 +1099,34 @@ void Config::recordQueryPerformance(const std::string& name,
 
   // Grab access to the non-const schedule item.
   auto& query = performance_.at(name);
-  if (!r1.at("user_time").empty() && !r0.at("user_time").empty()) {
-    auto ut1 = tryTo<long long>(r1.at("user_time"));
-    auto ut0 = tryTo<long long>(r0.at("user_time"));
-    auto diff = (ut1 && ut0) ? ut1.take() - ut0.take() : 0;
-    if (diff > 0) {
-      query.user_time += diff;
-      query.last_user_time = diff;
-    }
+  uint64_t cpu_time = 0;
+  if (r1.user_time > r0.user_time) {
+    auto diff = r1.user_time - r0.user_time;
+    query.user_time += diff;
+    query.last_user_time = diff;
+    cpu_time += diff;
   }
 
-  if (!r1.at("system_time").empty() && !r0.at("system_time").empty()) {
-    auto st1 = tryTo<long long>(r1.at("system_time"));
-    auto st0 = tryTo<long long>(r0.at("system_time"));
-    auto diff = (st1 && st0) ? st1.take() - st0.take() : 0;
-    if (diff > 0) {
-      query.system_time += diff;
-      query.last_system_time = diff;
-    }
+  if (r1.system_time > r0.system_time) {
+    auto diff = r1.system_time - r0.system_time;
+    query.system_time += diff;
+    query.last_system_time = diff;
+    cpu_time += diff;
   }
 
-  if (!r1.at("resident_size").empty() && !r0.at("resident_size").empty()) {
-    auto rs1 = tryTo<long long>(r1.at("resident_size"));
-    auto rs0 = tryTo<long long>(r0.at("resident_size"));
-    auto diff = (rs1 && rs0) ? rs1.take() - rs0.take() : 0;
-    if (diff > 0) {
-      // Memory is stored as an average of RSS changes between query executions.
-      query.average_memory = (query.average_memory * query.executions) + diff;
-      query.average_memory = (query.average_memory / (query.executions + 1));
-      query.last_memory = diff;
-    }
+  if (r0.resident_size > 0 && r1.resident_size > r0.resident_size) {
+    auto diff = r1.resident_size - r0.resident_size;
+    // Memory is stored as an average of RSS changes between query executions.
+    query.average_memory = (query.average_memory * query.executions) + diff;
+    query.average_memory = (query.average_memory / (query.executions + 1));
+    query.last_memory = diff;
+    query.memory_histogram.record(diff);
+  } else {
+    query.memory_histogram.record(0);
   }
 
+  query.wall_time_histogram.record(delay_ms);
+  query.cpu_time_histogram.record(cpu_time);
   query.last_wall_time_ms = delay_ms;
   query.wall_time_ms += delay_ms;
   query.wall_time += (delay_ms / 1000);
@@ -1073,13 +1138,26 @@ void Config::recordQueryPerformance(const std::string& name,
      This is used by the next worker execution to denylist a query
      that triggered a watchdog resource limit. */
   if (!Initializer::isResourceLimitHit()) {
-    setDatabaseValue(kPersistentSettings, kExecutingQuery, "");
+    auto it = std::find(
+        executing_queries_.begin(), executing_queries_.end(), name);
+    if (it != executing_queries_.end()) {
+      executing_queries_.erase(it);
+    }
+    setDatabaseValue(kPersistentSettings,
+                     kExecutingQuery,
+                     serializeExecutingQueries(executing_queries_));
   }
 }
 
 void Config::recordQueryStart(const std::string& name) {
-  // There should only ever be a single executing query in the schedule.
-  setDatabaseValue(kPersistentSettings, kExecutingQuery, name);
+  {
+    // Scheduler workers may execute several queries at once, record them all.
+    RecursiveLock lock(config_performance_mutex_);
+    executing_queries_.push_back(name);
+    setDatabaseValue(kPersistentSettings,
+                     kExecutingQuery,
+                     serializeExecutingQueries(executing_queries_));
+  }
   // Store the time this query name last executed for later results eviction.
   // When configuration updates occur the previous schedule is searched for
   // 'stale' query names, aka those that have week-old or longer last execute
@@ -34,6 +34,17 @@ class ConfigRefreshRunner;
 /// The name of the executing query within the single-threaded schedule.
 extern const std::string kExecutingQuery;
 
+/**
+ * @brief Serialize the names of the executing queries.
+ *
+ * A single name is stored as is, several names are stored as a JSON array
+ * since a query name may contain any separator.
+ */
+std::string serializeExecutingQueries(const std::vector<std::string>& names);
+
+/// Parse the names of the executing queries stored by the schedule.
+std::vector<std::string> parseExecutingQueries(const std::string& value);
+
 /**
  * @brief The programmatic representation of osquery's configuration
  *
@@ -87,14 +98,14 @@ class Config : private boost::noncopyable {
    * @param name The unique name of the scheduled item
    * @param delay_ms Number of milliseconds (wall time) taken by the query
    * @param size Number of characters generated by query
-   * @param r0 the process row before the query
-   * @param r1 the process row after the query
+   * @param r0 the resource usage before the query
+   * @param r1 the resource usage after the query
    */
   void recordQueryPerformance(const std::string& name,
                               uint64_t delay_ms,
                               uint64_t size,
-                              const Row& r0,
-                              const Row& r1);
+                              const ResourceUsage& r0,
+                              const ResourceUsage& r1);
 
   /**
    * @brief Record a query 'initialization', meaning the query will run.
@@ -104,6 +115,7 @@ class Config : private boost::noncopyable {
    * status set by this method. This status is saved in the backing database
    * store. On process start, or worker state, if any dirty bit is set then
    * it is assumed that the current start is a result of a previous abort.
+   * Every query executing concurrently is recorded.
    *
    * @param name THe unique name of the scheduled item
    */
@@ -334,6 +346,9 @@ class Config : private boost::noncopyable {
   /// A set of performance stats for each query in the schedule.
   std::map<std::string, QueryPerformance> performance_;
 
+  /// Names of the scheduled queries currently executing, in start order.
+  std::vector<std::string> executing_queries_;
+
   /// A set of named categories filled with filesystem globbing paths.
   using FileCategories = std::map<std::string, std::vector<std::string>>;
   std::map<std::string, FileCategories> files_;
@@ -356,6 +356,31 @@ TEST_F(ConfigTests, test_schedule_denylist) {
   EXPECT_EQ(denylist.size(), 1U);
 }
 
+TEST_F(ConfigTests, test_schedule_denylist_executing) {
+  std::map<std::string, uint64_t> denylist;
+  saveScheduleDenylist(denylist);
+
+  // Queries executing concurrently are all recorded.
+  get().recordQueryStart("pack:executing_1");
+  std::string content;
+  getDatabaseValue(kPersistentSettings, kExecutingQuery, content);
+  EXPECT_EQ(content, "pack:executing_1");
+
+  get().recordQueryStart("pack:executing_2");
+  getDatabaseValue(kPersistentSettings, kExecutingQuery, content);
+  EXPECT_EQ(content, "[\"pack:executing_1\",\"pack:executing_2\"]");
+
+  // If the tool stops while they execute, each one is denylisted.
+  get().reset();
+  restoreScheduleDenylist(denylist);
+  EXPECT_EQ(denylist.size(), 2U);
+  EXPECT_EQ(denylist.count("pack:executing_1"), 1U);
+  EXPECT_EQ(denylist.count("pack:executing_2"), 1U);
+
+  denylist.clear();
+  saveScheduleDenylist(denylist);
+}
+
 TEST_F(ConfigTests, test_pack_noninline) {
   auto& rf = RegistryFactory::get();
   rf.registry("config")->add("test", std::make_shared<TestConfigPlugin>());
@@ -0,0 +1,32 @@
+/**
+ * Copyright (c) 2014-present, The osquery authors
+ *
+ * This source code is licensed as defined by the LICENSE file found in the
+ * root directory of this source tree.
+ *
+ * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
+ */
+
+#include <osquery/core/column_sources.h>
+
+namespace osquery {
+
+ColumnSources::ColumnSources(
+    std::initializer_list<std::pair<Source, std::vector<std::string>>> sources)
+    : sources_(sources) {}
+
+ColumnSourceSet ColumnSources::used(const QueryContext& context) const {
+  ColumnSourceSet used;
+  for (const auto& source : sources_) {
+    for (const auto& column : source.second) {
+      if (context.isColumnUsed(column)) {
+        used.set(source.first);
+        break;
+      }
+    }
+  }
+
+  return used;
+}
+
+} // namespace osquery
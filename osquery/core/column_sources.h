@@ -0,0 +1,59 @@
+/**
+ * Copyright (c) 2014-present, The osquery authors
+ *
+ * This source code is licensed as defined by the LICENSE file found in the
+ * root directory of this source tree.
+ *
+ * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
+ */
+
+#pragma once
+
+#include <bitset>
+#include <initializer_list>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <osquery/core/tables.h>
+
+namespace osquery {
+
+/// The maximum number of sources a table may declare.
+constexpr size_t kMaxColumnSources{32};
+
+/// A set of sources, indexed by a table-defined enumeration.
+using ColumnSourceSet = std::bitset<kMaxColumnSources>;
+
+/**
+ * @brief A declaration of the sources filling a table's columns.
+ *
+ * Tables generating each row from several sources, such as /proc or sysfs
+ * files, declare the columns filled by every source. Before generating, the
+ * table asks for the sources used by the query and skips reading the others,
+ * the columns of a skipped source are left empty.
+ *
+ * Sources a row cannot be generated without are not declared, they are
+ * always read.
+ */
+class ColumnSources {
+ public:
+  using Source = size_t;
+
+  ColumnSources(
+      std::initializer_list<std::pair<Source, std::vector<std::string>>>
+          sources);
+
+  /**
+   * @brief Return the sources filling at least one column used by a query.
+   *
+   * Every declared source is returned when the used columns are not known.
+   */
+  ColumnSourceSet used(const QueryContext& context) const;
+
+ private:
+  /// The columns filled by each source.
+  std::vector<std::pair<Source, std::vector<std::string>>> sources_;
+};
+
+} // namespace osquery
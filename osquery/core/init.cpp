@@ -578,7 +578,7 @@ void Initializer::start() const {
     }
 
     // Ensure the database results version is up to date before proceeding
-    if (!upgradeDatabase()) {
+    if (!upgradeDatabase(requiredDatabaseVersion())) {
       auto retcode = (isWorker()) ? EXIT_CATASTROPHIC : EXIT_FAILURE;
       requestShutdown(retcode, "Failed to upgrade database");
       return;
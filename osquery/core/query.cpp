@@ -9,14 +9,17 @@
 
 #include <algorithm>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include <osquery/core/flagalias.h>
 #include <osquery/core/flags.h>
 #include <osquery/core/query.h>
 #include <osquery/database/database.h>
+#include <osquery/hashing/hashing.h>
 #include <osquery/logger/logger.h>
 
+#include <osquery/utils/conversions/tryto.h>
 #include <osquery/utils/json/json.h>
 
 namespace rj = rapidjson;
@@ -32,6 +35,84 @@ FLAG(bool,
      "Use numeric JSON syntax for numeric values");
 FLAG_ALIAS(bool, log_numerics_as_numbers, logger_numerics);
 
+/// Store scheduled query results as per-row fingerprints
+FLAG(bool,
+     schedule_differential_fingerprints,
+     false,
+     "Calculate scheduled query differentials using row fingerprints");
+
+const std::string kQueryFingerprintPrefix{"fingerprint."};
+
+namespace {
+
+/// Header identifying a stored result set as a fingerprint index.
+const std::string kFingerprintIndexHeader{"#fingerprints\n"};
+
+/// Map of row fingerprints to the number of identical rows.
+using RowFingerprints = std::unordered_map<std::string, size_t>;
+
+inline bool isFingerprintIndex(const std::string& raw) {
+  return raw.compare(
+             0, kFingerprintIndexHeader.size(), kFingerprintIndexHeader) == 0;
+}
+
+inline std::string getFingerprintKey(const std::string& name,
+                                     const std::string& fingerprint) {
+  return kQueryFingerprintPrefix + name + "." + fingerprint;
+}
+
+/// Fingerprint a row using its numeric JSON form, which preserves types.
+Status getRowFingerprint(const RowTyped& row,
+                         std::string& json,
+                         std::string& fingerprint) {
+  auto status = serializeRowJSON(row, json, true);
+  if (!status.ok()) {
+    return status;
+  }
+
+  // A 128-bit digest is used, collisions between rows are not expected.
+  fingerprint = hashFromBuffer(HASH_TYPE_MD5, json.data(), json.size());
+  return Status::success();
+}
+
+std::string serializeFingerprintIndex(const RowFingerprints& index) {
+  std::string raw = kFingerprintIndexHeader;
+  raw.reserve(raw.size() + index.size() * 40);
+  for (const auto& fingerprint : index) {
+    raw += fingerprint.first;
+    raw += ' ';
+    raw += std::to_string(fingerprint.second);
+    raw += '\n';
+  }
+  return raw;
+}
+
+Status deserializeFingerprintIndex(const std::string& raw,
+                                   RowFingerprints& index) {
+  auto pos = kFingerprintIndexHeader.size();
+  while (pos < raw.size()) {
+    auto end = raw.find('\n', pos);
+    if (end == std::string::npos) {
+      end = raw.size();
+    }
+
+    auto sep = raw.find(' ', pos);
+    if (sep == std::string::npos || sep > end) {
+      return Status::failure("Malformed fingerprint index");
+    }
+
+    auto count = tryTo<std::size_t>(raw.substr(sep + 1, end - sep - 1));
+    if (count.isError()) {
+      return Status::failure("Malformed fingerprint index count");
+    }
+    index[raw.substr(pos, sep - pos)] += count.get();
+    pos = end + 1;
+  }
+  return Status::success();
+}
+
+} // namespace
+
 uint64_t Query::getPreviousEpoch() const {
   uint64_t epoch = 0;
   std::string raw;
@@ -63,13 +144,63 @@ Status Query::getPreviousQueryResults(QueryDataSet& results) const {
     return status;
   }
 
-  status = deserializeQueryDataJSON(raw, results);
+  if (!isFingerprintIndex(raw)) {
+    return deserializeQueryDataJSON(raw, results);
+  }
+
+  // The results were stored as fingerprints, expand each stored row.
+  RowFingerprints index;
+  status = deserializeFingerprintIndex(raw, index);
   if (!status.ok()) {
     return status;
   }
+
+  for (const auto& fingerprint : index) {
+    std::string json;
+    status = getDatabaseValue(
+        kQueries, getFingerprintKey(name_, fingerprint.first), json);
+    if (!status.ok()) {
+      return status;
+    }
+
+    RowTyped row;
+    status = deserializeRowJSON(json, row);
+    if (!status.ok()) {
+      return status;
+    }
+
+    for (size_t i = 1; i < fingerprint.second; i++) {
+      results.insert(row);
+    }
+    results.insert(std::move(row));
+  }
   return Status::success();
 }
 
+Status Query::removeFingerprintRows(const std::string& name) {
+  // Check the small marker key before reading a potentially large result set.
+  std::string marker;
+  if (!getDatabaseValue(kQueries, kQueryFingerprintPrefix + name, marker)
+           .ok()) {
+    return Status::success();
+  }
+
+  std::string raw;
+  auto status = getDatabaseValue(kQueries, name, raw);
+  if (status.ok() && isFingerprintIndex(raw)) {
+    RowFingerprints index;
+    status = deserializeFingerprintIndex(raw, index);
+    if (!status.ok()) {
+      return status;
+    }
+
+    for (const auto& fingerprint : index) {
+      deleteDatabaseValue(kQueries, getFingerprintKey(name, fingerprint.first));
+    }
+  }
+  return deleteDatabaseValue(kQueries, kQueryFingerprintPrefix + name);
+}
+
 std::vector<std::string> Query::getStoredQueryNames() {
   std::vector<std::string> results;
   scanDatabaseKeys(kQueries, results);
@@ -77,8 +208,8 @@ std::vector<std::string> Query::getStoredQueryNames() {
 }
 
 bool Query::isQueryNameInDatabase() const {
-  auto names = Query::getStoredQueryNames();
-  return std::find(names.begin(), names.end(), name_) != names.end();
+  std::string raw;
+  return getDatabaseValue(kQueries, name_, raw).ok();
 }
 
 static inline void saveQuery(const std::string& name,
@@ -140,6 +271,129 @@ Status Query::addNewEvents(QueryDataTyped current_qd,
   return Status::success();
 }
 
+Status Query::addFingerprintResults(QueryDataTyped& current_qd,
+                                    bool calculate_diff,
+                                    DiffResults& dr,
+                                    bool& update_db) const {
+  // The previous index is always read, rows it references may become stale.
+  RowFingerprints previous;
+  bool rows_stored = false;
+
+  // Rows from results stored as JSON, before fingerprints were enabled.
+  std::unordered_map<std::string, RowTyped> legacy_rows;
+
+  std::string raw;
+  if (getDatabaseValue(kQueries, name_, raw).ok()) {
+    if (isFingerprintIndex(raw)) {
+      auto status = deserializeFingerprintIndex(raw, previous);
+      if (!status.ok()) {
+        return status;
+      }
+      rows_stored = true;
+    } else if (calculate_diff) {
+      QueryDataSet previous_qd;
+      auto status = deserializeQueryDataJSON(raw, previous_qd);
+      if (!status.ok()) {
+        return status;
+      }
+
+      for (const auto& row : previous_qd) {
+        std::string json;
+        std::string fingerprint;
+        status = getRowFingerprint(row, json, fingerprint);
+        if (!status.ok()) {
+          return status;
+        }
+        previous[fingerprint]++;
+        legacy_rows.emplace(fingerprint, row);
+      }
+    }
+  }
+
+  // Match each current row against the previous rows with equal fingerprints.
+  RowFingerprints current;
+  auto remaining = previous;
+  DatabaseStringValueList new_rows;
+  for (auto& row : current_qd) {
+    std::string json;
+    std::string fingerprint;
+    auto status = getRowFingerprint(row, json, fingerprint);
+    if (!status.ok()) {
+      return status;
+    }
+
+    if (current[fingerprint]++ == 0 &&
+        (!rows_stored || previous.count(fingerprint) == 0)) {
+      new_rows.emplace_back(getFingerprintKey(name_, fingerprint),
+                            std::move(json));
+    }
+
+    auto match = remaining.find(fingerprint);
+    if (calculate_diff && match != remaining.end() && match->second > 0) {
+      match->second--;
+    } else {
+      dr.added.push_back(std::move(row));
+    }
+  }
+
+  // Unmatched previous rows are removed, read them before deleting keys.
+  std::vector<std::string> stale_keys;
+  for (const auto& fingerprint : previous) {
+    if (rows_stored && current.count(fingerprint.first) == 0) {
+      stale_keys.push_back(getFingerprintKey(name_, fingerprint.first));
+    }
+
+    auto left = remaining[fingerprint.first];
+    if (!calculate_diff || left == 0) {
+      continue;
+    }
+
+    RowTyped row;
+    auto legacy_row = legacy_rows.find(fingerprint.first);
+    if (legacy_row != legacy_rows.end()) {
+      row = std::move(legacy_row->second);
+    } else {
+      std::string json;
+      auto status = getDatabaseValue(
+          kQueries, getFingerprintKey(name_, fingerprint.first), json);
+      if (!status.ok()) {
+        return status;
+      }
+
+      status = deserializeRowJSON(json, row);
+      if (!status.ok()) {
+        return status;
+      }
+    }
+    dr.removed.insert(dr.removed.end(), left, row);
+  }
+
+  update_db = !calculate_diff || !dr.added.empty() || !dr.removed.empty();
+  if (!update_db) {
+    return Status::success();
+  }
+
+  // Write new rows before the index so the index never references missing
+  // rows, then delete the rows no longer referenced. The marker key lets
+  // removeFingerprintRows skip reading results stored as JSON.
+  new_rows.emplace_back(kQueryFingerprintPrefix + name_, "1");
+  auto status = setDatabaseBatch(kQueries, new_rows);
+  if (!status.ok()) {
+    return status;
+  }
+
+  status =
+      setDatabaseValue(kQueries, name_, serializeFingerprintIndex(current));
+  if (!status.ok()) {
+    return status;
+  }
+
+  for (const auto& key : stale_keys) {
+    deleteDatabaseValue(kQueries, key);
+  }
+  return Status::success();
+}
+
 Status Query::addNewResults(QueryDataTyped qd,
                             const uint64_t epoch,
                             uint64_t& counter) const {
@@ -162,7 +416,15 @@ Status Query::addNewResults(QueryDataTyped current_qd,
   // query data, otherwise the content is moved to the differential's added set.
   const auto* target_gd = &current_qd;
   bool update_db = true;
-  if (!fresh_results && calculate_diff) {
+  if (FLAGS_schedule_differential_fingerprints) {
+    // Only the changed rows and the fingerprint index are written.
+    auto status = addFingerprintResults(
+        current_qd, !fresh_results && calculate_diff, dr, update_db);
+    if (!status.ok()) {
+      return status;
+    }
+    target_gd = nullptr;
+  } else if (!fresh_results && calculate_diff) {
     // Get the rows from the last run of this query name.
     QueryDataSet previous_qd;
     auto status = getPreviousQueryResults(previous_qd);
@@ -180,19 +442,24 @@ Status Query::addNewResults(QueryDataTyped current_qd,
   }
 
   if (update_db) {
-    // Replace the "previous" query data with the current.
-    std::string json;
-    auto status = serializeQueryDataJSON(*target_gd, json, true);
-    if (!status.ok()) {
-      return status;
-    }
+    if (target_gd != nullptr) {
+      // Replace the "previous" query data with the current.
+      std::string json;
+      auto status = serializeQueryDataJSON(*target_gd, json, true);
+      if (!status.ok()) {
+        return status;
+      }
 
-    status = setDatabaseValue(kQueries, name_, json);
-    if (!status.ok()) {
-      return status;
+      // Results may have been stored as fingerprints before.
+      removeFingerprintRows(name_);
+
+      status = setDatabaseValue(kQueries, name_, json);
+      if (!status.ok()) {
+        return status;
+      }
     }
 
-    status = setDatabaseValue(
+    auto status = setDatabaseValue(
         kQueries, name_ + "epoch", std::to_string(current_epoch));
     if (!status.ok()) {
       return status;
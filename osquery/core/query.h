@@ -26,6 +26,9 @@ namespace osquery {
 
 class Status;
 
+/// Key prefix for result rows stored by the fingerprint differential.
+extern const std::string kQueryFingerprintPrefix;
+
 /**
  * @brief Query results from a schedule, snapshot, or ad-hoc execution.
  *
@@ -145,6 +148,19 @@ class Query {
    */
   Status getPreviousQueryResults(QueryDataSet& results) const;
 
+  /**
+   * @brief Remove the rows stored by a fingerprint differential.
+   *
+   * When results are stored as row fingerprints each distinct row is kept
+   * under its own key. This removes those keys, the fingerprint index itself
+   * is left for the caller to remove.
+   *
+   * @param name The scheduled query name.
+   *
+   * @return the success or failure of the operation.
+   */
+  static Status removeFingerprintRows(const std::string& name);
+
   /**
    * @brief Get the epoch associated with the previous query results.
    *
@@ -262,6 +278,24 @@ class Query {
   /// The scheduled query name.
   std::string name_;
 
+ private:
+  /**
+   * @brief Calculate a differential using per-row fingerprints.
+   *
+   * Rows are fingerprinted and compared against the fingerprint index stored
+   * for this query. Only rows that were added or removed are written to, or
+   * deleted from, the backing store.
+   *
+   * @param current_qd the current query results.
+   * @param calculate_diff populate dr.removed and only report added rows.
+   * @param dr [output] the differential results.
+   * @param update_db [output] true if the stored results changed.
+   */
+  Status addFingerprintResults(QueryDataTyped& current_qd,
+                               bool calculate_diff,
+                               DiffResults& dr,
+                               bool& update_db) const;
+
  private:
   FRIEND_TEST(QueryTests, test_private_members);
   FRIEND_TEST(QueryTests, test_add_and_get_current_results);
@@ -270,6 +304,7 @@ class Query {
   FRIEND_TEST(QueryTests, test_get_executions);
   FRIEND_TEST(QueryTests, test_get_query_results);
   FRIEND_TEST(QueryTests, test_query_name_not_found_in_db);
+  FRIEND_TEST(QueryTests, test_fingerprint_results);
 };
 
 } // namespace osquery
@@ -8,3 +8,36 @@
  */
 
 #include "query_performance.h"
+
+namespace osquery {
+
+void PerformanceHistogram::record(std::uint64_t value) {
+  std::size_t bucket = 0;
+  while (value > 0 && bucket < kBuckets - 1) {
+    value >>= 1;
+    bucket++;
+  }
+  buckets_[bucket]++;
+  samples_++;
+}
+
+std::uint64_t PerformanceHistogram::percentile(double percentile) const {
+  if (samples_ == 0) {
+    return 0;
+  }
+
+  // The rank of the sample at the requested percentile, counting from 1.
+  auto rank = static_cast<std::uint64_t>(percentile / 100 * samples_);
+  rank = (rank == 0) ? 1 : rank;
+
+  std::uint64_t seen = 0;
+  for (std::size_t bucket = 0; bucket < kBuckets; ++bucket) {
+    seen += buckets_[bucket];
+    if (seen >= rank) {
+      return (bucket == 0) ? 0 : (std::uint64_t{1} << bucket) - 1;
+    }
+  }
+  return (std::uint64_t{1} << (kBuckets - 1)) - 1;
+}
+
+} // namespace osquery
@@ -9,11 +9,57 @@
 
 #pragma once
 
+#include <array>
 #include <cstddef>
 #include <cstdint>
 
 namespace osquery {
 
+/**
+ * @brief A snapshot of the CPU time and memory used by the daemon.
+ *
+ * Snapshots are taken before and after each scheduled query execution.
+ * CPU times are measured for the calling thread where the platform allows.
+ */
+struct ResourceUsage {
+  /// User time in milliseconds
+  std::uint64_t user_time{0};
+
+  /// System time in milliseconds
+  std::uint64_t system_time{0};
+
+  /// Resident memory of the process in bytes, 0 if unavailable
+  std::uint64_t resident_size{0};
+};
+
+/**
+ * @brief Sample counts in power-of-two buckets.
+ *
+ * The bucket for a value is its bit width, so percentiles are estimated to
+ * within a factor of two while the histogram stays a fixed size.
+ */
+class PerformanceHistogram {
+ public:
+  /// Add a sample.
+  void record(std::uint64_t value);
+
+  /**
+   * @brief Estimate a percentile of the recorded samples.
+   *
+   * @param percentile A value between 0 and 100.
+   * @return The upper bound of the bucket containing the percentile.
+   */
+  std::uint64_t percentile(double percentile) const;
+
+ private:
+  /// Values up to 2^47 are bucketed separately, larger values share a bucket.
+  static constexpr std::size_t kBuckets = 48;
+
+  std::array<std::uint64_t, kBuckets> buckets_{};
+
+  std::uint64_t samples_{0};
+};
+
 /**
  * @brief performance statistics about a query
  */
@@ -55,6 +101,15 @@ struct QueryPerformance {
 
   /// Total bytes for the query
   std::uint64_t output_size{0};
+
+  /// Wall time in milliseconds of each execution
+  PerformanceHistogram wall_time_histogram;
+
+  /// User and system time in milliseconds of each execution
+  PerformanceHistogram cpu_time_histogram;
+
+  /// Resident memory in bytes left allocated after each execution
+  PerformanceHistogram memory_histogram;
 };
 
 } // namespace osquery
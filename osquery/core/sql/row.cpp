@@ -92,6 +92,24 @@ Status serializeRowJSON(const Row& r, std::string& json) {
   return doc.toString(json);
 }
 
+Status serializeRowJSON(const std::vector<RowColumnView>& columns,
+                        std::string& json) {
+  rj::StringBuffer sb;
+  rj::Writer<rj::StringBuffer> writer(sb);
+
+  writer.StartObject();
+  for (const auto& column : columns) {
+    writer.Key(column.first.data(),
+               static_cast<rj::SizeType>(column.first.size()));
+    writer.String(column.second.data(),
+                  static_cast<rj::SizeType>(column.second.size()));
+  }
+  writer.EndObject();
+
+  json.assign(sb.GetString(), sb.GetSize());
+  return Status::success();
+}
+
 Status deserializeRow(const rj::Value& doc, Row& r) {
   if (!doc.IsObject()) {
     return Status(1);
@@ -11,6 +11,8 @@
 
 #include <map>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 
 #include <boost/lexical_cast.hpp>
@@ -47,6 +49,13 @@ using Row = std::map<std::string, RowData>;
  */
 using RowTyped = std::map<std::string, RowDataTyped>;
 
+/**
+ * @brief A column name and value, referring to storage owned elsewhere.
+ *
+ * Used to serialize rows that are not held in a Row.
+ */
+using RowColumnView = std::pair<std::string_view, std::string_view>;
+
 /**
  * @brief A vector of column names associated with a query
  *
@@ -94,6 +103,20 @@ Status serializeRow(const RowTyped& r,
  */
 Status serializeRowJSON(const Row& r, std::string& json);
 
+/**
+ * @brief Serialize a list of columns into a JSON string.
+ *
+ * The output matches the one of a Row holding the same columns when the
+ * columns are sorted by name.
+ *
+ * @param columns the columns to serialize.
+ * @param json [output] the output JSON string.
+ *
+ * @return Status indicating the success or failure of the operation.
+ */
+Status serializeRowJSON(const std::vector<RowColumnView>& columns,
+                        std::string& json);
+
 /**
  * @brief Serialize a RowTyped object into a JSON string.
  *
@@ -0,0 +1,227 @@
+/**
+ * Copyright (c) 2014-present, The osquery authors
+ *
+ * This source code is licensed as defined by the LICENSE file found in the
+ * root directory of this source tree.
+ *
+ * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
+ */
+
+#include <iterator>
+
+#include "row_binary.h"
+
+namespace osquery {
+
+namespace {
+
+void writeVarint(std::uint64_t value, std::string& out) {
+  while (value >= 0x80) {
+    out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+    value >>= 7;
+  }
+
+  out.push_back(static_cast<char>(value));
+}
+
+bool readVarint(const std::string& in,
+                std::size_t& offset,
+                std::size_t& value) {
+  std::uint64_t result{0};
+  for (unsigned shift = 0; shift < 64 && offset < in.size(); shift += 7) {
+    auto byte = static_cast<unsigned char>(in[offset++]);
+    result |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+    if ((byte & 0x80) == 0) {
+      value = static_cast<std::size_t>(result);
+      return true;
+    }
+  }
+
+  return false;
+}
+
+bool readString(const std::string& in,
+                std::size_t& offset,
+                const char*& data,
+                std::size_t& size) {
+  if (!readVarint(in, offset, size) || size > in.size() - offset) {
+    return false;
+  }
+
+  data = in.data() + offset;
+  offset += size;
+  return true;
+}
+
+/// Dictionary lookups need a std::string key.
+const std::string& columnName(const std::string& name) {
+  return name;
+}
+
+std::string columnName(std::string_view name) {
+  return std::string(name);
+}
+
+template <typename Columns>
+void writeRowBinary(const Columns& columns,
+                    const std::vector<std::size_t>& indexes,
+                    std::string& out) {
+  std::size_t size{1 + 10};
+  for (const auto& column : columns) {
+    size += column.second.size() + 10;
+  }
+
+  out.clear();
+  out.reserve(size);
+  out.push_back(kBinaryRowVersion);
+  writeVarint(columns.size(), out);
+
+  auto index = indexes.begin();
+  for (const auto& column : columns) {
+    writeVarint(*index++, out);
+    writeVarint(column.second.size(), out);
+    out.append(column.second.data(), column.second.size());
+  }
+}
+
+} // namespace
+
+std::size_t RowColumnDictionary::size() const {
+  ReadLock lock(mutex_);
+  return columns_.size();
+}
+
+std::size_t RowColumnDictionary::serialize(std::string& out) const {
+  ReadLock lock(mutex_);
+
+  out.clear();
+  out.push_back(kBinaryRowVersion);
+  writeVarint(columns_.size(), out);
+  for (const auto& column : columns_) {
+    writeVarint(column.size(), out);
+    out.append(column);
+  }
+
+  return columns_.size();
+}
+
+Status RowColumnDictionary::deserialize(const std::string& in) {
+  if (!isBinaryRow(in)) {
+    return Status::failure("Unknown column dictionary version");
+  }
+
+  std::size_t offset{1};
+  std::size_t count{0};
+  if (!readVarint(in, offset, count) || count > in.size()) {
+    return Status::failure("Invalid column dictionary");
+  }
+
+  std::vector<std::string> columns;
+  std::unordered_map<std::string, std::size_t> indexes;
+  columns.reserve(count);
+  for (std::size_t i = 0; i < count; i++) {
+    const char* data{nullptr};
+    std::size_t size{0};
+    if (!readString(in, offset, data, size)) {
+      return Status::failure("Invalid column dictionary");
+    }
+
+    columns.emplace_back(data, size);
+    indexes.emplace(columns.back(), i);
+  }
+
+  WriteLock lock(mutex_);
+  columns_ = std::move(columns);
+  indexes_ = std::move(indexes);
+  return Status::success();
+}
+
+template <typename Columns>
+void RowColumnDictionary::indexes(const Columns& columns,
+                                  std::vector<std::size_t>& indexes) {
+  indexes.clear();
+  indexes.reserve(columns.size());
+
+  {
+    ReadLock lock(mutex_);
+    for (const auto& column : columns) {
+      auto it = indexes_.find(columnName(column.first));
+      if (it == indexes_.end()) {
+        break;
+      }
+      indexes.push_back(it->second);
+    }
+  }
+
+  if (indexes.size() == columns.size()) {
+    return;
+  }
+
+  // At least one column is new, finish the lookup while holding the writer.
+  WriteLock lock(mutex_);
+  auto column = std::next(columns.begin(), indexes.size());
+  for (; column != columns.end(); ++column) {
+    auto name = columnName(column->first);
+    auto it = indexes_.find(name);
+    if (it == indexes_.end()) {
+      it = indexes_.emplace(name, columns_.size()).first;
+      columns_.push_back(name);
+    }
+    indexes.push_back(it->second);
+  }
+}
+
+Status serializeRowBinary(const Row& r,
+                          RowColumnDictionary& dictionary,
+                          std::string& out) {
+  std::vector<std::size_t> indexes;
+  dictionary.indexes(r, indexes);
+
+  writeRowBinary(r, indexes, out);
+  return Status::success();
+}
+
+Status serializeRowBinary(const std::vector<RowColumnView>& columns,
+                          RowColumnDictionary& dictionary,
+                          std::string& out) {
+  std::vector<std::size_t> indexes;
+  dictionary.indexes(columns, indexes);
+
+  writeRowBinary(columns, indexes, out);
+  return Status::success();
+}
+
+Status deserializeRowBinary(const std::string& in,
+                            const RowColumnDictionary& dictionary,
+                            Row& r) {
+  if (!isBinaryRow(in)) {
+    return Status::failure("Unknown binary row version");
+  }
+
+  std::size_t offset{1};
+  std::size_t count{0};
+  if (!readVarint(in, offset, count)) {
+    return Status::failure("Invalid binary row");
+  }
+
+  ReadLock lock(dictionary.mutex_);
+  for (std::size_t i = 0; i < count; i++) {
+    std::size_t index{0};
+    const char* data{nullptr};
+    std::size_t size{0};
+    if (!readVarint(in, offset, index) || !readString(in, offset, data, size)) {
+      return Status::failure("Invalid binary row");
+    }
+
+    if (index >= dictionary.columns_.size()) {
+      return Status::failure("Unknown column in binary row");
+    }
+
+    // Columns are encoded in the order of the Row map.
+    r.emplace_hint(r.end(), dictionary.columns_[index], RowData(data, size));
+  }
+
+  return Status::success();
+}
+
+} // namespace osquery
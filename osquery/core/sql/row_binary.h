@@ -0,0 +1,125 @@
+/**
+ * Copyright (c) 2014-present, The osquery authors
+ *
+ * This source code is licensed as defined by the LICENSE file found in the
+ * root directory of this source tree.
+ *
+ * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
+ */
+
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <osquery/core/sql/row.h>
+#include <osquery/utils/mutex.h>
+#include <osquery/utils/status/status.h>
+
+namespace osquery {
+
+/// Leading byte and version of binary encoded rows and column dictionaries.
+constexpr char kBinaryRowVersion{'\x01'};
+
+/**
+ * @brief An append-only dictionary of column names.
+ *
+ * Binary encoded rows refer to their columns by dictionary index, so the
+ * dictionary must be stored along with the rows it was used to encode.
+ * Indexes are never removed or reused. The dictionary may be shared between
+ * threads encoding and decoding rows.
+ */
+class RowColumnDictionary final {
+ public:
+  /// Number of known columns.
+  std::size_t size() const;
+
+  /**
+   * @brief Serialize the dictionary.
+   *
+   * @param out [output] the encoded dictionary.
+   * @return The number of columns serialized.
+   */
+  std::size_t serialize(std::string& out) const;
+
+  /// Replace the dictionary content with a serialized dictionary.
+  Status deserialize(const std::string& in);
+
+ private:
+  /// Add any unknown columns of a row and return the index of every column.
+  template <typename Columns>
+  void indexes(const Columns& columns, std::vector<std::size_t>& indexes);
+
+ private:
+  mutable Mutex mutex_;
+
+  /// Column names by index.
+  std::vector<std::string> columns_;
+
+  /// Column indexes by name.
+  std::unordered_map<std::string, std::size_t> indexes_;
+
+ private:
+  friend Status serializeRowBinary(const Row& r,
+                                   RowColumnDictionary& dictionary,
+                                   std::string& out);
+  friend Status serializeRowBinary(const std::vector<RowColumnView>& columns,
+                                   RowColumnDictionary& dictionary,
+                                   std::string& out);
+  friend Status deserializeRowBinary(const std::string& in,
+                                     const RowColumnDictionary& dictionary,
+                                     Row& r);
+};
+
+/**
+ * @brief Serialize a Row into a compact binary string.
+ *
+ * The encoding is a version byte, the number of columns, then a dictionary
+ * index, a length and the value bytes for each column. Integers are encoded
+ * as unsigned LEB128 varints.
+ *
+ * @param r the Row to serialize.
+ * @param dictionary the column dictionary, unknown columns are added.
+ * @param out [output] the encoded row.
+ *
+ * @return Status indicating the success or failure of the operation.
+ */
+Status serializeRowBinary(const Row& r,
+                          RowColumnDictionary& dictionary,
+                          std::string& out);
+
+/**
+ * @brief Serialize a list of columns into a compact binary string.
+ *
+ * The encoding is the same used for a Row holding the same columns.
+ *
+ * @param columns the columns to serialize.
+ * @param dictionary the column dictionary, unknown columns are added.
+ * @param out [output] the encoded row.
+ *
+ * @return Status indicating the success or failure of the operation.
+ */
+Status serializeRowBinary(const std::vector<RowColumnView>& columns,
+                          RowColumnDictionary& dictionary,
+                          std::string& out);
+
+/**
+ * @brief Deserialize a Row from a binary string.
+ *
+ * @param in the encoded row.
+ * @param dictionary the column dictionary used to encode the row.
+ * @param r [output] the output Row structure.
+ *
+ * @return Status indicating the success or failure of the operation.
+ */
+Status deserializeRowBinary(const std::string& in,
+                            const RowColumnDictionary& dictionary,
+                            Row& r);
+
+/// Check if a serialized row uses the binary encoding rather than JSON.
+inline bool isBinaryRow(const std::string& in) {
+  return !in.empty() && in.front() == kBinaryRowVersion;
+}
+
+} // namespace osquery
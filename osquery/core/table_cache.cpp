@@ -0,0 +1,225 @@
+/**
+ * Copyright (c) 2014-present, The osquery authors
+ *
+ * This source code is licensed as defined by the LICENSE file found in the
+ * root directory of this source tree.
+ *
+ * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
+ */
+
+#include <iterator>
+#include <set>
+
+#include <osquery/core/flags.h>
+#include <osquery/core/table_cache.h>
+#include <osquery/logger/logger.h>
+
+namespace osquery {
+
+FLAG(uint64,
+     table_cache_max_rows,
+     100000,
+     "Maximum number of rows held by the scheduled query table cache");
+
+namespace {
+
+/// Build the canonical form of the constraints that change generation.
+std::string generatingConstraints(const TableColumns& columns,
+                                  const QueryContext& ctx) {
+  auto generating = ColumnOptions::INDEX | ColumnOptions::REQUIRED |
+                    ColumnOptions::ADDITIONAL | ColumnOptions::OPTIMIZED;
+
+  std::string key;
+  for (const auto& column : columns) {
+    const auto& options = std::get<2>(column);
+    if (!(options & generating)) {
+      continue;
+    }
+
+    auto constraint_list = ctx.constraints.find(std::get<0>(column));
+    if (constraint_list == ctx.constraints.end() ||
+        !constraint_list->second.exists()) {
+      continue;
+    }
+
+    // The same predicates may be listed in any order.
+    std::set<std::pair<unsigned char, std::string>> predicates;
+    for (const auto& constraint : constraint_list->second.getAll()) {
+      predicates.emplace(constraint.op, constraint.expr);
+    }
+
+    key += std::get<0>(column);
+    for (const auto& predicate : predicates) {
+      key += '\x1f';
+      key += std::to_string(predicate.first);
+      key += '\x1f';
+      key += predicate.second;
+    }
+    key += '\x1e';
+  }
+
+  return key;
+}
+
+UsedColumnsBitset usedColumns(const QueryContext& ctx) {
+  if (ctx.colsUsedBitset) {
+    return *ctx.colsUsedBitset;
+  }
+
+  return UsedColumnsBitset().set();
+}
+
+bool isFresh(uint64_t step, uint64_t entry_step, uint64_t entry_interval) {
+  return step >= entry_step && step < entry_step + entry_interval;
+}
+
+} // namespace
+
+TableResultCache& TableResultCache::instance() {
+  static TableResultCache cache;
+  return cache;
+}
+
+bool TableResultCache::lookup(const std::string& table,
+                              const TableColumns& columns,
+                              uint64_t step,
+                              const QueryContext& ctx,
+                              TableRows& results) {
+  auto constraints = generatingConstraints(columns, ctx);
+  auto used = usedColumns(ctx);
+
+  WriteLock lock(mutex_);
+  auto& counters = counters_[table];
+
+  std::vector<EntryList::iterator> expired;
+  auto match = entries_.end();
+  auto range = index_.equal_range(table);
+  for (auto it = range.first; it != range.second; ++it) {
+    const auto& entry = *it->second;
+    if (!isFresh(step, entry.step, entry.interval)) {
+      expired.push_back(it->second);
+      continue;
+    }
+
+    if ((entry.columns & used) != used) {
+      continue;
+    }
+
+    if (entry.constraints == constraints) {
+      match = it->second;
+      break;
+    }
+  }
+
+  for (auto& entry : expired) {
+    erase(entry);
+  }
+
+  if (match == entries_.end()) {
+    ++counters.misses;
+    return false;
+  }
+
+  ++counters.hits;
+  entries_.splice(entries_.begin(), entries_, match);
+
+  VLOG(1) << "Retrieving results from cache for table: " << table;
+  results.clear();
+  results.reserve(match->rows.size());
+  for (const auto& row : match->rows) {
+    results.push_back(row->clone());
+  }
+
+  return true;
+}
+
+void TableResultCache::store(const std::string& table,
+                             const TableColumns& columns,
+                             uint64_t step,
+                             uint64_t interval,
+                             const QueryContext& ctx,
+                             const TableRows& results) {
+  if (interval == 0 || results.size() > FLAGS_table_cache_max_rows) {
+    return;
+  }
+
+  Entry entry;
+  entry.table = table;
+  entry.constraints = generatingConstraints(columns, ctx);
+  entry.columns = usedColumns(ctx);
+  entry.step = step;
+  entry.interval = interval;
+  entry.rows.reserve(results.size());
+  for (const auto& row : results) {
+    entry.rows.push_back(row->clone());
+  }
+
+  WriteLock lock(mutex_);
+
+  // Drop the entries this one replaces, and any stale ones.
+  std::vector<EntryList::iterator> replaced;
+  auto range = index_.equal_range(table);
+  for (auto it = range.first; it != range.second; ++it) {
+    const auto& existing = *it->second;
+    if (!isFresh(step, existing.step, existing.interval) ||
+        (existing.constraints == entry.constraints &&
+         (existing.columns & entry.columns) == existing.columns)) {
+      replaced.push_back(it->second);
+    }
+  }
+
+  for (auto& existing : replaced) {
+    erase(existing);
+  }
+
+  rows_ += entry.rows.size();
+  entries_.push_front(std::move(entry));
+  index_.emplace(table, entries_.begin());
+
+  while (rows_ > FLAGS_table_cache_max_rows) {
+    auto last = std::prev(entries_.end());
+    ++counters_[last->table].evictions;
+    erase(last);
+  }
+}
+
+void TableResultCache::clear() {
+  WriteLock lock(mutex_);
+  entries_.clear();
+  index_.clear();
+  rows_ = 0;
+}
+
+std::vector<TableCacheStats> TableResultCache::stats() const {
+  ReadLock lock(mutex_);
+
+  std::vector<TableCacheStats> stats;
+  stats.reserve(counters_.size());
+  for (const auto& counters : counters_) {
+    stats.push_back(counters.second);
+    stats.back().name = counters.first;
+
+    auto range = index_.equal_range(counters.first);
+    for (auto it = range.first; it != range.second; ++it) {
+      ++stats.back().entries;
+      stats.back().rows += it->second->rows.size();
+    }
+  }
+
+  return stats;
+}
+
+void TableResultCache::erase(EntryList::iterator entry) {
+  auto range = index_.equal_range(entry->table);
+  for (auto it = range.first; it != range.second; ++it) {
+    if (it->second == entry) {
+      index_.erase(it);
+      break;
+    }
+  }
+
+  rows_ -= entry->rows.size();
+  entries_.erase(entry);
+}
+
+} // namespace osquery
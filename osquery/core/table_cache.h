@@ -0,0 +1,144 @@
+/**
+ * Copyright (c) 2014-present, The osquery authors
+ *
+ * This source code is licensed as defined by the LICENSE file found in the
+ * root directory of this source tree.
+ *
+ * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
+ */
+
+#pragma once
+
+#include <list>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+
+#include <osquery/core/tables.h>
+#include <osquery/utils/mutex.h>
+
+namespace osquery {
+
+/// Counters for the cached results of a single table.
+struct TableCacheStats {
+  /// The table name.
+  std::string name;
+
+  /// Number of cached result sets.
+  std::size_t entries{0};
+
+  /// Number of rows held by the cached result sets.
+  std::size_t rows{0};
+
+  /// Number of generate requests answered from the cache.
+  std::size_t hits{0};
+
+  /// Number of cacheable generate requests that were not answered.
+  std::size_t misses{0};
+
+  /// Number of result sets dropped to stay within the row limit.
+  std::size_t evictions{0};
+};
+
+/**
+ * @brief An in-memory cache of table results used by scheduled queries.
+ *
+ * Results are keyed by the table name, the constraints that may change what
+ * the table generates (constraints on index, required, additional and
+ * optimized columns) and the columns used by the query.
+ *
+ * A result set can answer any query using the same generating constraints
+ * and a subset of its columns. A full scan is not reused for constrained
+ * index or optimized columns, tables may generate rows for these constraints
+ * that a scan does not list (processes resolves thread IDs given as a pid).
+ *
+ * A result set is fresh for the interval of the query that generated it. The
+ * least recently used result sets are dropped when the cached row count is
+ * above --table_cache_max_rows.
+ */
+class TableResultCache : private boost::noncopyable {
+ public:
+  /// Get the process-wide table results cache.
+  static TableResultCache& instance();
+
+  /**
+   * @brief Lookup fresh results able to answer a query.
+   *
+   * @param table The table name.
+   * @param columns The table's columns and their options.
+   * @param step The current schedule step.
+   * @param ctx The query context of the generate request.
+   * @param results [output] A copy of the cached rows.
+   * @return True if results were found.
+   */
+  bool lookup(const std::string& table,
+              const TableColumns& columns,
+              uint64_t step,
+              const QueryContext& ctx,
+              TableRows& results);
+
+  /**
+   * @brief Store the results of a generate request.
+   *
+   * Result sets with the same generating constraints and a subset of the
+   * used columns are replaced.
+   */
+  void store(const std::string& table,
+             const TableColumns& columns,
+             uint64_t step,
+             uint64_t interval,
+             const QueryContext& ctx,
+             const TableRows& results);
+
+  /// Drop every cached result set, the counters are kept.
+  void clear();
+
+  /// Return the counters of each table that used the cache.
+  std::vector<TableCacheStats> stats() const;
+
+ private:
+  TableResultCache() = default;
+
+ private:
+  struct Entry {
+    /// The table name.
+    std::string table;
+
+    /// Canonical form of the generating constraints, empty for a scan.
+    std::string constraints;
+
+    /// Columns used by the query that generated the results.
+    UsedColumnsBitset columns;
+
+    /// The schedule step and interval the results were generated for.
+    uint64_t step{0};
+    uint64_t interval{0};
+
+    TableRows rows;
+  };
+
+  using EntryList = std::list<Entry>;
+
+  /// Remove an entry from the list and the table index.
+  void erase(EntryList::iterator entry);
+
+ private:
+  /// Cached results, most recently used first.
+  EntryList entries_;
+
+  /// Entries of each table.
+  std::unordered_multimap<std::string, EntryList::iterator> index_;
+
+  /// Number of rows held by all entries.
+  std::size_t rows_{0};
+
+  /// Counters of each table, by table name.
+  std::map<std::string, TableCacheStats> counters_;
+
+  mutable Mutex mutex_;
+};
+
+} // namespace osquery
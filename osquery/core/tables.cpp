@@ -10,6 +10,7 @@
 #include <osquery/utils/json/json.h>
 
 #include <osquery/core/flags.h>
+#include <osquery/core/table_cache.h>
 #include <osquery/core/tables.h>
 #include <osquery/database/database.h>
 #include <osquery/logger/logger.h>
@@ -24,9 +25,6 @@ FLAG(bool, disable_caching, false, "Disable scheduled query caching");
 
 CREATE_LAZY_REGISTRY(TablePlugin, "table");
 
-uint64_t TablePlugin::kCacheInterval = 0;
-uint64_t TablePlugin::kCacheStep = 0;
-
 #define kDisableRowId "WITHOUT ROWID"
 
 // Columns used bitmask
@@ -195,57 +193,32 @@ PluginResponse TablePlugin::routeInfo() const {
   return response;
 }
 
-static bool cacheAllowed(const TableColumns& cols, const QueryContext& ctx) {
-  if (!ctx.useCache() || !ctx.defaultColumnsUsed()) {
-    // The query execution did not request use of the warm cache.
-    return false;
-  }
-
-  auto uncachable = ColumnOptions::INDEX | ColumnOptions::REQUIRED |
-                    ColumnOptions::ADDITIONAL | ColumnOptions::OPTIMIZED;
-  for (const auto& column : cols) {
-    auto opts = std::get<2>(column) & uncachable;
-    if (opts && ctx.constraints.at(std::get<0>(column)).exists()) {
-      return false;
-    }
-  }
-  return true;
+static bool cacheAllowed(const QueryContext& ctx) {
+  // The query execution must request use of the warm cache.
+  return !FLAGS_disable_caching && ctx.useCache();
 }
 
-bool TablePlugin::isCached(uint64_t step, const QueryContext& ctx) const {
-  if (FLAGS_disable_caching) {
+bool TablePlugin::getCache(uint64_t step,
+                           const QueryContext& ctx,
+                           TableRows& results) const {
+  if (!cacheAllowed(ctx)) {
     return false;
   }
 
-  // Perform the step comparison first, because it's easy.
-  return (step < last_cached_ + last_interval_ && cacheAllowed(columns(), ctx));
-}
-
-TableRows TablePlugin::getCache() const {
-  VLOG(1) << "Retrieving results from cache for table: " << getName();
-  // Lookup results from database and deserialize.
-  std::string content;
-  getDatabaseValue(kQueries, "cache." + getName(), content);
-  TableRows results;
-  deserializeTableRowsJSON(content, results);
-  return results;
+  return TableResultCache::instance().lookup(
+      getName(), columns(), step, ctx, results);
 }
 
 void TablePlugin::setCache(uint64_t step,
                            uint64_t interval,
                            const QueryContext& ctx,
                            const TableRows& results) {
-  if (FLAGS_disable_caching || !cacheAllowed(columns(), ctx)) {
+  if (!cacheAllowed(ctx)) {
     return;
   }
 
-  // Serialize QueryData and save to database.
-  std::string content;
-  if (serializeTableRowsJSON(results, content)) {
-    last_cached_ = step;
-    last_interval_ = interval;
-    setDatabaseValue(kQueries, "cache." + getName(), content);
-  }
+  TableResultCache::instance().store(
+      getName(), columns(), step, interval, ctx, results);
 }
 
 std::string columnDefinition(const TableColumns& columns, bool is_extension) {
@@ -532,6 +505,19 @@ bool QueryContext::useCache() const {
   return use_cache_;
 }
 
+void QueryContext::setCacheStep(uint64_t step, uint64_t interval) {
+  cache_step_ = step;
+  cache_interval_ = interval;
+}
+
+uint64_t QueryContext::cacheStep() const {
+  return cache_step_;
+}
+
+uint64_t QueryContext::cacheInterval() const {
+  return cache_interval_;
+}
+
 void QueryContext::setCache(const std::string& index,
                             const TableRowHolder& cache) {
   table_->cache[index] = cache->clone();
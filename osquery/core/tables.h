@@ -423,6 +423,14 @@ struct VirtualTableContent {
   /// Transient set of virtual table used columns (as bitmasks)
   std::unordered_map<size_t, UsedColumnsBitset> colsUsedBitsets;
 
+  /**
+   * @brief Constraint indexes kept between queries.
+   *
+   * A cached prepared statement is not planned again, so the constraints
+   * selected by xBestIndex while preparing it must outlive the query.
+   */
+  std::unordered_set<size_t> retained;
+
   /*
    * @brief A table implementation specific query result cache.
    *
@@ -473,6 +481,8 @@ struct QueryContext {
         colsUsed(std::move(other.colsUsed)),
         enable_cache_(other.enable_cache_),
         use_cache_(other.use_cache_),
+        cache_step_(other.cache_step_),
+        cache_interval_(other.cache_interval_),
         table_(other.table_) {
     other.enable_cache_ = false;
     other.table_ = nullptr;
@@ -484,6 +494,8 @@ struct QueryContext {
     std::swap(colsUsed, other.colsUsed);
     std::swap(enable_cache_, other.enable_cache_);
     std::swap(use_cache_, other.use_cache_);
+    std::swap(cache_step_, other.cache_step_);
+    std::swap(cache_interval_, other.cache_interval_);
     std::swap(table_, other.table_);
 
     return *this;
@@ -631,6 +643,15 @@ struct QueryContext {
   /// Check if the query requested use of the warm query cache.
   bool useCache() const;
 
+  /// Set the schedule step and interval of the query using the warm cache.
+  void setCacheStep(uint64_t step, uint64_t interval);
+
+  /// The schedule step of the query, the position of the schedule.
+  uint64_t cacheStep() const;
+
+  /// The scheduled interval of the query, used to calculate freshness.
+  uint64_t cacheInterval() const;
+
   /// Set the entire cache for an index.
   void setCache(const std::string& index, const TableRowHolder& _cache);
 
@@ -647,6 +668,10 @@ struct QueryContext {
   /// If the context is allowed to use the warm query cache.
   bool use_cache_{false};
 
+  /// The schedule step and interval of the query using the warm cache.
+  uint64_t cache_step_{0};
+  uint64_t cache_interval_{0};
+
   /// Persistent table content for table caching.
   std::shared_ptr<VirtualTableContent> table_;
 
@@ -794,73 +819,37 @@ class TablePlugin : public Plugin {
   PluginResponse routeInfo() const override;
 
   /**
-   * @brief Check if there are fresh cache results for this table.
+   * @brief Lookup fresh cached results for this table.
    *
-   * Table results are considered fresh when evaluated against a given interval.
-   * The interval is the expected rate for which this data should be generated.
    * Caching and cache freshness only applies to queries acting on tables
    * within a schedule. If two queries "one" and "two" both inspect the
    * table "processes" at the interval 60. The first executed will cache results
    * and the second will use the cached results.
    *
-   * Table results are not cached if a QueryContext contains constraints or
-   * provides HOB (hand-off blocks) to additional tables within a query.
-   * Currently, the query scheduler cannot communicate to table implementations.
-   * An interval is set globally by the scheduler and passed to the table
-   * implementation as a future-proof API. There is no "shortcut" for caching
-   * when used in external tables. A cache lookup within an extension means
-   * a database call API and re-serialization to the virtual table APIs. In
-   * practice this does not perform well and is explicitly disabled.
+   * Results are cached in memory by the TableResultCache, keyed by the
+   * constraints on index, required, additional and optimized columns and by
+   * the used columns. Results generated for more columns, or by a scan without
+   * constraints when only index or optimized columns are constrained, are
+   * reused. There is no "shortcut" for caching when used in external tables.
    *
-   * @param interval The interval this query expects the tables results.
+   * @param step The current schedule step.
    * @param ctx The query context.
-   * @return True if the cache contains fresh results, otherwise false.
-   */
-  bool isCached(uint64_t interval, const QueryContext& ctx) const;
-
-  /**
-   * @brief Perform a database lookup of cached results and deserialize.
-   *
-   * If a query determined the table's cached results are fresh, it may ask the
-   * table to retrieve results from the database and deserialized them into
-   * table row data.
-   *
-   * @return The deserialized row data of cached results.
+   * @param results [output] The cached row data.
+   * @return True if the cache contained fresh results, otherwise false.
    */
-  TableRows getCache() const;
+  bool getCache(uint64_t step, const QueryContext& ctx, TableRows& results)
+      const;
 
   /**
    * @brief Similar to getCache, stores the results from generate.
    *
-   * Set will serialize and save the results as JSON to be retrieved later.
-   * It will inspect the query context, if any required/indexed/optimized or
-   * additional columns are used then the cache will not be saved.
+   * The results are fresh for the interval of the executing query.
    */
   void setCache(uint64_t step,
                 uint64_t interval,
                 const QueryContext& ctx,
                 const TableRows& results);
 
- private:
-  /// The last time in seconds the table data results were saved to cache.
-  uint64_t last_cached_{0};
-
-  /// The last interval in seconds when the table data was cached.
-  uint64_t last_interval_{0};
-
- public:
-  /**
-   * @brief The scheduled interval for the executing query.
-   *
-   * Scheduled queries execute within a pseudo-mutex, and each may communicate
-   * their scheduled interval to internal TablePlugin implementations. If the
-   * table is cachable then the interval can be used to calculate freshness.
-   */
-  static uint64_t kCacheInterval;
-
-  /// The schedule step, this is the current position of the schedule.
-  static uint64_t kCacheStep;
-
  public:
   /**
    * @brief The registry call "router".
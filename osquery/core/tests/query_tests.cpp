@@ -25,6 +25,7 @@ namespace osquery {
 
 DECLARE_bool(disable_database);
 DECLARE_bool(logger_numerics);
+DECLARE_bool(schedule_differential_fingerprints);
 
 class QueryTests : public testing::Test {
  public:
@@ -143,6 +144,54 @@ TEST_F(QueryTests, test_add_and_get_current_results) {
   }
 }
 
+TEST_F(QueryTests, test_fingerprint_results) {
+  auto query = getOsqueryScheduledQuery();
+  auto cf = Query("fingerprints", query);
+
+  // Start with results stored as JSON, these are migrated on the first diff.
+  uint64_t counter = 0;
+  auto status = cf.addNewResults(getTestDBExpectedResults(), 0, counter);
+  ASSERT_TRUE(status.ok());
+
+  FLAGS_schedule_differential_fingerprints = true;
+  for (auto result : getTestDBResultStream()) {
+    QueryDataSet previous_qd;
+    status = cf.getPreviousQueryResults(previous_qd);
+    ASSERT_TRUE(status.ok());
+
+    DiffResults dr;
+    status = cf.addNewResults(result.second, 0, counter, dr, true);
+    ASSERT_TRUE(status.ok());
+
+    // Row order within the differential is not preserved for removed rows.
+    DiffResults expected = diff(previous_qd, result.second);
+    EXPECT_EQ(QueryDataSet(dr.added.begin(), dr.added.end()),
+              QueryDataSet(expected.added.begin(), expected.added.end()));
+    EXPECT_EQ(QueryDataSet(dr.removed.begin(), dr.removed.end()),
+              QueryDataSet(expected.removed.begin(), expected.removed.end()));
+
+    QueryDataSet qds_previous;
+    status = cf.getPreviousQueryResults(qds_previous);
+    ASSERT_TRUE(status.ok());
+    EXPECT_EQ(qds_previous,
+              QueryDataSet(result.second.begin(), result.second.end()));
+  }
+
+  // Each distinct row is stored once, alongside a marker key.
+  std::vector<std::string> keys;
+  scanDatabaseKeys(kQueries, keys, kQueryFingerprintPrefix + "fingerprints");
+  EXPECT_FALSE(keys.empty());
+
+  // Returning to JSON storage removes the fingerprinted rows.
+  FLAGS_schedule_differential_fingerprints = false;
+  status = cf.addNewResults(getTestDBExpectedResults(), 0, counter);
+  ASSERT_TRUE(status.ok());
+
+  keys.clear();
+  scanDatabaseKeys(kQueries, keys, kQueryFingerprintPrefix + "fingerprints");
+  EXPECT_TRUE(keys.empty());
+}
+
 TEST_F(QueryTests, test_get_query_results) {
   // Grab an expected set of query data and add it as the previous result.
   auto encoded_qd = getSerializedQueryDataJSON();
@@ -10,7 +10,9 @@
 #include <gtest/gtest.h>
 #include <gflags/gflags.h>
 
+#include <osquery/core/column_sources.h>
 #include <osquery/core/system.h>
+#include <osquery/core/table_cache.h>
 #include <osquery/core/tables.h>
 #include <osquery/database/database.h>
 #include <osquery/registry/registry.h>
@@ -157,23 +159,25 @@ class TestTablePlugin : public TablePlugin {
     setCache(step, interval, ctx, r);
   }
 
-  bool testIsCached(size_t interval) {
+  bool testIsCached(uint64_t step) {
     QueryContext ctx;
     ctx.useCache(true);
-    return isCached(interval, ctx);
+    TableRows results;
+    return getCache(step, ctx, results);
   }
 };
 
 TEST_F(TablesTests, test_caching) {
+  TableResultCache::instance().clear();
   TestTablePlugin test;
   // By default the interval and step is 0, so a step of 5 will not be cached.
   EXPECT_FALSE(test.testIsCached(5));
 
-  TablePlugin::kCacheInterval = 5;
-  TablePlugin::kCacheStep = 1;
+  uint64_t interval = 5;
+  uint64_t step = 1;
   EXPECT_FALSE(test.testIsCached(5));
   // Set the current time to 1, and the interval at 5.
-  test.testSetCache(TablePlugin::kCacheStep, TablePlugin::kCacheInterval);
+  test.testSetCache(step, interval);
   // Time at 1 is cached for an interval of 5, so at time 5 the cache is fresh.
   EXPECT_TRUE(test.testIsCached(5));
   // 6 is the end of the cache, it is not fresh.
@@ -182,11 +186,41 @@ TEST_F(TablesTests, test_caching) {
   EXPECT_FALSE(test.testIsCached(7));
 
   // Set the time at now to 2.
-  TablePlugin::kCacheStep = 2;
-  test.testSetCache(TablePlugin::kCacheStep, TablePlugin::kCacheInterval);
+  step = 2;
+  test.testSetCache(step, interval);
   EXPECT_TRUE(test.testIsCached(5));
   // Now 6 is within the freshness of 2 + 5.
   EXPECT_TRUE(test.testIsCached(6));
   EXPECT_FALSE(test.testIsCached(7));
 }
+
+TEST_F(TablesTests, test_column_sources) {
+  enum TestSource : ColumnSources::Source {
+    kTestStat,
+    kTestLink,
+    kTestIo,
+  };
+
+  ColumnSources sources = {
+      {kTestStat, {"state", "parent"}},
+      {kTestLink, {"path"}},
+      {kTestIo, {"read_bytes", "write_bytes"}},
+  };
+
+  // Without the used columns every source is read.
+  QueryContext ctx;
+  auto used = sources.used(ctx);
+  EXPECT_TRUE(used[kTestStat]);
+  EXPECT_TRUE(used[kTestLink]);
+  EXPECT_TRUE(used[kTestIo]);
+
+  ctx.colsUsed = UsedColumns({"pid", "parent", "write_bytes"});
+  used = sources.used(ctx);
+  EXPECT_TRUE(used[kTestStat]);
+  EXPECT_FALSE(used[kTestLink]);
+  EXPECT_TRUE(used[kTestIo]);
+
+  ctx.colsUsed = UsedColumns({"pid"});
+  EXPECT_TRUE(sources.used(ctx).none());
+}
 }
@@ -18,6 +18,8 @@
 
 namespace osquery {
 
+DECLARE_bool(schedule_differential_fingerprints);
+
 QueryData getExampleQueryData(size_t x, size_t y) {
   QueryData qd;
   Row r;
@@ -120,6 +122,64 @@ BENCHMARK(DATABASE_query_results)
     ->ArgPair(10, 10)
     ->ArgPair(10, 100);
 
+QueryDataTyped getExampleQueryDataTyped(size_t x, size_t y, size_t offset) {
+  QueryDataTyped qd;
+
+  // Each row is distinct, the offset shifts the window of rows.
+  for (size_t i = 0; i < y; i++) {
+    RowTyped r;
+    r["id"] = static_cast<long long>(i + offset);
+    for (size_t j = 0; j < x; j++) {
+      r["key" + std::to_string(j)] = std::to_string(j) + "content";
+    }
+    qd.push_back(std::move(r));
+  }
+  return qd;
+}
+
+static void queryResultsDifferential(benchmark::State& state,
+                                     bool fingerprints) {
+  FLAGS_schedule_differential_fingerprints = fingerprints;
+
+  // Alternate between two result sets that differ by a single row.
+  auto first = getExampleQueryDataTyped(state.range(0), state.range(1), 0);
+  auto second = getExampleQueryDataTyped(state.range(0), state.range(1), 1);
+  auto query = getOsqueryScheduledQuery();
+  auto dbq = Query("differential", query);
+
+  uint64_t counter = 0;
+  dbq.addNewResults(first, 0, counter);
+
+  size_t k = 0;
+  while (state.KeepRunning()) {
+    DiffResults diff_results;
+    dbq.addNewResults(
+        (k++ % 2 == 0) ? second : first, 0, counter, diff_results);
+  }
+
+  Query::removeFingerprintRows("differential");
+  deleteDatabaseValue(kQueries, "differential");
+  FLAGS_schedule_differential_fingerprints = false;
+}
+
+static void DATABASE_query_results_json(benchmark::State& state) {
+  queryResultsDifferential(state, false);
+}
+
+BENCHMARK(DATABASE_query_results_json)
+    ->ArgPair(10, 100)
+    ->ArgPair(10, 1000)
+    ->ArgPair(10, 10000);
+
+static void DATABASE_query_results_fingerprints(benchmark::State& state) {
+  queryResultsDifferential(state, true);
+}
+
+BENCHMARK(DATABASE_query_results_fingerprints)
+    ->ArgPair(10, 100)
+    ->ArgPair(10, 1000)
+    ->ArgPair(10, 10000);
+
 static void DATABASE_get(benchmark::State& state) {
   setDatabaseValue(kPersistentSettings, "benchmark", "1");
   while (state.KeepRunning()) {
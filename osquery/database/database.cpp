@@ -7,12 +7,16 @@
  * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
  */
 
+#include <map>
+#include <set>
+
 #include <boost/algorithm/string/predicate.hpp>
 #include <boost/io/quoted.hpp>
 #include <boost/property_tree/json_parser.hpp>
 
 #include <osquery/core/flagalias.h>
 #include <osquery/core/flags.h>
+#include <osquery/core/sql/row_binary.h>
 #include <osquery/database/database.h>
 #include <osquery/logger/logger.h>
 #include <osquery/process/process.h>
@@ -39,6 +43,11 @@ FLAG_ALIAS(std::string, db_path, database_path);
 
 FLAG(bool, disable_database, false, "Disable the persistent RocksDB storage");
 
+CLI_FLAG(bool,
+         events_binary_serialization,
+         false,
+         "Store event subscriber rows in a compact binary encoding");
+
 const std::string kInternalDatabase = "rocksdb";
 const std::string kPersistentSettings = "configurations";
 const std::string kQueries = "queries";
@@ -118,6 +127,30 @@ Status DatabasePlugin::scan(const std::string& domain,
   return Status::success();
 }
 
+Status DatabasePlugin::scanRange(const std::string& domain,
+                                 const std::string& low,
+                                 const std::string& high,
+                                 const DatabaseRangeCallback& callback) const {
+  auto common = std::mismatch(low.begin(), low.end(), high.begin(), high.end());
+  std::vector<std::string> keys;
+  auto status = scan(domain, keys, std::string(low.begin(), common.first), 0);
+  if (!status.ok()) {
+    return status;
+  }
+
+  for (const auto& key : keys) {
+    if (key < low || key > high) {
+      continue;
+    }
+
+    std::string value;
+    if (get(domain, key, value).ok() && !callback(key, value)) {
+      break;
+    }
+  }
+  return Status::success();
+}
+
 Status DatabasePlugin::call(const PluginRequest& request,
                             PluginResponse& response) {
   if (request.count("action") == 0) {
@@ -442,6 +475,34 @@ Status scanDatabaseKeys(const std::string& domain,
   }
 }
 
+Status scanDatabaseRange(const std::string& domain,
+                         const std::string& low,
+                         const std::string& high,
+                         const DatabaseRangeCallback& callback) {
+  if (domain.empty()) {
+    return Status(1, "Missing domain");
+  }
+
+  if (low > high) {
+    return Status::failure("Invalid range: low > high");
+  }
+
+  if (RegistryFactory::get().external()) {
+    // Extensions scan for the keys and request each value.
+    return getOsqueryDatabase().IDatabaseInterface::scanDatabaseRange(
+        domain, low, high, callback);
+  }
+
+  ReadLock lock(kDatabaseReset);
+  if (!kDBInitialized) {
+    throw std::runtime_error("Cannot scan database values: " + low + " - " +
+                             high);
+  } else {
+    auto plugin = getDatabasePlugin();
+    return plugin->scanRange(domain, low, high, callback);
+  }
+}
+
 void resetDatabase() {
   PluginRequest request = {{"action", "reset"}};
   Registry::call("database", request);
@@ -622,6 +683,96 @@ static Status migrateV1V2(void) {
   return Status::success();
 }
 
+/// Number of event rows converted per write batch by the v2 to v3 migration.
+const size_t kMigrateV2V3BatchSize{1024};
+
+static Status migrateV2V3(void) {
+  std::vector<std::string> keys;
+  const std::string data_prefix("data.");
+
+  Status s = scanDatabaseKeys(kEvents, keys, data_prefix, 0);
+  if (!s.ok()) {
+    return Status::failure(
+        1, "Failed to scan event keys from database: " + s.what());
+  }
+
+  // Each subscriber namespace, "type.name", has its own column dictionary.
+  std::map<std::string, RowColumnDictionary> dictionaries;
+  std::set<std::string> updated_dictionaries;
+  DatabaseStringValueList data;
+
+  // Rows are written in bounded batches, each with the dictionaries that the
+  // converted rows refer to.
+  auto flush = [&]() -> Status {
+    for (const auto& database_namespace : updated_dictionaries) {
+      std::string serialized_dictionary;
+      dictionaries.at(database_namespace).serialize(serialized_dictionary);
+      data.push_back(std::make_pair("columns." + database_namespace,
+                                    std::move(serialized_dictionary)));
+    }
+    updated_dictionaries.clear();
+
+    auto status = data.empty() ? Status::success()
+                               : setDatabaseBatch(kEvents, data);
+    data.clear();
+    return status;
+  };
+
+  for (const auto& key : keys) {
+    const auto pos = key.rfind('.');
+    if (pos == std::string::npos || pos <= data_prefix.size()) {
+      continue;
+    }
+
+    std::string value;
+    s = getDatabaseValue(kEvents, key, value);
+    if (!s.ok() || isBinaryRow(value)) {
+      continue;
+    }
+
+    Row row;
+    s = deserializeRowJSON(value, row);
+    if (!s.ok()) {
+      LOG(WARNING) << "Failed to parse event '" << key
+                   << "'. Key will be kept but won't be migrated!";
+      continue;
+    }
+
+    auto database_namespace =
+        key.substr(data_prefix.size(), pos - data_prefix.size());
+    auto new_namespace = (dictionaries.count(database_namespace) == 0);
+    auto& dictionary = dictionaries[database_namespace];
+    if (new_namespace) {
+      std::string serialized_dictionary;
+      s = getDatabaseValue(
+          kEvents, "columns." + database_namespace, serialized_dictionary);
+      if (s.ok()) {
+        dictionary.deserialize(serialized_dictionary);
+      }
+    }
+
+    std::string serialized_row;
+    serializeRowBinary(row, dictionary, serialized_row);
+    data.push_back(std::make_pair(key, std::move(serialized_row)));
+    updated_dictionaries.insert(database_namespace);
+
+    if (data.size() >= kMigrateV2V3BatchSize) {
+      s = flush();
+      if (!s.ok()) {
+        return s;
+      }
+    }
+  }
+
+  return flush();
+}
+
+int requiredDatabaseVersion() {
+  // Binary event rows are the only change in version 3, a database without
+  // them stays readable by builds that only know version 2.
+  return FLAGS_events_binary_serialization ? kDbCurrentVersion : 2;
+}
+
 Status upgradeDatabase(int to_version) {
   std::string value;
   Status st = getDatabaseValue(kPersistentSettings, kDbVersionKey, value);
@@ -642,7 +793,14 @@ Status upgradeDatabase(int to_version) {
     }
   }
 
-  while (db_version != to_version) {
+  if (db_version > kDbCurrentVersion) {
+    LOG(ERROR) << "The database version " << db_version
+               << " is newer than the supported version " << kDbCurrentVersion;
+    return Status::failure("Unsupported database version.");
+  }
+
+  // A database already upgraded further remains readable.
+  while (db_version < to_version) {
     Status migrate_status;
     switch (db_version) {
     case 0:
@@ -653,6 +811,10 @@ Status upgradeDatabase(int to_version) {
       migrate_status = migrateV1V2();
       break;
 
+    case 2:
+      migrate_status = migrateV2V3();
+      break;
+
     default:
       LOG(ERROR) << "Logic error: the migration code is broken!";
       migrate_status = Status::failure("Migration code broken.");
@@ -739,6 +901,14 @@ class OsqueryDatabase final : public IDatabaseInterface {
                                   size_t max) const override {
     return osquery::scanDatabaseKeys(domain, keys, prefix, max);
   }
+
+  virtual Status scanDatabaseRange(
+      const std::string& domain,
+      const std::string& low,
+      const std::string& high,
+      const DatabaseRangeCallback& callback) const override {
+    return osquery::scanDatabaseRange(domain, low, high, callback);
+  }
 };
 
 IDatabaseInterface& getOsqueryDatabase() {
@@ -55,7 +55,7 @@ extern const std::string kDbVersionKey;
 extern const std::string kDistributedQueries;
 
 /// The running version of our database schema
-const int kDbCurrentVersion = 2;
+const int kDbCurrentVersion = 3;
 
 /**
  * @brief The "domain" where buffered log results are stored.
@@ -141,6 +141,22 @@ class DatabasePlugin : public Plugin {
                       const std::string& prefix,
                       uint64_t max) const;
 
+  /**
+   * @brief Visit each key and value within an inclusive key range, in order.
+   *
+   * The default implementation scans for keys and looks up each value,
+   * plugins with ordered iteration should implement a single pass.
+   *
+   * @param domain A string value representing abstract storage indexing.
+   * @param low The first key, inclusive.
+   * @param high The last key, inclusive.
+   * @param callback Called for each key and value, return false to stop.
+   */
+  virtual Status scanRange(const std::string& domain,
+                           const std::string& low,
+                           const std::string& high,
+                           const DatabaseRangeCallback& callback) const;
+
   /**
    * @brief Shutdown the database and release initialization resources.
    *
@@ -241,6 +257,24 @@ Status scanDatabaseKeys(const std::string& domain,
                         const std::string& prefix,
                         uint64_t max = 0);
 
+/**
+ * @brief Visit the keys and values of a domain within an inclusive range.
+ *
+ * Keys are visited in order, and the values are not copied into a list, which
+ * allows large ranges to be streamed. The callback runs while the database
+ * lock is held, it must not block or re-enter the database.
+ *
+ * @param domain A string value representing abstract storage indexing.
+ * @param low The first key, inclusive.
+ * @param high The last key, inclusive.
+ * @param callback Called for each key and value, return false to stop.
+ * @return Storage operation status.
+ */
+Status scanDatabaseRange(const std::string& domain,
+                         const std::string& low,
+                         const std::string& high,
+                         const DatabaseRangeCallback& callback);
+
 /// Allow callers to reload or reset the database plugin.
 void resetDatabase();
 
@@ -288,6 +322,14 @@ Status ptreeToRapidJSON(const std::string& in, std::string& out);
  */
 Status upgradeDatabase(int to_version = kDbCurrentVersion);
 
+/**
+ * @brief The database version required by the enabled features.
+ *
+ * Version 3 is only needed to store binary encoded events, so the database
+ * is not upgraded further unless events_binary_serialization is set.
+ */
+int requiredDatabaseVersion();
+
 /// Returns a database inteface that routes database requests through the
 /// registry
 IDatabaseInterface& getOsqueryDatabase();
@@ -65,6 +65,12 @@ class EphemeralDatabasePlugin : public DatabasePlugin {
               const std::string& prefix,
               uint64_t max) const override;
 
+  /// Ordered key and value iteration.
+  Status scanRange(const std::string& domain,
+                   const std::string& low,
+                   const std::string& high,
+                   const DatabaseRangeCallback& callback) const override;
+
  public:
   /// Database workflow: open and setup.
   Status setUp() override {
@@ -199,4 +205,26 @@ Status EphemeralDatabasePlugin::scan(const std::string& domain,
   }
   return Status(0);
 }
+
+Status EphemeralDatabasePlugin::scanRange(
+    const std::string& domain,
+    const std::string& low,
+    const std::string& high,
+    const DatabaseRangeCallback& callback) const {
+  auto domainIterator = db_.find(domain);
+  if (domainIterator == db_.end()) {
+    return Status::success();
+  }
+
+  const auto& keys = domainIterator->second;
+  for (auto it = keys.lower_bound(low); it != keys.end() && it->first <= high;
+       ++it) {
+    const auto* value = boost::get<std::string>(&it->second);
+    if (value != nullptr && !callback(it->first, *value)) {
+      break;
+    }
+  }
+  return Status::success();
+}
+
 } // namespace osquery
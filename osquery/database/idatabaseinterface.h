@@ -10,6 +10,8 @@
 
 #pragma once
 
+#include <algorithm>
+#include <functional>
 #include <memory>
 #include <string>
 #include <vector>
@@ -20,6 +22,10 @@ namespace osquery {
 using DatabaseStringValueList =
     std::vector<std::pair<std::string, std::string>>;
 
+/// Visits a key and value, returning false stops a range scan.
+using DatabaseRangeCallback =
+    std::function<bool(const std::string& key, const std::string& value)>;
+
 class IDatabaseInterface {
  public:
   IDatabaseInterface() = default;
@@ -60,6 +66,39 @@ class IDatabaseInterface {
                                   const std::string& prefix,
                                   size_t max) const = 0;
 
+  /**
+   * @brief Visit the keys and values within an inclusive range, in order.
+   *
+   * The default implementation looks up each key within the range.
+   */
+  virtual Status scanDatabaseRange(
+      const std::string& domain,
+      const std::string& low,
+      const std::string& high,
+      const DatabaseRangeCallback& callback) const {
+    auto common =
+        std::mismatch(low.begin(), low.end(), high.begin(), high.end());
+    std::vector<std::string> keys;
+    auto status = scanDatabaseKeys(
+        domain, keys, std::string(low.begin(), common.first), 0);
+    if (!status.ok()) {
+      return status;
+    }
+
+    for (const auto& key : keys) {
+      if (key < low || key > high) {
+        continue;
+      }
+
+      std::string value;
+      status = getDatabaseValue(domain, key, value);
+      if (status.ok() && !callback(key, value)) {
+        break;
+      }
+    }
+    return Status::success();
+  }
+
   IDatabaseInterface(const IDatabaseInterface&) = delete;
   IDatabaseInterface& operator=(const IDatabaseInterface&) = delete;
 };
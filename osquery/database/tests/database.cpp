@@ -8,6 +8,7 @@
  */
 
 #include <osquery/core/flags.h>
+#include <osquery/core/sql/row_binary.h>
 #include <osquery/core/system.h>
 #include <osquery/database/database.h>
 #include <osquery/registry/registry.h>
@@ -22,6 +23,8 @@ namespace rj = rapidjson;
 
 namespace osquery {
 
+DECLARE_bool(events_binary_serialization);
+
 class DatabaseTests : public testing::Test {
  public:
   void SetUp() override {
@@ -294,4 +297,68 @@ TEST_F(DatabaseTests, test_migration_v1v2) {
   EXPECT_EQ(value, "event_data");
 }
 
+TEST_F(DatabaseTests, test_migration_v2v3) {
+  /* Testing migration from 2 to 3 */
+  Status status = setDatabaseValue(kPersistentSettings, kDbVersionKey, "2");
+  ASSERT_TRUE(status.ok());
+
+  const std::string key = "data.type.name.0000000001";
+  status =
+      setDatabaseValue(kEvents, key, "{\"time\":\"1\",\"eid\":\"1\"}");
+  ASSERT_TRUE(status.ok());
+
+  auto binary_serialization = FLAGS_events_binary_serialization;
+  FLAGS_events_binary_serialization = true;
+  status = upgradeDatabase(3);
+  FLAGS_events_binary_serialization = binary_serialization;
+  ASSERT_TRUE(status.ok());
+
+  std::string value;
+  status = getDatabaseValue(kPersistentSettings, kDbVersionKey, value);
+  EXPECT_EQ(value, "3");
+
+  std::string serialized_row;
+  status = getDatabaseValue(kEvents, key, serialized_row);
+  ASSERT_TRUE(status.ok());
+  EXPECT_TRUE(isBinaryRow(serialized_row));
+
+  std::string serialized_dictionary;
+  status =
+      getDatabaseValue(kEvents, "columns.type.name", serialized_dictionary);
+  ASSERT_TRUE(status.ok());
+
+  RowColumnDictionary dictionary;
+  ASSERT_TRUE(dictionary.deserialize(serialized_dictionary).ok());
+
+  Row row;
+  ASSERT_TRUE(deserializeRowBinary(serialized_row, dictionary, row).ok());
+  EXPECT_EQ(row, Row({{"eid", "1"}, {"time", "1"}}));
+}
+
+TEST_F(DatabaseTests, test_required_version) {
+  Status status = setDatabaseValue(kPersistentSettings, kDbVersionKey, "2");
+  ASSERT_TRUE(status.ok());
+
+  // Without binary event rows the database stays readable by older builds.
+  auto binary_serialization = FLAGS_events_binary_serialization;
+  FLAGS_events_binary_serialization = false;
+  EXPECT_EQ(requiredDatabaseVersion(), 2);
+  status = upgradeDatabase(requiredDatabaseVersion());
+  ASSERT_TRUE(status.ok());
+
+  std::string value;
+  getDatabaseValue(kPersistentSettings, kDbVersionKey, value);
+  EXPECT_EQ(value, "2");
+
+  // A database upgraded by a previous run with binary rows is still used.
+  status = setDatabaseValue(kPersistentSettings, kDbVersionKey, "3");
+  ASSERT_TRUE(status.ok());
+  status = upgradeDatabase(requiredDatabaseVersion());
+  EXPECT_TRUE(status.ok());
+
+  FLAGS_events_binary_serialization = true;
+  EXPECT_EQ(requiredDatabaseVersion(), kDbCurrentVersion);
+  FLAGS_events_binary_serialization = binary_serialization;
+}
+
 } // namespace osquery
@@ -12,6 +12,7 @@
 #include <osquery/core/query.h>
 #include <osquery/core/sql/diff_results.h>
 #include <osquery/core/sql/query_data.h>
+#include <osquery/core/sql/row_binary.h>
 #include <osquery/sql/tests/sql_test_utils.h>
 
 #include <gtest/gtest.h>
@@ -59,6 +60,46 @@ TEST_F(ResultsTests, test_deserialize_row_json) {
   EXPECT_EQ(output, results.second);
 }
 
+TEST_F(ResultsTests, test_serialize_row_binary) {
+  Row input = {{"alphabetical", "alphabetical_value"},
+               {"empty", ""},
+               {"meaning_of_life", std::string(200, 'x')}};
+
+  RowColumnDictionary dictionary;
+  std::string serialized_row;
+  auto s = serializeRowBinary(input, dictionary, serialized_row);
+  EXPECT_TRUE(s.ok());
+  EXPECT_TRUE(isBinaryRow(serialized_row));
+  EXPECT_EQ(dictionary.size(), 3U);
+
+  // Columns are only added to the dictionary once.
+  std::string second_row;
+  serializeRowBinary({{"empty", "1"}}, dictionary, second_row);
+  EXPECT_EQ(dictionary.size(), 3U);
+
+  // A dictionary restored from storage decodes the rows.
+  std::string serialized_dictionary;
+  EXPECT_EQ(dictionary.serialize(serialized_dictionary), 3U);
+
+  RowColumnDictionary restored;
+  EXPECT_TRUE(restored.deserialize(serialized_dictionary).ok());
+
+  Row output;
+  s = deserializeRowBinary(serialized_row, restored, output);
+  EXPECT_TRUE(s.ok());
+  EXPECT_EQ(output, input);
+
+  // Rows using unknown columns or truncated rows are rejected.
+  RowColumnDictionary empty;
+  output.clear();
+  EXPECT_FALSE(deserializeRowBinary(serialized_row, empty, output).ok());
+
+  output.clear();
+  serialized_row.pop_back();
+  EXPECT_FALSE(deserializeRowBinary(serialized_row, restored, output).ok());
+  EXPECT_FALSE(isBinaryRow("{\"json\":\"row\"}"));
+}
+
 TEST_F(ResultsTests, test_serialize_query_data) {
   auto results = getSerializedQueryData();
   auto doc = JSON::newArray();
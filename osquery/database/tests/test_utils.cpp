@@ -269,4 +269,39 @@ void DatabasePluginTests::testScanLimit() {
   EXPECT_EQ(s.getMessage(), "OK");
   EXPECT_EQ(keys.size(), 2U);
 }
+
+void DatabasePluginTests::testScanRange() {
+  getPlugin()->put(kQueries, "test_range_1", "a");
+  getPlugin()->put(kQueries, "test_range_2", "b");
+  getPlugin()->put(kQueries, "test_range_3", "c");
+  getPlugin()->put(kQueries, "test_range_4", "d");
+
+  std::vector<std::pair<std::string, std::string>> visited;
+  auto s = getPlugin()->scanRange(
+      kQueries,
+      "test_range_2",
+      "test_range_3",
+      [&visited](const std::string& key, const std::string& value) {
+        visited.push_back(std::make_pair(key, value));
+        return true;
+      });
+  EXPECT_TRUE(s.ok());
+  std::vector<std::pair<std::string, std::string>> expected = {
+      {"test_range_2", "b"}, {"test_range_3", "c"}};
+  EXPECT_EQ(visited, expected);
+
+  // Returning false stops the iteration.
+  visited.clear();
+  s = getPlugin()->scanRange(
+      kQueries,
+      "test_range_1",
+      "test_range_4",
+      [&visited](const std::string& key, const std::string& value) {
+        visited.push_back(std::make_pair(key, value));
+        return false;
+      });
+  EXPECT_TRUE(s.ok());
+  ASSERT_EQ(visited.size(), 1U);
+  EXPECT_EQ(visited[0].first, "test_range_1");
+}
 } // namespace osquery
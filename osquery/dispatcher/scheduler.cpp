@@ -22,8 +22,8 @@
 #include <osquery/database/database.h>
 #include <osquery/logger/data_logger.h>
 #include <osquery/numeric_monitoring/numeric_monitoring.h>
-#include <osquery/process/process.h>
 #include <osquery/profiler/code_profiler.h>
+#include <osquery/profiler/resource_usage.h>
 
 #include <osquery/utils/system/time.h>
 
@@ -52,6 +52,11 @@ FLAG(bool,
      false,
      "Log the running scheduled query name at INFO level");
 
+FLAG(uint64,
+     schedule_workers,
+     0,
+     "Threads executing scheduled queries concurrently, 0 to run serially");
+
 HIDDEN_FLAG(bool,
             schedule_reload_sql,
             false,
@@ -62,7 +67,9 @@ DECLARE_bool(events_optimize);
 DECLARE_bool(enable_numeric_monitoring);
 DECLARE_bool(verbose);
 
-SQLInternal monitor(const std::string& name, const ScheduledQuery& query) {
+SQLInternal monitor(const std::string& name,
+                    const ScheduledQuery& query,
+                    uint64_t step) {
   if (FLAGS_enable_numeric_monitoring) {
     CodeProfiler profiler(
         {(boost::format("scheduler.pack.%s") % query.pack_name).str(),
@@ -77,43 +84,32 @@ SQLInternal monitor(const std::string& name, const ScheduledQuery& query) {
           monitoring::hostIdentifierKeys().scheme % query.pack_name %
           query.name)
              .str()});
-    return SQLInternal(query.query, true);
+    return SQLInternal(query.query, true, step, query.splayed_interval);
   } else {
-    // Snapshot the performance and times for the worker before running.
-    auto pid = std::to_string(PlatformProcess::getCurrentPid());
-    auto r0 = SQL::selectFrom({"resident_size", "user_time", "system_time"},
-                              "processes",
-                              "pid",
-                              EQUALS,
-                              pid);
+    // Snapshot the resources used by this thread before running.
+    auto r0 = getResourceUsage();
 
     using namespace std::chrono;
     auto t0 = steady_clock::now();
     Config::get().recordQueryStart(name);
-    SQLInternal sql(query.query, true);
+    SQLInternal sql(query.query, true, step, query.splayed_interval);
 
-    // Snapshot the performance after, and compare.
+    // Snapshot the resources after, and compare.
     auto t1 = steady_clock::now();
-    auto r1 = SQL::selectFrom({"resident_size", "user_time", "system_time"},
-                              "processes",
-                              "pid",
-                              EQUALS,
-                              pid);
-    if (r0.size() > 0 && r1.size() > 0) {
-      // Always called while processes table is working.
-      uint64_t size = sql.getSize();
-      Config::get().recordQueryPerformance(
-          name,
-          duration_cast<milliseconds>(t1 - t0).count(),
-          size,
-          r0[0],
-          r1[0]);
-    }
+    auto r1 = getResourceUsage();
+    Config::get().recordQueryPerformance(
+        name,
+        duration_cast<milliseconds>(t1 - t0).count(),
+        sql.getSize(),
+        r0,
+        r1);
     return sql;
   }
 }
 
-Status launchQuery(const std::string& name, const ScheduledQuery& query) {
+Status launchQuery(const std::string& name,
+                   const ScheduledQuery& query,
+                   uint64_t step) {
   // Execute the scheduled query and create a named query object.
   if (FLAGS_verbose) {
     VLOG(1) << "Executing scheduled query " << name << ": " << query.query;
@@ -122,7 +118,7 @@ Status launchQuery(const std::string& name, const ScheduledQuery& query) {
   }
   runDecorators(DECORATE_ALWAYS);
 
-  auto sql = monitor(name, query);
+  auto sql = monitor(name, query, step);
   if (!sql.getStatus().ok()) {
     LOG(ERROR) << "Error executing scheduled query " << name << ": "
                << sql.getStatus().toString();
@@ -194,6 +190,115 @@ Status launchQuery(const std::string& name, const ScheduledQuery& query) {
   return status;
 }
 
+static void recordLaunchStatus(const ScheduledQuery& query,
+                               const Status& status) {
+  monitoring::record((boost::format("scheduler.query.%s.%s.status.%s") %
+                      query.pack_name % query.name %
+                      (status.ok() ? "success" : "failure"))
+                         .str(),
+                     1,
+                     monitoring::PreAggregationType::Sum,
+                     true);
+}
+
+/// Scheduled queries are only movable, a worker needs its own copy.
+static ScheduledQuery copyScheduledQuery(const ScheduledQuery& query) {
+  ScheduledQuery copy(query.pack_name, query.name, query.query);
+  copy.oncall = query.oncall;
+  copy.interval = query.interval;
+  copy.splayed_interval = query.splayed_interval;
+  copy.denylisted = query.denylisted;
+  copy.options = query.options;
+  return copy;
+}
+
+SchedulerWorkers::SchedulerWorkers(size_t workers) {
+  for (size_t i = 0; i < workers; ++i) {
+    threads_.emplace_back(&SchedulerWorkers::run, this);
+  }
+}
+
+SchedulerWorkers::~SchedulerWorkers() {
+  {
+    WriteLock lock(mutex_);
+    stopping_ = true;
+  }
+  work_cv_.notify_all();
+
+  for (auto& thread : threads_) {
+    thread.join();
+  }
+}
+
+bool SchedulerWorkers::dispatch(const std::string& name,
+                                const ScheduledQuery& query,
+                                uint64_t step) {
+  {
+    WriteLock lock(mutex_);
+    for (const auto& execution : queue_) {
+      if (execution.name == name) {
+        VLOG(1) << "Scheduled query " << name
+                << " is still waiting to execute, skipping this interval";
+        return false;
+      }
+    }
+    queue_.push_back({name, copyScheduledQuery(query), step});
+  }
+  work_cv_.notify_one();
+  return true;
+}
+
+void SchedulerWorkers::wait() {
+  WriteLock lock(mutex_);
+  idle_cv_.wait(lock, [this] { return queue_.empty() && running_.empty(); });
+}
+
+void SchedulerWorkers::cancel() {
+  {
+    WriteLock lock(mutex_);
+    queue_.clear();
+  }
+  idle_cv_.notify_all();
+}
+
+void SchedulerWorkers::run() {
+  while (true) {
+    Execution execution;
+    {
+      WriteLock lock(mutex_);
+
+      // Select the oldest execution whose query name is not already running.
+      auto next = queue_.end();
+      work_cv_.wait(lock, [this, &next] {
+        next = std::find_if(
+            queue_.begin(), queue_.end(), [this](const Execution& e) {
+              return running_.count(e.name) == 0;
+            });
+        return next != queue_.end() || (stopping_ && queue_.empty());
+      });
+
+      if (next == queue_.end()) {
+        return;
+      }
+      execution = std::move(*next);
+      queue_.erase(next);
+      running_.insert(execution.name);
+    }
+
+    const auto status =
+        launchQuery(execution.name, execution.query, execution.step);
+    recordLaunchStatus(execution.query, status);
+
+    {
+      WriteLock lock(mutex_);
+      running_.erase(execution.name);
+    }
+    // A queued execution of the same name may now run.
+    work_cv_.notify_all();
+    idle_cv_.notify_all();
+  }
+}
+
 void SchedulerRunner::calculateTimeDriftAndMaybePause(
     std::chrono::milliseconds loop_step_duration) {
   if (loop_step_duration + time_drift_ < interval_) {
@@ -223,8 +328,20 @@ void SchedulerRunner::maybeScheduleCarves(uint64_t time_step) {
 
 void SchedulerRunner::maybeReloadSchedule(uint64_t time_step) {
   if (FLAGS_schedule_reload > 0 && (time_step % FLAGS_schedule_reload) == 0) {
+    if (workers_ != nullptr) {
+      // Queries must not execute while the databases are reset. The time
+      // spent waiting is part of this step and accounted for as drift.
+      workers_->wait();
+    }
+
+    auto stats = SQLiteDBManager::getStatementCacheStats();
+    VLOG(1) << "Prepared statement cache hits: " << stats.hits
+            << " misses: " << stats.misses;
     if (FLAGS_schedule_reload_sql) {
       SQLiteDBManager::resetPrimary();
+    } else {
+      // The reset connection would have finalized the cached statements.
+      SQLiteDBManager::clearStatementCache();
     }
     resetDatabase();
   }
@@ -237,27 +354,34 @@ void SchedulerRunner::maybeFlushLogs(uint64_t time_step) {
   }
 }
 
+void SchedulerRunner::launchOrDispatch(const std::string& name,
+                                       const ScheduledQuery& query,
+                                       uint64_t step) {
+  if (workers_ != nullptr) {
+    workers_->dispatch(name, query, step);
+    return;
+  }
+
+  const auto status = launchQuery(name, query, step);
+  recordLaunchStatus(query, status);
+}
+
 void SchedulerRunner::start() {
   // Start the counter at the second.
   auto i = osquery::getUnixTime();
   // Timeout is the number of seconds from starting.
   auto end = (timeout_ == 0) ? 0 : timeout_ + i;
 
+  if (FLAGS_schedule_workers > 0) {
+    workers_ = std::make_unique<SchedulerWorkers>(FLAGS_schedule_workers);
+  }
+
   for (; (end == 0) || (i <= end); ++i) {
     auto start_time_point = std::chrono::steady_clock::now();
-    Config::get().scheduledQueries(([&i](const std::string& name,
-                                         const ScheduledQuery& query) {
+    Config::get().scheduledQueries(([this, &i](const std::string& name,
+                                               const ScheduledQuery& query) {
       if (query.splayed_interval > 0 && i % query.splayed_interval == 0) {
-        TablePlugin::kCacheInterval = query.splayed_interval;
-        TablePlugin::kCacheStep = i;
-        const auto status = launchQuery(name, query);
-        monitoring::record((boost::format("scheduler.query.%s.%s.status.%s") %
-                            query.pack_name % query.name %
-                            (status.ok() ? "success" : "failure"))
-                               .str(),
-                           1,
-                           monitoring::PreAggregationType::Sum,
-                           true);
+        launchOrDispatch(name, query, i);
       }
     }));
 
@@ -275,6 +399,12 @@ void SchedulerRunner::start() {
     }
   }
 
+  // Let running queries complete before the scheduler ends.
+  if (workers_ != nullptr && interrupted()) {
+    workers_->cancel();
+  }
+  workers_.reset();
+
   // Scheduler ended.
   if (!interrupted() && request_shutdown_on_expiration) {
     LOG(INFO) << "The scheduler ended after " << timeout_ << " seconds";
@@ -10,14 +10,82 @@
 #pragma once
 
 #include <chrono>
+#include <deque>
 #include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
 
+#include <boost/noncopyable.hpp>
+
+#include <osquery/core/sql/scheduled_query.h>
 #include <osquery/dispatcher/dispatcher.h>
+#include <osquery/utils/mutex.h>
 
 #include "osquery/sql/sqlite_util.h"
 
 namespace osquery {
 
+/**
+ * @brief A bounded pool of threads executing scheduled queries concurrently.
+ *
+ * Executions of the same query name never overlap and complete in the order
+ * they were dispatched. If a query is still waiting for a worker when it is
+ * due again, the new execution is coalesced into the waiting one.
+ *
+ * Each execution requests its own SQLite connection from the SQLiteDBManager,
+ * which hands out transient instances while the primary is in use.
+ */
+class SchedulerWorkers : private boost::noncopyable {
+ public:
+  explicit SchedulerWorkers(size_t workers);
+
+  /// Stops accepting work and joins after the queued executions complete.
+  ~SchedulerWorkers();
+
+  /// Queue an execution for a schedule step, returns false if coalesced.
+  bool dispatch(const std::string& name,
+                const ScheduledQuery& query,
+                uint64_t step);
+
+  /// Block until every queued and running execution completes.
+  void wait();
+
+  /// Drop the executions still waiting for a worker.
+  void cancel();
+
+ private:
+  /// Worker thread entry point.
+  void run();
+
+ private:
+  struct Execution {
+    std::string name;
+    ScheduledQuery query;
+    uint64_t step{0};
+  };
+
+  /// Executions waiting for a worker, in dispatch order.
+  std::deque<Execution> queue_;
+
+  /// Names of the queries currently executing.
+  std::set<std::string> running_;
+
+  std::vector<std::thread> threads_;
+
+  bool stopping_{false};
+
+  Mutex mutex_;
+
+  /// Signaled when an execution is queued or a query name becomes idle.
+  ConditionVariable work_cv_;
+
+  /// Signaled when an execution completes.
+  ConditionVariable idle_cv_;
+};
+
 /// A Dispatcher service thread that watches an ExtensionManagerHandler.
 class SchedulerRunner : public InternalRunnable {
  public:
@@ -57,6 +125,11 @@ class SchedulerRunner : public InternalRunnable {
   /// Check if carve requests should be scheduled.
   void maybeScheduleCarves(uint64_t time_step);
 
+  /// Execute a due query on the worker pool or the scheduler thread.
+  void launchOrDispatch(const std::string& name,
+                        const ScheduledQuery& query,
+                        uint64_t step);
+
  private:
   /// Interval in seconds between schedule steps.
   const std::chrono::milliseconds interval_;
@@ -71,13 +144,19 @@ class SchedulerRunner : public InternalRunnable {
 
   const std::chrono::milliseconds max_time_drift_;
 
+  /// Optional pool executing queries concurrently, see schedule_workers.
+  std::unique_ptr<SchedulerWorkers> workers_;
+
   /// Tests should not always trigger a shutdown when the scheduler expires,
   /// so let tests decide when this should happen.
   FRIEND_TEST(TLSConfigTests, test_runner_and_scheduler);
   bool request_shutdown_on_expiration{true};
 };
 
-SQLInternal monitor(const std::string& name, const ScheduledQuery& query);
+/// Execute a scheduled query, the step is used by cacheable tables.
+SQLInternal monitor(const std::string& name,
+                    const ScheduledQuery& query,
+                    uint64_t step = 0);
 
 /// Start querying according to the config's schedule
 void startScheduler();
@@ -7,6 +7,9 @@
  * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
  */
 
+#include <chrono>
+#include <thread>
+
 #include <gtest/gtest.h>
 
 #include <osquery/config/config.h>
@@ -15,14 +18,17 @@
 #include <osquery/database/database.h>
 #include <osquery/dispatcher/scheduler.h>
 #include <osquery/logger/logger.h>
+#include <osquery/profiler/resource_usage.h>
 #include <osquery/registry/registry.h>
 #include <osquery/sql/sqlite_util.h>
+#include <osquery/utils/info/platform_type.h>
 #include <osquery/utils/system/time.h>
 
 namespace osquery {
 
 DECLARE_bool(disable_logging);
 DECLARE_uint64(schedule_reload);
+DECLARE_uint64(schedule_workers);
 
 class SchedulerTests : public testing::Test {
   void SetUp() override {
@@ -113,6 +119,56 @@ TEST_F(SchedulerTests, test_output_size) {
   EXPECT_EQ(perf.output_size, 28U);
 }
 
+TEST_F(SchedulerTests, test_performance_histogram) {
+  PerformanceHistogram histogram;
+  EXPECT_EQ(histogram.percentile(50), 0U);
+
+  // Percentiles are reported as the upper bound of a power-of-two bucket.
+  for (uint64_t i = 0; i < 90; ++i) {
+    histogram.record(5);
+  }
+  for (uint64_t i = 0; i < 10; ++i) {
+    histogram.record(1000);
+  }
+  EXPECT_EQ(histogram.percentile(50), 7U);
+  EXPECT_EQ(histogram.percentile(95), 1023U);
+
+  // The query monitor records a sample for each execution.
+  ScheduledQuery query("test", "test", "select 1 as number");
+  monitor("histogram_test_query", query);
+
+  QueryPerformance perf;
+  Config::get().getPerformanceStats(
+      "histogram_test_query",
+      ([&perf](const QueryPerformance& r) { perf = r; }));
+  EXPECT_EQ(perf.executions, 1U);
+  EXPECT_LE(perf.wall_time_histogram.percentile(50),
+            perf.last_wall_time_ms * 2 + 1);
+}
+
+TEST_F(SchedulerTests, test_helper_cpu_time) {
+  auto r0 = getResourceUsage();
+
+  // A helper thread credits its CPU time to the thread it works for.
+  auto helper_cpu_time = getHelperCpuTime();
+  std::thread helper([helper_cpu_time]() {
+    ScopedHelperCpuTime scoped_cpu_time(helper_cpu_time);
+    auto start = std::chrono::steady_clock::now();
+    while (std::chrono::steady_clock::now() - start <
+           std::chrono::milliseconds(200)) {
+    }
+  });
+  helper.join();
+
+  auto r1 = getResourceUsage();
+  auto helper_time = helper_cpu_time->user_time + helper_cpu_time->system_time;
+  if (isPlatform(PlatformType::TYPE_LINUX)) {
+    EXPECT_GE(helper_time, 100U);
+  }
+  EXPECT_GE(r1.user_time + r1.system_time,
+            r0.user_time + r0.system_time + helper_time);
+}
+
 TEST_F(SchedulerTests, test_config_results_purge) {
   // Set a query time for now (time is only important relative to a week ago).
   auto query_time = osquery::getUnixTime();
@@ -175,13 +231,6 @@ TEST_F(SchedulerTests, test_config_results_purge) {
 }
 
 TEST_F(SchedulerTests, test_scheduler) {
-  auto backup_step = TablePlugin::kCacheStep;
-  auto backup_interval = TablePlugin::kCacheInterval;
-
-  // Start the scheduler now.
-  auto now = osquery::getUnixTime();
-  TablePlugin::kCacheStep = now;
-
   // Update the config with a pack/schedule that contains several queries.
   std::string config =
       "{"
@@ -202,22 +251,17 @@ TEST_F(SchedulerTests, test_scheduler) {
   SchedulerRunner runner(static_cast<unsigned long int>(1), 1);
   runner.start();
 
-  // If a query was executed the cache step will have been advanced.
-  EXPECT_GT(TablePlugin::kCacheStep, now);
-
-  // Restore plugin settings.
-  TablePlugin::kCacheStep = backup_step;
-  TablePlugin::kCacheInterval = backup_interval;
+  // The executed queries have recorded their performance.
+  size_t executions = 0;
+  Config::get().getPerformanceStats(
+      "pack_scheduler_1",
+      ([&executions](const QueryPerformance& r) {
+        executions = r.executions;
+      }));
+  EXPECT_GT(executions, 0U);
 }
 
 TEST_F(SchedulerTests, test_scheduler_zero_drift) {
-  const auto backup_step = TablePlugin::kCacheStep;
-  const auto backup_interval = TablePlugin::kCacheInterval;
-
-  // Start the scheduler now.
-  const auto now = osquery::getUnixTime();
-  TablePlugin::kCacheStep = now;
-
   // Update the config with a pack/schedule that contains several queries.
   std::string config = R"config(
   {
@@ -238,20 +282,9 @@ TEST_F(SchedulerTests, test_scheduler_zero_drift) {
   runner.start();
 
   EXPECT_EQ(runner.getCurrentTimeDrift(), std::chrono::milliseconds::zero());
-
-  // Restore plugin settings.
-  TablePlugin::kCacheStep = backup_step;
-  TablePlugin::kCacheInterval = backup_interval;
 }
 
 TEST_F(SchedulerTests, test_scheduler_drift_accumulation) {
-  const auto backup_step = TablePlugin::kCacheStep;
-  const auto backup_interval = TablePlugin::kCacheInterval;
-
-  // Start the scheduler now.
-  const auto now = osquery::getUnixTime();
-  TablePlugin::kCacheStep = now;
-
   // Update the config with a pack/schedule that contains several queries.
   std::string config = R"config(
   {
@@ -277,10 +310,54 @@ TEST_F(SchedulerTests, test_scheduler_drift_accumulation) {
   runner.start();
 
   EXPECT_GE(runner.getCurrentTimeDrift(), std::chrono::milliseconds{1});
+}
+
+TEST_F(SchedulerTests, test_scheduler_workers) {
+  const auto backup_workers = FLAGS_schedule_workers;
+  FLAGS_schedule_workers = 2;
+
+  std::string config = R"config(
+  {
+    "packs": {
+      "workers": {
+        "queries": {
+          "1": {"query": "select 1 as number", "interval": 1},
+          "2": {"query": "select 2 as number", "interval": 1},
+          "3": {"query": "select 3 as number", "interval": 1}
+        }
+      }
+    }
+  })config";
+  Config::get().update({{"data", config}});
+
+  // Running the scheduler joins the workers after their queries complete.
+  SchedulerRunner runner(
+      static_cast<unsigned long int>(1), size_t{1}, std::chrono::seconds{10});
+  runner.start();
+
+  for (const auto& name :
+       {"pack_workers_1", "pack_workers_2", "pack_workers_3"}) {
+    std::string content;
+    getDatabaseValue(kQueries, name, content);
+    EXPECT_FALSE(content.empty());
+  }
+
+  FLAGS_schedule_workers = backup_workers;
+}
+
+TEST_F(SchedulerTests, test_scheduler_workers_coalesce) {
+  // Without threads every dispatched execution waits for a worker.
+  SchedulerWorkers workers(0);
+  ScheduledQuery query("workers", "coalesce", "select 1 as number");
+
+  // At most one execution per query name waits for a worker.
+  EXPECT_TRUE(workers.dispatch("pack_workers_coalesce", query, 1));
+  EXPECT_FALSE(workers.dispatch("pack_workers_coalesce", query, 2));
+  EXPECT_TRUE(workers.dispatch("pack_workers_other", query, 2));
 
-  // Restore plugin settings.
-  TablePlugin::kCacheStep = backup_step;
-  TablePlugin::kCacheInterval = backup_interval;
+  // Cancelling drops the waiting executions, leaving the pool idle.
+  workers.cancel();
+  workers.wait();
 }
 
 TEST_F(SchedulerTests, test_scheduler_reload) {
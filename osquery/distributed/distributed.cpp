@@ -7,7 +7,16 @@
  * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
  */
 
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
 #include <sstream>
+#include <thread>
 #include <utility>
 
 #include <osquery/core/flags.h>
@@ -39,9 +48,58 @@ FLAG(bool,
      false,
      "Log the running distributed queries name at INFO level");
 
+FLAG(uint32,
+     distributed_concurrency,
+     1,
+     "Number of distributed queries executed at the same time (default 1)");
+
+FLAG(uint32,
+     distributed_query_timeout,
+     0,
+     "Seconds before a running distributed query is reported as failed "
+     "(default 0, no timeout)");
+
+FLAG(uint32,
+     distributed_flush_interval,
+     5,
+     "Seconds between writes of completed distributed query results while "
+     "other queries are running (default 5)");
+
 DECLARE_bool(verbose);
 
-std::string Distributed::currentRequestId_{""};
+thread_local std::string Distributed::currentRequestId_{""};
+
+namespace {
+
+using DistributedClock = std::chrono::steady_clock;
+
+/// A distributed query being executed, with the time it started.
+struct RunningDistributedQuery {
+  DistributedQueryRequest request;
+  DistributedClock::time_point start;
+
+  /// Index of the thread executing the query.
+  size_t worker{0};
+};
+
+} // namespace
+
+/// The state shared by the threads executing distributed queries.
+struct DistributedQueryPool {
+  std::mutex mutex;
+  std::condition_variable cv;
+
+  std::deque<DistributedQueryRequest> pending;
+
+  /// The queries being executed, by request ID.
+  std::map<std::string, RunningDistributedQuery> running;
+
+  /// The results which have not been reported yet.
+  std::vector<DistributedQueryResult> completed;
+
+  /// Indexes of the threads which returned.
+  std::set<size_t> finished;
+};
 
 Status DistributedPlugin::call(const PluginRequest& request,
                                PluginResponse& response) {
@@ -121,35 +179,209 @@ void Distributed::addResult(const DistributedQueryResult& result) {
   results_.push_back(result);
 }
 
+DistributedQueryResult Distributed::runQuery(
+    const DistributedQueryRequest& request) {
+  if (FLAGS_verbose) {
+    VLOG(1) << "Executing distributed query: " << request.id << ": "
+            << request.query;
+  } else if (FLAGS_distributed_loginfo) {
+    LOG(INFO) << "Executing distributed query: " << request.id << ": "
+              << request.query;
+  }
+
+  // Keep track of the currently executing request
+  Distributed::setCurrentRequestId(request.id);
+
+  SQL sql(request.query);
+  const auto ok = sql.getStatus().ok();
+  const auto& msg = ok ? "" : sql.getMessageString();
+  if (!ok) {
+    LOG(ERROR) << "Error executing distributed query: " << request.id << ": "
+               << msg;
+  }
+
+  return DistributedQueryResult(
+      request, sql.rows(), sql.columns(), sql.getStatus(), msg);
+}
+
+Distributed::~Distributed() {
+  joinTimedOut(true);
+}
+
+void Distributed::joinTimedOut(bool wait) {
+  for (auto it = timed_out_.begin(); it != timed_out_.end();) {
+    if (!wait) {
+      std::lock_guard<std::mutex> lock(it->pool->mutex);
+      if (it->pool->finished.count(it->index) == 0) {
+        ++it;
+        continue;
+      }
+    }
+
+    it->thread.join();
+    it = timed_out_.erase(it);
+  }
+}
+
 Status Distributed::runQueries() {
+  joinTimedOut(false);
+
   auto queries = getPendingQueries();
+  if (queries.empty()) {
+    // Retry the results which could not be flushed.
+    return flushCompleted();
+  }
 
+  // Up to one thread per concurrent query is left to finish a timed out
+  // query. Past this limit, the queries wait in the database.
+  const size_t max_timed_out = std::max(FLAGS_distributed_concurrency, 1U);
+  if (timed_out_.size() >= max_timed_out) {
+    LOG(WARNING) << "Distributed queries are delayed, " << timed_out_.size()
+                 << " timed out queries are still running";
+    return flushCompleted();
+  }
+
+  // Threads whose query timed out outlive this call, and share the pool.
+  auto pool = std::make_shared<DistributedQueryPool>();
   for (const auto& query : queries) {
-    auto request = popRequest(query);
+    pool->pending.push_back(popRequest(query));
+  }
 
-    if (FLAGS_verbose) {
-      VLOG(1) << "Executing distributed query: " << request.id << ": "
-              << request.query;
-    } else if (FLAGS_distributed_loginfo) {
-      LOG(INFO) << "Executing distributed query: " << request.id << ": "
-                << request.query;
+  auto worker = [pool](size_t index) {
+    std::unique_lock<std::mutex> lock(pool->mutex);
+    while (!pool->pending.empty()) {
+      auto request = std::move(pool->pending.front());
+      pool->pending.pop_front();
+      pool->running[request.id] = {request, DistributedClock::now(), index};
+
+      lock.unlock();
+      auto result = runQuery(request);
+      lock.lock();
+
+      // The results of a query which timed out were already reported, and
+      // another thread has taken over the pending queries.
+      if (pool->running.erase(request.id) == 0) {
+        break;
+      }
+
+      pool->completed.push_back(std::move(result));
+      pool->cv.notify_all();
     }
+    pool->finished.insert(index);
+  };
+
+  auto thread_count = std::min<size_t>(
+      std::max(FLAGS_distributed_concurrency, 1U), queries.size());
+
+  std::vector<std::thread> threads;
+  std::vector<bool> timed_out(thread_count, false);
+  for (size_t i = 0; i < thread_count; ++i) {
+    threads.emplace_back(worker, i);
+  }
+
+  const auto timeout = std::chrono::seconds(FLAGS_distributed_query_timeout);
+  const auto flush_interval =
+      std::chrono::seconds(FLAGS_distributed_flush_interval);
+  auto last_flush = DistributedClock::now();
+
+  Status status;
+  size_t reported = 0;
+  size_t expected = queries.size();
+  size_t timed_out_count = 0;
+
+  std::unique_lock<std::mutex> lock(pool->mutex);
+  while (reported < expected) {
+    auto now = DistributedClock::now();
+    auto wake = DistributedClock::time_point::max();
+
+    if (timeout.count() > 0) {
+      for (auto it = pool->running.begin(); it != pool->running.end();) {
+        auto deadline = it->second.start + timeout;
+        if (deadline > now) {
+          wake = std::min(wake, deadline);
+          ++it;
+          continue;
+        }
 
-    // Keep track of the currently executing request
-    Distributed::setCurrentRequestId(request.id);
+        const auto& request = it->second.request;
+        LOG(ERROR) << "Distributed query timed out: " << request.id;
+
+        Status timeout_status(1, "Distributed query timed out");
+        pool->completed.emplace_back(request,
+                                     QueryData{},
+                                     ColumnNames{},
+                                     timeout_status,
+                                     timeout_status.getMessage());
+
+        // The query cannot be cancelled, so its thread is left to finish
+        // it while a new one executes the pending queries.
+        timed_out[it->second.worker] = true;
+        ++timed_out_count;
+        if (!pool->pending.empty() &&
+            timed_out_.size() + timed_out_count <= max_timed_out) {
+          threads.emplace_back(worker, threads.size());
+          timed_out.push_back(false);
+        }
+        it = pool->running.erase(it);
+      }
 
-    SQL sql(request.query);
-    const auto ok = sql.getStatus().ok();
-    const auto& msg = ok ? "" : sql.getMessageString();
-    if (!ok) {
-      LOG(ERROR) << "Error executing distributed query: " << request.id << ": "
-                 << msg;
+      // Without a thread left to execute them, the pending queries are
+      // returned to the database for the next run.
+      if (!pool->pending.empty() && timed_out_count == threads.size()) {
+        LOG(WARNING) << "Distributed queries are delayed, "
+                     << pool->pending.size()
+                     << " queries wait for timed out queries to finish";
+        for (const auto& request : pool->pending) {
+          setDatabaseValue(kDistributedQueries, request.id, request.query);
+        }
+        expected -= pool->pending.size();
+        pool->pending.clear();
+      }
+    }
+
+    if (!pool->completed.empty()) {
+      auto done = reported + pool->completed.size() == expected;
+      if (done || now - last_flush >= flush_interval) {
+        auto batch = std::move(pool->completed);
+        pool->completed.clear();
+        reported += batch.size();
+
+        lock.unlock();
+        for (const auto& result : batch) {
+          addResult(result);
+        }
+
+        // Keep the first error, later flushes also retry its results.
+        auto flush_status = flushCompleted();
+        if (status.ok()) {
+          status = flush_status;
+        }
+        last_flush = DistributedClock::now();
+        lock.lock();
+        continue;
+      }
+
+      wake = std::min(wake, last_flush + flush_interval);
+    }
+
+    // Wait for a result, the next deadline or the next flush.
+    if (wake == DistributedClock::time_point::max()) {
+      pool->cv.wait(lock);
+    } else {
+      pool->cv.wait_until(lock, wake);
     }
-    DistributedQueryResult result(
-        request, sql.rows(), sql.columns(), sql.getStatus(), msg);
-    addResult(result);
   }
-  return flushCompleted();
+  lock.unlock();
+
+  for (size_t i = 0; i < threads.size(); ++i) {
+    if (timed_out[i]) {
+      timed_out_.push_back({pool, i, std::move(threads[i])});
+    } else {
+      threads[i].join();
+    }
+  }
+
+  return status;
 }
 
 Status Distributed::flushCompleted() {
@@ -9,7 +9,9 @@
 
 #pragma once
 
+#include <memory>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include <osquery/core/plugins/plugin.h>
@@ -214,11 +216,16 @@ class DistributedPlugin : public Plugin {
  *   }
  * @endcode
  */
+struct DistributedQueryPool;
+
 class Distributed {
  public:
   /// Default constructor
   Distributed() {}
 
+  /// Wait for the threads of timed out queries to finish
+  ~Distributed();
+
   /// Retrieve queued queries from a remote server
   Status pullUpdates();
 
@@ -231,7 +238,20 @@ class Distributed {
   /// Serialize result data into a JSON string and clear the results
   Status serializeResults(std::string& json);
 
-  /// Process and execute queued queries
+  /**
+   * @brief Process and execute queued queries
+   *
+   * Up to distributed_concurrency queries are executed at the same time. The
+   * completed results are flushed in batches while other queries are still
+   * running, at most every distributed_flush_interval seconds. A query running
+   * for longer than distributed_query_timeout seconds is reported as failed
+   * and its results are dropped. The query cannot be canceled: its thread is
+   * left to finish it, and another one executes the pending queries. While
+   * distributed_concurrency timed out queries are still running, the pending
+   * queries are left in the database for a later call.
+   *
+   * @return the first error writing the results, if any.
+   */
   Status runQueries();
 
   // Getter for ID of currently executing request
@@ -256,6 +276,17 @@ class Distributed {
    */
   DistributedQueryRequest popRequest(std::string query);
 
+  /**
+   * @brief Execute a distributed query request
+   *
+   * This is called from the threads executing distributed queries.
+   *
+   * @param request is the DistributedQueryRequest to execute
+   * @return the DistributedQueryResult of the query
+   */
+  static DistributedQueryResult runQuery(
+      const DistributedQueryRequest& request);
+
   /**
    * @brief Queue a result to be batch sent to the server
    *
@@ -273,11 +304,28 @@ class Distributed {
 
   std::vector<DistributedQueryResult> results_;
 
-  // ID of the currently executing query
-  static std::string currentRequestId_;
+  // ID of the query executing on the current thread
+  static thread_local std::string currentRequestId_;
+
+ private:
+  /// A thread left to finish a query which timed out.
+  struct TimedOutWorker {
+    std::shared_ptr<DistributedQueryPool> pool;
+    size_t index{0};
+    std::thread thread;
+  };
+
+  /// Join the threads of timed out queries, wait for them or only if done.
+  void joinTimedOut(bool wait);
+
+  /// The threads of timed out queries, joined once they finish.
+  std::vector<TimedOutWorker> timed_out_;
 
  private:
   friend class DistributedTests;
   FRIEND_TEST(DistributedTests, test_workflow);
+  FRIEND_TEST(DistributedTests, test_concurrent_queries);
+  FRIEND_TEST(DistributedTests, test_query_timeout_pending);
+  FRIEND_TEST(DistributedTests, test_query_timeout_limit);
 };
 } // namespace osquery
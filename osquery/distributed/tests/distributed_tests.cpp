@@ -7,15 +7,19 @@
  * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
  */
 
+#include <chrono>
 #include <iostream>
+#include <thread>
 
 #include <gtest/gtest.h>
 
 #include <osquery/core/core.h>
+#include <osquery/core/tables.h>
 #include <osquery/database/database.h>
 #include <osquery/distributed/distributed.h>
 #include <osquery/registry/registry_factory.h>
 #include <osquery/remote/enroll/enroll.h>
+#include <osquery/sql/dynamic_table_row.h>
 #include <osquery/sql/sql.h>
 
 #include "osquery/remote/tests/test_utils.h"
@@ -27,6 +31,43 @@ namespace osquery {
 
 DECLARE_string(distributed_tls_read_endpoint);
 DECLARE_string(distributed_tls_write_endpoint);
+DECLARE_uint32(distributed_concurrency);
+DECLARE_uint32(distributed_query_timeout);
+DECLARE_uint32(distributed_flush_interval);
+
+class MockDistributedPlugin : public DistributedPlugin {
+ public:
+  Status getQueries(std::string& json) override {
+    json = "{}";
+    return Status::success();
+  }
+
+  Status writeResults(const std::string& json) override {
+    writes.push_back(json);
+    return Status::success();
+  }
+
+  std::vector<std::string> writes;
+};
+
+/// A table taking as long as a large hash or file query.
+class SlowTablePlugin : public TablePlugin {
+ private:
+  TableColumns columns() const override {
+    return {
+        std::make_tuple("value", INTEGER_TYPE, ColumnOptions::DEFAULT),
+    };
+  }
+
+ public:
+  TableRows generate(QueryContext&) override {
+    std::this_thread::sleep_for(std::chrono::seconds(3));
+
+    TableRows tr;
+    tr.push_back(make_table_row({{"value", "1"}}));
+    return tr;
+  }
+};
 
 class DistributedTests : public testing::Test {
  protected:
@@ -34,10 +75,20 @@ class DistributedTests : public testing::Test {
     platformSetup();
     registryAndPluginInit();
     initDatabasePluginForTesting();
+
+    distributed_plugin_ = RegistryFactory::get().getActive("distributed");
+    distributed_concurrency_ = FLAGS_distributed_concurrency;
+    distributed_query_timeout_ = FLAGS_distributed_query_timeout;
+    distributed_flush_interval_ = FLAGS_distributed_flush_interval;
   }
 
  protected:
   void TearDown() override {
+    Registry::get().setActive("distributed", distributed_plugin_);
+    FLAGS_distributed_concurrency = distributed_concurrency_;
+    FLAGS_distributed_query_timeout = distributed_query_timeout_;
+    FLAGS_distributed_flush_interval = distributed_flush_interval_;
+
     if (server_started_) {
       TLSServerRunner::stop();
       TLSServerRunner::unsetClientConfig();
@@ -50,6 +101,20 @@ class DistributedTests : public testing::Test {
     }
   }
 
+  /// Wait for the threads of timed out queries, up to a deadline.
+  bool joinTimedOut(Distributed& dist) {
+    auto deadline =
+        std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (std::chrono::steady_clock::now() < deadline) {
+      dist.joinTimedOut(false);
+      if (dist.timed_out_.empty()) {
+        return true;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+    return false;
+  }
+
   bool startServer() {
     if (!TLSServerRunner::start()) {
       return false;
@@ -75,6 +140,11 @@ class DistributedTests : public testing::Test {
   std::string distributed_tls_read_endpoint_;
   std::string distributed_tls_write_endpoint_;
 
+  std::string distributed_plugin_;
+  uint32_t distributed_concurrency_{0};
+  uint32_t distributed_query_timeout_{0};
+  uint32_t distributed_flush_interval_{0};
+
  private:
   bool server_started_{false};
 };
@@ -209,4 +279,139 @@ TEST_F(DistributedTests, test_workflow) {
   EXPECT_EQ(queries.size(), 0U);
   EXPECT_EQ(dist.results_.size(), 0U);
 }
+
+TEST_F(DistributedTests, test_concurrent_queries) {
+  FLAGS_distributed_concurrency = 2;
+  FLAGS_distributed_query_timeout = 1;
+  FLAGS_distributed_flush_interval = 0;
+
+  auto tables = RegistryFactory::get().registry("table");
+  tables->add("slow_table", std::make_shared<SlowTablePlugin>());
+  SQLiteDBManager::resetPrimary();
+
+  auto plugin = std::make_shared<MockDistributedPlugin>();
+  RegistryFactory::get().registry("distributed")->add("mock", plugin);
+  Registry::get().setActive("distributed", "mock");
+
+  setDatabaseValue(kDistributedQueries, "fast1", "select 1 as value");
+  setDatabaseValue(kDistributedQueries, "fast2", "select 2 as value");
+  setDatabaseValue(kDistributedQueries, "slow", "select * from slow_table");
+
+  auto dist = Distributed();
+  auto s = dist.runQueries();
+  ASSERT_TRUE(s.ok()) << s.getMessage();
+  EXPECT_TRUE(dist.getPendingQueries().empty());
+  EXPECT_EQ(dist.results_.size(), 0U);
+
+  // The fast queries are written before the slow one times out.
+  ASSERT_GE(plugin->writes.size(), 2U);
+  std::map<std::string, size_t> query_writes;
+  for (size_t i = 0; i < plugin->writes.size(); i++) {
+    auto doc = JSON::newObject();
+    ASSERT_TRUE(doc.fromString(plugin->writes[i]));
+    for (const auto& status : doc.doc()["statuses"].GetObject()) {
+      std::string id = status.name.GetString();
+      query_writes[id] = i;
+      EXPECT_EQ(status.value.GetInt(), (id == "slow") ? 1 : 0);
+    }
+
+    auto it = doc.doc()["messages"].FindMember("slow");
+    if (it != doc.doc()["messages"].MemberEnd()) {
+      EXPECT_EQ(std::string(it->value.GetString()),
+                "Distributed query timed out");
+      EXPECT_EQ(doc.doc()["queries"]["slow"].Size(), 0U);
+    }
+  }
+
+  ASSERT_EQ(query_writes.size(), 3U);
+  EXPECT_LT(query_writes["fast1"], query_writes["slow"]);
+  EXPECT_LT(query_writes["fast2"], query_writes["slow"]);
+
+  // The timed out query is still running, its thread is joined once done.
+  EXPECT_EQ(dist.timed_out_.size(), 1U);
+  EXPECT_TRUE(joinTimedOut(dist));
+}
+
+TEST_F(DistributedTests, test_query_timeout_pending) {
+  FLAGS_distributed_concurrency = 1;
+  FLAGS_distributed_query_timeout = 1;
+  FLAGS_distributed_flush_interval = 0;
+
+  auto tables = RegistryFactory::get().registry("table");
+  tables->add("slow_table", std::make_shared<SlowTablePlugin>());
+  SQLiteDBManager::resetPrimary();
+
+  auto plugin = std::make_shared<MockDistributedPlugin>();
+  RegistryFactory::get().registry("distributed")->add("mock", plugin);
+  Registry::get().setActive("distributed", "mock");
+
+  // The slow query is executed first, by the only thread.
+  setDatabaseValue(kDistributedQueries, "a_slow", "select * from slow_table");
+  setDatabaseValue(kDistributedQueries, "b_fast", "select 1 as value");
+
+  auto start = std::chrono::steady_clock::now();
+  auto dist = Distributed();
+  auto s = dist.runQueries();
+  ASSERT_TRUE(s.ok()) << s.getMessage();
+
+  // The pending query does not wait for the timed out one to end.
+  EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(3));
+  EXPECT_TRUE(dist.getPendingQueries().empty());
+
+  std::map<std::string, int> statuses;
+  for (const auto& write : plugin->writes) {
+    auto doc = JSON::newObject();
+    ASSERT_TRUE(doc.fromString(write));
+    for (const auto& status : doc.doc()["statuses"].GetObject()) {
+      statuses[status.name.GetString()] = status.value.GetInt();
+    }
+  }
+
+  ASSERT_EQ(statuses.size(), 2U);
+  EXPECT_EQ(statuses["a_slow"], 1);
+  EXPECT_EQ(statuses["b_fast"], 0);
+
+  EXPECT_EQ(dist.timed_out_.size(), 1U);
+  EXPECT_TRUE(joinTimedOut(dist));
+}
+
+TEST_F(DistributedTests, test_query_timeout_limit) {
+  FLAGS_distributed_concurrency = 1;
+  FLAGS_distributed_query_timeout = 1;
+  FLAGS_distributed_flush_interval = 0;
+
+  auto tables = RegistryFactory::get().registry("table");
+  tables->add("slow_table", std::make_shared<SlowTablePlugin>());
+  SQLiteDBManager::resetPrimary();
+
+  auto plugin = std::make_shared<MockDistributedPlugin>();
+  RegistryFactory::get().registry("distributed")->add("mock", plugin);
+  Registry::get().setActive("distributed", "mock");
+
+  // The second slow query times out on the thread replacing the first one.
+  setDatabaseValue(kDistributedQueries, "a_slow", "select * from slow_table");
+  setDatabaseValue(kDistributedQueries, "b_slow", "select * from slow_table");
+  setDatabaseValue(kDistributedQueries, "c_fast", "select 1 as value");
+
+  auto dist = Distributed();
+  auto s = dist.runQueries();
+  ASSERT_TRUE(s.ok()) << s.getMessage();
+
+  // No thread is left for the pending query, it is kept for the next run.
+  EXPECT_EQ(dist.timed_out_.size(), 2U);
+  EXPECT_EQ(dist.getPendingQueries(), std::vector<std::string>{"c_fast"});
+
+  // The query is not executed while the timed out ones are running.
+  auto writes = plugin->writes.size();
+  s = dist.runQueries();
+  ASSERT_TRUE(s.ok()) << s.getMessage();
+  EXPECT_EQ(plugin->writes.size(), writes);
+  EXPECT_EQ(dist.getPendingQueries(), std::vector<std::string>{"c_fast"});
+
+  ASSERT_TRUE(joinTimedOut(dist));
+  s = dist.runQueries();
+  ASSERT_TRUE(s.ok()) << s.getMessage();
+  EXPECT_TRUE(dist.getPendingQueries().empty());
+  EXPECT_EQ(plugin->writes.size(), writes + 1);
+}
 } // namespace osquery
@@ -10,13 +10,18 @@
 #include <benchmark/benchmark.h>
 
 #include <osquery/config/config.h>
+#include <osquery/core/flags.h>
+#include <osquery/core/sql/row_binary.h>
 #include <osquery/core/tables.h>
+#include <osquery/events/eventrowlist.h>
 #include <osquery/registry/registry_factory.h>
 
 #include "osquery/tests/test_util.h"
 
 namespace osquery {
 
+DECLARE_bool(events_binary_serialization);
+
 class BenchmarkEventPublisher
     : public EventPublisher<SubscriptionContext, EventContext> {
   DECLARE_PUBLISHER("benchmark");
@@ -190,4 +195,145 @@ BENCHMARK(EVENTS_add_and_gentable)
     ->ArgPair(0, 100)
     ->ArgPair(0, 1000)
     ->ArgPair(0, 10000);
+
+/// A process_events-like row, the subscribers store many of these.
+static Row getBenchmarkEventRow() {
+  Row r;
+  for (const auto& column : {"auid", "cwd", "egid", "euid", "gid", "mode",
+                             "owner_uid", "parent", "pid", "uid", "uptime"}) {
+    r[column] = "1000";
+  }
+  r["cmdline"] = "/usr/bin/python3 -m http.server --bind 127.0.0.1 8000";
+  r["path"] = "/usr/bin/python3";
+  r["time"] = "1600000000";
+  r["eid"] = "0000012345";
+  return r;
+}
+
+static void EVENTS_serialize_row_json(benchmark::State& state) {
+  auto r = getBenchmarkEventRow();
+
+  while (state.KeepRunning()) {
+    std::string serialized_row;
+    serializeRowJSON(r, serialized_row);
+  }
+}
+
+BENCHMARK(EVENTS_serialize_row_json);
+
+static void EVENTS_serialize_row_binary(benchmark::State& state) {
+  auto r = getBenchmarkEventRow();
+  RowColumnDictionary dictionary;
+
+  while (state.KeepRunning()) {
+    std::string serialized_row;
+    serializeRowBinary(r, dictionary, serialized_row);
+  }
+}
+
+BENCHMARK(EVENTS_serialize_row_binary);
+
+static void EVENTS_deserialize_row_json(benchmark::State& state) {
+  std::string serialized_row;
+  serializeRowJSON(getBenchmarkEventRow(), serialized_row);
+
+  while (state.KeepRunning()) {
+    Row r;
+    deserializeRowJSON(serialized_row, r);
+  }
+}
+
+BENCHMARK(EVENTS_deserialize_row_json);
+
+static void EVENTS_deserialize_row_binary(benchmark::State& state) {
+  RowColumnDictionary dictionary;
+  std::string serialized_row;
+  serializeRowBinary(getBenchmarkEventRow(), dictionary, serialized_row);
+
+  while (state.KeepRunning()) {
+    Row r;
+    deserializeRowBinary(serialized_row, dictionary, r);
+  }
+}
+
+BENCHMARK(EVENTS_deserialize_row_binary);
+
+/// Build and encode the rows of a batch of file events, as Row maps.
+static void EVENTS_build_rows(benchmark::State& state) {
+  RowColumnDictionary dictionary;
+  std::string serialized_row;
+
+  while (state.KeepRunning()) {
+    std::vector<Row> row_list;
+    for (int i = 0; i < state.range(0); i++) {
+      Row r;
+      r["operation"] = "write";
+      r["path"] = "/home/alessandro/test_file";
+      r["pid"] = std::to_string(1000 + i);
+      r["uid"] = std::to_string(1000);
+      r["uptime"] = std::to_string(123456);
+      row_list.push_back(std::move(r));
+    }
+
+    for (const auto& r : row_list) {
+      serializeRowBinary(r, dictionary, serialized_row);
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+BENCHMARK(EVENTS_build_rows)->Arg(100)->Arg(1000);
+
+/// Build and encode the same rows with a reused EventRowList.
+static void EVENTS_build_row_list(benchmark::State& state) {
+  RowColumnDictionary dictionary;
+  std::string serialized_row;
+  std::vector<RowColumnView> columns;
+  EventRowList row_list;
+
+  while (state.KeepRunning()) {
+    row_list.clear();
+    for (int i = 0; i < state.range(0); i++) {
+      row_list.addRow();
+      row_list.setColumn("operation", "write");
+      row_list.setColumn("path", "/home/alessandro/test_file");
+      row_list.setColumn("pid", 1000 + i);
+      row_list.setColumn("uid", 1000);
+      row_list.setColumn("uptime", 123456);
+    }
+
+    for (std::size_t i = 0; i < row_list.size(); i++) {
+      row_list.getColumns(i, columns);
+      serializeRowBinary(columns, dictionary, serialized_row);
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+BENCHMARK(EVENTS_build_row_list)->Arg(100)->Arg(1000);
+
+static void EVENTS_add_and_gentable_binary(benchmark::State& state) {
+  auto binary_serialization = FLAGS_events_binary_serialization;
+  FLAGS_events_binary_serialization = true;
+
+  auto sub = std::make_shared<BenchmarkEventSubscriber>();
+
+  while (state.KeepRunning()) {
+    for (int i = 0; i < state.range(1); i++) {
+      sub->benchmarkAdd(i++);
+    }
+
+    genRows(sub.get());
+  }
+
+  sub->clearRows();
+  FLAGS_events_binary_serialization = binary_serialization;
+}
+
+BENCHMARK(EVENTS_add_and_gentable_binary)
+    ->ArgPair(0, 100)
+    ->ArgPair(0, 1000)
+    ->ArgPair(0, 10000);
 } // namespace osquery
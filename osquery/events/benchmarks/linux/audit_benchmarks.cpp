@@ -0,0 +1,200 @@
+/**
+ * Copyright (c) 2014-present, The osquery authors
+ *
+ * This source code is licensed as defined by the LICENSE file found in the
+ * root directory of this source tree.
+ *
+ * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "osquery/events/linux/auditdnetlink.h"
+#include "osquery/events/linux/auditeventpublisher.h"
+
+namespace osquery {
+
+namespace {
+
+// clang-format off
+/// The records of an execve event, as received from the audit netlink.
+const std::vector<std::pair<int, std::string>> kExecveTrace = {
+  { 1300, "audit(1502125323.756:6): arch=c000003e syscall=59 success=yes "
+    "exit=0 a0=23eb8e0 a1=23ebbc0 a2=23c9860 a3=7ffe18d32ed0 items=2 "
+    "ppid=6882 pid=7841 auid=1000 uid=1000 gid=1000 euid=1000 suid=1000 "
+    "fsuid=1000 egid=1000 sgid=1000 fsgid=1000 tty=pts1 ses=2 "
+    "comm=\"sh\" exe=\"/usr/bin/bash\" "
+    "subj=unconfined_u:unconfined_r:unconfined_t:s0-s0:c0.c1023 key=(null)" },
+  { 1309, "audit(1502125323.756:6): argc=3 a0=\"sh\" a1=\"-c\" "
+    "a2=\"find /var/log -name '*.gz' -mtime +7 -delete\"" },
+  { 1307, "audit(1502125323.756:6):  cwd=\"/home/alessandro\"" },
+  { 1302, "audit(1502125323.756:6): item=0 name=\"/usr/bin/sh\" inode=18867 "
+    "dev=fd:00 mode=0100755 ouid=0 ogid=0 rdev=00:00 "
+    "obj=system_u:object_r:shell_exec_t:s0 objtype=NORMAL" },
+  { 1302, "audit(1502125323.756:6): item=1 "
+    "name=\"/lib64/ld-linux-x86-64.so.2\" inode=33604032 dev=fd:00 "
+    "mode=0100755 ouid=0 ogid=0 rdev=00:00 "
+    "obj=system_u:object_r:ld_so_t:s0 objtype=NORMAL" },
+  { 1327, "audit(1502125323.756:6): proctitle=7368002D630066696E64202F7661722F"
+    "6C6F67202D6E616D6520272A2E677A27202D6D74696D65202B37202D64656C657465" },
+  { 1320, "audit(1502125323.756:6): " }
+};
+// clang-format on
+
+/// The keys read by the publisher and the process_events subscriber.
+const std::vector<std::string> kSyscallKeys = {
+    "exe",  "syscall", "success", "pid",  "ppid", "uid",   "auid",
+    "euid", "fsuid",   "suid",    "gid",  "egid", "fsgid", "sgid"};
+
+std::vector<audit_reply> getTraceReplies() {
+  std::vector<audit_reply> replies;
+  for (const auto& record : kExecveTrace) {
+    audit_reply reply{};
+    reply.type = record.first;
+    reply.len = static_cast<int>(record.second.size());
+    reply.message = const_cast<char*>(record.second.data());
+    replies.push_back(reply);
+  }
+
+  return replies;
+}
+
+/// Replays the trace as netlink messages, with a distinct serial per event.
+std::vector<std::unique_ptr<AuditReplySlab>> getTraceSlabs(
+    std::size_t event_count, std::size_t shard_count) {
+  std::vector<std::unique_ptr<AuditReplySlab>> slabs;
+  for (std::size_t serial = 1; serial <= event_count; serial++) {
+    for (const auto& record : kExecveTrace) {
+      if (slabs.empty() || slabs.back()->count == kAuditSlabSize) {
+        slabs.push_back(std::make_unique<AuditReplySlab>());
+        slabs.back()->replies.resize(kAuditSlabSize);
+        slabs.back()->shards.resize(kAuditSlabSize);
+      }
+
+      auto message = "audit(1502125323.756:" + std::to_string(serial) +
+                     record.second.substr(record.second.find("): "));
+
+      auto& slab = *slabs.back();
+      auto& reply = slab.replies[slab.count];
+      reply.msg.nlh.nlmsg_type = static_cast<std::uint16_t>(record.first);
+      reply.msg.nlh.nlmsg_len = static_cast<std::uint32_t>(message.size());
+      std::memcpy(NLMSG_DATA(&reply.msg.nlh), message.data(), message.size());
+
+      AuditdNetlinkParser::AdjustAuditReply(reply);
+      slab.shards[slab.count] =
+          AuditdNetlinkParser::GetReplyShard(reply, shard_count);
+      slab.count++;
+    }
+  }
+
+  return slabs;
+}
+
+} // namespace
+
+static void AUDIT_tokenize_fields(benchmark::State& state) {
+  std::vector<AuditFieldView> fields;
+  while (state.KeepRunning()) {
+    for (const auto& record : kExecveTrace) {
+      auto text = std::string_view(record.second);
+      TokenizeAuditFields(text.substr(text.find("): ") + 3), fields);
+      benchmark::DoNotOptimize(fields.data());
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations() * kExecveTrace.size());
+}
+
+BENCHMARK(AUDIT_tokenize_fields);
+
+static void AUDIT_parse_reply(benchmark::State& state) {
+  auto replies = getTraceReplies();
+  AuditEventRecord record;
+  while (state.KeepRunning()) {
+    for (const auto& reply : replies) {
+      AuditdNetlinkParser::ParseAuditReply(reply, record);
+      benchmark::DoNotOptimize(record);
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations() * replies.size());
+}
+
+BENCHMARK(AUDIT_parse_reply);
+
+static void AUDIT_parse_reply_get_fields(benchmark::State& state) {
+  // What assembling a syscall event needs from its AUDIT_SYSCALL record.
+  auto replies = getTraceReplies();
+  AuditEventRecord record;
+  std::string_view value;
+  while (state.KeepRunning()) {
+    AuditdNetlinkParser::ParseAuditReply(replies.front(), record);
+    for (const auto& key : kSyscallKeys) {
+      record.fields.get(key, value);
+      benchmark::DoNotOptimize(value);
+    }
+  }
+}
+
+BENCHMARK(AUDIT_parse_reply_get_fields);
+
+static void AUDIT_parse_reply_materialize_fields(benchmark::State& state) {
+  // Owned strings for every field, what each record used to cost.
+  auto replies = getTraceReplies();
+  AuditEventRecord record;
+  while (state.KeepRunning()) {
+    for (const auto& reply : replies) {
+      AuditdNetlinkParser::ParseAuditReply(reply, record);
+      benchmark::DoNotOptimize(record.fields.map());
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations() * replies.size());
+}
+
+BENCHMARK(AUDIT_parse_reply_materialize_fields);
+
+static void AUDIT_pipeline_replay(benchmark::State& state) {
+  // Parse and assemble with a number of workers, as the parser workers do.
+  const auto shard_count = static_cast<std::size_t>(state.range(0));
+  const std::size_t kEventCount{1024};
+
+  auto slabs = getTraceSlabs(kEventCount, shard_count);
+  AuditEventAssembler assembler(shard_count, {});
+
+  while (state.KeepRunning()) {
+    std::vector<std::thread> workers;
+    for (std::size_t shard = 0; shard < shard_count; shard++) {
+      workers.emplace_back([&slabs, &assembler, shard]() {
+        std::vector<AuditEventRecord> records;
+        for (const auto& slab : slabs) {
+          records.clear();
+          AuditdNetlinkParser::ParseShard(
+              *slab, static_cast<std::uint32_t>(shard), records);
+          assembler.assemble(shard, records);
+        }
+      });
+    }
+
+    for (auto& worker : workers) {
+      worker.join();
+    }
+
+    auto events = assembler.takeEvents();
+    benchmark::DoNotOptimize(events.data());
+  }
+
+  state.SetItemsProcessed(state.iterations() * kEventCount *
+                          kExecveTrace.size());
+}
+
+BENCHMARK(AUDIT_pipeline_replay)->Arg(1)->Arg(2)->Arg(4)->Arg(8);
+
+} // namespace osquery
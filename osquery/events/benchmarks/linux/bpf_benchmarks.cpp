@@ -0,0 +1,107 @@
+/**
+ * Copyright (c) 2014-present, The osquery authors
+ *
+ * This source code is licensed as defined by the LICENSE file found in the
+ * root directory of this source tree.
+ *
+ * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <osquery/core/flags.h>
+#include <osquery/registry/registry_factory.h>
+#include <osquery/tables/events/linux/bpf_process_events.h>
+#include <osquery/tables/events/linux/bpf_socket_events.h>
+
+#include <memory>
+#include <string>
+
+namespace osquery {
+
+DECLARE_uint32(bpf_events_batch_latency);
+
+namespace {
+
+/// An execve followed by a connect, as emitted by the system state tracker.
+ISystemStateTracker::EventList getSyntheticEventList(std::size_t event_count) {
+  ISystemStateTracker::EventList event_list;
+
+  for (std::size_t i = 0U; i < event_count; ++i) {
+    ISystemStateTracker::Event event{};
+    event.bpf_header.timestamp = 1234567890ULL + i;
+    event.bpf_header.thread_id = 1001 + static_cast<pid_t>(i);
+    event.bpf_header.process_id = event.bpf_header.thread_id;
+    event.bpf_header.user_id = 1000;
+    event.bpf_header.group_id = 1000;
+    event.parent_process_id = 1000;
+    event.binary_path = "/usr/bin/curl";
+    event.cwd = "/home/alessandro";
+
+    if ((i % 2U) == 0U) {
+      ISystemStateTracker::Event::ExecData exec_data;
+      exec_data.argv = {"curl", "-s", "https://osquery.io"};
+
+      event.type = ISystemStateTracker::Event::Type::Exec;
+      event.data = std::move(exec_data);
+
+    } else {
+      ISystemStateTracker::Event::SocketData socket_data;
+      socket_data.domain = 2;
+      socket_data.type = 1;
+      socket_data.protocol = 6;
+      socket_data.fd = 3;
+      socket_data.remote_address = "104.18.2.12";
+      socket_data.remote_port = 443;
+
+      event.type = ISystemStateTracker::Event::Type::Connect;
+      event.data = std::move(socket_data);
+    }
+
+    event_list.push_back(std::move(event));
+  }
+
+  return event_list;
+}
+
+} // namespace
+
+/// Fires lists of range(0) events, holding rows for up to range(1) ms.
+static void BPF_store_events(benchmark::State& state) {
+  RegistryFactory::get().setActive("database", "rocksdb");
+
+  auto batch_latency = FLAGS_bpf_events_batch_latency;
+  FLAGS_bpf_events_batch_latency = static_cast<std::uint32_t>(state.range(1));
+
+  auto process_subscriber = std::make_shared<BPFProcessEventSubscriber>();
+  process_subscriber->setName("bpf_process_events");
+
+  auto socket_subscriber = std::make_shared<BPFSocketEventSubscriber>();
+  socket_subscriber->setName("bpf_socket_events");
+
+  auto event_context = std::make_shared<BPFEventEC>();
+  event_context->event_list =
+      getSyntheticEventList(static_cast<std::size_t>(state.range(0)));
+
+  while (state.KeepRunning()) {
+    process_subscriber->eventCallback(event_context, nullptr);
+    socket_subscriber->eventCallback(event_context, nullptr);
+  }
+
+  // Store the rows that are still pending
+  process_subscriber->tearDown();
+  socket_subscriber->tearDown();
+
+  FLAGS_bpf_events_batch_latency = batch_latency;
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+BENCHMARK(BPF_store_events)
+    ->ArgPair(1, 0)
+    ->ArgPair(16, 0)
+    ->ArgPair(256, 0)
+    ->ArgPair(1, 1000)
+    ->ArgPair(16, 1000)
+    ->ArgPair(256, 1000);
+
+} // namespace osquery
@@ -34,6 +34,40 @@ struct SubscriberExpirationDetails {
   size_t query_count{0};
 };
 
+/// Read the columns a subscriber should not store from the "events" config.
+EventColumnSetRef getConfiguredExcludedColumns(const std::string& subscriber) {
+  auto plugin = Config::get().getParser("events");
+  if (plugin == nullptr || plugin.get() == nullptr) {
+    return nullptr;
+  }
+
+  const auto& data = plugin->getData().doc();
+  if (!data.HasMember("events") ||
+      !data["events"].HasMember("exclude_columns") ||
+      !data["events"]["exclude_columns"].IsObject()) {
+    return nullptr;
+  }
+
+  const auto& exclude_columns = data["events"]["exclude_columns"];
+  auto it = exclude_columns.FindMember(subscriber);
+  if (it == exclude_columns.MemberEnd() || !it->value.IsArray()) {
+    return nullptr;
+  }
+
+  auto columns = std::make_shared<EventColumnSet>();
+  for (const auto& column : it->value.GetArray()) {
+    if (column.IsString()) {
+      columns->insert(column.GetString());
+    }
+  }
+
+  if (columns->empty()) {
+    return nullptr;
+  }
+
+  return columns;
+}
+
 } // namespace
 
 FLAG(bool, disable_events, false, "Disable osquery publish/subscribe system");
@@ -85,6 +119,8 @@ Status EventFactory::registerEventSubscriber(const PluginRef& sub) {
     }
   }
 
+  base_sub->setExcludedColumns(getConfiguredExcludedColumns(name));
+
   if (base_sub->state() != EventState::EVENT_NONE) {
     base_sub->tearDown();
   }
@@ -297,6 +333,10 @@ void EventFactory::addForwarder(const std::string& logger) {
   getInstance().loggers_.push_back(logger);
 }
 
+bool EventFactory::hasForwarders() {
+  return !getInstance().loggers_.empty();
+}
+
 void EventFactory::forwardEvent(const std::string& event) {
   for (const auto& logger : getInstance().loggers_) {
     Registry::call("logger", logger, {{"event", event}});
@@ -356,6 +396,14 @@ void EventFactory::configUpdate() {
     subscriber->resetQueryCount(details.second.query_count);
   }
 
+  {
+    RecursiveLock lock(ef.factory_lock_);
+    for (const auto& subscriber : ef.event_subs_) {
+      subscriber.second->setExcludedColumns(
+          getConfiguredExcludedColumns(subscriber.first));
+    }
+  }
+
   // If events are enabled configure the subscribers before publishers.
   if (!FLAGS_disable_events) {
     RegistryFactory::get().registry("event_subscriber")->configure();
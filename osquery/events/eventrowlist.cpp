@@ -0,0 +1,123 @@
+/**
+ * Copyright (c) 2014-present, The osquery authors
+ *
+ * This source code is licensed as defined by the LICENSE file found in the
+ * root directory of this source tree.
+ *
+ * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
+ */
+
+#include <algorithm>
+
+#include <osquery/events/eventrowlist.h>
+
+namespace osquery {
+
+void EventRowList::setExcludedColumns(EventColumnSetRef excluded_columns) {
+  excluded_columns_ = std::move(excluded_columns);
+}
+
+bool EventRowList::isStored(std::string_view column) const {
+  return excluded_columns_ == nullptr ||
+         excluded_columns_->find(column) == excluded_columns_->end();
+}
+
+void EventRowList::addRow() {
+  row_list_.push_back(column_list_.size());
+}
+
+void EventRowList::discardRow() {
+  if (row_list_.empty()) {
+    return;
+  }
+
+  auto first_column = row_list_.back();
+  row_list_.pop_back();
+
+  if (first_column < column_list_.size()) {
+    value_buffer_.resize(column_list_[first_column].offset);
+  }
+
+  column_list_.resize(first_column);
+}
+
+void EventRowList::setColumn(std::string_view column, std::string_view value) {
+  if (!isStored(column)) {
+    return;
+  }
+
+  appendColumn(column, value);
+}
+
+void EventRowList::appendColumn(std::string_view column,
+                                std::string_view value) {
+  if (row_list_.empty()) {
+    addRow();
+  }
+
+  column_list_.push_back({column, value_buffer_.size(), value.size()});
+  value_buffer_.append(value.data(), value.size());
+}
+
+std::size_t EventRowList::size() const {
+  return row_list_.size();
+}
+
+bool EventRowList::empty() const {
+  return row_list_.empty();
+}
+
+void EventRowList::clear() {
+  value_buffer_.clear();
+  column_list_.clear();
+  row_list_.clear();
+}
+
+void EventRowList::getColumns(std::size_t index,
+                              std::vector<RowColumnView>& columns) const {
+  columns.clear();
+
+  auto first_column = row_list_.at(index);
+  auto last_column = index + 1 < row_list_.size() ? row_list_[index + 1]
+                                                  : column_list_.size();
+
+  for (auto i = first_column; i < last_column; ++i) {
+    const auto& column = column_list_[i];
+    columns.emplace_back(
+        column.name,
+        std::string_view(value_buffer_.data() + column.offset, column.size));
+  }
+
+  std::stable_sort(columns.begin(),
+                   columns.end(),
+                   [](const RowColumnView& lhs, const RowColumnView& rhs) {
+                     return lhs.first < rhs.first;
+                   });
+
+  // Keep the last value of the columns that were set more than once.
+  auto output = columns.begin();
+  for (auto it = columns.begin(); it != columns.end(); ++it) {
+    auto next = std::next(it);
+    if (next == columns.end() || next->first != it->first) {
+      *output++ = *it;
+    }
+  }
+
+  columns.erase(output, columns.end());
+}
+
+Row EventRowList::getRow(std::size_t index) const {
+  std::vector<RowColumnView> columns;
+  getColumns(index, columns);
+
+  Row row;
+  for (const auto& column : columns) {
+    row.emplace_hint(row.end(),
+                     std::string(column.first),
+                     RowData(column.second.data(), column.second.size()));
+  }
+
+  return row;
+}
+
+} // namespace osquery
@@ -0,0 +1,122 @@
+/**
+ * Copyright (c) 2014-present, The osquery authors
+ *
+ * This source code is licensed as defined by the LICENSE file found in the
+ * root directory of this source tree.
+ *
+ * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
+ */
+
+#pragma once
+
+#include <charconv>
+#include <memory>
+#include <set>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include <osquery/core/sql/row.h>
+
+namespace osquery {
+
+/// A set of column names, searchable without building a string.
+using EventColumnSet = std::set<std::string, std::less<>>;
+
+/// Columns a subscriber should not store, see the "events" configuration.
+using EventColumnSetRef = std::shared_ptr<const EventColumnSet>;
+
+/**
+ * @brief A list of event rows, built without a Row for each event.
+ *
+ * Subscribers emitting many events append their columns to a single value
+ * buffer, with integers formatted in place. The buffers are kept when the
+ * list is cleared, so a subscriber can reuse one list for every callback.
+ * Rows are serialized directly from the buffer when they are stored with
+ * EventSubscriberPlugin::addBatch, and are only materialized as a Row on
+ * request.
+ *
+ * Column names are not copied: they must outlive the list, which is the
+ * case for string literals. Columns excluded through setExcludedColumns are
+ * ignored when set; isStored() allows skipping the computation of their
+ * values altogether.
+ */
+class EventRowList final {
+ public:
+  /// Set the columns that are not stored.
+  void setExcludedColumns(EventColumnSetRef excluded_columns);
+
+  /// Check if a column is stored, to avoid computing ignored values.
+  bool isStored(std::string_view column) const;
+
+  /// Start a new row, the columns that follow are added to it.
+  void addRow();
+
+  /// Remove the last row, along with its columns.
+  void discardRow();
+
+  /// Set a column of the last row.
+  void setColumn(std::string_view column, std::string_view value);
+
+  /// Set a column of the last row, formatting an integer in place.
+  template <typename Integer,
+            typename = std::enable_if_t<std::is_integral<Integer>::value &&
+                                        !std::is_same<Integer, bool>::value>>
+  void setColumn(std::string_view column, Integer value) {
+    if (!isStored(column)) {
+      return;
+    }
+
+    char buffer[24];
+    auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    appendColumn(column,
+                 std::string_view(buffer, static_cast<std::size_t>(
+                                              result.ptr - buffer)));
+  }
+
+  /// Number of rows.
+  std::size_t size() const;
+
+  /// Check if the list has no rows.
+  bool empty() const;
+
+  /// Remove all rows, keeping the allocated buffers.
+  void clear();
+
+  /**
+   * @brief Get the columns of a row, sorted by name.
+   *
+   * If a column was set more than once, the last value is used. The views
+   * refer to the list buffers and are invalidated when the list changes.
+   *
+   * @param index the row index.
+   * @param columns [output] the columns of the row.
+   */
+  void getColumns(std::size_t index, std::vector<RowColumnView>& columns) const;
+
+  /// Materialize a row.
+  Row getRow(std::size_t index) const;
+
+ private:
+  struct Column final {
+    std::string_view name;
+    std::size_t offset{0U};
+    std::size_t size{0U};
+  };
+
+  void appendColumn(std::string_view column, std::string_view value);
+
+  EventColumnSetRef excluded_columns_;
+
+  /// The values of every column, one after the other.
+  std::string value_buffer_;
+
+  /// The columns of every row, one after the other.
+  std::vector<Column> column_list_;
+
+  /// Index of the first column of each row.
+  std::vector<std::size_t> row_list_;
+};
+
+} // namespace osquery
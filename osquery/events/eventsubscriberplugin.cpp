@@ -7,6 +7,8 @@
  * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
  */
 
+#include <algorithm>
+
 #include <osquery/config/config.h>
 #include <osquery/core/flags.h>
 #include <osquery/database/database.h>
@@ -21,11 +23,19 @@
 
 namespace osquery {
 
+DECLARE_bool(events_binary_serialization);
+
 namespace {
 
 /// Checkpoint interval to inspect max event buffering.
 const EventContextID kEventsCheckpoint{256U};
 
+/// Use a range scan if at least 1 in N of the keys in the range is selected.
+const std::size_t kEventsRangeDensity{2U};
+
+/// Number of events read by a range scan before their rows are yielded.
+const std::size_t kEventsRangeBatch{1024U};
+
 void removeDeprecatedEventKeysOnceHelper() {
   std::vector<std::string> key_list;
   auto status = scanDatabaseKeys(kEvents, key_list);
@@ -68,6 +78,32 @@ void removeDeprecatedEventKeysOnce() {
   std::call_once(f, removeDeprecatedEventKeysOnceHelper);
 }
 
+/// Encode an event row as a single line of JSON.
+Status serializeEventRowJSON(const Row& row, std::string& serialized_row) {
+  auto status = serializeRowJSON(row, serialized_row);
+  if (!status.ok()) {
+    return status;
+  }
+
+  // Then remove the newline.
+  if (serialized_row.size() > 0 && serialized_row.back() == '\n') {
+    serialized_row.pop_back();
+  }
+
+  return Status::success();
+}
+
+/// Decode a stored event row in either the binary or the JSON encoding.
+Status deserializeEventRow(const RowColumnDictionary& dictionary,
+                           const std::string& serialized_row,
+                           Row& row) {
+  if (isBinaryRow(serialized_row)) {
+    return deserializeRowBinary(serialized_row, dictionary, row);
+  }
+
+  return deserializeRowJSON(serialized_row, row);
+}
+
 } // namespace
 
 FLAG(bool,
@@ -121,7 +157,15 @@ Status EventSubscriberPlugin::addBatch(std::vector<Row>& row_list,
   auto event_time = custom_event_time != 0 ? custom_event_time : getTime();
   auto string_event_time = std::to_string(event_time);
 
+  auto excluded_columns = getExcludedColumns();
+
   for (auto& row : row_list) {
+    if (excluded_columns != nullptr) {
+      for (const auto& column : *excluded_columns) {
+        row.erase(column);
+      }
+    }
+
     auto event_identifier = getEventID();
     event_id_list.push_back(event_identifier);
 
@@ -132,20 +176,27 @@ Status EventSubscriberPlugin::addBatch(std::vector<Row>& row_list,
 
     // Serialize and store the row data, for query-time retrieval.
     std::string serialized_row;
-    auto status = serializeRowJSON(row, serialized_row);
-    if (!status.ok()) {
-      VLOG(1) << status.getMessage();
-      continue;
-    }
+    if (FLAGS_events_binary_serialization) {
+      serializeRowBinary(row, context.column_dictionary, serialized_row);
+
+      // Forwarded events are always JSON, only encode them when needed.
+      std::string json_row;
+      if (EventFactory::hasForwarders() &&
+          serializeEventRowJSON(row, json_row).ok()) {
+        EventFactory::forwardEvent(json_row);
+      }
 
-    // Then remove the newline.
-    if (serialized_row.size() > 0 && serialized_row.back() == '\n') {
-      serialized_row.pop_back();
-    }
+    } else {
+      auto status = serializeEventRowJSON(row, serialized_row);
+      if (!status.ok()) {
+        VLOG(1) << status.getMessage();
+        continue;
+      }
 
-    // Logger plugins may request events to be forwarded directly.
-    // If no active logger is marked 'usesLogEvent' then this is a no-op.
-    EventFactory::forwardEvent(serialized_row);
+      // Logger plugins may request events to be forwarded directly.
+      // If no active logger is marked 'usesLogEvent' then this is a no-op.
+      EventFactory::forwardEvent(serialized_row);
+    }
 
     // Store the event data in the batch
     database_data.push_back(
@@ -153,6 +204,94 @@ Status EventSubscriberPlugin::addBatch(std::vector<Row>& row_list,
                        serialized_row));
   }
 
+  return storeBatch(database_data, event_id_list, event_time);
+}
+
+Status EventSubscriberPlugin::addBatch(const EventRowList& row_list) {
+  removeDeprecatedEventKeysOnce();
+
+  DatabaseStringValueList database_data;
+  database_data.reserve(row_list.size());
+
+  EventIDList event_id_list;
+  event_id_list.reserve(row_list.size());
+
+  auto event_time = getTime();
+  auto string_event_time = std::to_string(event_time);
+
+  auto excluded_columns = getExcludedColumns();
+  auto key_prefix = "data." + dbNamespace() + ".";
+
+  // The column views are reused for every row.
+  std::vector<RowColumnView> columns;
+
+  for (std::size_t i = 0; i < row_list.size(); ++i) {
+    auto event_identifier = getEventID();
+    event_id_list.push_back(event_identifier);
+
+    auto string_event_identifier = toIndex(event_identifier);
+
+    row_list.getColumns(i, columns);
+    if (excluded_columns != nullptr) {
+      columns.erase(std::remove_if(columns.begin(),
+                                   columns.end(),
+                                   [&](const RowColumnView& column) {
+                                     return excluded_columns->count(
+                                                column.first) != 0;
+                                   }),
+                    columns.end());
+    }
+
+    // Add the time and eid columns, keeping the columns sorted by name.
+    for (const auto& column :
+         {RowColumnView{"eid", string_event_identifier},
+          RowColumnView{"time", string_event_time}}) {
+      auto it = std::lower_bound(
+          columns.begin(),
+          columns.end(),
+          column,
+          [](const RowColumnView& lhs, const RowColumnView& rhs) {
+            return lhs.first < rhs.first;
+          });
+
+      if (it != columns.end() && it->first == column.first) {
+        *it = column;
+      } else {
+        columns.insert(it, column);
+      }
+    }
+
+    // Serialize and store the row data, for query-time retrieval.
+    std::string serialized_row;
+    if (FLAGS_events_binary_serialization) {
+      serializeRowBinary(columns, context.column_dictionary, serialized_row);
+
+      // Forwarded events are always JSON, only encode them when needed.
+      std::string json_row;
+      if (EventFactory::hasForwarders() &&
+          serializeRowJSON(columns, json_row).ok()) {
+        EventFactory::forwardEvent(json_row);
+      }
+
+    } else {
+      serializeRowJSON(columns, serialized_row);
+
+      // Logger plugins may request events to be forwarded directly.
+      // If no active logger is marked 'usesLogEvent' then this is a no-op.
+      EventFactory::forwardEvent(serialized_row);
+    }
+
+    database_data.push_back(std::make_pair(key_prefix + string_event_identifier,
+                                           std::move(serialized_row)));
+  }
+
+  return storeBatch(database_data, event_id_list, event_time);
+}
+
+Status EventSubscriberPlugin::storeBatch(
+    DatabaseStringValueList& database_data,
+    const EventIDList& event_id_list,
+    EventTime event_time) {
   if (database_data.empty()) {
     return Status(1, "Failed to process the rows");
   }
@@ -163,11 +302,22 @@ Status EventSubscriberPlugin::addBatch(std::vector<Row>& row_list,
   {
     WriteLock lock(event_id_lock_);
 
+    // Columns added while encoding are stored along with the rows using them.
+    std::size_t column_count{context.stored_column_count};
+    if (context.column_dictionary.size() != column_count) {
+      std::string serialized_dictionary;
+      column_count = context.column_dictionary.serialize(serialized_dictionary);
+      database_data.push_back(std::make_pair("columns." + dbNamespace(),
+                                             serialized_dictionary));
+    }
+
     auto status = setDatabaseBatch(kEvents, database_data);
     if (!status.ok()) {
       return status;
     }
 
+    context.stored_column_count = column_count;
+
     auto it = context.event_index.find(event_time);
     if (it == context.event_index.end()) {
       context.event_index.insert({event_time, event_id_list});
@@ -178,9 +328,10 @@ Status EventSubscriberPlugin::addBatch(std::vector<Row>& row_list,
           index_entry.end(), event_id_list.begin(), event_id_list.end());
     }
 
-    cleanup_events = (((event_count_ % kEventsCheckpoint) + row_list.size()) >=
-                      kEventsCheckpoint);
-    event_count_ += row_list.size();
+    cleanup_events =
+        (((event_count_ % kEventsCheckpoint) + event_id_list.size()) >=
+         kEventsCheckpoint);
+    event_count_ += event_id_list.size();
   }
 
   // Use the last EventID and a checkpoint bucket size to periodically apply
@@ -194,6 +345,17 @@ Status EventSubscriberPlugin::addBatch(std::vector<Row>& row_list,
   return Status::success();
 }
 
+EventColumnSetRef EventSubscriberPlugin::getExcludedColumns() const {
+  ReadLock lock(excluded_columns_lock_);
+  return excluded_columns_;
+}
+
+void EventSubscriberPlugin::setExcludedColumns(
+    EventColumnSetRef excluded_columns) {
+  WriteLock lock(excluded_columns_lock_);
+  excluded_columns_ = std::move(excluded_columns);
+}
+
 Status EventSubscriberPlugin::generateEventDataIndex() {
   return generateEventDataIndex(context, getDatabase());
 }
@@ -254,7 +416,8 @@ uint64_t EventSubscriberPlugin::getExpireTime() {
 void EventSubscriberPlugin::generateRows(std::function<void(Row)> callback,
                                          bool can_optimize,
                                          EventTime start_time,
-                                         EventTime stop_time) {
+                                         EventTime stop_time,
+                                         const EventIDSet& eid_filter) {
   EventTime optimize_time{0U};
   EventID optimize_eid{0U};
   if (can_optimize && shouldOptimize()) {
@@ -274,7 +437,8 @@ void EventSubscriberPlugin::generateRows(std::function<void(Row)> callback,
                              callback,
                              start_time,
                              stop_time,
-                             optimize_eid);
+                             optimize_eid,
+                             eid_filter);
 
     if (can_optimize && shouldOptimize()) {
       if (last != this->context.event_index.end()) {
@@ -314,11 +478,20 @@ void EventSubscriberPlugin::genTable(RowYield& yield, QueryContext& context) {
     }
   }
 
+  // Use 'eid' equality constraints to read only the selected events.
+  EventIDSet eid_filter;
+  if (context.constraints["eid"].exists(EQUALS)) {
+    can_optimize = false;
+    for (const auto& eid : context.constraints["eid"].getAll(EQUALS)) {
+      eid_filter.insert(tryTo<EventID>(eid).takeOr(EventID{0}));
+    }
+  }
+
   auto generateRowsCallback = [&yield](Row row) {
     yield(TableRowHolder(new DynamicTableRow(std::move(row))));
   };
 
-  generateRows(generateRowsCallback, can_optimize, start, stop);
+  generateRows(generateRowsCallback, can_optimize, start, stop, eid_filter);
 }
 
 size_t EventSubscriberPlugin::numSubscriptions() const {
@@ -346,13 +519,17 @@ void EventSubscriberPlugin::setOptimizeData(IDatabaseInterface& db_interface,
                                             EventTime time,
                                             EventID eid) {
   // Store the optimization time and eid.
-  std::string query_name;
-  db_interface.getDatabaseValue(
-      kPersistentSettings, kExecutingQuery, query_name);
-  if (query_name.empty()) {
+  std::string content;
+  db_interface.getDatabaseValue(kPersistentSettings, kExecutingQuery, content);
+
+  // Concurrent executions cannot be told apart, do not optimize.
+  auto executing_queries = parseExecutingQueries(content);
+  if (executing_queries.size() != 1) {
     return;
   }
 
+  const auto& query_name = executing_queries[0];
+
   db_interface.setDatabaseValue(
       kEvents, "optimize." + query_name, std::to_string(time));
 
@@ -370,15 +547,20 @@ void EventSubscriberPlugin::getOptimizeData(IDatabaseInterface& db_interface,
                                             EventID& o_eid,
                                             std::string& query_name) {
   // Read the optimization time for the current executing query.
+  std::string executing_query;
   db_interface.getDatabaseValue(
-      kPersistentSettings, kExecutingQuery, query_name);
+      kPersistentSettings, kExecutingQuery, executing_query);
 
-  if (query_name.empty()) {
+  auto executing_queries = parseExecutingQueries(executing_query);
+  if (executing_queries.size() != 1) {
+    query_name.clear();
     o_time = 0;
     o_eid = 0;
     return;
   }
 
+  query_name = executing_queries[0];
+
   {
     std::string content;
     db_interface.getDatabaseValue(kEvents, "optimize." + query_name, content);
@@ -406,6 +588,24 @@ void EventSubscriberPlugin::setDatabaseNamespace(Context& context,
 
 Status EventSubscriberPlugin::generateEventDataIndex(
     Context& context, IDatabaseInterface& db_interface) {
+  // Binary encoded rows need the column dictionary of this subscriber.
+  {
+    std::string serialized_dictionary;
+    auto status =
+        db_interface.getDatabaseValue(kEvents,
+                                      "columns." + context.database_namespace,
+                                      serialized_dictionary);
+    if (status.ok()) {
+      status = context.column_dictionary.deserialize(serialized_dictionary);
+      if (!status.ok()) {
+        LOG(ERROR) << "Invalid column dictionary for subscriber "
+                   << context.database_namespace;
+      }
+    }
+
+    context.stored_column_count = context.column_dictionary.size();
+  }
+
   std::vector<std::string> key_list;
 
   std::string prefix = "data." + context.database_namespace + ".";
@@ -450,7 +650,8 @@ Status EventSubscriberPlugin::generateEventDataIndex(
       }
 
       Row row;
-      if (!deserializeRowJSON(serialized_row, row)) {
+      if (!deserializeEventRow(
+              context.column_dictionary, serialized_row, row)) {
         invalid_data_key_list.push_back(key);
         continue;
       }
@@ -641,7 +842,8 @@ EventIndex::iterator EventSubscriberPlugin::generateRows(
     std::function<void(Row)> callback,
     EventTime start_time,
     EventTime end_time,
-    EventID last_eid) {
+    EventID last_eid,
+    const EventIDSet& eid_filter) {
   auto last = context.event_index.end();
   if (end_time != 0 && start_time > end_time) {
     return last;
@@ -662,34 +864,113 @@ EventIndex::iterator EventSubscriberPlugin::generateRows(
                             ? context.event_index.end()
                             : context.event_index.upper_bound(end_time);
 
-  std::vector<std::string> invalid_key_list;
+  // Select the events within the window from the in-memory index first.
+  std::vector<EventID> event_id_list;
   for (auto it = lower_bound_it; it != upper_bound_it; ++it) {
-    const auto& event_id_list = it->second;
-
-    for (const auto& event_identifier : event_id_list) {
+    for (const auto& event_identifier : it->second) {
       if (last_eid >= event_identifier) {
         // A previous optimized query has already visited this event.
         continue;
       }
-      auto key = databaseKeyForEventId(context, event_identifier);
-
-      std::string serialized_row;
-      auto status = db_interface.getDatabaseValue(kEvents, key, serialized_row);
-      if (serialized_row.empty()) {
-        invalid_key_list.push_back(key);
+      if (!eid_filter.empty() && eid_filter.count(event_identifier) == 0) {
         continue;
       }
+      event_id_list.push_back(event_identifier);
+    }
+    last = it;
+  }
+
+  if (event_id_list.empty()) {
+    return last;
+  }
+
+  // Event IDs increase with time, so the list is nearly sorted.
+  std::sort(event_id_list.begin(), event_id_list.end());
+
+  std::vector<std::string> invalid_key_list;
+  auto emitRow = [&context, &callback, &invalid_key_list](
+                     const std::string& key,
+                     const std::string& serialized_row) {
+    if (serialized_row.empty()) {
+      invalid_key_list.push_back(key);
+      return;
+    }
+
+    Row row = {};
+    auto status =
+        deserializeEventRow(context.column_dictionary, serialized_row, row);
+    if (!status.ok()) {
+      invalid_key_list.push_back(key);
+      return;
+    }
+
+    callback(std::move(row));
+  };
+
+  auto low_key = databaseKeyForEventId(context, event_id_list.front());
+  auto high_key = databaseKeyForEventId(context, event_id_list.back());
+  auto span = event_id_list.back() - event_id_list.front() + 1;
+
+  // Keys sort like their event ids while they have the same number of digits.
+  auto next = event_id_list.begin();
+  if (low_key.size() == high_key.size() &&
+      event_id_list.size() * kEventsRangeDensity >= span) {
+    // Most of the keys between the first and last event are selected, stream
+    // them with an ordered range scan instead of looking up each event.
+    auto prefix_size = low_key.size() - toIndex(event_id_list.front()).size();
+
+    // The scan holds the database lock and an iterator, so rows are only
+    // yielded between scans. Each scan resumes from the next selected event.
+    std::vector<std::pair<std::string, std::string>> batch;
+    auto status = Status::success();
+    bool batch_full = true;
+    while (batch_full && next != event_id_list.end()) {
+      batch_full = false;
+      status = db_interface.scanDatabaseRange(
+          kEvents,
+          databaseKeyForEventId(context, *next),
+          high_key,
+          [&](const std::string& key, const std::string& value) {
+            auto event_identifier =
+                tryTo<EventID>(key.substr(prefix_size)).takeOr(EventID{0});
+            while (next != event_id_list.end() && *next < event_identifier) {
+              // The selected event is missing from the store.
+              invalid_key_list.push_back(
+                  databaseKeyForEventId(context, *next));
+              ++next;
+            }
+            if (next != event_id_list.end() && *next == event_identifier) {
+              ++next;
+              batch.emplace_back(key, value);
+            }
+            batch_full = batch.size() >= kEventsRangeBatch;
+            return !batch_full && next != event_id_list.end();
+          });
+
+      for (const auto& item : batch) {
+        emitRow(item.first, item.second);
+      }
+      batch.clear();
 
-      Row row = {};
-      status = deserializeRowJSON(serialized_row, row);
       if (!status.ok()) {
-        invalid_key_list.push_back(key);
-        continue;
+        break;
       }
+    }
 
-      callback(std::move(row));
+    if (status.ok()) {
+      for (; next != event_id_list.end(); ++next) {
+        invalid_key_list.push_back(databaseKeyForEventId(context, *next));
+      }
     }
-    last = it;
+  }
+
+  // Look up each remaining event, for sparse selections or a failed scan.
+  for (; next != event_id_list.end(); ++next) {
+    auto key = databaseKeyForEventId(context, *next);
+
+    std::string serialized_row;
+    db_interface.getDatabaseValue(kEvents, key, serialized_row);
+    emitRow(key, serialized_row);
   }
 
   if (!invalid_key_list.empty()) {
@@ -12,9 +12,11 @@
 #include <gtest/gtest_prod.h>
 
 #include <osquery/core/plugins/plugin.h>
+#include <osquery/core/sql/row_binary.h>
 #include <osquery/core/tables.h>
 #include <osquery/database/database.h>
 #include <osquery/events/eventer.h>
+#include <osquery/events/eventrowlist.h>
 #include <osquery/events/types.h>
 #include <osquery/utils/mutex.h>
 
@@ -66,11 +68,42 @@ class EventSubscriberPlugin : public Plugin, public Eventer {
    */
   Status addBatch(std::vector<Row>& row_list);
 
+  /**
+   * @brief Store the rows of an EventRowList in a backing store.
+   *
+   * The rows are serialized directly from the list buffers, without
+   * materializing a Row for each event. The list is left unchanged, so it
+   * can be cleared and reused by the caller.
+   *
+   * @param row_list The rows to store.
+   *
+   * @return Was the element added to the backing store.
+   */
+  Status addBatch(const EventRowList& row_list);
+
+  /**
+   * @brief Get the columns this subscriber should not store.
+   *
+   * The set comes from the "exclude_columns" key of the "events"
+   * configuration, and is null when no column is excluded. Excluded columns
+   * are removed by addBatch, subscribers may use the set to avoid computing
+   * them, see EventRowList::setExcludedColumns.
+   */
+  EventColumnSetRef getExcludedColumns() const;
+
  private:
   /// Overload add for tests and allow them to override the event time.
   virtual Status addBatch(std::vector<Row>& row_list,
                           EventTime custom_event_time) final;
 
+  /// Write serialized rows to the database and update the event index.
+  Status storeBatch(DatabaseStringValueList& database_data,
+                    const EventIDList& event_id_list,
+                    EventTime event_time);
+
+  /// Set the columns this subscriber should not store.
+  void setExcludedColumns(EventColumnSetRef excluded_columns);
+
   /// Scans the database to enumerate all the data keys and build a new index
   Status generateEventDataIndex();
 
@@ -123,12 +156,14 @@ class EventSubscriberPlugin : public Plugin, public Eventer {
    * @param can_optimize If true then optimization can be considered.
    * @param start_time Inclusive lower bound time limit.
    * @param end_time Inclusive upper bound time limit.
+   * @param eid_filter (optional) Only emit these event ids, if not empty.
    * @return Set of event rows matching time limits.
    */
   void generateRows(std::function<void(Row)> callback,
                     bool can_optimize,
                     EventTime start_time,
-                    EventTime stop_stop);
+                    EventTime stop_stop,
+                    const EventIDSet& eid_filter = {});
 
   /// Track a query execution.
   virtual void setExecutedQuery(const std::string& query_name,
@@ -188,6 +223,12 @@ class EventSubscriberPlugin : public Plugin, public Eventer {
 
     std::size_t last_query_time{0U};
     std::atomic<EventID> last_event_id{0U};
+
+    /// Columns of the binary encoded rows, see events_binary_serialization.
+    RowColumnDictionary column_dictionary;
+
+    /// Number of dictionary columns written to the database.
+    std::size_t stored_column_count{0U};
   };
 
   static std::string toIndex(std::uint64_t i);
@@ -234,6 +275,7 @@ class EventSubscriberPlugin : public Plugin, public Eventer {
    * @param start_time Inclusive lower bound time limit.
    * @param end_time Inclusive upper bound time limit.
    * @param last_eid (optional) The last visited event id.
+   * @param eid_filter (optional) Only emit these event ids, if not empty.
    * @return The upper bound time or 0 if there were no events in the range.
    */
   static EventIndex::iterator generateRows(Context& context,
@@ -241,7 +283,8 @@ class EventSubscriberPlugin : public Plugin, public Eventer {
                                            std::function<void(Row)> callback,
                                            EventTime start_time,
                                            EventTime end_time,
-                                           EventID last_eid = 0);
+                                           EventID last_eid = 0,
+                                           const EventIDSet& eid_filter = {});
 
   explicit EventSubscriberPlugin(EventSubscriberPlugin const&) = delete;
   EventSubscriberPlugin& operator=(EventSubscriberPlugin const&) = delete;
@@ -306,6 +349,12 @@ class EventSubscriberPlugin : public Plugin, public Eventer {
   /// Lock used when recording queries executing against this subscriber.
   mutable Mutex event_query_record_;
 
+  /// Lock used when replacing the excluded columns on config updates.
+  mutable Mutex excluded_columns_lock_;
+
+  /// Columns removed from the stored rows, null if there are none.
+  EventColumnSetRef excluded_columns_;
+
   Context context;
 
   /**
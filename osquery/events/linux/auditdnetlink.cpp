@@ -10,13 +10,15 @@
 #include <libaudit.h>
 #include <linux/audit.h>
 #include <poll.h>
+#include <sys/socket.h>
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <chrono>
+#include <cstring>
 #include <iostream>
-
-#include <boost/utility/string_ref.hpp>
+#include <iterator>
 
 #include <osquery/core/flags.h>
 #include <osquery/events/linux/apparmor_events.h>
@@ -26,6 +28,7 @@
 #include <osquery/events/linux/selinux_events.h>
 #include <osquery/events/linux/socket_events.h>
 #include <osquery/logger/logger.h>
+#include <osquery/numeric_monitoring/numeric_monitoring.h>
 #include <osquery/utils/conversions/tryto.h>
 #include <osquery/utils/expected/expected.h>
 #include <osquery/utils/system/time.h>
@@ -56,6 +59,11 @@ FLAG(int32, audit_backlog_wait_time, 0, "The audit backlog wait time");
 /// This value is passed directly to the audit API.
 FLAG(int32, audit_backlog_limit, 4096, "The audit backlog limit");
 
+FLAG(uint32,
+     audit_parser_threads,
+     1,
+     "Number of threads parsing and assembling audit events (default 1)");
+
 // External flags; they are used to determine which rules need to be installed
 DECLARE_bool(audit_allow_config);
 DECLARE_bool(audit_allow_fim_events);
@@ -72,6 +80,12 @@ namespace {
 
 const std::string kAppArmorRecordMarker{"apparmor="};
 
+const std::string kAuditBatchSizeMonitorPath{"audit.netlink.batch_size"};
+const std::string kAuditQueueDepthMonitorPath{"audit.netlink.queue_depth"};
+const std::string kAuditDropsMonitorPath{"audit.netlink.drops"};
+const std::string kAuditStallsMonitorPath{"audit.netlink.stalls"};
+const std::string kAuditKernelLostMonitorPath{"audit.kernel.lost"};
+
 bool IsSELinuxRecord(const audit_reply& reply) noexcept {
   static const auto& selinux_event_set = kSELinuxEventList;
   return (selinux_event_set.find(reply.type) != selinux_event_set.end()) &&
@@ -87,6 +101,79 @@ bool isAppArmorRecord(const audit_reply& reply) noexcept {
           std::string::npos);
 }
 
+/// Position of the first a or b byte from pos, or the text size.
+std::size_t findEither(std::string_view text,
+                       std::size_t pos,
+                       char a,
+                       char b) noexcept {
+  constexpr std::uint64_t kOnes{0x0101010101010101ULL};
+  constexpr std::uint64_t kHighs{0x8080808080808080ULL};
+  const auto pattern_a = kOnes * static_cast<unsigned char>(a);
+  const auto pattern_b = kOnes * static_cast<unsigned char>(b);
+
+  // Skip eight bytes at a time while none of them match
+  for (; pos + sizeof(std::uint64_t) <= text.size();
+       pos += sizeof(std::uint64_t)) {
+    std::uint64_t word;
+    std::memcpy(&word, text.data() + pos, sizeof(word));
+
+    auto x = word ^ pattern_a;
+    auto y = word ^ pattern_b;
+    if ((((x - kOnes) & ~x) | ((y - kOnes) & ~y)) & kHighs) {
+      break;
+    }
+  }
+
+  for (; pos < text.size(); ++pos) {
+    if (text[pos] == a || text[pos] == b) {
+      return pos;
+    }
+  }
+
+  return text.size();
+}
+
+/**
+ * Calls callback(key, value) for each field of an audit record.
+ *
+ * Fields are separated by spaces. A value ends at a space, unless it contains
+ * a quote: the enclosure then extends to the closing quote, which ends the
+ * field. A key without a value is reported with an empty one.
+ */
+template <typename Callback>
+void tokenizeAuditFields(std::string_view text, Callback callback) {
+  std::size_t pos{0U};
+  while (pos < text.size()) {
+    if (text[pos] == ' ') {
+      ++pos;
+      continue;
+    }
+
+    auto key_end = findEither(text, pos, '=', ' ');
+    auto key = text.substr(pos, key_end - pos);
+    if (key_end == text.size() || text[key_end] == ' ') {
+      callback(key, text.substr(key_end, 0U));
+      pos = key_end + 1U;
+      continue;
+    }
+
+    auto value_begin = key_end + 1U;
+    auto value_end = findEither(text, value_begin, ' ', '"');
+    if (value_end < text.size() && text[value_end] == '"') {
+      auto enclosure_end = text.find('"', value_end + 1U);
+      value_end = enclosure_end == std::string_view::npos ? text.size()
+                                                          : enclosure_end + 1U;
+      pos = value_end;
+    } else {
+      pos = value_end + 1U;
+    }
+
+    if (!key.empty()) {
+      callback(key, text.substr(value_begin, value_end - value_begin));
+    }
+  }
+}
+
 /**
  * User messages should be filtered. Also, we should handle the 2nd user
  * message type.
@@ -128,16 +215,212 @@ enum AuditStatus {
   AUDIT_IMMUTABLE = 2,
 };
 
-AuditdNetlink::AuditdNetlink() {
+void TokenizeAuditFields(std::string_view text,
+                         std::vector<AuditFieldView>& fields) {
+  fields.clear();
+  tokenizeAuditFields(
+      text, [&fields](std::string_view key, std::string_view value) {
+        fields.emplace_back(key, value);
+      });
+}
+
+void AuditFields::parse(std::string_view text) {
+  text_.assign(text.data(), text.size());
+  spans_.clear();
+  spans_.reserve(static_cast<std::size_t>(
+      std::count(text_.begin(), text_.end(), '=')));
+  map_ = boost::none;
+
+  const auto base = text_.data();
+  tokenizeAuditFields(
+      text_, [this, base](std::string_view key, std::string_view value) {
+        Span span;
+        span.key_offset = static_cast<std::uint32_t>(key.data() - base);
+        span.key_size = static_cast<std::uint32_t>(key.size());
+        span.value_offset = static_cast<std::uint32_t>(value.data() - base);
+        span.value_size = static_cast<std::uint32_t>(value.size());
+        spans_.push_back(span);
+      });
+}
+
+bool AuditFields::get(std::string_view key,
+                      std::string_view& value) const noexcept {
+  if (map_) {
+    auto it = map_->find(key);
+    if (it == map_->end()) {
+      return false;
+    }
+
+    value = it->second;
+    return true;
+  }
+
+  for (const auto& span : spans_) {
+    if (this->key(span) == key) {
+      value = this->value(span);
+      return true;
+    }
+  }
+
+  return false;
+}
+
+std::size_t AuditFields::size() const noexcept {
+  if (map_) {
+    return map_->size();
+  }
+
+  std::size_t distinct{0U};
+  for (auto it = spans_.begin(); it != spans_.end(); ++it) {
+    auto first = std::find_if(spans_.begin(), it, [this, it](const Span& span) {
+      return key(span) == key(*it);
+    });
+
+    if (first == it) {
+      ++distinct;
+    }
+  }
+
+  return distinct;
+}
+
+bool AuditFields::empty() const noexcept {
+  return map_ ? map_->empty() : spans_.empty();
+}
+
+std::size_t AuditFields::count(std::string_view key) const noexcept {
+  std::string_view value;
+  return get(key, value) ? 1U : 0U;
+}
+
+const AuditFields::Map& AuditFields::map() const {
+  if (!map_) {
+    Map fields;
+    for (const auto& span : spans_) {
+      fields.emplace(std::string(key(span)), std::string(value(span)));
+    }
+
+    map_ = std::move(fields);
+  }
+
+  return *map_;
+}
+
+AuditFields::Map::const_iterator AuditFields::begin() const {
+  return map().begin();
+}
+
+AuditFields::Map::const_iterator AuditFields::end() const {
+  return map().end();
+}
+
+AuditFields::Map::const_iterator AuditFields::find(
+    std::string_view key) const {
+  return map().find(key);
+}
+
+const std::string& AuditFields::at(const std::string& key) const {
+  return map().at(key);
+}
+
+std::string& AuditFields::operator[](const std::string& key) {
+  map();
+  return (*map_)[key];
+}
+
+std::string_view AuditFields::key(const Span& span) const noexcept {
+  return std::string_view(text_).substr(span.key_offset, span.key_size);
+}
+
+std::string_view AuditFields::value(const Span& span) const noexcept {
+  return std::string_view(text_).substr(span.value_offset, span.value_size);
+}
+
+AuditSlabRing::AuditSlabRing(std::size_t capacity) : slots_(capacity) {}
+
+bool AuditSlabRing::push(AuditReplySlab* slab) noexcept {
+  auto tail = tail_.load(std::memory_order_relaxed);
+  if (tail - head_.load(std::memory_order_acquire) == slots_.size()) {
+    return false;
+  }
+
+  slots_[tail % slots_.size()] = slab;
+  tail_.store(tail + 1, std::memory_order_release);
+  return true;
+}
+
+AuditReplySlab* AuditSlabRing::pop() noexcept {
+  auto head = head_.load(std::memory_order_relaxed);
+  if (head == tail_.load(std::memory_order_acquire)) {
+    return nullptr;
+  }
+
+  auto slab = slots_[head % slots_.size()];
+  head_.store(head + 1, std::memory_order_release);
+  return slab;
+}
+
+std::size_t AuditSlabRing::size() const noexcept {
+  // Load the head first, the tail can only have moved past it since
+  auto head = head_.load(std::memory_order_acquire);
+  return tail_.load(std::memory_order_acquire) - head;
+}
+
+std::size_t AuditSlabRing::capacity() const noexcept {
+  return slots_.size();
+}
+
+AuditdContext::AuditdContext() {
+  slabs.reserve(kAuditSlabCount);
+  for (std::size_t i = 0U; i < kAuditSlabCount; ++i) {
+    slabs.push_back(std::make_unique<AuditReplySlab>());
+    slabs.back()->replies.resize(kAuditSlabSize);
+    slabs.back()->shards.resize(kAuditSlabSize, kAuditSkipShard);
+    free_slabs.push(slabs.back().get());
+  }
+}
+
+std::uint64_t GetAuditSerial(std::string_view audit_id) noexcept {
+  auto separator = audit_id.find(':');
+  if (separator == std::string_view::npos) {
+    return 0U;
+  }
+
+  std::uint64_t serial{0U};
+  for (auto it = audit_id.begin() + separator + 1;
+       it != audit_id.end() && *it >= '0' && *it <= '9';
+       ++it) {
+    serial = serial * 10U + static_cast<std::uint64_t>(*it - '0');
+  }
+
+  return serial;
+}
+
+AuditdNetlink::AuditdNetlink() : AuditdNetlink(1U, nullptr) {}
+
+AuditdNetlink::AuditdNetlink(std::size_t worker_count,
+                             AuditRecordHandler handler) {
   try {
     auditd_context_ = std::make_shared<AuditdContext>();
 
+    if (worker_count > 1U && handler) {
+      for (std::size_t i = 0U; i < worker_count; ++i) {
+        auditd_context_->workers.push_back(
+            std::make_unique<AuditdWorkerQueue>());
+      }
+    }
+
     Dispatcher::addService(
         std::make_shared<AuditdNetlinkReader>(auditd_context_));
 
     Dispatcher::addService(
         std::make_shared<AuditdNetlinkParser>(auditd_context_));
 
+    for (std::size_t i = 0U; i < auditd_context_->workers.size(); ++i) {
+      Dispatcher::addService(std::make_shared<AuditdNetlinkParserWorker>(
+          auditd_context_, static_cast<std::uint32_t>(i), handler));
+    }
+
   } catch (const std::bad_alloc&) {
     VLOG(1) << "Failed to initialize the AuditdNetlink services due to a "
                "memory allocation error";
@@ -166,7 +449,16 @@ std::vector<AuditEventRecord> AuditdNetlink::getEvents() noexcept {
 AuditdNetlinkReader::AuditdNetlinkReader(AuditdContextRef context)
     : InternalRunnable("AuditdNetlinkReader"),
       auditd_context_(std::move(context)),
-      read_buffer_(4096U) {}
+      read_headers_(kAuditSlabSize),
+      read_addresses_(kAuditSlabSize),
+      read_iovecs_(kAuditSlabSize) {
+  for (std::size_t i = 0U; i < kAuditSlabSize; ++i) {
+    auto& header = read_headers_[i].msg_hdr;
+    header.msg_name = &read_addresses_[i];
+    header.msg_iov = &read_iovecs_[i];
+    header.msg_iovlen = 1;
+  }
+}
 
 void AuditdNetlinkReader::start() {
   int counter_to_next_status_request = 0;
@@ -237,17 +529,27 @@ void AuditdNetlinkReader::stop() {
 bool AuditdNetlinkReader::acquireMessages() noexcept {
   pollfd fds[] = {{audit_netlink_handle_, POLLIN, 0}};
 
-  struct sockaddr_nl nladdr = {};
-  socklen_t nladdrlen = sizeof(nladdr);
-
   bool reset_handle = false;
   size_t events_received = 0;
 
-  // Attempt to read as many messages as possible before we exit, and terminate
-  // early if we have been asked to terminate
-  for (events_received = 0;
-       !interrupted() && events_received < read_buffer_.size();
-       events_received++) {
+  // Attempt to read as many messages as the slabs can hold before we exit, and
+  // terminate early if we have been asked to terminate
+  while (!interrupted() &&
+         events_received < kAuditSlabSize * kAuditSlabCount) {
+    if (slab_ == nullptr) {
+      slab_ = auditd_context_->free_slabs.pop();
+    }
+
+    if (slab_ == nullptr) {
+      // The parser is behind, records wait in the kernel backlog meanwhile
+      ++auditd_context_->stats.stalls;
+      monitoring::record(
+          kAuditStallsMonitorPath, 1, monitoring::PreAggregationType::Sum);
+
+      pause(std::chrono::milliseconds(1));
+      break;
+    }
+
     errno = 0;
     int poll_status = ::poll(fds, 1, 2000);
     if (poll_status == 0) {
@@ -267,34 +569,96 @@ bool AuditdNetlinkReader::acquireMessages() noexcept {
       break;
     }
 
-    audit_reply reply = {};
-    ssize_t len = recvfrom(audit_netlink_handle_,
-                           &reply.msg,
-                           sizeof(reply.msg),
-                           0,
-                           reinterpret_cast<struct sockaddr*>(&nladdr),
-                           &nladdrlen);
+    auto received = receiveBatch(reset_handle);
+    if (received != 0U) {
+      events_received += received;
+
+      // Every slab fits in the ring, so this can't fail
+      auditd_context_->filled_slabs.push(slab_);
+      slab_ = nullptr;
 
-    if (len < 0) {
+      ++auditd_context_->stats.batches;
+      auditd_context_->stats.records += received;
+      monitoring::record(kAuditBatchSizeMonitorPath,
+                         static_cast<monitoring::ValueType>(received),
+                         monitoring::PreAggregationType::Avg);
+
+      // Synchronize with a parser about to wait, so the wake up isn't lost
+      {
+        std::lock_guard<std::mutex> lock(
+            auditd_context_->unprocessed_records_mutex);
+      }
+
+      auditd_context_->unprocessed_records_cv.notify_one();
+    }
+
+    if (reset_handle) {
+      break;
+    }
+  }
+
+  if (reset_handle) {
+    VLOG(1) << "Requesting audit handle reset";
+    return false;
+  }
+
+  return true;
+}
+
+std::size_t AuditdNetlinkReader::receiveBatch(bool& reset_handle) noexcept {
+  for (std::size_t i = 0U; i < kAuditSlabSize; ++i) {
+    read_iovecs_[i].iov_base = &slab_->replies[i].msg;
+    read_iovecs_[i].iov_len = sizeof(slab_->replies[i].msg);
+    read_headers_[i].msg_hdr.msg_namelen = sizeof(read_addresses_[i]);
+    read_headers_[i].msg_len = 0;
+  }
+
+  errno = 0;
+  int count = recvmmsg(audit_netlink_handle_,
+                       read_headers_.data(),
+                       static_cast<unsigned int>(read_headers_.size()),
+                       MSG_DONTWAIT,
+                       nullptr);
+
+  if (count < 0) {
+    if (errno == ENOBUFS) {
+      // The socket buffer overflowed, the kernel dropped records
+      ++auditd_context_->stats.drops;
+      monitoring::record(
+          kAuditDropsMonitorPath, 1, monitoring::PreAggregationType::Sum);
+
+      if (FLAGS_audit_debug) {
+        VLOG(1) << "The audit netlink receive buffer overflowed (ENOBUFS)";
+      }
+
+    } else if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
       VLOG(1) << "Failed to receive data from the audit netlink";
       reset_handle = true;
-      break;
     }
 
-    if (nladdrlen != sizeof(nladdr)) {
+    return 0U;
+  }
+
+  // Keep the records preceding an invalid one
+  std::size_t received = 0U;
+  for (; received < static_cast<std::size_t>(count); ++received) {
+    const auto& header = read_headers_[received];
+    const auto& reply = slab_->replies[received];
+
+    if (header.msg_hdr.msg_namelen != sizeof(struct sockaddr_nl)) {
       VLOG(1) << "Protocol error";
       reset_handle = true;
       break;
     }
 
-    if (nladdr.nl_pid) {
+    if (read_addresses_[received].nl_pid) {
       VLOG(1) << "Invalid netlink endpoint";
       reset_handle = true;
       break;
     }
 
-    if (!NLMSG_OK(&reply.msg.nlh, static_cast<unsigned int>(len))) {
-      if (len == sizeof(reply.msg)) {
+    if (!NLMSG_OK(&reply.msg.nlh, header.msg_len)) {
+      if (header.msg_len == sizeof(reply.msg)) {
         VLOG(1) << "Netlink event too big (EFBIG)";
       } else {
         VLOG(1) << "Broken netlink event (EBADE)";
@@ -303,31 +667,10 @@ bool AuditdNetlinkReader::acquireMessages() noexcept {
       reset_handle = true;
       break;
     }
-
-    read_buffer_[events_received] = reply;
-  }
-
-  if (events_received != 0) {
-    std::unique_lock<std::mutex> lock(
-        auditd_context_->unprocessed_records_mutex);
-
-    auditd_context_->unprocessed_records.reserve(
-        auditd_context_->unprocessed_records.size() + events_received);
-
-    auditd_context_->unprocessed_records.insert(
-        auditd_context_->unprocessed_records.end(),
-        read_buffer_.begin(),
-        std::next(read_buffer_.begin(), events_received));
-
-    auditd_context_->unprocessed_records_cv.notify_all();
-  }
-
-  if (reset_handle) {
-    VLOG(1) << "Requesting audit handle reset";
-    return false;
   }
 
-  return true;
+  slab_->count = received;
+  return received;
 }
 
 bool AuditdNetlinkReader::configureAuditService() noexcept {
@@ -690,84 +1033,226 @@ AuditdNetlinkParser::AuditdNetlinkParser(AuditdContextRef context)
 
 void AuditdNetlinkParser::start() {
   while (!interrupted()) {
-    std::vector<audit_reply> queue;
+    releaseParsedSlabs();
 
-    {
+    auto slab = auditd_context_->filled_slabs.pop();
+    if (slab == nullptr) {
       std::unique_lock<std::mutex> lock(
           auditd_context_->unprocessed_records_mutex);
 
-      while (auditd_context_->unprocessed_records.empty() && !interrupted()) {
-        auditd_context_->unprocessed_records_cv.wait_for(
-            lock, std::chrono::seconds(1));
-      }
+      auditd_context_->unprocessed_records_cv.wait_for(
+          lock, std::chrono::seconds(1), [this]() {
+            return auditd_context_->filled_slabs.size() != 0U ||
+                   (!dispatched_slabs_.empty() &&
+                    dispatched_slabs_.front()->pending == 0U) ||
+                   interrupted();
+          });
 
-      queue = std::move(auditd_context_->unprocessed_records);
-      auditd_context_->unprocessed_records.clear();
+      continue;
     }
 
-    std::vector<AuditEventRecord> audit_event_record_queue;
-    audit_event_record_queue.reserve(queue.size());
+    monitoring::record(
+        kAuditQueueDepthMonitorPath,
+        static_cast<monitoring::ValueType>(
+            auditd_context_->filled_slabs.size() + 1U),
+        monitoring::PreAggregationType::Max);
 
-    for (auto& reply : queue) {
-      if (interrupted()) {
-        break;
-      }
+    if (auditd_context_->workers.empty()) {
+      parseSlab(slab);
+    } else {
+      dispatchSlab(slab);
+    }
+  }
+}
 
-      AdjustAuditReply(reply);
+bool AuditdNetlinkParser::prepareReply(audit_reply& reply) noexcept {
+  AdjustAuditReply(reply);
 
-      // This record carries the process id of the controlling daemon; in case
-      // we lost control of the audit service, we are going to request a reset
-      // as soon as we finish processing the pending queue
-      if (reply.type == AUDIT_GET) {
-        reply.status = static_cast<struct audit_status*>(NLMSG_DATA(reply.nlh));
-        auto new_pid = static_cast<pid_t>(reply.status->pid);
+  // This record carries the process id of the controlling daemon; in case
+  // we lost control of the audit service, we are going to request a reset
+  // as soon as we finish processing the pending queue
+  if (reply.type == AUDIT_GET) {
+    reply.status = static_cast<struct audit_status*>(NLMSG_DATA(reply.nlh));
+    auto new_pid = static_cast<pid_t>(reply.status->pid);
 
-        if (new_pid != getpid()) {
-          VLOG(1) << "Audit control lost to pid: " << new_pid;
+    auto lost = static_cast<std::uint64_t>(reply.status->lost);
+    if (auditd_context_->stats.kernel_lost.exchange(lost) != lost &&
+        FLAGS_audit_debug) {
+      VLOG(1) << "The kernel lost " << lost << " audit records";
+    }
 
-          if (FLAGS_audit_persist) {
-            VLOG(1) << "Attempting to reacquire control of the audit service";
-            auditd_context_->acquire_handle = true;
-          }
-        }
+    monitoring::record(kAuditKernelLostMonitorPath,
+                       static_cast<monitoring::ValueType>(lost),
+                       monitoring::PreAggregationType::Max);
 
-        continue;
-      }
+    if (new_pid != getpid()) {
+      VLOG(1) << "Audit control lost to pid: " << new_pid;
 
-      // We are not interested in all messages; only get the ones related to
-      // user events, seccomp, syscalls, SELinux events and AppArmor events
-      if (!ShouldHandle(reply)) {
-        continue;
+      if (FLAGS_audit_persist) {
+        VLOG(1) << "Attempting to reacquire control of the audit service";
+        auditd_context_->acquire_handle = true;
       }
+    }
 
-      AuditEventRecord audit_event_record = {};
-      if (!ParseAuditReply(reply, audit_event_record)) {
-        VLOG(1) << "Malformed audit record received";
-        continue;
-      }
+    return false;
+  }
 
-      audit_event_record_queue.push_back(audit_event_record);
+  // We are not interested in all messages; only get the ones related to
+  // user events, seccomp, syscalls, SELinux events and AppArmor events
+  return ShouldHandle(reply);
+}
+
+void AuditdNetlinkParser::parseSlab(AuditReplySlab* slab) {
+  std::vector<AuditEventRecord> audit_event_record_queue;
+  audit_event_record_queue.reserve(slab->count);
+
+  for (std::size_t i = 0U; i < slab->count; ++i) {
+    if (interrupted()) {
+      break;
     }
 
-    // Save the new records and notify the reader
-    if (!audit_event_record_queue.empty()) {
-      std::lock_guard<std::mutex> queue_lock(
-          auditd_context_->processed_events_mutex);
+    // The records are parsed in place, out of the slab
+    auto& reply = slab->replies[i];
+    if (!prepareReply(reply)) {
+      continue;
+    }
 
-      auditd_context_->processed_events.reserve(
-          auditd_context_->processed_events.size() +
-          audit_event_record_queue.size());
+    AuditEventRecord audit_event_record = {};
+    if (!ParseAuditReply(reply, audit_event_record)) {
+      VLOG(1) << "Malformed audit record received";
+      continue;
+    }
 
-      auditd_context_->processed_events.insert(
-          auditd_context_->processed_events.end(),
-          audit_event_record_queue.begin(),
-          audit_event_record_queue.end());
+    audit_event_record_queue.push_back(std::move(audit_event_record));
+  }
+
+  // The records have been copied out, give the slab back to the reader
+  slab->count = 0U;
+  auditd_context_->free_slabs.push(slab);
+
+  // Save the new records and notify the reader
+  if (!audit_event_record_queue.empty()) {
+    std::lock_guard<std::mutex> queue_lock(
+        auditd_context_->processed_events_mutex);
 
-      auditd_context_->processed_records_cv.notify_all();
+    auditd_context_->processed_events.reserve(
+        auditd_context_->processed_events.size() +
+        audit_event_record_queue.size());
+
+    auditd_context_->processed_events.insert(
+        auditd_context_->processed_events.end(),
+        std::make_move_iterator(audit_event_record_queue.begin()),
+        std::make_move_iterator(audit_event_record_queue.end()));
+
+    auditd_context_->processed_records_cv.notify_all();
+  }
+}
+
+void AuditdNetlinkParser::dispatchSlab(AuditReplySlab* slab) noexcept {
+  auto& workers = auditd_context_->workers;
+
+  for (std::size_t i = 0U; i < slab->count; ++i) {
+    auto& reply = slab->replies[i];
+    slab->shards[i] = prepareReply(reply)
+                          ? GetReplyShard(reply, workers.size())
+                          : kAuditSkipShard;
+  }
+
+  // Every worker reads the slab, the last one to finish allows its release
+  slab->pending = workers.size();
+  dispatched_slabs_.push_back(slab);
+
+  for (auto& worker : workers) {
+    // Every slab fits in the ring, so this can't fail
+    worker->slabs.push(slab);
+
+    {
+      std::lock_guard<std::mutex> lock(worker->mutex);
+    }
+
+    worker->cv.notify_one();
+  }
+}
+
+void AuditdNetlinkParser::releaseParsedSlabs() noexcept {
+  while (!dispatched_slabs_.empty() &&
+         dispatched_slabs_.front()->pending == 0U) {
+    auto slab = dispatched_slabs_.front();
+    dispatched_slabs_.pop_front();
+
+    slab->count = 0U;
+    auditd_context_->free_slabs.push(slab);
+  }
+}
+
+std::uint32_t AuditdNetlinkParser::GetReplyShard(
+    const audit_reply& reply, std::size_t shard_count) noexcept {
+  // Skip the "audit(" prefix; records without a serial share the first shard
+  if (reply.message == nullptr || reply.len <= 6) {
+    return 0U;
+  }
+
+  std::string_view message(reply.message, static_cast<std::size_t>(reply.len));
+  return static_cast<std::uint32_t>(GetAuditSerial(message.substr(6)) %
+                                    shard_count);
+}
+
+void AuditdNetlinkParser::ParseShard(const AuditReplySlab& slab,
+                                     std::uint32_t shard,
+                                     std::vector<AuditEventRecord>& records) {
+  for (std::size_t i = 0U; i < slab.count; ++i) {
+    if (slab.shards[i] != shard) {
+      continue;
+    }
+
+    AuditEventRecord audit_event_record = {};
+    if (!ParseAuditReply(slab.replies[i], audit_event_record)) {
+      VLOG(1) << "Malformed audit record received";
+      continue;
+    }
+
+    records.push_back(std::move(audit_event_record));
+  }
+}
+
+AuditdNetlinkParserWorker::AuditdNetlinkParserWorker(
+    AuditdContextRef context, std::uint32_t shard, AuditRecordHandler handler)
+    : InternalRunnable("AuditdNetlinkParserWorker"),
+      auditd_context_(std::move(context)),
+      shard_(shard),
+      handler_(std::move(handler)) {}
+
+void AuditdNetlinkParserWorker::start() {
+  auto& queue = *auditd_context_->workers[shard_];
+  std::vector<AuditEventRecord> records;
+
+  while (!interrupted()) {
+    auto slab = queue.slabs.pop();
+    if (slab == nullptr) {
+      std::unique_lock<std::mutex> lock(queue.mutex);
+      queue.cv.wait_for(lock, std::chrono::seconds(1), [this, &queue]() {
+        return queue.slabs.size() != 0U || interrupted();
+      });
+
+      continue;
+    }
+
+    records.clear();
+    AuditdNetlinkParser::ParseShard(*slab, shard_, records);
+
+    // Once every worker is done, the parser gives the slab back to the reader
+    if (slab->pending.fetch_sub(1U) == 1U) {
+      {
+        std::lock_guard<std::mutex> lock(
+            auditd_context_->unprocessed_records_mutex);
+      }
+
+      auditd_context_->unprocessed_records_cv.notify_all();
     }
 
-    queue.clear();
-    audit_event_record_queue.clear();
+    if (!records.empty()) {
+      handler_(shard_, records);
+    }
   }
 }
 
@@ -781,18 +1266,19 @@ bool AuditdNetlinkParser::ParseAuditReply(
 
   // Parse the record header
   event_record.type = reply.type;
-  boost::string_ref message_view(reply.message,
-                                 static_cast<unsigned int>(reply.len));
+  std::string_view message_view(reply.message,
+                                static_cast<unsigned int>(reply.len));
 
   auto preamble_end = message_view.find("): ");
-  if (preamble_end == std::string::npos) {
+  if (preamble_end == std::string_view::npos) {
     return false;
   }
 
   event_record.time =
-      tryTo<unsigned long int>(message_view.substr(6, 10).to_string(), 10)
+      tryTo<unsigned long int>(std::string(message_view.substr(6, 10)), 10)
           .takeOr(event_record.time);
-  event_record.audit_id = message_view.substr(6, preamble_end - 6).to_string();
+  event_record.audit_id =
+      std::string(message_view.substr(6, preamble_end - 6));
 
   // SELinux doesn't output valid audit records; just save them as they are
   if (IsSELinuxRecord(reply)) {
@@ -805,65 +1291,8 @@ bool AuditdNetlinkParser::ParseAuditReply(
     event_record.raw_data = reply.message;
   }
 
-  // Tokenize the message
-  boost::string_ref field_view(message_view.substr(preamble_end + 3));
-
-  // The linear search will construct series of key value pairs.
-  std::string key, value;
-  key.reserve(20);
-  value.reserve(256);
-
-  // There are several ways of representing value data (enclosed strings,
-  // etc).
-  bool found_assignment{false};
-  bool found_enclose{false};
-
-  for (const auto& c : field_view) {
-    // Iterate over each character in the audit message.
-    if ((found_enclose && c == '"') || (!found_enclose && c == ' ')) {
-      if (c == '"') {
-        value += c;
-      }
-
-      // This is a terminating sequence, the end of an enclosure or space
-      // tok.
-      if (!key.empty()) {
-        // Multiple space tokens are supported.
-        event_record.fields.emplace(
-            std::make_pair(std::move(key), std::move(value)));
-      }
-
-      found_enclose = false;
-      found_assignment = false;
-
-      key.clear();
-      value.clear();
-
-    } else if (!found_assignment && c == ' ') {
-      // A field tokenizer.
-
-    } else if (found_assignment) {
-      // Enclosure sequences appear immediately following assignment.
-      if (c == '"') {
-        found_enclose = true;
-      }
-
-      value += c;
-
-    } else if (c == '=') {
-      found_assignment = true;
-
-    } else {
-      key += c;
-    }
-  }
-
-  // Last step, if there was no trailing tokenizer.
-  if (!key.empty()) {
-    event_record.fields.emplace(
-        std::make_pair(std::move(key), std::move(value)));
-  }
-
+  // The fields are only located here, subscribers copy the ones they use
+  event_record.fields.parse(message_view.substr(preamble_end + 3));
   return true;
 }
 
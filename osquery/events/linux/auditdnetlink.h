@@ -10,17 +10,28 @@
 #pragma once
 
 #include <libaudit.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
 
 #include <atomic>
 #include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
 #include <future>
+#include <limits>
 #include <map>
 #include <memory>
 #include <set>
+#include <string>
+#include <string_view>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include <boost/algorithm/hex.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/optional.hpp>
 
 #include <osquery/dispatcher/dispatcher.h>
 
@@ -32,6 +43,77 @@ enum class NetlinkStatus { ActiveMutable, ActiveImmutable, Disabled, Error };
 /// Contains an audit_rule_data structure
 using AuditRuleDataObject = std::vector<std::uint8_t>;
 
+/// A field of an audit record, as views into the record's field text.
+using AuditFieldView = std::pair<std::string_view, std::string_view>;
+
+/**
+ * @brief Tokenize the key=value fields of an audit record.
+ *
+ * The fields refer to the given text, nothing is copied. The vector is
+ * cleared first, reusing it avoids any allocation.
+ */
+void TokenizeAuditFields(std::string_view text,
+                         std::vector<AuditFieldView>& fields);
+
+/**
+ * @brief The key=value fields of an audit record.
+ *
+ * Parsing copies the record's field text once and keeps the position of each
+ * key and value within it, get() finds fields in place. Owned strings are
+ * only built, once, when the map interface is used. As with a std::map, an
+ * instance must not be used by several threads without locking.
+ */
+class AuditFields final {
+ public:
+  using Map = std::map<std::string, std::string, std::less<>>;
+
+  /// Replace the fields with the ones found in a record's field text.
+  void parse(std::string_view text);
+
+  /// Find a field without copying it, returns false if it is missing.
+  bool get(std::string_view key, std::string_view& value) const noexcept;
+
+  /// Number of distinct fields.
+  std::size_t size() const noexcept;
+
+  bool empty() const noexcept;
+
+  std::size_t count(std::string_view key) const noexcept;
+
+  /// The fields as owned strings, the first value of a repeated key is kept.
+  const Map& map() const;
+
+  Map::const_iterator begin() const;
+  Map::const_iterator end() const;
+  Map::const_iterator find(std::string_view key) const;
+  const std::string& at(const std::string& key) const;
+
+  /// Mutable access, lookups use the owned strings from now on.
+  std::string& operator[](const std::string& key);
+
+ private:
+  /// Positions of a field's key and value within the text.
+  struct Span final {
+    std::uint32_t key_offset{0U};
+    std::uint32_t key_size{0U};
+    std::uint32_t value_offset{0U};
+    std::uint32_t value_size{0U};
+  };
+
+  std::string_view key(const Span& span) const noexcept;
+  std::string_view value(const Span& span) const noexcept;
+
+ private:
+  /// The record's field text
+  std::string text_;
+
+  /// Fields in the order they appear in the text
+  std::vector<Span> spans_;
+
+  /// Owned fields, built on first use of the map interface
+  mutable boost::optional<Map> map_;
+};
+
 /// A single, prepared audit event record.
 struct AuditEventRecord final {
   /// Record type (i.e.: AUDIT_SYSCALL, AUDIT_PATH, ...)
@@ -45,7 +127,7 @@ struct AuditEventRecord final {
 
   /// The field list for this record. Valid for everything except SELinux and
   /// AppArmor records
-  std::map<std::string, std::string> fields;
+  AuditFields fields;
 
   /// The raw message, only valid for SELinux and AppArmor records (because they
   /// have broken syntax)
@@ -55,19 +137,108 @@ struct AuditEventRecord final {
 static_assert(std::is_move_constructible<AuditEventRecord>::value,
               "not move constructible");
 
+/// Number of audit records received with a single recvmmsg call.
+constexpr std::size_t kAuditSlabSize{128U};
+
+/// Number of slabs shared by the reader and the parser.
+constexpr std::size_t kAuditSlabCount{32U};
+
+/// A batch of raw audit records, filled in place by the netlink reader.
+struct AuditReplySlab final {
+  /// Record storage, allocated once
+  std::vector<audit_reply> replies;
+
+  /// Number of records received in this slab
+  std::size_t count{0U};
+
+  /// The parser worker of each record, or kAuditSkipShard
+  std::vector<std::uint32_t> shards;
+
+  /// Number of parser workers that have yet to parse their records
+  std::atomic<std::size_t> pending{0U};
+};
+
+/// Shard of the records that no parser worker needs to parse.
+constexpr std::uint32_t kAuditSkipShard{
+    std::numeric_limits<std::uint32_t>::max()};
+
+/**
+ * @brief A bounded, lock-free, single producer single consumer ring.
+ *
+ * Only one thread may push() and only one other thread may pop(). It passes
+ * slab references between the reader and the parser without copying the
+ * records they hold.
+ */
+class AuditSlabRing final : private boost::noncopyable {
+ public:
+  explicit AuditSlabRing(std::size_t capacity);
+
+  /// Append a slab, returns false if the ring is full.
+  bool push(AuditReplySlab* slab) noexcept;
+
+  /// Take the oldest slab, returns nullptr if the ring is empty.
+  AuditReplySlab* pop() noexcept;
+
+  /// Number of slabs in the ring, exact only if both threads are idle.
+  std::size_t size() const noexcept;
+
+  std::size_t capacity() const noexcept;
+
+ private:
+  std::vector<AuditReplySlab*> slots_;
+
+  /// Position of the next slab to pop, written by the consumer
+  alignas(64) std::atomic<std::size_t> head_{0U};
+
+  /// Position of the next slab to push, written by the producer
+  alignas(64) std::atomic<std::size_t> tail_{0U};
+};
+
+/// Counters of the audit netlink ingestion.
+struct AuditdNetlinkStats final {
+  /// Receive batches handed to the parser
+  std::atomic<std::uint64_t> batches{0U};
+
+  /// Records handed to the parser
+  std::atomic<std::uint64_t> records{0U};
+
+  /// Receive calls failed because the socket buffer overflowed (ENOBUFS)
+  std::atomic<std::uint64_t> drops{0U};
+
+  /// Times the reader waited for the parser to release a slab
+  std::atomic<std::uint64_t> stalls{0U};
+
+  /// Records lost by the kernel, as reported by the last audit status
+  std::atomic<std::uint64_t> kernel_lost{0U};
+};
+
+/// The slabs dispatched to a parser worker.
+struct AuditdWorkerQueue final {
+  AuditSlabRing slabs{kAuditSlabCount};
+
+  /// Used to wake up the worker when slabs are dispatched
+  std::mutex mutex;
+  std::condition_variable cv;
+};
+
 // This structure is used to share data between the reading and processing
 // services
 struct AuditdContext final {
-  /// Unprocessed audit records
-  std::vector<audit_reply> unprocessed_records;
-  static_assert(
-      std::is_move_constructible<decltype(unprocessed_records)>::value,
-      "not move constructible");
+  AuditdContext();
+
+  /// Slab storage; slabs are either free, filled or held by one service
+  std::vector<std::unique_ptr<AuditReplySlab>> slabs;
+
+  /// Slabs filled by the reader, waiting to be parsed
+  AuditSlabRing filled_slabs{kAuditSlabCount};
 
-  /// Mutex for the list of unprocessed records
+  /// Slabs released by the parser, ready to be filled again
+  AuditSlabRing free_slabs{kAuditSlabCount};
+
+  /// Mutex used by the parser to wait for filled slabs
   std::mutex unprocessed_records_mutex;
 
-  /// Processed events condition variable
+  /// Used to wake up the thread that processes the raw audit records
   std::condition_variable unprocessed_records_cv;
 
   /// This queue contains processed events
@@ -76,11 +247,17 @@ struct AuditdContext final {
   /// Processed events queue mutex.
   std::mutex processed_events_mutex;
 
-  /// Used to wake up the thread that processes the raw audit records
+  /// Processed events condition variable
   std::condition_variable processed_records_cv;
 
   /// When set to true, the audit handle is (re)acquired
   std::atomic_bool acquire_handle{true};
+
+  /// Queues of the parser workers, empty if the parser parses every record
+  std::vector<std::unique_ptr<AuditdWorkerQueue>> workers;
+
+  /// Ingestion counters
+  AuditdNetlinkStats stats;
 };
 
 using AuditdContextRef = std::shared_ptr<AuditdContext>;
@@ -98,6 +275,9 @@ class AuditdNetlinkReader final : public InternalRunnable {
   /// Reads as many audit event records as possible before returning.
   bool acquireMessages() noexcept;
 
+  /// Receives a batch of records into the current slab, returns their count.
+  std::size_t receiveBatch(bool& reset_handle) noexcept;
+
   /// Configures the audit service and applies required rules
   bool configureAuditService() noexcept;
 
@@ -117,8 +297,13 @@ class AuditdNetlinkReader final : public InternalRunnable {
   /// Shared data
   AuditdContextRef auditd_context_;
 
-  /// Read buffer used when receiving events from the netlink
-  std::vector<audit_reply> read_buffer_;
+  /// The slab being filled, taken from the free slabs
+  AuditReplySlab* slab_{nullptr};
+
+  /// recvmmsg headers, addresses and buffers of a batch
+  std::vector<struct mmsghdr> read_headers_;
+  std::vector<struct sockaddr_nl> read_addresses_;
+  std::vector<struct iovec> read_iovecs_;
 
   /// The set of rules we applied (and that we'll uninstall when exiting)
   std::vector<audit_rule_data> installed_rule_list_;
@@ -130,7 +315,21 @@ class AuditdNetlinkReader final : public InternalRunnable {
   int audit_netlink_handle_{-1};
 };
 
-/// This service parses the raw audit records
+/// Receives the records parsed by a worker, in the order they were received.
+using AuditRecordHandler = std::function<void(
+    std::size_t shard, const std::vector<AuditEventRecord>& records)>;
+
+/// The serial number in an audit id ("1502125323.756:6"), 0 if missing.
+std::uint64_t GetAuditSerial(std::string_view audit_id) noexcept;
+
+/**
+ * @brief This service parses the raw audit records.
+ *
+ * Without workers every record is parsed here. With workers, this service
+ * only prepares the records of each slab and assigns them to a worker by
+ * serial number. Every worker then reads the slab, so all the records of an
+ * event are parsed by the same worker, in order.
+ */
 class AuditdNetlinkParser final : public InternalRunnable {
  public:
   explicit AuditdNetlinkParser(AuditdContextRef context);
@@ -143,15 +342,69 @@ class AuditdNetlinkParser final : public InternalRunnable {
   /// Adjusts the internal pointers of the audit_reply object
   static void AdjustAuditReply(audit_reply& reply) noexcept;
 
+  /// Returns the worker of a record, by serial number.
+  static std::uint32_t GetReplyShard(const audit_reply& reply,
+                                     std::size_t shard_count) noexcept;
+
+  /// Parses the records of a slab assigned to a worker.
+  static void ParseShard(const AuditReplySlab& slab,
+                         std::uint32_t shard,
+                         std::vector<AuditEventRecord>& records);
+
+ private:
+  /// Handles control records, returns false if the record is not parsed.
+  bool prepareReply(audit_reply& reply) noexcept;
+
+  /// Parses every record of a slab and releases it.
+  void parseSlab(AuditReplySlab* slab);
+
+  /// Assigns the records of a slab to the workers and hands it to them.
+  void dispatchSlab(AuditReplySlab* slab) noexcept;
+
+  /// Releases the oldest slabs every worker has parsed.
+  void releaseParsedSlabs() noexcept;
+
  private:
   /// Shared data
   AuditdContextRef auditd_context_;
+
+  /// Slabs handed to the workers, oldest first
+  std::deque<AuditReplySlab*> dispatched_slabs_;
+};
+
+/// This service parses the records assigned to one shard.
+class AuditdNetlinkParserWorker final : public InternalRunnable {
+ public:
+  AuditdNetlinkParserWorker(AuditdContextRef context,
+                            std::uint32_t shard,
+                            AuditRecordHandler handler);
+
+  virtual void start() override;
+
+ private:
+  /// Shared data
+  AuditdContextRef auditd_context_;
+
+  /// Index of this worker and of its queue
+  std::uint32_t shard_{0U};
+
+  /// Receives the parsed records, assembles the events of the shard
+  AuditRecordHandler handler_;
 };
 
 /// This class provides access to the audit netlink data
 class AuditdNetlink final : private boost::noncopyable {
  public:
   AuditdNetlink();
+
+  /**
+   * @brief Parse the records with several workers.
+   *
+   * The records are handed to the handler by the worker of their shard,
+   * getEvents() is not used.
+   */
+  AuditdNetlink(std::size_t worker_count, AuditRecordHandler handler);
+
   virtual ~AuditdNetlink() = default;
 
   /// Prepares the raw audit event records stored in the given context.
@@ -7,7 +7,10 @@
  * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
  */
 
+#include <algorithm>
 #include <array>
+#include <chrono>
+#include <iterator>
 
 #include <osquery/core/flags.h>
 #include <osquery/events/linux/apparmor_events.h>
@@ -30,6 +33,7 @@ DECLARE_bool(audit_allow_selinux_events);
 DECLARE_bool(audit_allow_kill_process_events);
 DECLARE_bool(audit_allow_apparmor_events);
 DECLARE_bool(audit_allow_seccomp_events);
+DECLARE_uint32(audit_parser_threads);
 
 REGISTER(AuditEventPublisher, "event_publisher", "auditeventpublisher");
 
@@ -72,10 +76,6 @@ void AuditEventPublisher::configure() {
     return;
   }
 
-  if (audit_netlink_ == nullptr) {
-    audit_netlink_ = std::make_unique<AuditdNetlink>();
-  }
-
   // Socket events do not always emit a reliable 'success' field when
   // O_NONBLOCK has been set. Collect these events even if it appears like
   // they have failed. The subscribers will know what to do.
@@ -83,6 +83,27 @@ void AuditEventPublisher::configure() {
   // Note: these are captured here since the actual contents depend on
   //       configuration flags
   syscalls_allowed_to_fail_ = getSocketEventsSyscalls();
+
+  if (audit_netlink_ != nullptr) {
+    return;
+  }
+
+  if (FLAGS_audit_parser_threads <= 1U) {
+    audit_netlink_ = std::make_unique<AuditdNetlink>();
+    return;
+  }
+
+  // The workers hold the assembler, it must outlive the publisher
+  assembler_ = std::make_shared<AuditEventAssembler>(
+      FLAGS_audit_parser_threads, syscalls_allowed_to_fail_);
+
+  auto assembler = assembler_;
+  audit_netlink_ = std::make_unique<AuditdNetlink>(
+      FLAGS_audit_parser_threads,
+      [assembler](std::size_t shard,
+                  const std::vector<AuditEventRecord>& record_list) {
+        assembler->assemble(shard, record_list);
+      });
 }
 
 void AuditEventPublisher::tearDown() {
@@ -91,6 +112,7 @@ void AuditEventPublisher::tearDown() {
   }
 
   audit_netlink_.reset();
+  assembler_.reset();
 }
 
 Status AuditEventPublisher::run() {
@@ -98,6 +120,17 @@ Status AuditEventPublisher::run() {
     return Status(1, "Publisher disabled via configuration");
   }
 
+  if (assembler_ != nullptr) {
+    auto audit_events = assembler_->takeEvents();
+    if (!audit_events.empty()) {
+      auto event_context = createEventContext();
+      event_context->audit_events = std::move(audit_events);
+      fire(event_context);
+    }
+
+    return Status::success();
+  }
+
   auto audit_event_record_queue = audit_netlink_->getEvents();
 
   auto event_context = createEventContext();
@@ -147,8 +180,7 @@ void AuditEventPublisher::ProcessEvents(
       // SELinux or AppArmor events
     } else if (selinux_event_set.find(audit_event_record.type) !=
                selinux_event_set.end()) {
-      if (audit_event_record.fields.find(kAppArmorEventMarker) ==
-          audit_event_record.fields.end()) {
+      if (audit_event_record.fields.count(kAppArmorEventMarker) == 0U) {
         // Pure SELinux Event
 
         AuditEvent audit_event;
@@ -418,6 +450,56 @@ void AuditEventPublisher::ProcessEvents(
   }
 }
 
+AuditEventAssembler::AuditEventAssembler(
+    std::size_t shard_count, std::set<int> syscalls_allowed_to_fail)
+    : trace_contexts_(shard_count),
+      syscalls_allowed_to_fail_(std::move(syscalls_allowed_to_fail)) {}
+
+void AuditEventAssembler::assemble(
+    std::size_t shard,
+    const std::vector<AuditEventRecord>& record_list) noexcept {
+  auto event_context = std::make_shared<AuditEventContext>();
+  AuditEventPublisher::ProcessEvents(event_context,
+                                     record_list,
+                                     trace_contexts_[shard],
+                                     syscalls_allowed_to_fail_);
+
+  if (event_context->audit_events.empty()) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  audit_events_.insert(
+      audit_events_.end(),
+      std::make_move_iterator(event_context->audit_events.begin()),
+      std::make_move_iterator(event_context->audit_events.end()));
+
+  cv_.notify_all();
+}
+
+std::vector<AuditEvent> AuditEventAssembler::takeEvents() {
+  std::vector<AuditEvent> audit_events;
+
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait_for(lock, std::chrono::seconds(1), [this]() {
+      return !audit_events_.empty();
+    });
+
+    audit_events.swap(audit_events_);
+  }
+
+  // Each shard completes its events in order, merge the shards back
+  std::stable_sort(audit_events.begin(),
+                   audit_events.end(),
+                   [](const AuditEvent& left, const AuditEvent& right) {
+                     return GetAuditSerial(left.record_list.front().audit_id) <
+                            GetAuditSerial(right.record_list.front().audit_id);
+                   });
+
+  return audit_events;
+}
+
 const AuditEventRecord* GetEventRecord(const AuditEvent& event,
                                        int record_type) noexcept {
   auto it = std::find_if(event.record_list.begin(),
@@ -434,21 +516,21 @@ const AuditEventRecord* GetEventRecord(const AuditEvent& event,
 };
 
 bool GetStringFieldFromMap(std::string& value,
-                           const std::map<std::string, std::string>& fields,
+                           const AuditFields& fields,
                            const std::string& name,
                            const std::string& default_value) noexcept {
-  auto it = fields.find(name);
-  if (it == fields.end()) {
+  std::string_view field;
+  if (!fields.get(name, field)) {
     value = default_value;
     return false;
   }
 
-  value = it->second;
+  value.assign(field.data(), field.size());
   return true;
 }
 
 bool GetIntegerFieldFromMap(std::uint64_t& value,
-                            const std::map<std::string, std::string>& field_map,
+                            const AuditFields& field_map,
                             const std::string& field_name,
                             std::size_t base,
                             std::uint64_t default_value) noexcept {
@@ -463,7 +545,7 @@ bool GetIntegerFieldFromMap(std::uint64_t& value,
 }
 
 void CopyFieldFromMap(Row& row,
-                      const std::map<std::string, std::string>& fields,
+                      const AuditFields& fields,
                       const std::string& name,
                       const std::string& default_value) noexcept {
   GetStringFieldFromMap(row[name], fields, name, default_value);
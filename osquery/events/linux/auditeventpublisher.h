@@ -9,10 +9,13 @@
 
 #pragma once
 
+#include <condition_variable>
 #include <cstdint>
 #include <limits>
 #include <memory>
+#include <mutex>
 
+#include <boost/noncopyable.hpp>
 #include <boost/variant.hpp>
 
 #include <osquery/events/eventpublisher.h>
@@ -133,6 +136,39 @@ using AuditSubscriptionContextRef = std::shared_ptr<AuditSubscriptionContext>;
 /// This type maps audit event id with the corresponding audit event object
 using AuditTraceContext = std::map<std::string, AuditEvent>;
 
+/**
+ * @brief Assembles audit events on the parser workers.
+ *
+ * Each worker assembles the records of its shard with its own trace context.
+ * The completed events are merged back in serial number order before they
+ * are fired.
+ */
+class AuditEventAssembler final : private boost::noncopyable {
+ public:
+  AuditEventAssembler(std::size_t shard_count,
+                      std::set<int> syscalls_allowed_to_fail);
+
+  /// Assembles the records of a shard, only called by the shard's worker.
+  void assemble(std::size_t shard,
+                const std::vector<AuditEventRecord>& record_list) noexcept;
+
+  /// Waits up to a second for completed events, ordered by serial number.
+  std::vector<AuditEvent> takeEvents();
+
+ private:
+  /// Partially assembled events of each shard
+  std::vector<AuditTraceContext> trace_contexts_;
+
+  /// Syscalls allowed to fail (captured even if success=no)
+  const std::set<int> syscalls_allowed_to_fail_;
+
+  /// Completed events, waiting to be fired
+  std::vector<AuditEvent> audit_events_;
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+};
+
 class AuditEventPublisher final
     : public EventPublisher<AuditSubscriptionContext, AuditEventContext> {
   DECLARE_PUBLISHER("auditeventpublisher");
@@ -161,6 +197,9 @@ class AuditEventPublisher final
   /// Netlink reader
   std::unique_ptr<AuditdNetlink> audit_netlink_;
 
+  /// Assembles events on the parser workers, if there are several
+  std::shared_ptr<AuditEventAssembler> assembler_;
+
   /// This is where audit records are assembled
   AuditTraceContext audit_trace_context_;
 
@@ -172,26 +211,26 @@ class AuditEventPublisher final
 const AuditEventRecord* GetEventRecord(const AuditEvent& event,
                                        int record_type) noexcept;
 
-/// Extracts the specified string key from the given string map
+/// Extracts the specified string key from the given record fields
 bool GetStringFieldFromMap(
     std::string& value,
-    const std::map<std::string, std::string>& fields,
+    const AuditFields& fields,
     const std::string& name,
     const std::string& default_value = std::string()) noexcept;
 
-/// Extracts the specified integer key from the given string map
+/// Extracts the specified integer key from the given record fields
 bool GetIntegerFieldFromMap(
     std::uint64_t& value,
-    const std::map<std::string, std::string>& field_map,
+    const AuditFields& field_map,
     const std::string& field_name,
     std::size_t base = 10,
     std::uint64_t default_value =
         std::numeric_limits<std::uint64_t>::max()) noexcept;
 
-/// Copies a named field from the 'fields' map to the specified row
+/// Copies a named field from the record fields to the specified row
 void CopyFieldFromMap(
     Row& row,
-    const std::map<std::string, std::string>& fields,
+    const AuditFields& fields,
     const std::string& name,
     const std::string& default_value = std::string()) noexcept;
 
@@ -56,6 +56,16 @@ void reportAndClearBpfErrorState(BPFErrorState& bpf_error_state) {
             << bpf_error_state.probe_error_counter;
   }
 
+  if (bpf_error_state.late_event_counter != 0U) {
+    VLOG(1) << "BPF events received too late to be sorted: "
+            << bpf_error_state.late_event_counter;
+  }
+
+  if (bpf_error_state.max_reorder_depth != 0U) {
+    VLOG(1) << "Highest BPF event reorder buffer depth: "
+            << bpf_error_state.max_reorder_depth;
+  }
+
   if (!bpf_error_state.errored_tracer_list.empty()) {
     std::string tracer_list;
 
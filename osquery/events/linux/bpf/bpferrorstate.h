@@ -29,6 +29,13 @@ struct BPFErrorState final {
   /// process correctly. This is likely caused by either lost events
   /// or probe errors (see above)
   std::unordered_set<std::uint64_t> errored_tracer_list;
+
+  /// Events received after a newer event had already been processed;
+  /// they are still processed, but out of order
+  std::size_t late_event_counter{};
+
+  /// The highest amount of events waiting in the reorder buffer
+  std::size_t max_reorder_depth{};
 };
 
 /// Updates the error state structure with the given perf error counters
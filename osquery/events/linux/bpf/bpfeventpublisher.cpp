@@ -10,15 +10,17 @@
 #include <osquery/core/flags.h>
 #include <osquery/events/linux/bpf/bpferrorstate.h>
 #include <osquery/events/linux/bpf/bpfeventpublisher.h>
+#include <osquery/events/linux/bpf/reorderbuffer.h>
 #include <osquery/events/linux/bpf/serializers.h>
 #include <osquery/events/linux/bpf/setrlimit.h>
 #include <osquery/events/linux/bpf/systemstatetracker.h>
 #include <osquery/logger/logger.h>
 #include <osquery/registry/registry_factory.h>
+#include <osquery/utils/mutex.h>
 #include <osquery/utils/system/time.h>
 
 #include <fcntl.h>
-#include <sys/sysinfo.h>
+#include <time.h>
 
 namespace osquery {
 
@@ -27,6 +29,23 @@ HIDDEN_FLAG(uint32,
             10,
             "Number of minutes between BPF system state tracker resets");
 
+HIDDEN_FLAG(bool,
+            bpf_state_tracker_full_reset,
+            false,
+            "Reset the BPF system state tracker with a full procfs snapshot "
+            "instead of reconciling it incrementally");
+
+HIDDEN_FLAG(uint32,
+            bpf_state_tracker_reconcile_batch,
+            64,
+            "Number of processes reconciled with procfs on each iteration "
+            "of the BPF publisher");
+
+HIDDEN_FLAG(uint64,
+            bpf_event_reorder_max_events,
+            500000ULL,
+            "Maximum number of BPF events held to be sorted by timestamp");
+
 namespace ebpfpub = tob::ebpfpub;
 namespace ebpf = tob::ebpf;
 
@@ -40,6 +59,8 @@ using EventHandler = bool (*)(ISystemStateTracker& state,
 
 using EventHandlerMap = std::unordered_map<std::uint64_t, EventHandler>;
 
+using EventReorderBuffer = ReorderBuffer<ebpfpub::IFunctionTracer::Event>;
+
 using BufferStorageMap =
     std::unordered_map<std::uint8_t, ebpfpub::IBufferStorage::Ref>;
 
@@ -123,6 +144,11 @@ FLAG(uint64,
      512ULL,
      "How many slots each buffer storage should have");
 
+FLAG(uint32,
+     bpf_event_reorder_window,
+     5000U,
+     "Milliseconds BPF events are held to be sorted by timestamp");
+
 REGISTER(BPFEventPublisher, "event_publisher", "BPFEventPublisher");
 
 struct BPFEventPublisher::PrivateData final {
@@ -133,7 +159,7 @@ struct BPFEventPublisher::PrivateData final {
   BufferStorageMap buffer_storage_map;
   EventHandlerMap event_handler_map;
 
-  std::map<std::uint64_t, ebpfpub::IFunctionTracer::Event> event_queue;
+  std::unique_ptr<EventReorderBuffer> event_queue;
   ISystemStateTracker::Ref system_state_tracker;
 };
 
@@ -278,6 +304,10 @@ Status BPFEventPublisher::setUp() {
     d->perf_event_reader->insert(std::move(function_tracer));
   }
 
+  d->event_queue = std::make_unique<EventReorderBuffer>(
+      FLAGS_bpf_event_reorder_window * 1000000ULL,
+      FLAGS_bpf_event_reorder_max_events);
+
   d->system_state_tracker = SystemStateTracker::create();
   if (!d->system_state_tracker) {
     return Status::failure("Failed to create the system state tracker object");
@@ -304,7 +334,7 @@ void BPFEventPublisher::tearDown() {
 
   d->buffer_storage_map.clear();
   d->event_handler_map.clear();
-  d->event_queue.clear();
+  d->event_queue.reset();
 
   d->initialized = false;
 }
@@ -323,19 +353,33 @@ Status BPFEventPublisher::run() {
 
   auto last_error_report = getUnixTime();
   auto last_tracker_restart = getUnixTime();
+  auto reconciling = false;
 
   while (!isEnding()) {
     auto current_time = getUnixTime();
-    if (last_tracker_restart + (FLAGS_bpf_state_tracker_reset_time * 60) <
-        current_time) {
-      auto status = d->system_state_tracker->restart();
-      if (!status.ok()) {
-        LOG(ERROR) << "The BPF system state tracker could not be successfully "
-                      "restarted: "
-                   << status.getMessage();
+    if (!reconciling &&
+        last_tracker_restart + (FLAGS_bpf_state_tracker_reset_time * 60) <
+            current_time) {
+      if (FLAGS_bpf_state_tracker_full_reset) {
+        auto status = d->system_state_tracker->restart();
+        if (!status.ok()) {
+          LOG(ERROR) << "The BPF system state tracker could not be "
+                        "successfully restarted: "
+                     << status.getMessage();
+        } else {
+          VLOG(1)
+              << "The BPF system state tracker has been successfully restarted";
+        }
+
       } else {
-        VLOG(1)
-            << "The BPF system state tracker has been successfully restarted";
+        auto status = d->system_state_tracker->startReconciliation();
+        if (!status.ok()) {
+          LOG(ERROR) << "The BPF system state tracker could not start the "
+                        "procfs reconciliation: "
+                     << status.getMessage();
+        } else {
+          reconciling = true;
+        }
       }
 
       last_tracker_restart = current_time;
@@ -349,49 +393,56 @@ Status BPFEventPublisher::run() {
                 perf_error_counters) {
           updateBpfErrorState(bpf_error_state, perf_error_counters);
 
-          for (auto& event : event_list) {
+          // The reader owns the list, each event is copied into the queue
+          for (const auto& event : event_list) {
             if (event.header.probe_error) {
               ++bpf_error_state.probe_error_counter;
             }
 
-            auto rel_timestamp = event.header.timestamp;
-            d->event_queue.insert({rel_timestamp, std::move(event)});
+            if (!d->event_queue->push(event.header.timestamp, event)) {
+              ++bpf_error_state.late_event_counter;
+            }
           }
         });
 
     current_time = getUnixTime();
     if (last_error_report + 5U < current_time) {
+      bpf_error_state.max_reorder_depth = d->event_queue->takeMaxDepth();
       reportAndClearBpfErrorState(bpf_error_state);
+
+      VLOG(1) << "BPF system state tracker memory usage: "
+              << d->system_state_tracker->memoryUsage() << " bytes";
       last_error_report = current_time;
     }
 
     auto& state = *d->system_state_tracker.get();
 
-    struct sysinfo system_info {};
-    sysinfo(&system_info);
+    // Event timestamps are nanoseconds since boot
+    struct timespec uptime {};
+    clock_gettime(CLOCK_BOOTTIME, &uptime);
 
-    for (auto event_it = d->event_queue.begin();
-         event_it != d->event_queue.end();) {
-      const auto& rel_timestamp = event_it->first / 1000000000ULL;
-      if (system_info.uptime - rel_timestamp < 5ULL) {
-        ++event_it;
-        continue;
-      }
+    auto now = static_cast<std::uint64_t>(uptime.tv_sec) * 1000000000ULL +
+               static_cast<std::uint64_t>(uptime.tv_nsec);
 
-      auto event = std::move(event_it->second);
-      event_it = d->event_queue.erase(event_it);
+    d->event_queue->drain(
+        now, [&](const ebpfpub::IFunctionTracer::Event& event) {
+          auto event_handler_it = d->event_handler_map.find(event.identifier);
+          if (event_handler_it == d->event_handler_map.end()) {
+            LOG(ERROR) << "Unhandled event received in BPFEventPublisher: "
+                       << event.identifier;
+            return;
+          }
 
-      auto event_handler_it = d->event_handler_map.find(event.identifier);
-      if (event_handler_it == d->event_handler_map.end()) {
-        LOG(ERROR) << "Unhandled event received in BPFEventPublisher: "
-                   << event.identifier;
-        continue;
-      }
+          const auto& event_handler = event_handler_it->second;
+          if (!event_handler(state, event)) {
+            bpf_error_state.errored_tracer_list.insert(event.identifier);
+          }
+        });
 
-      const auto& event_handler = event_handler_it->second;
-      if (!event_handler(state, event)) {
-        bpf_error_state.errored_tracer_list.insert(event.identifier);
-      }
+    // Reconcile a few processes at a time, after the pending events have
+    // been applied, so that the event loop is never stalled
+    if (reconciling) {
+      reconciling = !state.reconcile(FLAGS_bpf_state_tracker_reconcile_batch);
     }
 
     auto event_list = state.eventList();
@@ -401,11 +452,33 @@ Status BPFEventPublisher::run() {
 
       fire(event_context);
     }
+
+    // The subscribers batch their rows, and store them from this hook once
+    // their latency limit is reached, even when no new events arrive
+    flushSubscribers();
   }
 
   return Status::success();
 }
 
+void BPFEventPublisher::flushSubscribers() {
+  std::vector<std::function<void()>> flush_callback_list;
+
+  {
+    ReadLock lock(subscription_lock_);
+    for (const auto& subscription : subscriptions_) {
+      auto subscription_context = getSubscriptionContext(subscription->context);
+      if (subscription_context->flush_callback) {
+        flush_callback_list.push_back(subscription_context->flush_callback);
+      }
+    }
+  }
+
+  for (const auto& flush_callback : flush_callback_list) {
+    flush_callback();
+  }
+}
+
 BPFEventPublisher::BPFEventPublisher() : d(new PrivateData) {}
 
 BPFEventPublisher::~BPFEventPublisher() {
@@ -15,11 +15,16 @@
 #include <ebpfpub/ifunctiontracer.h>
 #include <ebpfpub/iperfeventreader.h>
 
+#include <functional>
 #include <vector>
 
 namespace osquery {
 
 struct BPFEventSC final : public SubscriptionContext {
+  /// Called at every iteration of the publisher loop, even when there are
+  /// no new events, so that the subscriber can store its pending rows
+  std::function<void()> flush_callback;
+
  private:
   friend class BPFEventPublisher;
 };
@@ -39,6 +44,9 @@ class BPFEventPublisher final : public EventPublisher<BPFEventSC, BPFEventEC> {
   virtual void tearDown() override;
 
  private:
+  /// Calls the flush callback of each subscription
+  void flushSubscribers();
+
   DECLARE_PUBLISHER("BPFEventPublisher");
 
   struct PrivateData;
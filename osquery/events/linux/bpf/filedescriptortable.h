@@ -0,0 +1,260 @@
+/**
+ * Copyright (c) 2014-present, The osquery authors
+ *
+ * This source code is licensed as defined by the LICENSE file found in the
+ * root directory of this source tree.
+ *
+ * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace osquery {
+
+/// \brief A copy-on-write map of file descriptors
+/// Copies share the same storage until one of them is modified, so a
+/// forked process does not duplicate the descriptor table of its parent.
+///
+/// Entries are kept in a dense array, indexed by an open addressing
+/// table with linear probing. Erasing an entry moves the last one in its
+/// place, so only iterators to the erased and to the last entry are
+/// invalidated. Lookups never modify the storage; entries can only be
+/// changed through operator[], insert() and erase()
+template <typename Value>
+class FileDescriptorTable final {
+ public:
+  using value_type = std::pair<int, Value>;
+  using const_iterator = typename std::vector<value_type>::const_iterator;
+
+  const_iterator begin() const {
+    return entries().begin();
+  }
+
+  const_iterator end() const {
+    return entries().end();
+  }
+
+  std::size_t size() const {
+    return entries().size();
+  }
+
+  bool empty() const {
+    return entries().empty();
+  }
+
+  const_iterator find(int fd) const {
+    if (!storage) {
+      return end();
+    }
+
+    auto slot = findSlot(*storage, fd);
+    if (storage->index[slot] == kEmptySlot) {
+      return end();
+    }
+
+    return begin() + storage->index[slot];
+  }
+
+  std::size_t count(int fd) const {
+    return find(fd) != end() ? 1U : 0U;
+  }
+
+  const Value& at(int fd) const {
+    auto fd_it = find(fd);
+    if (fd_it == end()) {
+      throw std::out_of_range("Invalid file descriptor");
+    }
+
+    return fd_it->second;
+  }
+
+  /// Returns the given descriptor, creating it if it does not exist
+  Value& operator[](int fd) {
+    auto& writable_storage = detach();
+
+    auto slot = findSlot(writable_storage, fd);
+    if (writable_storage.index[slot] == kEmptySlot) {
+      slot = emplace(writable_storage, slot, {fd, Value{}});
+    }
+
+    return writable_storage.entries[writable_storage.index[slot]].second;
+  }
+
+  /// Adds a descriptor, unless one with the same value already exists
+  bool insert(value_type entry) {
+    if (count(entry.first) != 0U) {
+      return false;
+    }
+
+    auto& writable_storage = detach();
+
+    auto slot = findSlot(writable_storage, entry.first);
+    emplace(writable_storage, slot, std::move(entry));
+
+    return true;
+  }
+
+  /// Adds or replaces a descriptor
+  void insert_or_assign(int fd, Value value) {
+    (*this)[fd] = std::move(value);
+  }
+
+  std::size_t erase(int fd) {
+    auto fd_it = find(fd);
+    if (fd_it == end()) {
+      return 0U;
+    }
+
+    erase(fd_it);
+    return 1U;
+  }
+
+  /// Returns an iterator to the entry that took the place of the erased one
+  const_iterator erase(const_iterator fd_it) {
+    auto position = static_cast<std::size_t>(fd_it - begin());
+
+    auto& writable_storage = detach();
+    auto& entry_list = writable_storage.entries;
+
+    auto slot = findSlot(writable_storage, entry_list[position].first);
+    releaseSlot(writable_storage, slot);
+
+    auto last_position = entry_list.size() - 1U;
+    if (position != last_position) {
+      auto last_slot =
+          findSlot(writable_storage, entry_list[last_position].first);
+
+      writable_storage.index[last_slot] = static_cast<std::uint32_t>(position);
+      entry_list[position] = std::move(entry_list[last_position]);
+    }
+
+    entry_list.pop_back();
+    return begin() + position;
+  }
+
+  void clear() {
+    storage.reset();
+  }
+
+  /// \brief Returns the memory used by this table, in bytes
+  /// The memory of a shared table is split between the copies sharing it
+  std::size_t memoryUsage() const {
+    if (!storage) {
+      return 0U;
+    }
+
+    auto memory_usage = sizeof(Storage) +
+                        storage->entries.capacity() * sizeof(value_type) +
+                        storage->index.capacity() * sizeof(std::uint32_t);
+
+    return memory_usage / static_cast<std::size_t>(storage.use_count());
+  }
+
+ private:
+  static constexpr std::uint32_t kEmptySlot{
+      std::numeric_limits<std::uint32_t>::max()};
+
+  static constexpr std::size_t kMinimumIndexSize{8U};
+
+  struct Storage final {
+    std::vector<value_type> entries;
+    std::vector<std::uint32_t> index;
+  };
+
+  const std::vector<value_type>& entries() const {
+    static const std::vector<value_type> kEmptyEntryList;
+    return storage ? storage->entries : kEmptyEntryList;
+  }
+
+  // Descriptors are small, mostly consecutive numbers: use them as they are
+  static std::size_t homeSlot(const Storage& storage, int fd) {
+    return static_cast<std::size_t>(static_cast<std::uint32_t>(fd)) &
+           (storage.index.size() - 1U);
+  }
+
+  /// Returns the slot holding the descriptor, or the empty slot ending
+  /// its probe sequence
+  static std::size_t findSlot(const Storage& storage, int fd) {
+    auto mask = storage.index.size() - 1U;
+
+    for (auto slot = homeSlot(storage, fd);; slot = (slot + 1U) & mask) {
+      auto position = storage.index[slot];
+      if (position == kEmptySlot || storage.entries[position].first == fd) {
+        return slot;
+      }
+    }
+  }
+
+  /// Takes ownership of the storage, copying it if it is shared
+  Storage& detach() {
+    if (!storage) {
+      storage = std::make_shared<Storage>();
+      storage->index.assign(kMinimumIndexSize, kEmptySlot);
+
+    } else if (storage.use_count() > 1) {
+      storage = std::make_shared<Storage>(*storage);
+    }
+
+    return *storage;
+  }
+
+  /// Adds an entry in the given empty slot, and returns its final slot
+  static std::size_t emplace(Storage& storage,
+                             std::size_t slot,
+                             value_type entry) {
+    auto fd = entry.first;
+
+    storage.entries.push_back(std::move(entry));
+    storage.index[slot] =
+        static_cast<std::uint32_t>(storage.entries.size() - 1U);
+
+    // Keep the load factor below 3/4
+    if (storage.entries.size() * 4U > storage.index.size() * 3U) {
+      rehash(storage, storage.index.size() * 2U);
+      slot = findSlot(storage, fd);
+    }
+
+    return slot;
+  }
+
+  static void rehash(Storage& storage, std::size_t index_size) {
+    storage.index.assign(index_size, kEmptySlot);
+
+    for (std::size_t position = 0U; position < storage.entries.size();
+         ++position) {
+      auto slot = findSlot(storage, storage.entries[position].first);
+      storage.index[slot] = static_cast<std::uint32_t>(position);
+    }
+  }
+
+  /// Empties a slot, moving back the entries that were displaced by it
+  static void releaseSlot(Storage& storage, std::size_t slot) {
+    auto mask = storage.index.size() - 1U;
+
+    storage.index[slot] = kEmptySlot;
+
+    for (auto next = (slot + 1U) & mask; storage.index[next] != kEmptySlot;
+         next = (next + 1U) & mask) {
+      const auto& entry = storage.entries[storage.index[next]];
+      auto home = homeSlot(storage, entry.first);
+
+      // Move the entry if the empty slot is between its home and itself
+      if (((next - home) & mask) >= ((next - slot) & mask)) {
+        storage.index[slot] = storage.index[next];
+        storage.index[next] = kEmptySlot;
+        slot = next;
+      }
+    }
+  }
+
+  std::shared_ptr<Storage> storage;
+};
+
+} // namespace osquery
@@ -0,0 +1,198 @@
+/**
+ * Copyright (c) 2014-present, The osquery authors
+ *
+ * This source code is licensed as defined by the LICENSE file found in the
+ * root directory of this source tree.
+ *
+ * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
+ */
+
+#include <osquery/events/linux/bpf/internedstring.h>
+
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+
+namespace osquery {
+
+namespace {
+
+struct InternTable final {
+  std::mutex mutex;
+  std::unordered_map<std::string_view, std::weak_ptr<const std::string>>
+      string_map;
+
+  std::size_t memory_usage{};
+};
+
+// Never destroyed, since interned strings may outlive static objects
+InternTable& getInternTable() {
+  static auto intern_table = new InternTable;
+  return *intern_table;
+}
+
+std::size_t getStringMemoryUsage(const std::string& value) {
+  auto memory_usage = sizeof(std::string);
+
+  // Short strings are stored inside the object
+  auto object_begin = reinterpret_cast<const char*>(&value);
+  auto object_end = object_begin + sizeof(std::string);
+  if (value.data() < object_begin || value.data() >= object_end) {
+    memory_usage += value.capacity() + 1U;
+  }
+
+  return memory_usage;
+}
+
+void releaseString(const std::string* value) {
+  auto& intern_table = getInternTable();
+
+  {
+    std::lock_guard<std::mutex> lock(intern_table.mutex);
+
+    // The entry may already point to a newer copy of the same string
+    auto string_it = intern_table.string_map.find(*value);
+    if (string_it != intern_table.string_map.end() &&
+        string_it->first.data() == value->data()) {
+      intern_table.string_map.erase(string_it);
+    }
+
+    intern_table.memory_usage -= getStringMemoryUsage(*value);
+  }
+
+  delete value;
+}
+
+std::shared_ptr<const std::string> internString(std::string value) {
+  if (value.empty()) {
+    return nullptr;
+  }
+
+  auto& intern_table = getInternTable();
+  std::lock_guard<std::mutex> lock(intern_table.mutex);
+
+  auto string_it = intern_table.string_map.find(value);
+  if (string_it != intern_table.string_map.end()) {
+    auto interned_value = string_it->second.lock();
+    if (interned_value) {
+      return interned_value;
+    }
+
+    // The last copy is being released, replace the entry
+    intern_table.string_map.erase(string_it);
+  }
+
+  value.shrink_to_fit();
+  auto interned_value = std::shared_ptr<const std::string>(
+      new std::string(std::move(value)), releaseString);
+
+  intern_table.string_map.insert({*interned_value, interned_value});
+  intern_table.memory_usage += getStringMemoryUsage(*interned_value);
+
+  return interned_value;
+}
+
+} // namespace
+
+InternedString::InternedString(const std::string& value)
+    : value(internString(value)) {}
+
+InternedString::InternedString(std::string&& value)
+    : value(internString(std::move(value))) {}
+
+InternedString::InternedString(const char* value)
+    : value(internString(value)) {}
+
+const std::string& InternedString::str() const {
+  static const std::string kEmptyString;
+  return value ? *value : kEmptyString;
+}
+
+InternedString::operator const std::string&() const {
+  return str();
+}
+
+bool InternedString::empty() const {
+  return !value;
+}
+
+std::size_t InternedString::size() const {
+  return str().size();
+}
+
+std::size_t InternedString::count() {
+  auto& intern_table = getInternTable();
+
+  std::lock_guard<std::mutex> lock(intern_table.mutex);
+  return intern_table.string_map.size();
+}
+
+std::size_t InternedString::memoryUsage() {
+  auto& intern_table = getInternTable();
+
+  std::lock_guard<std::mutex> lock(intern_table.mutex);
+  return intern_table.memory_usage +
+         intern_table.string_map.bucket_count() * sizeof(void*) +
+         intern_table.string_map.size() *
+             (sizeof(std::string_view) + sizeof(std::weak_ptr<void>) +
+              sizeof(void*));
+}
+
+bool operator==(const InternedString& lhs, const InternedString& rhs) {
+  // Equal strings share the same storage
+  return &lhs.str() == &rhs.str();
+}
+
+bool operator==(const InternedString& lhs, const std::string& rhs) {
+  return lhs.str() == rhs;
+}
+
+bool operator==(const std::string& lhs, const InternedString& rhs) {
+  return lhs == rhs.str();
+}
+
+bool operator==(const InternedString& lhs, const char* rhs) {
+  return lhs.str() == rhs;
+}
+
+bool operator==(const char* lhs, const InternedString& rhs) {
+  return lhs == rhs.str();
+}
+
+bool operator!=(const InternedString& lhs, const InternedString& rhs) {
+  return !(lhs == rhs);
+}
+
+bool operator!=(const InternedString& lhs, const std::string& rhs) {
+  return !(lhs == rhs);
+}
+
+bool operator!=(const std::string& lhs, const InternedString& rhs) {
+  return !(lhs == rhs);
+}
+
+bool operator!=(const InternedString& lhs, const char* rhs) {
+  return !(lhs == rhs);
+}
+
+bool operator!=(const char* lhs, const InternedString& rhs) {
+  return !(lhs == rhs);
+}
+
+std::string operator+(const InternedString& lhs, const std::string& rhs) {
+  return lhs.str() + rhs;
+}
+
+std::string operator+(const InternedString& lhs, const char* rhs) {
+  return lhs.str() + rhs;
+}
+
+std::string operator+(const InternedString& lhs, char rhs) {
+  return lhs.str() + rhs;
+}
+
+std::ostream& operator<<(std::ostream& stream, const InternedString& value) {
+  return stream << value.str();
+}
+
+} // namespace osquery
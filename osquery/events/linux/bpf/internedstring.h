@@ -0,0 +1,65 @@
+/**
+ * Copyright (c) 2014-present, The osquery authors
+ *
+ * This source code is licensed as defined by the LICENSE file found in the
+ * root directory of this source tree.
+ *
+ * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
+ */
+
+#pragma once
+
+#include <memory>
+#include <ostream>
+#include <string>
+
+namespace osquery {
+
+/// \brief An immutable string, stored once no matter how many copies exist
+/// Equal strings share the same storage through a process-wide table;
+/// the storage is released together with the last copy. This is used
+/// for the paths tracked by the BPF system state tracker, since most
+/// processes share their binary, working directory and open files
+class InternedString final {
+ public:
+  InternedString() = default;
+  InternedString(const std::string& value);
+  InternedString(std::string&& value);
+  InternedString(const char* value);
+
+  /// Returns the string value
+  const std::string& str() const;
+  operator const std::string&() const;
+
+  bool empty() const;
+  std::size_t size() const;
+
+  /// Returns the amount of distinct strings currently interned
+  static std::size_t count();
+
+  /// Returns the memory used by the interned strings, in bytes
+  static std::size_t memoryUsage();
+
+ private:
+  std::shared_ptr<const std::string> value;
+};
+
+bool operator==(const InternedString& lhs, const InternedString& rhs);
+bool operator==(const InternedString& lhs, const std::string& rhs);
+bool operator==(const std::string& lhs, const InternedString& rhs);
+bool operator==(const InternedString& lhs, const char* rhs);
+bool operator==(const char* lhs, const InternedString& rhs);
+
+bool operator!=(const InternedString& lhs, const InternedString& rhs);
+bool operator!=(const InternedString& lhs, const std::string& rhs);
+bool operator!=(const std::string& lhs, const InternedString& rhs);
+bool operator!=(const InternedString& lhs, const char* rhs);
+bool operator!=(const char* lhs, const InternedString& rhs);
+
+std::string operator+(const InternedString& lhs, const std::string& rhs);
+std::string operator+(const InternedString& lhs, const char* rhs);
+std::string operator+(const InternedString& lhs, char rhs);
+
+std::ostream& operator<<(std::ostream& stream, const InternedString& value);
+
+} // namespace osquery
@@ -9,22 +9,29 @@
 
 #pragma once
 
+#include <optional>
 #include <string>
 #include <unordered_map>
+#include <variant>
 #include <vector>
 
+#include <osquery/events/linux/bpf/filedescriptortable.h>
 #include <osquery/events/linux/bpf/ifilesystem.h>
+#include <osquery/events/linux/bpf/internedstring.h>
 
 namespace osquery {
 
-/// A structure collecting process data
+/// \brief A structure collecting process data
+/// Paths and addresses are interned, and file descriptor tables are
+/// shared between copies until modified, since a forked process starts
+/// with the same state as its parent
 struct ProcessContext final {
   /// An object describing a file descriptor
   struct FileDescriptor final {
     /// Path data for files
     struct FileData final {
       /// File or directory path
-      std::string path;
+      InternedString path;
     };
 
     /// Network information for sockets
@@ -39,13 +46,13 @@ struct ProcessContext final {
       std::optional<int> opt_protocol;
 
       /// Local address, as passed to bind()
-      std::optional<std::string> opt_local_address;
+      std::optional<InternedString> opt_local_address;
 
       /// Local port, as passed to bind()
       std::optional<std::uint16_t> opt_local_port;
 
       /// Remote address, as passed to connect() or received from accept()
-      std::optional<std::string> opt_remote_address;
+      std::optional<InternedString> opt_remote_address;
 
       /// Remote port, as passed to connect() or received from accept()
       std::optional<std::uint16_t> opt_remote_port;
@@ -58,19 +65,19 @@ struct ProcessContext final {
     bool close_on_exec{false};
   };
 
-  using FileDescriptorMap = std::unordered_map<int, FileDescriptor>;
+  using FileDescriptorMap = FileDescriptorTable<FileDescriptor>;
 
   /// Parent process id
   pid_t parent_process_id{};
 
   /// Current binary path
-  std::string binary_path;
+  InternedString binary_path;
 
   /// Program argument list
   std::vector<std::string> argv;
 
   /// Current working directory
-  std::string cwd;
+  InternedString cwd;
 
   /// File descriptor map, automatically inherited when forking
   FileDescriptorMap fd_map;
@@ -98,6 +98,20 @@ class ISystemStateTracker {
   /// \brief Resets the internal state, taking a new /proc snapshot
   virtual Status restart() = 0;
 
+  /// \brief Starts comparing the internal state against /proc
+  /// The list of processes to compare is taken immediately, while the
+  /// comparison is performed in small batches through reconcile()
+  virtual Status startReconciliation() = 0;
+
+  /// \brief Compares up to max_process_count processes against /proc
+  /// Only the process contexts that differ from /proc are updated.
+  /// Returns true when no process is left to compare
+  virtual bool reconcile(std::size_t max_process_count) = 0;
+
+  /// \brief Returns an estimate of the memory used by the tracked state
+  /// The value is in bytes, and includes the interned strings
+  virtual std::size_t memoryUsage() const = 0;
+
   /// \brief Creates a new process, in response to an fork, vfork or clone
   /// syscall Once the method has updated the internal state, it will also emit
   /// a new event
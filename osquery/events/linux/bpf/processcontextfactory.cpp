@@ -130,9 +130,12 @@ bool ProcessContextFactory::captureSingleProcess(
     return false;
   }
 
-  succeeded = fs.readLinkAt(output.binary_path, process_root.get(), "exe");
+  std::string binary_path;
+  succeeded = fs.readLinkAt(binary_path, process_root.get(), "exe");
   static_cast<void>(succeeded);
 
+  output.binary_path = std::move(binary_path);
+
   succeeded = getArgvFromCmdlineFile(fs, output.argv, process_cmdline.get());
   static_cast<void>(succeeded);
 
@@ -142,10 +145,13 @@ bool ProcessContextFactory::captureSingleProcess(
     return false;
   }
 
-  if (!fs.readLinkAt(output.cwd, process_root.get(), "cwd")) {
+  std::string cwd;
+  if (!fs.readLinkAt(cwd, process_root.get(), "cwd")) {
     return false;
   }
 
+  output.cwd = std::move(cwd);
+
   if (!getParentPidFromStatFile(
           fs, output.parent_process_id, process_stat.get())) {
     return false;
@@ -159,12 +165,32 @@ bool ProcessContextFactory::captureAllProcesses(
     IFilesystem& fs, ProcessContextMap& process_map) {
   process_map = {};
 
+  std::vector<pid_t> process_id_list;
+  auto succeeded = getProcessIdList(fs, process_id_list);
+
+  ProcessContextMap output;
+
+  for (auto pid : process_id_list) {
+    ProcessContext process_context = {};
+    if (captureSingleProcess(fs, process_context, pid)) {
+      output.insert({pid, std::move(process_context)});
+    }
+  }
+
+  process_map = std::move(output);
+  return succeeded;
+}
+
+bool ProcessContextFactory::getProcessIdList(
+    IFilesystem& fs, std::vector<pid_t>& process_id_list) {
+  process_id_list = {};
+
   tob::utils::UniqueFd process_root;
   if (!fs.open(process_root, kProcFsRoot, O_DIRECTORY)) {
     return false;
   }
 
-  ProcessContextMap output;
+  std::vector<pid_t> output;
 
   // clang-format off
   auto succeeded = fs.enumFiles(
@@ -180,18 +206,12 @@ bool ProcessContextFactory::captureAllProcesses(
         return;
       }
 
-      auto pid = pid_exp.take();
-
-      ProcessContext process_context = {};
-      if (captureSingleProcess(fs, process_context, pid)) {
-        output.insert({pid, std::move(process_context)});
-      } else {
-      }
+      output.push_back(static_cast<pid_t>(pid_exp.take()));
     }
   );
   // clang-format on
 
-  process_map = std::move(output);
+  process_id_list = std::move(output);
   return succeeded;
 }
 
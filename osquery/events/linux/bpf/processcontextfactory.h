@@ -36,6 +36,9 @@ class ProcessContextFactory final : public IProcessContextFactory {
   static bool captureAllProcesses(IFilesystem& fs,
                                   ProcessContextMap& process_map);
 
+  static bool getProcessIdList(IFilesystem& fs,
+                               std::vector<pid_t>& process_id_list);
+
   static bool getArgvFromCmdlineFile(IFilesystem& fs,
                                      std::vector<std::string>& argv,
                                      int fd);
@@ -0,0 +1,139 @@
+/**
+ * Copyright (c) 2014-present, The osquery authors
+ *
+ * This source code is licensed as defined by the LICENSE file found in the
+ * root directory of this source tree.
+ *
+ * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace osquery {
+
+/**
+ * @brief Sorts events by timestamp within a lateness window
+ *
+ * Events are held until they are older than the window, then released
+ * in timestamp order; events sharing a timestamp are released in the
+ * order they were received. The heap only holds indexes, and the event
+ * storage slots are reused once released.
+ *
+ * When more than `capacity` events are held, the oldest ones are released
+ * early. An event older than one that has already been released can no
+ * longer be sorted: it is counted as late and released with the next batch
+ */
+template <typename Event>
+class ReorderBuffer final {
+ public:
+  /// The window uses the same unit as the event timestamps
+  ReorderBuffer(std::uint64_t window, std::size_t capacity)
+      : window(window), capacity(capacity) {}
+
+  /// Adds an event, returns false if the event is late
+  bool push(std::uint64_t timestamp, Event event) {
+    std::size_t slot{};
+    if (free_slot_list.empty()) {
+      slot = storage.size();
+      storage.push_back(std::move(event));
+
+    } else {
+      slot = free_slot_list.back();
+      free_slot_list.pop_back();
+
+      storage[slot] = std::move(event);
+    }
+
+    heap.push_back({timestamp, next_sequence++, slot});
+    std::push_heap(heap.begin(), heap.end(), Later{});
+
+    max_depth = std::max(max_depth, heap.size());
+    return !isLate(timestamp);
+  }
+
+  /// Releases, in order, the events that are older than the window
+  template <typename Callback>
+  void drain(std::uint64_t now, Callback callback) {
+    while (!heap.empty()) {
+      auto timestamp = heap.front().timestamp;
+      auto expired = now >= window && timestamp <= now - window;
+      if (!expired && !isLate(timestamp) && heap.size() <= capacity) {
+        break;
+      }
+
+      std::pop_heap(heap.begin(), heap.end(), Later{});
+      auto slot = heap.back().slot;
+      heap.pop_back();
+
+      last_released = std::max(last_released, timestamp);
+      released = true;
+
+      callback(storage[slot]);
+
+      // Do not keep the released event's buffers alive in the free slot
+      storage[slot] = Event{};
+      free_slot_list.push_back(slot);
+    }
+  }
+
+  /// Drops every event that is currently held
+  void clear() {
+    heap.clear();
+    storage.clear();
+    free_slot_list.clear();
+  }
+
+  /// Returns the amount of events currently held
+  std::size_t size() const {
+    return heap.size();
+  }
+
+  /// Returns the highest amount of events held since the last call
+  std::size_t takeMaxDepth() {
+    auto depth = max_depth;
+    max_depth = heap.size();
+
+    return depth;
+  }
+
+ private:
+  struct Entry final {
+    std::uint64_t timestamp{};
+    std::uint64_t sequence{};
+    std::size_t slot{};
+  };
+
+  /// Orders the heap so that the oldest entry is at the front
+  struct Later final {
+    bool operator()(const Entry& lhs, const Entry& rhs) const {
+      if (lhs.timestamp != rhs.timestamp) {
+        return lhs.timestamp > rhs.timestamp;
+      }
+
+      return lhs.sequence > rhs.sequence;
+    }
+  };
+
+  bool isLate(std::uint64_t timestamp) const {
+    return released && timestamp < last_released;
+  }
+
+  std::uint64_t window{};
+  std::size_t capacity{};
+
+  std::vector<Entry> heap;
+  std::vector<Event> storage;
+  std::vector<std::size_t> free_slot_list;
+
+  std::uint64_t next_sequence{};
+  std::uint64_t last_released{};
+  bool released{false};
+
+  std::size_t max_depth{};
+};
+
+} // namespace osquery
@@ -7,10 +7,12 @@
  * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
  */
 
+#include <algorithm>
 #include <iomanip>
 #include <iostream>
 #include <sstream>
 
+#include <osquery/events/linux/bpf/processcontextfactory.h>
 #include <osquery/events/linux/bpf/systemstatetracker.h>
 #include <osquery/logger/logger.h>
 #include <osquery/utils/status/status.h>
@@ -29,11 +31,24 @@ namespace {
 const std::size_t kMaxFileHandleEntryCount{512U};
 const std::uint64_t kExpirationTime{180U};
 const std::size_t kEventsBeforeExpiration{10000U};
+
+std::size_t getHeapMemoryUsage(const std::string& value) {
+  // Short strings are stored inside the object
+  auto object_begin = reinterpret_cast<const char*>(&value);
+  auto object_end = object_begin + sizeof(std::string);
+  if (value.data() >= object_begin && value.data() < object_end) {
+    return 0U;
+  }
+
+  return value.capacity() + 1U;
 }
 
+} // namespace
+
 struct SystemStateTracker::PrivateData final {
   Context context;
   IProcessContextFactory::Ref process_context_factory;
+  IFilesystem::Ref fs;
   std::uint64_t last_expiration{};
   std::size_t event_count_since_expiration{};
 };
@@ -74,6 +89,18 @@ Status SystemStateTracker::restart() {
   return Status::success();
 }
 
+Status SystemStateTracker::startReconciliation() {
+  return startReconciliation(d->context, *d->fs.get());
+}
+
+bool SystemStateTracker::reconcile(std::size_t max_process_count) {
+  return reconcileProcessContexts(d->context, *d->fs.get(), max_process_count);
+}
+
+std::size_t SystemStateTracker::memoryUsage() const {
+  return memoryUsage(d->context);
+}
+
 bool SystemStateTracker::createProcess(
     const tob::ebpfpub::IFunctionTracer::Event::Header& event_header,
     pid_t process_id,
@@ -272,7 +299,12 @@ SystemStateTracker::SystemStateTracker(
   d->last_expiration = getUnixTime();
   d->process_context_factory = std::move(process_context_factory);
 
-  auto status = restart();
+  auto status = IFilesystem::create(d->fs);
+  if (!status.ok()) {
+    throw status;
+  }
+
+  status = restart();
   if (!status.ok()) {
     throw status;
   }
@@ -336,6 +368,174 @@ Status SystemStateTracker::expireProcessContexts(Context& context,
   return Status::success();
 }
 
+std::size_t SystemStateTracker::memoryUsage(const Context& context) {
+  const auto& process_map = context.process_map;
+
+  auto memory_usage = sizeof(Context) + InternedString::memoryUsage() +
+                      process_map.bucket_count() * sizeof(void*);
+
+  for (const auto& p : process_map) {
+    const auto& process_context = p.second;
+
+    // Each node holds the value and a pointer to the next node
+    memory_usage += sizeof(p) + sizeof(void*);
+    memory_usage += process_context.fd_map.memoryUsage();
+
+    const auto& argv = process_context.argv;
+    memory_usage += argv.capacity() * sizeof(std::string);
+
+    for (const auto& argument : argv) {
+      memory_usage += getHeapMemoryUsage(argument);
+    }
+  }
+
+  return memory_usage;
+}
+
+Status SystemStateTracker::startReconciliation(Context& context,
+                                               IFilesystem& fs) {
+  std::vector<pid_t> process_id_list;
+  if (!ProcessContextFactory::getProcessIdList(fs, process_id_list)) {
+    return Status::failure("Failed to scan the procfs folder");
+  }
+
+  // Also visit the tracked processes, in case they no longer exist
+  for (const auto& p : context.process_map) {
+    process_id_list.push_back(p.first);
+  }
+
+  std::sort(process_id_list.begin(), process_id_list.end());
+
+  auto last_it = std::unique(process_id_list.begin(), process_id_list.end());
+  process_id_list.erase(last_it, process_id_list.end());
+
+  context.reconciliation_list = std::move(process_id_list);
+  context.reconciliation_stats = {};
+
+  return Status::success();
+}
+
+bool SystemStateTracker::reconcileProcessContexts(
+    Context& context, IFilesystem& fs, std::size_t max_process_count) {
+  if (context.reconciliation_list.empty()) {
+    return true;
+  }
+
+  auto& stats = context.reconciliation_stats;
+
+  for (std::size_t i = 0U;
+       i < max_process_count && !context.reconciliation_list.empty();
+       ++i) {
+    auto process_id = context.reconciliation_list.back();
+    context.reconciliation_list.pop_back();
+
+    auto process_it = context.process_map.find(process_id);
+
+    ProcessContext procfs_context;
+    if (!ProcessContextFactory::captureSingleProcess(
+            fs, procfs_context, process_id)) {
+      if (process_it != context.process_map.end()) {
+        context.process_map.erase(process_it);
+        ++stats.removed;
+      }
+
+      continue;
+    }
+
+    if (process_it == context.process_map.end()) {
+      context.process_map.insert({process_id, std::move(procfs_context)});
+      ++stats.added;
+      continue;
+    }
+
+    if (reconcileProcessContext(process_it->second, procfs_context)) {
+      ++stats.repaired;
+    }
+  }
+
+  if (!context.reconciliation_list.empty()) {
+    return false;
+  }
+
+  VLOG(1) << "The BPF system state tracker has been reconciled with procfs. "
+          << "Added: " << stats.added << ", removed: " << stats.removed
+          << ", repaired: " << stats.repaired;
+
+  return true;
+}
+
+bool SystemStateTracker::reconcileProcessContext(
+    ProcessContext& process_context, ProcessContext& procfs_context) {
+  bool repaired{false};
+
+  if (process_context.parent_process_id != procfs_context.parent_process_id) {
+    process_context.parent_process_id = procfs_context.parent_process_id;
+    repaired = true;
+  }
+
+  if (process_context.binary_path != procfs_context.binary_path) {
+    process_context.binary_path = std::move(procfs_context.binary_path);
+    repaired = true;
+  }
+
+  if (process_context.argv != procfs_context.argv) {
+    process_context.argv = std::move(procfs_context.argv);
+    repaired = true;
+  }
+
+  if (process_context.cwd != procfs_context.cwd) {
+    process_context.cwd = std::move(procfs_context.cwd);
+    repaired = true;
+  }
+
+  // procfs only reports file paths: sockets are kept as they are, while
+  // files that are no longer listed have been closed
+  auto& fd_map = process_context.fd_map;
+  for (auto fd_it = fd_map.begin(); fd_it != fd_map.end();) {
+    const auto& fd_info = fd_it->second;
+
+    if (std::holds_alternative<ProcessContext::FileDescriptor::FileData>(
+            fd_info.data) &&
+        procfs_context.fd_map.count(fd_it->first) == 0U) {
+      fd_it = fd_map.erase(fd_it);
+      repaired = true;
+
+    } else {
+      ++fd_it;
+    }
+  }
+
+  for (auto& procfs_fd : procfs_context.fd_map) {
+    // Sockets only appear in procfs as "socket:[inode]" links, which must
+    // not replace the socket state tracked from the events
+    auto procfs_file_data =
+        std::get_if<ProcessContext::FileDescriptor::FileData>(
+            &procfs_fd.second.data);
+
+    if (procfs_file_data == nullptr ||
+        procfs_file_data->path.str().find("socket:[") == 0U) {
+      continue;
+    }
+
+    auto fd_it = fd_map.find(procfs_fd.first);
+    if (fd_it != fd_map.end()) {
+      const auto& fd_info = fd_it->second;
+
+      auto file_data = std::get_if<ProcessContext::FileDescriptor::FileData>(
+          &fd_info.data);
+
+      if (file_data != nullptr && file_data->path == procfs_file_data->path) {
+        continue;
+      }
+    }
+
+    fd_map[procfs_fd.first] = std::move(procfs_fd.second);
+    repaired = true;
+  }
+
+  return repaired;
+}
+
 bool SystemStateTracker::createProcess(
     Context& context,
     IProcessContextFactory& process_context_factory,
@@ -497,11 +697,13 @@ bool SystemStateTracker::setWorkingDirectory(
     process_context.cwd = path;
 
   } else {
-    if (process_context.cwd.back() != '/') {
-      process_context.cwd += '/';
+    std::string cwd = process_context.cwd;
+    if (cwd.back() != '/') {
+      cwd += '/';
     }
 
-    process_context.cwd += path;
+    cwd += path;
+    process_context.cwd = std::move(cwd);
   }
 
   return true;
@@ -652,20 +854,9 @@ bool SystemStateTracker::bind(
 
   // If we dont have a file descriptor, create one right now. We may have
   // to figure out what's in the sockaddr structure
-  auto fd_info_it = process_context.fd_map.find(fd);
-  if (fd_info_it == process_context.fd_map.end()) {
-    ProcessContext::FileDescriptor fd_info;
-    fd_info.close_on_exec = false;
-    fd_info.data = ProcessContext::FileDescriptor::SocketData{};
-
-    auto insert_status =
-        process_context.fd_map.insert({fd, std::move(fd_info)});
-
-    fd_info_it = insert_status.first;
-  }
+  auto& fd_info = process_context.fd_map[fd];
 
   // Reset the file descriptor type if it's not a socket
-  auto& fd_info = fd_info_it->second;
   if (!std::holds_alternative<ProcessContext::FileDescriptor::SocketData>(
           fd_info.data)) {
     fd_info.data = ProcessContext::FileDescriptor::SocketData{};
@@ -796,20 +987,9 @@ bool SystemStateTracker::connect(
 
   // If we dont have a file descriptor, create one right now. We may have
   // to figure out what's in the sockaddr structure
-  auto fd_info_it = process_context.fd_map.find(fd);
-  if (fd_info_it == process_context.fd_map.end()) {
-    ProcessContext::FileDescriptor fd_info;
-    fd_info.close_on_exec = false;
-    fd_info.data = ProcessContext::FileDescriptor::SocketData{};
-
-    auto insert_status =
-        process_context.fd_map.insert({fd, std::move(fd_info)});
-
-    fd_info_it = insert_status.first;
-  }
+  auto& fd_info = process_context.fd_map[fd];
 
   // Reset the file descriptor type if it's not a socket
-  auto& fd_info = fd_info_it->second;
   if (!std::holds_alternative<ProcessContext::FileDescriptor::SocketData>(
           fd_info.data)) {
     fd_info.data = ProcessContext::FileDescriptor::SocketData{};
@@ -879,20 +1059,9 @@ bool SystemStateTracker::accept(
 
   // If we dont have a file descriptor, create one right now. We may have
   // to figure out what's in the sockaddr structure
-  auto parent_fd_info_it = process_context.fd_map.find(fd);
-  if (parent_fd_info_it == process_context.fd_map.end()) {
-    ProcessContext::FileDescriptor fd_info;
-    fd_info.close_on_exec = false;
-    fd_info.data = ProcessContext::FileDescriptor::SocketData{};
-
-    auto insert_status =
-        process_context.fd_map.insert({fd, std::move(fd_info)});
-
-    parent_fd_info_it = insert_status.first;
-  }
+  auto& parent_fd_info = process_context.fd_map[fd];
 
   // Reset the parent file descriptor type if it's not a socket
-  auto& parent_fd_info = parent_fd_info_it->second;
   if (!std::holds_alternative<ProcessContext::FileDescriptor::SocketData>(
           parent_fd_info.data)) {
     parent_fd_info.data = ProcessContext::FileDescriptor::SocketData{};
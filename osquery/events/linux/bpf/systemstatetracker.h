@@ -28,6 +28,9 @@ class SystemStateTracker final : public ISystemStateTracker {
   virtual ~SystemStateTracker() override;
 
   virtual Status restart() override;
+  virtual Status startReconciliation() override;
+  virtual bool reconcile(std::size_t max_process_count) override;
+  virtual std::size_t memoryUsage() const override;
 
   virtual bool createProcess(
       const tob::ebpfpub::IFunctionTracer::Event::Header& event_header,
@@ -121,12 +124,21 @@ class SystemStateTracker final : public ISystemStateTracker {
 
   using FileHandleStructMap = std::unordered_map<std::string, FileHandleStruct>;
 
+  struct ReconciliationStats final {
+    std::size_t added{};
+    std::size_t removed{};
+    std::size_t repaired{};
+  };
+
   struct Context final {
     ProcessContextMap process_map;
     EventList event_list;
 
     std::vector<std::string> file_handle_struct_index;
     FileHandleStructMap file_handle_struct_map;
+
+    std::vector<pid_t> reconciliation_list;
+    ReconciliationStats reconciliation_stats;
   };
 
   static ProcessContext& getProcessContext(
@@ -136,6 +148,17 @@ class SystemStateTracker final : public ISystemStateTracker {
 
   static Status expireProcessContexts(Context& context, IFilesystem& fs);
 
+  static std::size_t memoryUsage(const Context& context);
+
+  static Status startReconciliation(Context& context, IFilesystem& fs);
+
+  static bool reconcileProcessContexts(Context& context,
+                                       IFilesystem& fs,
+                                       std::size_t max_process_count);
+
+  static bool reconcileProcessContext(ProcessContext& process_context,
+                                      ProcessContext& procfs_context);
+
   static bool createProcess(
       Context& context,
       IProcessContextFactory& process_context_factory,
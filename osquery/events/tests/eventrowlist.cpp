@@ -0,0 +1,145 @@
+/**
+ * Copyright (c) 2014-present, The osquery authors
+ *
+ * This source code is licensed as defined by the LICENSE file found in the
+ * root directory of this source tree.
+ *
+ * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
+ */
+
+#include <gtest/gtest.h>
+
+#include <osquery/core/sql/row_binary.h>
+#include <osquery/events/eventrowlist.h>
+
+namespace osquery {
+
+class EventRowListTests : public testing::Test {};
+
+TEST_F(EventRowListTests, buildRows) {
+  EventRowList row_list;
+  EXPECT_TRUE(row_list.empty());
+
+  row_list.addRow();
+  row_list.setColumn("path", "/etc/passwd");
+  row_list.setColumn("pid", 1234);
+  row_list.setColumn("uid", static_cast<std::uint64_t>(0));
+  row_list.setColumn("uptime", -1L);
+
+  row_list.addRow();
+  row_list.setColumn("path", std::string("/etc/shadow"));
+
+  ASSERT_EQ(row_list.size(), 2U);
+
+  auto row = row_list.getRow(0);
+  Row expected_row = {
+      {"path", "/etc/passwd"}, {"pid", "1234"}, {"uid", "0"}, {"uptime", "-1"}};
+  EXPECT_EQ(row, expected_row);
+
+  row = row_list.getRow(1);
+  expected_row = {{"path", "/etc/shadow"}};
+  EXPECT_EQ(row, expected_row);
+
+  // The buffers are kept, but the rows are gone
+  row_list.clear();
+  EXPECT_TRUE(row_list.empty());
+
+  row_list.addRow();
+  row_list.setColumn("operation", "open");
+  ASSERT_EQ(row_list.size(), 1U);
+  EXPECT_EQ(row_list.getRow(0).at("operation"), "open");
+}
+
+TEST_F(EventRowListTests, discardRow) {
+  EventRowList row_list;
+
+  row_list.addRow();
+  row_list.setColumn("path", "/etc/passwd");
+
+  row_list.addRow();
+  row_list.setColumn("path", "/tmp/discarded");
+  row_list.discardRow();
+
+  row_list.addRow();
+  row_list.setColumn("path", "/etc/hosts");
+
+  ASSERT_EQ(row_list.size(), 2U);
+  EXPECT_EQ(row_list.getRow(0).at("path"), "/etc/passwd");
+  EXPECT_EQ(row_list.getRow(1).at("path"), "/etc/hosts");
+}
+
+TEST_F(EventRowListTests, sortedColumns) {
+  EventRowList row_list;
+
+  row_list.addRow();
+  row_list.setColumn("uid", 1000);
+  row_list.setColumn("path", "/etc/passwd");
+  row_list.setColumn("cwd", "/root");
+  row_list.setColumn("uid", 0);
+
+  std::vector<RowColumnView> columns;
+  row_list.getColumns(0, columns);
+
+  // Columns are sorted, and the last value set is used
+  ASSERT_EQ(columns.size(), 3U);
+  EXPECT_EQ(columns[0], RowColumnView("cwd", "/root"));
+  EXPECT_EQ(columns[1], RowColumnView("path", "/etc/passwd"));
+  EXPECT_EQ(columns[2], RowColumnView("uid", "0"));
+}
+
+TEST_F(EventRowListTests, excludedColumns) {
+  EventRowList row_list;
+  row_list.setExcludedColumns(
+      std::make_shared<EventColumnSet>(EventColumnSet{"cwd", "uptime"}));
+
+  EXPECT_TRUE(row_list.isStored("path"));
+  EXPECT_FALSE(row_list.isStored("cwd"));
+
+  row_list.addRow();
+  row_list.setColumn("path", "/etc/passwd");
+  row_list.setColumn("cwd", "/root");
+  row_list.setColumn("uptime", 100);
+
+  Row expected_row = {{"path", "/etc/passwd"}};
+  EXPECT_EQ(row_list.getRow(0), expected_row);
+
+  row_list.setExcludedColumns(nullptr);
+  EXPECT_TRUE(row_list.isStored("cwd"));
+}
+
+TEST_F(EventRowListTests, serializeColumns) {
+  EventRowList row_list;
+
+  row_list.addRow();
+  row_list.setColumn("path", "/home/\"quoted\"");
+  row_list.setColumn("pid", 1234);
+  row_list.setColumn("cwd", "/root");
+
+  std::vector<RowColumnView> columns;
+  row_list.getColumns(0, columns);
+  auto row = row_list.getRow(0);
+
+  // The columns are encoded as the equivalent Row would be
+  std::string expected_json;
+  ASSERT_TRUE(serializeRowJSON(row, expected_json).ok());
+
+  std::string json;
+  ASSERT_TRUE(serializeRowJSON(columns, json).ok());
+  EXPECT_EQ(json, expected_json);
+
+  RowColumnDictionary expected_dictionary;
+  std::string expected_binary;
+  ASSERT_TRUE(
+      serializeRowBinary(row, expected_dictionary, expected_binary).ok());
+
+  RowColumnDictionary dictionary;
+  std::string binary;
+  ASSERT_TRUE(serializeRowBinary(columns, dictionary, binary).ok());
+  EXPECT_EQ(binary, expected_binary);
+
+  Row decoded_row;
+  ASSERT_TRUE(deserializeRowBinary(binary, dictionary, decoded_row).ok());
+  EXPECT_EQ(decoded_row, row);
+}
+
+} // namespace osquery
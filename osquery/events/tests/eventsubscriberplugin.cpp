@@ -237,6 +237,89 @@ TEST_F(EventSubscriberPluginTests, generateRows) {
   EXPECT_EQ(last, context.event_index.end());
 }
 
+TEST_F(EventSubscriberPluginTests, generateRowsWithEidFilter) {
+  MockedOsqueryDatabase mocked_database;
+  mocked_database.generateEvents("type", "name");
+
+  EventSubscriberPlugin::Context context;
+  EventSubscriberPlugin::setDatabaseNamespace(context, "type", "name");
+
+  auto status =
+      EventSubscriberPlugin::generateEventDataIndex(context, mocked_database);
+  ASSERT_TRUE(status.ok());
+
+  std::vector<std::string> eids;
+  auto callback = [&eids](Row row) { eids.push_back(row["eid"]); };
+
+  // Sparse selections are looked up one event at a time.
+  EventSubscriberPlugin::generateRows(
+      context, mocked_database, callback, 0, 0, 0, {3, 15});
+  std::vector<std::string> expected = {"3", "15"};
+  EXPECT_EQ(eids, expected);
+
+  // Dense selections are read with a range scan, rows are yielded after it.
+  eids.clear();
+  EventSubscriberPlugin::generateRows(
+      context,
+      mocked_database,
+      [&eids, &mocked_database](Row row) {
+        EXPECT_FALSE(mocked_database.scanning);
+        eids.push_back(row["eid"]);
+      },
+      0,
+      0,
+      0,
+      {1, 3, 5});
+  expected = {"1", "3", "5"};
+  EXPECT_EQ(eids, expected);
+
+  // Events are only emitted if they are also within the time range.
+  eids.clear();
+  EventSubscriberPlugin::generateRows(
+      context, mocked_database, callback, 2, 9, 0, {1, 3, 5, 7});
+  expected = {"5", "7"};
+  EXPECT_EQ(eids, expected);
+}
+
+TEST_F(EventSubscriberPluginTests, generateRowsWithBinaryRows) {
+  MockedOsqueryDatabase mocked_database;
+  mocked_database.generateEvents("type", "name");
+
+  // Re-encode every other valid event, the store may hold both encodings.
+  RowColumnDictionary dictionary;
+  bool encode{false};
+  for (auto& p : mocked_database.key_map) {
+    Row row;
+    if (!deserializeRowJSON(p.second, row).ok()) {
+      continue;
+    }
+
+    if (encode) {
+      serializeRowBinary(row, dictionary, p.second);
+    }
+    encode = !encode;
+  }
+
+  dictionary.serialize(mocked_database.key_map["columns.type.name"]);
+
+  EventSubscriberPlugin::Context context;
+  EventSubscriberPlugin::setDatabaseNamespace(context, "type", "name");
+
+  auto status =
+      EventSubscriberPlugin::generateEventDataIndex(context, mocked_database);
+  ASSERT_TRUE(status.ok());
+  EXPECT_EQ(context.event_index.size(), 10U);
+  EXPECT_EQ(context.stored_column_count, dictionary.size());
+
+  std::vector<std::string> eids;
+  auto callback = [&eids](Row row) { eids.push_back(row["eid"]); };
+  EventSubscriberPlugin::generateRows(context, mocked_database, callback, 0, 0);
+
+  std::vector<std::string> expected = {
+      "1", "3", "5", "7", "9", "11", "13", "15", "17", "19"};
+  EXPECT_EQ(eids, expected);
+}
+
 class FakeEventSubscriberPlugin : public EventSubscriberPlugin {
  public:
   FakeEventSubscriberPlugin(IDatabaseInterface& db)
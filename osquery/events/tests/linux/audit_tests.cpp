@@ -14,12 +14,16 @@
 #include <cstdint>
 #include <ctime>
 
+#include <memory>
 #include <sstream>
+#include <string_view>
+#include <thread>
 
 #include <osquery/core/flags.h>
 #include <osquery/core/tables.h>
 
 #include "osquery/events/linux/auditdnetlink.h"
+#include "osquery/events/linux/auditeventpublisher.h"
 #include "osquery/tests/test_util.h"
 
 namespace osquery {
@@ -76,6 +80,121 @@ TEST_F(AuditTests, test_handle_reply) {
   EXPECT_EQ(audit_event_record.fields["a2"], "c");
 }
 
+TEST_F(AuditTests, test_tokenize_fields) {
+  std::vector<AuditFieldView> fields;
+  TokenizeAuditFields(
+      "argc=3  a0=\"H=1 \" a1=x\"y z\"key2 flag a3= =ignored", fields);
+
+  std::vector<AuditFieldView> expected = {{"argc", "3"},
+                                          {"a0", "\"H=1 \""},
+                                          {"a1", "x\"y z\""},
+                                          {"key2", ""},
+                                          {"flag", ""},
+                                          {"a3", ""}};
+  EXPECT_EQ(fields, expected);
+
+  // An unterminated enclosure extends to the end of the record.
+  TokenizeAuditFields("a0=\"/bin/ls -l", fields);
+  ASSERT_EQ(fields.size(), 1U);
+  EXPECT_EQ(fields[0].second, "\"/bin/ls -l");
+
+  TokenizeAuditFields("", fields);
+  EXPECT_TRUE(fields.empty());
+}
+
+TEST_F(AuditTests, test_audit_fields) {
+  AuditFields fields;
+  EXPECT_TRUE(fields.empty());
+
+  fields.parse("pid=10 exe=\"/bin/sh\" pid=11 uid=0");
+  EXPECT_EQ(fields.size(), 3U);
+  EXPECT_EQ(fields.count("exe"), 1U);
+  EXPECT_EQ(fields.count("ppid"), 0U);
+
+  // Lookups are served from the record text, the first value is kept.
+  std::string_view value;
+  ASSERT_TRUE(fields.get("pid", value));
+  EXPECT_EQ(value, "10");
+  EXPECT_FALSE(fields.get("ppid", value));
+
+  // Copies keep working once the original is gone.
+  auto copy = std::make_unique<AuditFields>(fields);
+  fields.parse("uid=1");
+  ASSERT_TRUE(copy->get("exe", value));
+  EXPECT_EQ(value, "\"/bin/sh\"");
+
+  // The map interface and mutations use owned strings.
+  const auto& map = copy->map();
+  EXPECT_EQ(map.size(), 3U);
+  EXPECT_EQ(map.begin()->first, "exe");
+  EXPECT_EQ(copy->at("pid"), "10");
+
+  (*copy)["success"] = "no";
+  ASSERT_TRUE(copy->get("success", value));
+  EXPECT_EQ(value, "no");
+  EXPECT_EQ(copy->size(), 4U);
+}
+
+TEST_F(AuditTests, test_audit_shards) {
+  EXPECT_EQ(GetAuditSerial("1440542781.644:403030"), 403030U);
+  EXPECT_EQ(GetAuditSerial("1440542781.644:7): argc=3"), 7U);
+  EXPECT_EQ(GetAuditSerial("1440542781.644"), 0U);
+
+  std::vector<std::string> messages = {
+      "audit(1440542781.644:10): argc=1 a0=\"ls\"",
+      "audit(1440542781.644:11): cwd=\"/\"",
+      "audit(1440542781.644:12): item=0 name=\"/bin/ls\"",
+  };
+
+  AuditReplySlab slab;
+  slab.replies.resize(messages.size());
+  slab.shards.resize(messages.size());
+  slab.count = messages.size();
+  for (size_t i = 0; i < messages.size(); i++) {
+    auto& reply = slab.replies[i];
+    reply.type = AUDIT_EXECVE;
+    reply.len = messages[i].size();
+    reply.message = &messages[i][0];
+    slab.shards[i] = AuditdNetlinkParser::GetReplyShard(reply, 2);
+  }
+
+  // Records are assigned by serial, a worker only parses its own.
+  EXPECT_EQ(slab.shards, std::vector<std::uint32_t>({0, 1, 0}));
+
+  std::vector<AuditEventRecord> records;
+  AuditdNetlinkParser::ParseShard(slab, 0, records);
+  ASSERT_EQ(records.size(), 2U);
+  EXPECT_EQ(records[0].audit_id, "1440542781.644:10");
+  EXPECT_EQ(records[1].audit_id, "1440542781.644:12");
+}
+
+TEST_F(AuditTests, test_audit_event_assembler) {
+  AuditEventAssembler assembler(2, {});
+
+  auto user_records = [](const std::vector<std::uint32_t>& serials) {
+    std::vector<AuditEventRecord> records;
+    for (auto serial : serials) {
+      AuditEventRecord record = {};
+      record.type = AUDIT_FIRST_USER_MSG;
+      record.audit_id = "1440542781.644:" + std::to_string(serial);
+      records.push_back(record);
+    }
+    return records;
+  };
+
+  assembler.assemble(1, user_records({5, 8}));
+  assembler.assemble(0, user_records({3, 10}));
+
+  // The events of both shards are merged back in serial order.
+  auto events = assembler.takeEvents();
+  std::vector<std::uint64_t> serials;
+  for (const auto& event : events) {
+    serials.push_back(GetAuditSerial(event.record_list.front().audit_id));
+  }
+
+  EXPECT_EQ(serials, std::vector<std::uint64_t>({3, 5, 8, 10}));
+}
+
 TEST_F(AuditTests, test_audit_value_decode) {
   // In the normal case the decoding only removes '"' characters from the ends.
   auto decoded_normal = DecodeAuditPathValues("\"/bin/ls\"");
@@ -90,6 +209,55 @@ TEST_F(AuditTests, test_audit_value_decode) {
   EXPECT_EQ(decoded_fail, "7");
 }
 
+TEST_F(AuditTests, test_slab_ring) {
+  std::vector<AuditReplySlab> slabs(3);
+  AuditSlabRing ring(2);
+  EXPECT_EQ(ring.capacity(), 2U);
+  EXPECT_EQ(ring.pop(), nullptr);
+
+  EXPECT_TRUE(ring.push(&slabs[0]));
+  EXPECT_TRUE(ring.push(&slabs[1]));
+  EXPECT_FALSE(ring.push(&slabs[2]));
+  EXPECT_EQ(ring.size(), 2U);
+
+  // Slabs come out in the order they were pushed, across the ring's end.
+  EXPECT_EQ(ring.pop(), &slabs[0]);
+  EXPECT_TRUE(ring.push(&slabs[2]));
+  EXPECT_EQ(ring.pop(), &slabs[1]);
+  EXPECT_EQ(ring.pop(), &slabs[2]);
+  EXPECT_EQ(ring.pop(), nullptr);
+  EXPECT_EQ(ring.size(), 0U);
+}
+
+TEST_F(AuditTests, test_slab_ring_threads) {
+  const size_t kTransfers{100000};
+  std::vector<AuditReplySlab> slabs(kTransfers);
+  AuditSlabRing ring(8);
+
+  std::thread producer([&]() {
+    for (auto& slab : slabs) {
+      while (!ring.push(&slab)) {
+        std::this_thread::yield();
+      }
+    }
+  });
+
+  size_t popped{0};
+  while (popped < kTransfers) {
+    auto slab = ring.pop();
+    if (slab == nullptr) {
+      std::this_thread::yield();
+      continue;
+    }
+
+    EXPECT_EQ(slab, &slabs[popped]);
+    popped++;
+  }
+
+  producer.join();
+  EXPECT_EQ(ring.pop(), nullptr);
+}
+
 size_t kAuditCounter{0};
 
 bool SimpleUpdate(size_t t, const StringMap& f, StringMap& m) {
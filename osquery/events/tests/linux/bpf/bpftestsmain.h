@@ -28,4 +28,14 @@ class ProcessContextFactoryTests : public testing::Test {
   virtual void SetUp() override{};
 };
 
+class ProcessContextTests : public testing::Test {
+ protected:
+  virtual void SetUp() override{};
+};
+
+class ReorderBufferTests : public testing::Test {
+ protected:
+  virtual void SetUp() override{};
+};
+
 } // namespace osquery
@@ -0,0 +1,150 @@
+/**
+ * Copyright (c) 2014-present, The osquery authors
+ *
+ * This source code is licensed as defined by the LICENSE file found in the
+ * root directory of this source tree.
+ *
+ * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
+ */
+
+#include "bpftestsmain.h"
+#include "utils.h"
+
+#include <osquery/events/linux/bpf/filedescriptortable.h>
+#include <osquery/events/linux/bpf/internedstring.h>
+#include <osquery/events/linux/bpf/systemstatetracker.h>
+
+#include <map>
+#include <string>
+
+namespace osquery {
+
+TEST_F(ProcessContextTests, internedString) {
+  auto initial_count = InternedString::count();
+
+  {
+    InternedString path1("/usr/lib/x86_64-linux-gnu/libc.so.6");
+    InternedString path2(std::string("/usr/lib/x86_64-linux-gnu/libc.so.6"));
+
+    EXPECT_EQ(path1, path2);
+    EXPECT_EQ(&path1.str(), &path2.str());
+    EXPECT_EQ(InternedString::count(), initial_count + 1U);
+
+    EXPECT_EQ(path1, "/usr/lib/x86_64-linux-gnu/libc.so.6");
+    EXPECT_EQ(path1 + '/' + "test", "/usr/lib/x86_64-linux-gnu/libc.so.6/test");
+
+    InternedString empty_path;
+    EXPECT_TRUE(empty_path.empty());
+    EXPECT_EQ(empty_path, "");
+    EXPECT_NE(empty_path, path1);
+  }
+
+  // The storage is released with the last copy
+  EXPECT_EQ(InternedString::count(), initial_count);
+}
+
+TEST_F(ProcessContextTests, fileDescriptorTable) {
+  FileDescriptorTable<std::string> fd_table;
+  std::map<int, std::string> expected_fd_map;
+
+  // Enough descriptors to grow the index a few times
+  for (int fd = 0; fd < 200; ++fd) {
+    EXPECT_TRUE(fd_table.insert({fd, std::to_string(fd)}));
+    expected_fd_map.insert({fd, std::to_string(fd)});
+  }
+
+  EXPECT_FALSE(fd_table.insert({10, "duplicate"}));
+  EXPECT_EQ(fd_table.at(10), "10");
+
+  fd_table[1000] = "1000";
+  expected_fd_map[1000] = "1000";
+
+  EXPECT_EQ(fd_table.erase(5), 1U);
+  EXPECT_EQ(fd_table.erase(5), 0U);
+  expected_fd_map.erase(5);
+
+  for (auto fd_it = fd_table.begin(); fd_it != fd_table.end();) {
+    if (fd_it->first % 3 == 0) {
+      fd_it = fd_table.erase(fd_it);
+    } else {
+      ++fd_it;
+    }
+  }
+
+  for (auto fd_it = expected_fd_map.begin(); fd_it != expected_fd_map.end();) {
+    if (fd_it->first % 3 == 0) {
+      fd_it = expected_fd_map.erase(fd_it);
+    } else {
+      ++fd_it;
+    }
+  }
+
+  ASSERT_EQ(fd_table.size(), expected_fd_map.size());
+  for (const auto& p : expected_fd_map) {
+    ASSERT_EQ(fd_table.count(p.first), 1U);
+    EXPECT_EQ(fd_table.at(p.first), p.second);
+  }
+
+  EXPECT_TRUE(fd_table.find(3) == fd_table.end());
+  EXPECT_THROW(fd_table.at(3), std::out_of_range);
+}
+
+TEST_F(ProcessContextTests, copyOnWrite) {
+  FileDescriptorTable<std::string> parent_fd_table;
+  parent_fd_table.insert({0, "/dev/pts/1"});
+  parent_fd_table.insert({1, "/dev/pts/1"});
+
+  // Copies share the storage until modified
+  auto child_fd_table = parent_fd_table;
+  EXPECT_EQ(&parent_fd_table.at(0), &child_fd_table.at(0));
+  EXPECT_EQ(parent_fd_table.memoryUsage(), child_fd_table.memoryUsage());
+
+  child_fd_table.erase(0);
+  child_fd_table[2] = "/tmp/file";
+
+  EXPECT_EQ(parent_fd_table.size(), 2U);
+  EXPECT_EQ(parent_fd_table.count(2), 0U);
+  EXPECT_EQ(parent_fd_table.at(0), "/dev/pts/1");
+
+  EXPECT_EQ(child_fd_table.size(), 2U);
+  EXPECT_EQ(child_fd_table.count(0), 0U);
+  EXPECT_EQ(child_fd_table.at(2), "/tmp/file");
+}
+
+TEST_F(ProcessContextTests, forkSharesState) {
+  SystemStateTracker::Context context;
+
+  auto& parent_process = context.process_map[1000];
+  parent_process.binary_path = "/usr/bin/zsh";
+  parent_process.cwd = "/home/alessandro";
+  setFileDescriptor(parent_process, 0, false, "/dev/pts/1");
+  setFileDescriptor(parent_process, 1, false, "/dev/pts/1");
+
+  auto single_process_usage = SystemStateTracker::memoryUsage(context);
+
+  auto child_process = parent_process;
+  EXPECT_EQ(&child_process.binary_path.str(),
+            &parent_process.binary_path.str());
+
+  const auto& parent_fd = parent_process.fd_map.at(0);
+  const auto& child_fd = child_process.fd_map.at(0);
+  EXPECT_EQ(&parent_fd, &child_fd);
+
+  context.process_map.insert({1001, std::move(child_process)});
+
+  // The second process only adds its own map entry, since the strings
+  // and the descriptor table are shared
+  auto memory_usage = SystemStateTracker::memoryUsage(context);
+  EXPECT_GT(memory_usage, single_process_usage);
+  EXPECT_LT(memory_usage - single_process_usage,
+            sizeof(ProcessContextMap::value_type) + 128U);
+
+  // Closing a descriptor in the child does not change the parent
+  auto& forked_process = context.process_map.at(1001);
+  forked_process.fd_map.erase(1);
+
+  EXPECT_EQ(context.process_map.at(1000).fd_map.size(), 2U);
+  EXPECT_EQ(forked_process.fd_map.size(), 1U);
+}
+
+} // namespace osquery
@@ -0,0 +1,128 @@
+/**
+ * Copyright (c) 2014-present, The osquery authors
+ *
+ * This source code is licensed as defined by the LICENSE file found in the
+ * root directory of this source tree.
+ *
+ * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
+ */
+
+#include "bpftestsmain.h"
+
+#include <osquery/events/linux/bpf/reorderbuffer.h>
+
+#include <string>
+#include <vector>
+
+namespace osquery {
+
+namespace {
+
+using TestEvent = std::pair<std::uint64_t, std::string>;
+using TestReorderBuffer = ReorderBuffer<TestEvent>;
+
+std::vector<TestEvent> drainBuffer(TestReorderBuffer& buffer,
+                                   std::uint64_t now) {
+  std::vector<TestEvent> event_list;
+  buffer.drain(now, [&](const TestEvent& event) {
+    event_list.push_back(event);
+  });
+
+  return event_list;
+}
+
+} // namespace
+
+TEST_F(ReorderBufferTests, sortsWithinWindow) {
+  TestReorderBuffer buffer(100U, 1000U);
+
+  EXPECT_TRUE(buffer.push(30U, {30U, "c"}));
+  EXPECT_TRUE(buffer.push(10U, {10U, "a"}));
+  EXPECT_TRUE(buffer.push(20U, {20U, "b"}));
+  EXPECT_EQ(buffer.size(), 3U);
+
+  // Nothing is older than the window yet
+  auto event_list = drainBuffer(buffer, 50U);
+  EXPECT_TRUE(event_list.empty());
+
+  event_list = drainBuffer(buffer, 120U);
+  ASSERT_EQ(event_list.size(), 2U);
+  EXPECT_EQ(event_list.at(0).second, "a");
+  EXPECT_EQ(event_list.at(1).second, "b");
+  EXPECT_EQ(buffer.size(), 1U);
+
+  event_list = drainBuffer(buffer, 1000U);
+  ASSERT_EQ(event_list.size(), 1U);
+  EXPECT_EQ(event_list.at(0).second, "c");
+  EXPECT_EQ(buffer.size(), 0U);
+}
+
+TEST_F(ReorderBufferTests, keepsDuplicateTimestamps) {
+  TestReorderBuffer buffer(100U, 1000U);
+
+  EXPECT_TRUE(buffer.push(10U, {10U, "a"}));
+  EXPECT_TRUE(buffer.push(5U, {5U, "first"}));
+  EXPECT_TRUE(buffer.push(10U, {10U, "b"}));
+  EXPECT_TRUE(buffer.push(10U, {10U, "c"}));
+
+  auto event_list = drainBuffer(buffer, 1000U);
+  ASSERT_EQ(event_list.size(), 4U);
+  EXPECT_EQ(event_list.at(0).second, "first");
+  EXPECT_EQ(event_list.at(1).second, "a");
+  EXPECT_EQ(event_list.at(2).second, "b");
+  EXPECT_EQ(event_list.at(3).second, "c");
+}
+
+TEST_F(ReorderBufferTests, releasesLateEvents) {
+  TestReorderBuffer buffer(100U, 1000U);
+
+  EXPECT_TRUE(buffer.push(200U, {200U, "a"}));
+
+  auto event_list = drainBuffer(buffer, 400U);
+  ASSERT_EQ(event_list.size(), 1U);
+
+  // Older than an event that has already been released
+  EXPECT_FALSE(buffer.push(150U, {150U, "late"}));
+  EXPECT_TRUE(buffer.push(390U, {390U, "b"}));
+
+  event_list = drainBuffer(buffer, 400U);
+  ASSERT_EQ(event_list.size(), 1U);
+  EXPECT_EQ(event_list.at(0).second, "late");
+  EXPECT_EQ(buffer.size(), 1U);
+}
+
+TEST_F(ReorderBufferTests, boundedCapacity) {
+  TestReorderBuffer buffer(100U, 2U);
+
+  EXPECT_TRUE(buffer.push(40U, {40U, "d"}));
+  EXPECT_TRUE(buffer.push(10U, {10U, "a"}));
+  EXPECT_TRUE(buffer.push(30U, {30U, "c"}));
+  EXPECT_TRUE(buffer.push(20U, {20U, "b"}));
+
+  // The oldest events are released early to get back to the capacity
+  auto event_list = drainBuffer(buffer, 0U);
+  ASSERT_EQ(event_list.size(), 2U);
+  EXPECT_EQ(event_list.at(0).second, "a");
+  EXPECT_EQ(event_list.at(1).second, "b");
+
+  EXPECT_EQ(buffer.size(), 2U);
+  EXPECT_EQ(buffer.takeMaxDepth(), 4U);
+  EXPECT_EQ(buffer.takeMaxDepth(), 2U);
+}
+
+TEST_F(ReorderBufferTests, reusesStorage) {
+  TestReorderBuffer buffer(0U, 1000U);
+
+  for (std::uint64_t i = 0U; i < 100U; ++i) {
+    EXPECT_TRUE(buffer.push(i, {i, std::to_string(i)}));
+
+    auto event_list = drainBuffer(buffer, i);
+    ASSERT_EQ(event_list.size(), 1U);
+    EXPECT_EQ(event_list.at(0).first, i);
+  }
+
+  EXPECT_EQ(buffer.size(), 0U);
+  EXPECT_EQ(buffer.takeMaxDepth(), 1U);
+}
+
+} // namespace osquery
@@ -1455,6 +1455,127 @@ TEST_F(SystemStateTrackerTests, expireProcessContexts) {
   EXPECT_EQ(context.process_map.size(), 1U);
 }
 
+TEST_F(SystemStateTrackerTests, reconcileProcessContexts) {
+  SystemStateTracker::Context context;
+
+  // This process no longer exists in procfs
+  context.process_map.insert({1234567, ProcessContext{}});
+
+  // This process has diverged from procfs
+  auto& process_context = context.process_map[1001];
+  process_context.parent_process_id = 1;
+  process_context.binary_path = "/usr/bin/bash";
+  process_context.argv = {"zsh", "-i", "-H"};
+  process_context.cwd = "/home/alessandro";
+
+  setFileDescriptor(process_context, 268435444, true, "/dev/pts/2");
+  setFileDescriptor(process_context, 268435445, false, "/dev/pts/9");
+  setFileDescriptor(process_context, 5, false, "/tmp/closed_file");
+
+  setSocketDescriptor(
+      process_context, 6, false, AF_INET, SOCK_STREAM, 0, "", 0, "", 0);
+
+  MockedFilesystem mocked_filesystem;
+  auto status =
+      SystemStateTracker::startReconciliation(context, mocked_filesystem);
+
+  ASSERT_TRUE(status.ok());
+  EXPECT_EQ(context.reconciliation_list.size(), 2U);
+
+  // Each call only handles the requested amount of processes
+  EXPECT_FALSE(SystemStateTracker::reconcileProcessContexts(
+      context, mocked_filesystem, 1U));
+
+  EXPECT_EQ(context.process_map.count(1234567), 0U);
+  EXPECT_EQ(context.process_map.at(1001).parent_process_id, 1);
+
+  EXPECT_TRUE(SystemStateTracker::reconcileProcessContexts(
+      context, mocked_filesystem, 1U));
+
+  EXPECT_EQ(context.reconciliation_stats.added, 0U);
+  EXPECT_EQ(context.reconciliation_stats.removed, 1U);
+  EXPECT_EQ(context.reconciliation_stats.repaired, 1U);
+
+  ASSERT_EQ(context.process_map.size(), 1U);
+  const auto& reconciled_context = context.process_map.at(1001);
+
+  EXPECT_EQ(reconciled_context.parent_process_id, 3616);
+  EXPECT_EQ(reconciled_context.binary_path, "/usr/bin/zsh");
+  EXPECT_EQ(reconciled_context.cwd, "/home/alessandro");
+
+  const auto& fd_map = reconciled_context.fd_map;
+  ASSERT_EQ(fd_map.size(), 3U);
+  EXPECT_EQ(fd_map.count(5), 0U);
+
+  // Unchanged descriptors keep the state tracked from the events
+  const auto& unchanged_fd = fd_map.at(268435444);
+  EXPECT_TRUE(unchanged_fd.close_on_exec);
+
+  const auto& repaired_fd = fd_map.at(268435445);
+  EXPECT_FALSE(repaired_fd.close_on_exec);
+  EXPECT_EQ(std::get<ProcessContext::FileDescriptor::FileData>(
+                repaired_fd.data)
+                .path,
+            "/dev/pts/3");
+
+  // Sockets are not listed by procfs and must be preserved
+  const auto& socket_fd = fd_map.at(6);
+  EXPECT_TRUE(
+      std::holds_alternative<ProcessContext::FileDescriptor::SocketData>(
+          socket_fd.data));
+}
+
+TEST_F(SystemStateTrackerTests, reconcileSocketDescriptors) {
+  ProcessContext process_context;
+  setSocketDescriptor(
+      process_context, 6, false, AF_INET, SOCK_STREAM, 0, "", 0, "", 0);
+
+  // A procfs socket link does not replace the tracked socket
+  ProcessContext procfs_context;
+  setFileDescriptor(procfs_context, 6, false, "socket:[123456]");
+
+  EXPECT_FALSE(SystemStateTracker::reconcileProcessContext(process_context,
+                                                           procfs_context));
+
+  ASSERT_EQ(process_context.fd_map.count(6), 1U);
+  EXPECT_TRUE(
+      std::holds_alternative<ProcessContext::FileDescriptor::SocketData>(
+          process_context.fd_map.at(6).data));
+}
+
+TEST_F(SystemStateTrackerTests, reconcileMissingProcessContexts) {
+  SystemStateTracker::Context context;
+  MockedFilesystem mocked_filesystem;
+
+  // Nothing to do until a reconciliation is started
+  EXPECT_TRUE(SystemStateTracker::reconcileProcessContexts(
+      context, mocked_filesystem, 64U));
+
+  EXPECT_TRUE(context.process_map.empty());
+
+  auto status =
+      SystemStateTracker::startReconciliation(context, mocked_filesystem);
+
+  ASSERT_TRUE(status.ok());
+  EXPECT_TRUE(SystemStateTracker::reconcileProcessContexts(
+      context, mocked_filesystem, 64U));
+
+  EXPECT_EQ(context.reconciliation_stats.added, 1U);
+  ASSERT_EQ(context.process_map.count(1001), 1U);
+  EXPECT_EQ(context.process_map.at(1001).fd_map.size(), 2U);
+
+  // A second pass finds nothing to repair
+  status = SystemStateTracker::startReconciliation(context, mocked_filesystem);
+
+  ASSERT_TRUE(status.ok());
+  EXPECT_TRUE(SystemStateTracker::reconcileProcessContexts(
+      context, mocked_filesystem, 64U));
+
+  EXPECT_EQ(context.reconciliation_stats.added, 0U);
+  EXPECT_EQ(context.reconciliation_stats.removed, 0U);
+  EXPECT_EQ(context.reconciliation_stats.repaired, 0U);
+}
+
 TEST_F(SystemStateTrackerTests, parseSocketAddress) {
   static const std::uint16_t kUnspecFamily{AF_UNSPEC};
 
@@ -96,7 +96,7 @@ TEST_F(AuditdFimTests, row_emission) {
   fim_context.included_path_list = included_file_paths;
 
   // Emit the rows, showing only writes
-  std::vector<Row> emitted_row_list;
+  EventRowList emitted_row_list;
   Status status = ProcessFileEventSubscriber::ProcessEvents(
       emitted_row_list, fim_context, event_context->audit_events);
 
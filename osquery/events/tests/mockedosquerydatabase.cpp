@@ -66,7 +66,11 @@ Status MockedOsqueryDatabase::getDatabaseValue(const std::string& domain,
 
   if (domain == kEvents) {
     auto key_it = key_map.find(key);
-    if (key_it == key_map.end()) {
+    if (key_it == key_map.end() && key.find("columns.") == 0U) {
+      // Subscribers look for an optional column dictionary.
+      return Status::failure("MockedOsqueryDatabase: Key not found: " + key);
+
+    } else if (key_it == key_map.end()) {
       throw std::logic_error(
           "MockedOsqueryDatabase: Invalid key passed to getDatabaseValue: " +
           key);
@@ -190,4 +194,16 @@ Status MockedOsqueryDatabase::scanDatabaseKeys(const std::string& domain,
   return Status::success();
 }
 
+Status MockedOsqueryDatabase::scanDatabaseRange(
+    const std::string& domain,
+    const std::string& low,
+    const std::string& high,
+    const DatabaseRangeCallback& callback) const {
+  scanning = true;
+  auto status =
+      IDatabaseInterface::scanDatabaseRange(domain, low, high, callback);
+  scanning = false;
+  return status;
+}
+
 } // namespace osquery
@@ -17,6 +17,9 @@ class MockedOsqueryDatabase final : public IDatabaseInterface {
  public:
   mutable std::map<std::string, std::string> key_map;
 
+  /// Set while a range scan visits keys, as a database lock would be held.
+  mutable bool scanning{false};
+
   MockedOsqueryDatabase() = default;
   virtual ~MockedOsqueryDatabase() override = default;
 
@@ -57,6 +60,12 @@ class MockedOsqueryDatabase final : public IDatabaseInterface {
                                   std::vector<std::string>& keys,
                                   const std::string& prefix,
                                   size_t max) const override;
+
+  virtual Status scanDatabaseRange(
+      const std::string& domain,
+      const std::string& low,
+      const std::string& high,
+      const DatabaseRangeCallback& callback) const override;
 };
 
 } // namespace osquery
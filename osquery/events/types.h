@@ -11,6 +11,7 @@
 
 #include <map>
 #include <memory>
+#include <set>
 #include <string>
 #include <vector>
 
@@ -24,6 +25,7 @@ using EventRecord = std::pair<std::string, EventTime>;
 using EventID = std::uint64_t;
 using EventIDList = std::vector<EventID>;
 using EventIndex = std::map<EventTime, EventIDList>;
+using EventIDSet = std::set<EventID>;
 
 /**
  * @brief An EventSubscriber EventCallback method will receive an EventContext.
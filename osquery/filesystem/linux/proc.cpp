@@ -7,17 +7,24 @@
  * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
  */
 
+#include <cerrno>
+
+#include <fcntl.h>
 #include <linux/limits.h>
 #include <unistd.h>
 
 #include <boost/filesystem.hpp>
 
+#include <osquery/core/flags.h>
 #include <osquery/filesystem/filesystem.h>
 #include <osquery/filesystem/linux/proc.h>
 #include <osquery/logger/logger.h>
 #include <osquery/utils/conversions/split.h>
 
 namespace osquery {
+
+DECLARE_uint64(read_max);
+
 const std::vector<std::string> kUserNamespaceList = {
     "cgroup", "ipc", "mnt", "net", "pid", "user", "uts"};
 
@@ -396,4 +403,43 @@ Status procReadDescriptor(const std::string& process,
   }
 }
 
+Status procReadFile(const std::string& path, std::string& content) {
+  content.clear();
+
+  auto fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return Status::failure("Cannot open file for reading: " + path);
+  }
+
+  // Grow the buffer by blocks, the sizes of /proc files are not known.
+  const std::size_t kBlockSize{4096};
+  std::size_t total{0};
+  Status status;
+  while (true) {
+    if (content.size() < total + kBlockSize) {
+      content.resize(total + kBlockSize);
+    }
+
+    auto part = ::read(fd, &content[total], content.size() - total);
+    if (part < 0 && errno == EINTR) {
+      continue;
+    } else if (part < 0) {
+      status = Status::failure("Cannot read file: " + path);
+      break;
+    } else if (part == 0) {
+      break;
+    }
+
+    total += static_cast<std::size_t>(part);
+    if (total >= FLAGS_read_max) {
+      status = Status::failure("File exceeds read limits: " + path);
+      break;
+    }
+  }
+
+  ::close(fd);
+  content.resize(status.ok() ? total : 0);
+  return status;
+}
+
 } // namespace osquery
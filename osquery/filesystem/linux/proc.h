@@ -93,6 +93,18 @@ Status procReadDescriptor(const std::string& process,
                           const std::string& descriptor,
                           std::string& result);
 
+/**
+ * @brief Read a /proc file into a reusable buffer.
+ *
+ * Most /proc files report a zero size, so the content is read until EOF. The
+ * buffer is cleared first and keeps its capacity, callers reading many files
+ * should reuse the same buffer. Reads are limited by --read_max.
+ *
+ * @param path The path of the /proc file.
+ * @param content [output] The file content.
+ */
+Status procReadFile(const std::string& path, std::string& content);
+
 /// From an hex encoded address and its socket family, read from
 /// a /proc/net file, decode the address and return a string.
 ///
@@ -123,5 +123,26 @@ TEST_F(LinuxProc, testProcGetSocketListPacketValidInvalidContent) {
   EXPECT_EQ("NONE", socket_list[0].state);
 }
 
+TEST_F(LinuxProc, testProcReadFile) {
+  std::string content;
+  auto status = procReadFile("/proc/self/status", content);
+  ASSERT_TRUE(status.ok());
+  EXPECT_EQ(0U, content.find("Name:"));
+  EXPECT_EQ(std::string::npos, content.find('\0'));
+
+  // The buffer is replaced, not appended to.
+  std::string stat;
+  ASSERT_TRUE(procReadFile("/proc/self/stat", stat).ok());
+  ASSERT_TRUE(procReadFile("/proc/self/stat", content).ok());
+  EXPECT_EQ(std::to_string(getpid()) + " (",
+            content.substr(0, std::to_string(getpid()).size() + 2));
+  EXPECT_EQ(stat.substr(0, stat.find(')')),
+            content.substr(0, content.find(')')));
+
+  status = procReadFile("/proc/self/does_not_exist", content);
+  EXPECT_FALSE(status.ok());
+  EXPECT_TRUE(content.empty());
+}
+
 } // namespace
 } // namespace osquery
\ No newline at end of file
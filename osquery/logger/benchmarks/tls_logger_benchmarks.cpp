@@ -0,0 +1,86 @@
+/**
+ * Copyright (c) 2014-present, The osquery authors
+ *
+ * This source code is licensed as defined by the LICENSE file found in the
+ * root directory of this source tree.
+ *
+ * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <osquery/core/flags.h>
+
+#include "plugins/logger/tls_logger.h"
+
+#include <string>
+#include <vector>
+
+namespace osquery {
+
+DECLARE_bool(logger_tls_splice);
+
+class BenchmarkTLSLogForwarder : public TLSLogForwarder {
+ public:
+  using TLSLogForwarder::serializeRequest;
+};
+
+/// A differential result log line, with a large row.
+static std::string getResultLogLine(std::size_t index) {
+  std::string line = "{\"name\":\"pack_incident-response_process_events\",";
+  line += "\"hostIdentifier\":\"osquery-benchmark\",";
+  line += "\"calendarTime\":\"Mon Jan  4 12:00:00 2021 UTC\",";
+  line += "\"unixTime\":" + std::to_string(1609761600U + index) + ",";
+  line += "\"epoch\":0,\"counter\":" + std::to_string(index) + ",";
+  line += "\"numerics\":false,\"columns\":{";
+
+  for (std::size_t i = 0U; i < 32U; ++i) {
+    if (i != 0U) {
+      line += ",";
+    }
+
+    line += "\"column_" + std::to_string(i) + "\":\"";
+    line += "/usr/local/bin/value_" + std::to_string(index * 32U + i) + "\"";
+  }
+
+  line += "},\"action\":\"added\"}";
+  return line;
+}
+
+/// Serializes range(0) log lines, spliced if range(1), compressed if range(2).
+static void LOGGER_tls_serialize_request(benchmark::State& state) {
+  auto splice = FLAGS_logger_tls_splice;
+  FLAGS_logger_tls_splice = (state.range(1) != 0);
+
+  auto line_count = static_cast<std::size_t>(state.range(0));
+
+  std::vector<std::string> log_lines;
+  for (std::size_t i = 0U; i < line_count; ++i) {
+    log_lines.push_back(getResultLogLine(i));
+  }
+
+  std::size_t body_size = 0U;
+  while (state.KeepRunning()) {
+    state.PauseTiming();
+    auto log_data = log_lines;
+    state.ResumeTiming();
+
+    std::string body;
+    BenchmarkTLSLogForwarder::serializeRequest(
+        "node_key", "result", log_data, state.range(2) != 0, body);
+
+    body_size = body.size();
+  }
+
+  state.counters["body_size"] = static_cast<double>(body_size);
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+
+  FLAGS_logger_tls_splice = splice;
+}
+
+BENCHMARK(LOGGER_tls_serialize_request)
+    ->Args({1024, 0, 0})
+    ->Args({1024, 1, 0})
+    ->Args({1024, 0, 1})
+    ->Args({1024, 1, 1});
+} // namespace osquery
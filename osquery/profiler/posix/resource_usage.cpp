@@ -0,0 +1,120 @@
+/**
+ * Copyright (c) 2014-present, The osquery authors
+ *
+ * This source code is licensed as defined by the LICENSE file found in the
+ * root directory of this source tree.
+ *
+ * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
+ */
+
+#ifdef __linux__
+// Needed for linux specific RUSAGE_THREAD, before including anything else
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#endif
+
+#include <chrono>
+#include <cstdlib>
+
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#ifdef __APPLE__
+#include <mach/mach.h>
+#endif
+
+#include <osquery/profiler/resource_usage.h>
+
+namespace osquery {
+namespace impl {
+
+#ifdef __APPLE__
+bool getThreadCpuTimes(ResourceUsage& usage) {
+  thread_basic_info_data_t info;
+  mach_msg_type_number_t count = THREAD_BASIC_INFO_COUNT;
+  auto thread = mach_thread_self();
+  auto kr = thread_info(
+      thread, THREAD_BASIC_INFO, reinterpret_cast<thread_info_t>(&info), &count);
+  mach_port_deallocate(mach_task_self(), thread);
+  if (kr != KERN_SUCCESS) {
+    return true;
+  }
+
+  usage.user_time = info.user_time.seconds * 1000ULL +
+                    info.user_time.microseconds / 1000ULL;
+  usage.system_time = info.system_time.seconds * 1000ULL +
+                      info.system_time.microseconds / 1000ULL;
+  return true;
+}
+
+void getResidentSize(ResourceUsage& usage) {
+  mach_task_basic_info_data_t info;
+  mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+  auto kr = task_info(mach_task_self(),
+                      MACH_TASK_BASIC_INFO,
+                      reinterpret_cast<task_info_t>(&info),
+                      &count);
+  if (kr == KERN_SUCCESS) {
+    usage.resident_size = info.resident_size;
+  }
+}
+#else
+namespace {
+
+std::uint64_t toMilliseconds(const struct timeval& timepoint) {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::seconds(timepoint.tv_sec) +
+             std::chrono::microseconds(timepoint.tv_usec))
+      .count();
+}
+
+} // namespace
+
+bool getThreadCpuTimes(ResourceUsage& usage) {
+  struct rusage stats;
+#if defined(__linux__) || defined(__FreeBSD__)
+  auto status = getrusage(RUSAGE_THREAD, &stats);
+  auto per_thread = true;
+#else
+  auto status = getrusage(RUSAGE_SELF, &stats);
+  auto per_thread = false;
+#endif
+  if (status == 0) {
+    usage.user_time = toMilliseconds(stats.ru_utime);
+    usage.system_time = toMilliseconds(stats.ru_stime);
+  }
+  return per_thread;
+}
+
+void getResidentSize(ResourceUsage& usage) {
+#ifdef __linux__
+  // The second field of statm is the resident set size in pages.
+  auto fd = ::open("/proc/self/statm", O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return;
+  }
+
+  char buffer[128];
+  auto size = ::read(fd, buffer, sizeof(buffer) - 1);
+  ::close(fd);
+  if (size <= 0) {
+    return;
+  }
+  buffer[size] = '\0';
+
+  char* end = nullptr;
+  std::strtoull(buffer, &end, 10);
+  auto pages = std::strtoull(end, nullptr, 10);
+  usage.resident_size = pages * static_cast<std::uint64_t>(getpagesize());
+#else
+  // The current resident size is not cheaply available, skip memory deltas.
+  (void)usage;
+#endif
+}
+#endif
+
+} // namespace impl
+} // namespace osquery
@@ -0,0 +1,62 @@
+/**
+ * Copyright (c) 2014-present, The osquery authors
+ *
+ * This source code is licensed as defined by the LICENSE file found in the
+ * root directory of this source tree.
+ *
+ * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
+ */
+
+#include <osquery/profiler/resource_usage.h>
+
+namespace osquery {
+
+namespace {
+
+/// The CPU time of the helper threads started by this thread.
+thread_local std::shared_ptr<HelperCpuTime> kHelperCpuTime;
+
+} // namespace
+
+ResourceUsage getResourceUsage() {
+  ResourceUsage usage;
+  if (impl::getThreadCpuTimes(usage) && kHelperCpuTime != nullptr) {
+    usage.user_time += kHelperCpuTime->user_time;
+    usage.system_time += kHelperCpuTime->system_time;
+  }
+
+  impl::getResidentSize(usage);
+  return usage;
+}
+
+std::shared_ptr<HelperCpuTime> getHelperCpuTime() {
+  if (kHelperCpuTime == nullptr) {
+    kHelperCpuTime = std::make_shared<HelperCpuTime>();
+  }
+  return kHelperCpuTime;
+}
+
+ScopedHelperCpuTime::ScopedHelperCpuTime(
+    std::shared_ptr<HelperCpuTime> account)
+    : account_(std::move(account)) {
+  // Process-wide CPU times already include the helper threads.
+  if (!impl::getThreadCpuTimes(start_)) {
+    account_.reset();
+  }
+}
+
+ScopedHelperCpuTime::~ScopedHelperCpuTime() {
+  if (account_ == nullptr) {
+    return;
+  }
+
+  ResourceUsage end;
+  impl::getThreadCpuTimes(end);
+  if (end.user_time >= start_.user_time &&
+      end.system_time >= start_.system_time) {
+    account_->user_time += end.user_time - start_.user_time;
+    account_->system_time += end.system_time - start_.system_time;
+  }
+}
+
+} // namespace osquery
@@ -0,0 +1,74 @@
+/**
+ * Copyright (c) 2014-present, The osquery authors
+ *
+ * This source code is licensed as defined by the LICENSE file found in the
+ * root directory of this source tree.
+ *
+ * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+#include <boost/noncopyable.hpp>
+
+#include <osquery/core/sql/query_performance.h>
+
+namespace osquery {
+
+/// CPU time of helper threads, credited to the thread that started them.
+struct HelperCpuTime {
+  /// User time in milliseconds
+  std::atomic<std::uint64_t> user_time{0};
+
+  /// System time in milliseconds
+  std::atomic<std::uint64_t> system_time{0};
+};
+
+/**
+ * @brief Take a low-overhead snapshot of the resources used by the daemon.
+ *
+ * CPU times are read for the calling thread on Linux, macOS and Windows,
+ * so concurrent work on other threads is not attributed to the caller.
+ * They include the CPU time of the helper threads started by the calling
+ * thread, see ScopedHelperCpuTime. Other platforms report process-wide CPU
+ * times.
+ *
+ * This does not use the processes table, it costs a few system calls.
+ */
+ResourceUsage getResourceUsage();
+
+/// Get the account of the calling thread, to hand over to its helpers.
+std::shared_ptr<HelperCpuTime> getHelperCpuTime();
+
+/**
+ * @brief Credit the CPU time of a helper thread to the thread it works for.
+ *
+ * Tables splitting a query across threads create one at the start of each
+ * helper thread, with the account of the thread executing the query. The
+ * CPU time used until it is destroyed is then part of the query's cost.
+ */
+class ScopedHelperCpuTime : private boost::noncopyable {
+ public:
+  explicit ScopedHelperCpuTime(std::shared_ptr<HelperCpuTime> account);
+  ~ScopedHelperCpuTime();
+
+ private:
+  std::shared_ptr<HelperCpuTime> account_;
+  ResourceUsage start_;
+};
+
+namespace impl {
+
+/// Read the CPU times of the calling thread, false if they are process-wide.
+bool getThreadCpuTimes(ResourceUsage& usage);
+
+/// Read the resident size of the process, if cheaply available.
+void getResidentSize(ResourceUsage& usage);
+
+} // namespace impl
+
+} // namespace osquery
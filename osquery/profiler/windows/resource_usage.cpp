@@ -0,0 +1,55 @@
+/**
+ * Copyright (c) 2014-present, The osquery authors
+ *
+ * This source code is licensed as defined by the LICENSE file found in the
+ * root directory of this source tree.
+ *
+ * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
+ */
+
+#include <Windows.h>
+
+#include <psapi.h>
+
+#include <osquery/profiler/resource_usage.h>
+
+namespace osquery {
+namespace {
+
+/// FILETIME durations are counted in 100 nanosecond intervals.
+std::uint64_t toMilliseconds(const FILETIME& duration) {
+  ULARGE_INTEGER value;
+  value.LowPart = duration.dwLowDateTime;
+  value.HighPart = duration.dwHighDateTime;
+  return value.QuadPart / 10000ULL;
+}
+
+} // namespace
+
+namespace impl {
+
+bool getThreadCpuTimes(ResourceUsage& usage) {
+  FILETIME creation_time;
+  FILETIME exit_time;
+  FILETIME kernel_time;
+  FILETIME user_time;
+  if (GetThreadTimes(GetCurrentThread(),
+                     &creation_time,
+                     &exit_time,
+                     &kernel_time,
+                     &user_time)) {
+    usage.user_time = toMilliseconds(user_time);
+    usage.system_time = toMilliseconds(kernel_time);
+  }
+  return true;
+}
+
+void getResidentSize(ResourceUsage& usage) {
+  PROCESS_MEMORY_COUNTERS counters;
+  if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+    usage.resident_size = counters.WorkingSetSize;
+  }
+}
+
+} // namespace impl
+} // namespace osquery
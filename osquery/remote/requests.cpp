@@ -7,53 +7,115 @@
  * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
  */
 
+#include <algorithm>
 #include <cstring>
 #include <string>
 
 #include <zlib.h>
 
+#include <osquery/remote/requests.h>
+
 namespace osquery {
 
 #define MOD_GZIP_ZLIB_WINDOWSIZE 15
 #define MOD_GZIP_ZLIB_CFACTOR 9
 
 std::string compressString(const std::string& data) {
-  z_stream zs;
-  memset(&zs, 0, sizeof(zs));
+  GzipCompressor compressor;
+
+  std::string output;
+  if (!compressor.append(data.data(), data.size()).ok() ||
+      !compressor.finish(output).ok()) {
+    return std::string();
+  }
+
+  return output;
+}
+
+GzipCompressor::GzipCompressor() : stream_(std::make_unique<z_stream>()) {
+  memset(stream_.get(), 0, sizeof(z_stream));
 
-  if (deflateInit2(&zs,
+  if (deflateInit2(stream_.get(),
                    Z_BEST_COMPRESSION,
                    Z_DEFLATED,
                    MOD_GZIP_ZLIB_WINDOWSIZE + 16,
                    MOD_GZIP_ZLIB_CFACTOR,
                    Z_DEFAULT_STRATEGY) != Z_OK) {
-    return std::string();
+    stream_.reset();
   }
+}
 
-  zs.next_in = (Bytef*)data.data();
-  zs.avail_in = static_cast<uInt>(data.size());
+GzipCompressor::~GzipCompressor() {
+  if (stream_ != nullptr) {
+    deflateEnd(stream_.get());
+  }
+}
 
-  int ret = Z_OK;
-  std::string output;
+Status GzipCompressor::append(const char* data, std::size_t size) {
+  if (stream_ == nullptr || finished_) {
+    return Status::failure("The compression stream is not available");
+  }
 
-  {
-    char buffer[16384] = {0};
-    while (ret == Z_OK) {
-      zs.next_out = reinterpret_cast<Bytef*>(buffer);
-      zs.avail_out = sizeof(buffer);
+  // The input size is limited by the zlib stream field.
+  while (size > 0U) {
+    auto chunk_size = std::min<std::size_t>(size, 1U << 30);
 
-      ret = deflate(&zs, Z_FINISH);
-      if (output.size() < zs.total_out) {
-        output.append(buffer, zs.total_out - output.size());
-      }
+    stream_->next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+    stream_->avail_in = static_cast<uInt>(chunk_size);
+
+    auto status = deflateInput(Z_NO_FLUSH);
+    if (!status.ok()) {
+      return status;
     }
+
+    data += chunk_size;
+    size -= chunk_size;
   }
 
-  deflateEnd(&zs);
-  if (ret != Z_STREAM_END) {
-    return std::string();
+  return Status::success();
+}
+
+Status GzipCompressor::finish(std::string& output) {
+  if (stream_ == nullptr || finished_) {
+    return Status::failure("The compression stream is not available");
   }
 
-  return output;
+  stream_->next_in = nullptr;
+  stream_->avail_in = 0U;
+
+  auto status = deflateInput(Z_FINISH);
+  finished_ = true;
+
+  if (!status.ok()) {
+    return status;
+  }
+
+  output = std::move(output_);
+  output_.clear();
+
+  return Status::success();
 }
+
+Status GzipCompressor::deflateInput(int flush) {
+  char buffer[16384];
+
+  int ret = Z_OK;
+  do {
+    stream_->next_out = reinterpret_cast<Bytef*>(buffer);
+    stream_->avail_out = sizeof(buffer);
+
+    ret = deflate(stream_.get(), flush);
+    if (ret == Z_STREAM_ERROR) {
+      finished_ = true;
+      return Status::failure("Failed to compress the data");
+    }
+
+    output_.append(buffer, sizeof(buffer) - stream_->avail_out);
+
+    // The input was consumed once the output buffer is not filled.
+  } while (stream_->avail_out == 0U ||
+           (flush == Z_FINISH && ret != Z_STREAM_END));
+
+  return Status::success();
 }
+} // namespace osquery
@@ -9,6 +9,7 @@
 
 #pragma once
 
+#include <cstddef>
 #include <memory>
 #include <utility>
 #include <string>
@@ -34,6 +35,45 @@ class Serializer;
  */
 std::string compressString(const std::string& data);
 
+/**
+ * @brief Compress data using GZip, one chunk at a time.
+ *
+ * Callers building large request bodies may compress them as they are
+ * written, instead of keeping the serialized body around. The output is
+ * the same as compressString for the concatenation of the chunks.
+ */
+class GzipCompressor final {
+ public:
+  GzipCompressor();
+  ~GzipCompressor();
+
+  GzipCompressor(const GzipCompressor&) = delete;
+  GzipCompressor& operator=(const GzipCompressor&) = delete;
+
+  /// Compress a chunk of data.
+  Status append(const char* data, std::size_t size);
+
+  /**
+   * @brief Compress the remaining data and end the stream.
+   *
+   * @param output The compressed data, moved out of the compressor.
+   */
+  Status finish(std::string& output);
+
+ private:
+  Status deflateInput(int flush);
+
+ private:
+  /// The zlib stream, nullptr if it could not be initialized.
+  std::unique_ptr<struct z_stream_s> stream_;
+
+  /// Compressed data produced so far.
+  std::string output_;
+
+  /// Set once the stream has ended, or failed.
+  bool finished_{false};
+};
+
 /**
  * @brief Abstract base class for remote transport implementations
  *
@@ -231,6 +271,21 @@ class Request {
       return s;
     }
 
+    return callSerialized(serialized);
+  }
+
+  /**
+   * @brief Send a request to the destination with serialized parameters
+   *
+   * Used by callers building large requests themselves, to avoid creating a
+   * JSON object only to serialize it. If the "compressed" option is set, the
+   * parameters were already compressed by the caller.
+   *
+   * @param serialized a string of the serialized parameters
+   *
+   * @return success or failure of the operation
+   */
+  Status callSerialized(const std::string& serialized) {
     bool compress = false;
     auto it = options_.doc().FindMember("compress");
     if (it != options_.doc().MemberEnd() && it->value.IsBool()) {
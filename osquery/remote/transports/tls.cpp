@@ -237,9 +237,17 @@ Status TLSTransport::sendRequest(const std::string& params, bool compress) {
         "Cannot create TLS request for non-HTTPS protocol URI");
   }
 
+  // The caller may have compressed the parameters while serializing them.
+  bool compressed = false;
+  auto compressed_it = options_.doc().FindMember("compressed");
+  if (compressed_it != options_.doc().MemberEnd() &&
+      compressed_it->value.IsBool()) {
+    compressed = compressed_it->value.GetBool();
+  }
+
   http::Request r(destination_);
   decorateRequest(r);
-  if (compress) {
+  if (compress || compressed) {
     // Later, when posting/putting, the data will be optionally compressed.
     r << http::Request::Header("Content-Encoding", "gzip");
   }
@@ -254,7 +262,7 @@ Status TLSTransport::sendRequest(const std::string& params, bool compress) {
 
   VLOG(1) << "TLS/HTTPS " << ((verb == HTTP_POST) ? "POST" : "PUT")
           << " request to URI: " << destination_;
-  if (FLAGS_verbose && FLAGS_tls_dump) {
+  if (FLAGS_verbose && FLAGS_tls_dump && !compressed) {
     fprintf(stdout, "%s\n", params.c_str());
   }
 
@@ -83,7 +83,6 @@ class TLSRequestHelper : private boost::noncopyable {
   template <class TSerializer>
   static Status go(const std::string& uri, JSON& params, JSON& output) {
     auto& params_doc = params.doc();
-    auto& output_doc = output.doc();
 
     auto node_key = getNodeKey("tls");
 
@@ -145,40 +144,58 @@ class TLSRequestHelper : private boost::noncopyable {
       return status;
     }
 
-    // Receive config or key rejection
-    it = output_doc.FindMember("node_invalid");
-    if (it != output_doc.MemberEnd()) {
-      assert(it->value.IsBool());
-
-      if (it->value.GetBool()) {
-        if (!FLAGS_disable_reenrollment) {
-          clearNodeKey();
-        }
+    return checkResponse(output);
+  }
 
-        std::string message = "Request failed: Invalid node key";
+  /**
+   * @brief Send a TLS request with parameters that are already serialized
+   *
+   * Callers sending large requests, such as buffered logs, serialize and
+   * optionally compress the parameters themselves. Unless `tls_node_api` is
+   * set, the serialized parameters must include the node_key.
+   *
+   * @param uri is the URI to send the request to
+   * @param params is the serialized parameters
+   * @param compressed true if params was compressed using GZip
+   * @param output is the string which will be populated with the deserialized
+   * results
+   *
+   * @return a Status object indicating the success or failure of the operation
+   */
+  template <class TSerializer>
+  static Status goSerialized(const std::string& uri,
+                             const std::string& params,
+                             bool compressed,
+                             std::string& output) {
+    std::string uri_suffix;
+    if (FLAGS_tls_node_api) {
+      uri_suffix = "&node_key=" + getNodeKey("tls");
+    }
 
-        it = output_doc.FindMember("error");
-        if (it != output_doc.MemberEnd()) {
-          message +=
-              ": " + std::string(it->value.IsString() ? it->value.GetString()
-                                                      : "<unknown>");
-        }
+    Request<TLSTransport, TSerializer> request(uri + uri_suffix);
+    request.setOption("hostname", FLAGS_tls_hostname);
+    if (compressed) {
+      request.setOption("compressed", true);
+    }
 
-        return Status(1, message);
-      }
+    auto status = request.callSerialized(params);
+    if (!status.ok()) {
+      return status;
     }
 
-    it = output_doc.FindMember("error");
-    if (it != output_doc.MemberEnd()) {
-      std::string message =
-          "Request failed: " + std::string(it->value.IsString()
-                                               ? it->value.GetString()
-                                               : "<unknown>");
+    JSON recv;
+    status = request.getResponse(recv);
+    if (!status.ok()) {
+      return status;
+    }
 
-      return Status(1, message);
+    status = checkResponse(recv);
+    if (!status.ok()) {
+      return status;
     }
 
-    return Status::success();
+    auto serializer = TSerializer();
+    return serializer.serialize(recv, output);
   }
 
   /**
@@ -300,5 +317,46 @@ class TLSRequestHelper : private boost::noncopyable {
     params.add("_get", true);
     return TLSRequestHelper::go<TSerializer>(uri, params, output, attempts);
   }
+
+ private:
+  /// Check the response of a request for errors, or a node key rejection.
+  static Status checkResponse(JSON& output) {
+    auto& output_doc = output.doc();
+
+    // Receive config or key rejection
+    auto it = output_doc.FindMember("node_invalid");
+    if (it != output_doc.MemberEnd()) {
+      assert(it->value.IsBool());
+
+      if (it->value.GetBool()) {
+        if (!FLAGS_disable_reenrollment) {
+          clearNodeKey();
+        }
+
+        std::string message = "Request failed: Invalid node key";
+
+        it = output_doc.FindMember("error");
+        if (it != output_doc.MemberEnd()) {
+          message +=
+              ": " + std::string(it->value.IsString() ? it->value.GetString()
+                                                      : "<unknown>");
+        }
+
+        return Status(1, message);
+      }
+    }
+
+    it = output_doc.FindMember("error");
+    if (it != output_doc.MemberEnd()) {
+      std::string message =
+          "Request failed: " + std::string(it->value.IsString()
+                                               ? it->value.GetString()
+                                               : "<unknown>");
+
+      return Status(1, message);
+    }
+
+    return Status::success();
+  }
 };
 } // namespace osquery
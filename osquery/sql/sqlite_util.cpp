@@ -25,6 +25,9 @@
 
 #include <boost/lexical_cast.hpp>
 
+#include <algorithm>
+#include <cstring>
+
 namespace osquery {
 
 CLI_FLAG(string,
@@ -39,6 +42,11 @@ CLI_FLAG(string,
 
 FLAG(string, nullvalue, "", "Set string for NULL values, default ''");
 
+FLAG(uint64,
+     sql_statement_cache_size,
+     0,
+     "Prepared statements kept per SQLite connection (default 0 disables)");
+
 using OpReg = QueryPlanner::Opcode::Register;
 
 using SQLiteDBInstanceRef = std::shared_ptr<SQLiteDBInstance>;
@@ -121,6 +129,41 @@ const std::map<std::string, QueryPlanner::Opcode> kSQLOpcodes = {
 
 RecursiveMutex SQLiteDBInstance::kPrimaryAttachMutex;
 
+/// Prepared statement cache counters.
+static std::atomic<uint64_t> kStatementCacheHits{0};
+static std::atomic<uint64_t> kStatementCacheMisses{0};
+
+/**
+ * @brief Create a statement cache key from query text.
+ *
+ * Scheduled queries repeat the exact same text, so only the surrounding
+ * whitespace and statement terminators are removed.
+ */
+static std::string normalizeStatementKey(const std::string& query) {
+  auto begin = query.find_first_not_of(" \t\r\n");
+  if (begin == std::string::npos) {
+    return "";
+  }
+  auto end = query.find_last_not_of(" \t\r\n;");
+  if (end == std::string::npos || end < begin) {
+    return "";
+  }
+  return query.substr(begin, end - begin + 1);
+}
+
+/// Erase the transient per-query entries that are not retained.
+template <typename T>
+static void clearUnretained(std::unordered_map<size_t, T>& entries,
+                            const std::unordered_set<size_t>& retained) {
+  for (auto it = entries.begin(); it != entries.end();) {
+    if (retained.count(it->first) == 0) {
+      it = entries.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
 /// The SQLiteSQLPlugin implements the "sql" registry for internal/core.
 class SQLiteSQLPlugin : public SQLPlugin {
  public:
@@ -181,9 +224,13 @@ Status SQLiteSQLPlugin::getQueryTables(const std::string& query,
   return Status(0);
 }
 
-SQLInternal::SQLInternal(const std::string& query, bool use_cache) {
+SQLInternal::SQLInternal(const std::string& query,
+                         bool use_cache,
+                         uint64_t cache_step,
+                         uint64_t cache_interval) {
   auto dbc = SQLiteDBManager::get();
   dbc->useCache(use_cache);
+  dbc->setCacheStep(cache_step, cache_interval);
   status_ = queryInternal(query, resultsTyped_, dbc);
 
   // One of the advantages of using SQLInternal (aside from the Registry-bypass)
@@ -375,6 +422,19 @@ bool SQLiteDBInstance::useCache() const {
   return use_cache_;
 }
 
+void SQLiteDBInstance::setCacheStep(uint64_t step, uint64_t interval) {
+  cache_step_ = step;
+  cache_interval_ = interval;
+}
+
+uint64_t SQLiteDBInstance::cacheStep() const {
+  return cache_step_;
+}
+
+uint64_t SQLiteDBInstance::cacheInterval() const {
+  return cache_interval_;
+}
+
 RecursiveLock SQLiteDBInstance::attachLock() const {
   if (isPrimary()) {
     return RecursiveLock(kPrimaryAttachMutex);
@@ -415,18 +475,125 @@ void SQLiteDBInstance::clearAffectedTables() {
   }
 
   for (const auto& table : affected_tables_) {
-    table.second->constraints.clear();
+    if (table.second->retained.empty()) {
+      table.second->constraints.clear();
+      table.second->colsUsed.clear();
+      table.second->colsUsedBitsets.clear();
+    } else {
+      // Cached prepared statements will filter using their planned indexes.
+      clearUnretained(table.second->constraints, table.second->retained);
+      clearUnretained(table.second->colsUsed, table.second->retained);
+      clearUnretained(table.second->colsUsedBitsets, table.second->retained);
+    }
     table.second->cache.clear();
-    table.second->colsUsed.clear();
-    table.second->colsUsedBitsets.clear();
   }
   // Since the affected tables are cleared, there are no more affected tables.
   // There is no concept of compounding tables between queries.
   affected_tables_.clear();
   use_cache_ = false;
+  cache_step_ = 0;
+  cache_interval_ = 0;
+}
+
+/// Drop the constraints of a planned index no longer used by a statement.
+static void releasePlan(const PlannedIndexes::value_type& plan) {
+  plan.first->retained.erase(plan.second);
+  plan.first->constraints.erase(plan.second);
+  plan.first->colsUsed.erase(plan.second);
+  plan.first->colsUsedBitsets.erase(plan.second);
+}
+
+CachedStatement::~CachedStatement() {
+  sqlite3_finalize(statement);
+  for (const auto& plan : plans) {
+    releasePlan(plan);
+  }
+}
+
+CachedStatement* SQLiteDBInstance::getCachedStatement(const std::string& key) {
+  if (isPrimary() && !managed_) {
+    return SQLiteDBManager::getConnection(true)->getCachedStatement(key);
+  }
+
+  auto cached = (statements_ == nullptr) ? nullptr : statements_->get(key);
+  if (cached == nullptr || (*cached)->in_use) {
+    kStatementCacheMisses++;
+    return nullptr;
+  }
+  kStatementCacheHits++;
+  return cached->get();
+}
+
+void SQLiteDBInstance::beginPlanning() {
+  if (isPrimary() && !managed_) {
+    SQLiteDBManager::getConnection(true)->beginPlanning();
+    return;
+  }
+
+  planning_ = true;
+  planned_.clear();
+}
+
+void SQLiteDBInstance::addPlannedIndex(
+    std::shared_ptr<VirtualTableContent> table, size_t index) {
+  // Virtual tables are attached to the managed instance, never forwarded.
+  if (planning_) {
+    planned_.emplace_back(std::move(table), index);
+  }
+}
+
+PlannedIndexes SQLiteDBInstance::endPlanning() {
+  if (isPrimary() && !managed_) {
+    return SQLiteDBManager::getConnection(true)->endPlanning();
+  }
+
+  planning_ = false;
+  auto plans = std::move(planned_);
+  planned_.clear();
+  return plans;
+}
+
+CachedStatement* SQLiteDBInstance::cacheStatement(const std::string& key,
+                                                  sqlite3_stmt* statement) {
+  if (isPrimary() && !managed_) {
+    return SQLiteDBManager::getConnection(true)->cacheStatement(key,
+                                                                statement);
+  }
+
+  auto plans = endPlanning();
+  if (statement == nullptr || FLAGS_sql_statement_cache_size == 0) {
+    return nullptr;
+  }
+
+  if (statements_ == nullptr) {
+    statements_ =
+        std::make_unique<StatementCache>(FLAGS_sql_statement_cache_size);
+  } else if (statements_->has(key)) {
+    // A nested execution of the same query may not replace a running one.
+    return nullptr;
+  }
+
+  auto cached = std::make_unique<CachedStatement>();
+  cached->statement = statement;
+  cached->plans = std::move(plans);
+  for (const auto& plan : cached->plans) {
+    plan.first->retained.insert(plan.second);
+  }
+  return statements_->insert(key, std::move(cached))->get();
+}
+
+void SQLiteDBInstance::clearStatementCache() {
+  if (isPrimary() && !managed_) {
+    SQLiteDBManager::getConnection(true)->clearStatementCache();
+    return;
+  }
+
+  statements_.reset();
 }
 
 SQLiteDBInstance::~SQLiteDBInstance() {
+  // Statements must be finalized before the database is closed.
+  statements_.reset();
   if (!isPrimary() && db_ != nullptr) {
     sqlite3_close(db_);
   } else {
@@ -489,6 +656,23 @@ void SQLiteDBManager::resetPrimary() {
   }
 }
 
+void SQLiteDBManager::clearStatementCache() {
+  auto& self = instance();
+
+  WriteLock connection_lock(self.mutex_);
+  WriteLock create_lock(self.create_mutex_);
+  if (self.connection_ != nullptr) {
+    self.connection_->clearStatementCache();
+  }
+}
+
+StatementCacheStats SQLiteDBManager::getStatementCacheStats() {
+  StatementCacheStats stats;
+  stats.hits = kStatementCacheHits;
+  stats.misses = kStatementCacheMisses;
+  return stats;
+}
+
 void SQLiteDBManager::setDisabledTables(const std::string& list) {
   const auto& tables = split(list, ",");
   disabled_tables_ =
@@ -634,14 +818,10 @@ Status queryInternal(const std::string& query,
   return status;
 }
 
-Status readRows(sqlite3_stmt* prepared_statement,
-                QueryDataTyped& results,
-                const SQLiteDBInstanceRef& instance) {
-  // Do nothing with a null prepared_statement (eg, if the sql was just
-  // whitespace)
-  if (prepared_statement == nullptr) {
-    return Status::success();
-  }
+/// Step through a statement's rows, the statement is not finalized.
+static Status stepRows(sqlite3_stmt* prepared_statement,
+                       QueryDataTyped& results,
+                       const SQLiteDBInstanceRef& instance) {
   int rc = sqlite3_step(prepared_statement);
   /* if we have a result set row... */
   if (SQLITE_ROW == rc) {
@@ -679,12 +859,27 @@ Status readRows(sqlite3_stmt* prepared_statement,
     } while (SQLITE_ROW == rc);
   }
   if (rc != SQLITE_DONE) {
-    auto s = Status::failure(sqlite3_errmsg(instance->db()));
+    return Status::failure(sqlite3_errmsg(instance->db()));
+  }
+  return Status::success();
+}
+
+Status readRows(sqlite3_stmt* prepared_statement,
+                QueryDataTyped& results,
+                const SQLiteDBInstanceRef& instance) {
+  // Do nothing with a null prepared_statement (eg, if the sql was just
+  // whitespace)
+  if (prepared_statement == nullptr) {
+    return Status::success();
+  }
+
+  auto s = stepRows(prepared_statement, results, instance);
+  if (!s.ok()) {
     sqlite3_finalize(prepared_statement);
     return s;
   }
 
-  rc = sqlite3_finalize(prepared_statement);
+  int rc = sqlite3_finalize(prepared_statement);
   if (rc != SQLITE_OK) {
     return Status::failure(sqlite3_errmsg(instance->db()));
   }
@@ -692,9 +887,52 @@ Status readRows(sqlite3_stmt* prepared_statement,
   return Status::success();
 }
 
+/// Run a cached statement and reset it for the next execution.
+static Status readCachedRows(CachedStatement& cached,
+                             QueryDataTyped& results,
+                             const SQLiteDBInstanceRef& instance) {
+  instance->beginPlanning();
+  cached.in_use = true;
+  auto s = stepRows(cached.statement, results, instance);
+  sqlite3_reset(cached.statement);
+  cached.in_use = false;
+
+  // SQLite prepares the statement again after a schema change, the new plan
+  // replaces the previous one.
+  auto plans = instance->endPlanning();
+  if (!plans.empty()) {
+    for (const auto& plan : plans) {
+      plan.first->retained.insert(plan.second);
+    }
+    for (const auto& plan : cached.plans) {
+      if (std::find(plans.begin(), plans.end(), plan) == plans.end()) {
+        releasePlan(plan);
+      }
+    }
+    cached.plans = std::move(plans);
+  }
+  return s;
+}
+
 Status queryInternal(const std::string& query,
                      QueryDataTyped& results,
                      const SQLiteDBInstanceRef& instance) {
+  // Single, read-only statements may be kept prepared for the next execution.
+  std::string cache_key;
+  if (FLAGS_sql_statement_cache_size > 0) {
+    cache_key = normalizeStatementKey(query);
+  }
+
+  if (!cache_key.empty()) {
+    const auto lock = instance->attachLock();
+    auto cached = instance->getCachedStatement(cache_key);
+    if (cached != nullptr) {
+      auto s = readCachedRows(*cached, results, instance);
+      sqlite3_db_release_memory(instance->db());
+      return s;
+    }
+  }
+
   sqlite3_stmt* prepared_statement{nullptr}; /* Statement to execute. */
 
   int rc = SQLITE_OK; /* Return Code */
@@ -709,14 +947,37 @@ Status queryInternal(const std::string& query,
     while (isspace(sql[0])) {
       sql++;
     }
+
+    // Only a query made of a single statement is cached.
+    bool cacheable = !cache_key.empty() && leftover_sql == nullptr;
+    if (cacheable) {
+      instance->beginPlanning();
+    }
     rc = sqlite3_prepare_v2(
         instance->db(), sql, -1, &prepared_statement, &leftover_sql);
     if (rc != SQLITE_OK) {
       Status s = Status::failure(sqlite3_errmsg(instance->db()));
       sqlite3_finalize(prepared_statement);
+      if (cacheable) {
+        instance->cacheStatement(cache_key, nullptr);
+      }
       return s;
     }
 
+    if (cacheable) {
+      cacheable = prepared_statement != nullptr &&
+                  sqlite3_stmt_readonly(prepared_statement) != 0 &&
+                  std::strspn(leftover_sql, " \t\r\n;") ==
+                      std::strlen(leftover_sql);
+      auto cached = instance->cacheStatement(
+          cache_key, cacheable ? prepared_statement : nullptr);
+      if (cached != nullptr) {
+        auto s = readCachedRows(*cached, results, instance);
+        sqlite3_db_release_memory(instance->db());
+        return s;
+      }
+    }
+
     Status s = readRows(prepared_statement, results, instance);
     if (!s.ok()) {
       return s;
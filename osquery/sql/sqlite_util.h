@@ -21,6 +21,7 @@
 
 #include <osquery/sql/sql.h>
 
+#include <osquery/utils/caches/lru.h>
 #include <osquery/utils/mutex.h>
 
 #include <gtest/gtest_prod.h>
@@ -86,6 +87,40 @@ const std::unordered_set<std::string> kAllowedSQLitePragmas = {
 
 class SQLiteDBManager;
 
+/// Virtual table constraint indexes selected by xBestIndex.
+using PlannedIndexes =
+    std::vector<std::pair<std::shared_ptr<VirtualTableContent>, size_t>>;
+
+/**
+ * @brief A single-statement query prepared once and reset between runs.
+ *
+ * Re-running the statement does not call xBestIndex again, the virtual table
+ * constraint indexes selected while preparing are retained by their tables
+ * until the statement is finalized.
+ */
+struct CachedStatement : private boost::noncopyable {
+  ~CachedStatement();
+
+  /// The prepared, and reset, statement.
+  sqlite3_stmt* statement{nullptr};
+
+  /// Virtual table constraint indexes planned while preparing the statement.
+  PlannedIndexes plans;
+
+  /// Set while the statement is stepped, a nested use must prepare again.
+  bool in_use{false};
+};
+
+/// Per-connection prepared statements keyed by normalized query text.
+using StatementCache =
+    caches::LRU<std::string, std::unique_ptr<CachedStatement>>;
+
+/// Prepared statement cache hit counters, across all connections.
+struct StatementCacheStats {
+  uint64_t hits{0};
+  uint64_t misses{0};
+};
+
 /**
  * @brief An RAII wrapper around an `sqlite3` object.
  *
@@ -136,9 +171,52 @@ class SQLiteDBInstance : private boost::noncopyable {
   /// Check if the query requested use of the warm query cache.
   bool useCache() const;
 
+  /// Set the schedule step and interval virtual tables cache results for.
+  void setCacheStep(uint64_t step, uint64_t interval);
+
+  /// The schedule step of the query using the warm cache.
+  uint64_t cacheStep() const;
+
+  /// The scheduled interval of the query using the warm cache.
+  uint64_t cacheInterval() const;
+
   /// Lock the database for attaching virtual tables.
   RecursiveLock attachLock() const;
 
+  /**
+   * @brief Find a cached prepared statement for a normalized query.
+   *
+   * The caller must hold the attachLock while the statement is used.
+   *
+   * @return The cached statement or nullptr if it was not prepared yet.
+   */
+  CachedStatement* getCachedStatement(const std::string& key);
+
+  /// Start recording the virtual table constraint indexes being planned.
+  void beginPlanning();
+
+  /// Record a constraint index selected by xBestIndex.
+  void addPlannedIndex(std::shared_ptr<VirtualTableContent> table,
+                       size_t index);
+
+  /// Stop recording and return the indexes planned since beginPlanning.
+  PlannedIndexes endPlanning();
+
+  /**
+   * @brief Stop planning and keep a prepared statement for the next runs.
+   *
+   * The indexes recorded since beginPlanning are retained by their tables.
+   * A nullptr statement only stops planning.
+   *
+   * @return The cached statement, or nullptr if the caller still owns it.
+   */
+  CachedStatement* cacheStatement(const std::string& key,
+                                  sqlite3_stmt* statement);
+
+  /// Finalize every cached prepared statement, for example after a schema
+  /// change from attaching or detaching tables.
+  void clearStatementCache();
+
  private:
   /// Handle the primary/forwarding requests for table attribute accesses.
   TableAttributes getAttributes() const;
@@ -158,6 +236,10 @@ class SQLiteDBInstance : private boost::noncopyable {
   /// True if this query should bypass table cache.
   bool use_cache_{false};
 
+  /// The schedule step and interval of the query using the table cache.
+  uint64_t cache_step_{0};
+  uint64_t cache_interval_{0};
+
   /// Either the managed primary database or an ephemeral instance.
   sqlite3* db_{nullptr};
 
@@ -184,6 +266,15 @@ class SQLiteDBInstance : private boost::noncopyable {
   /// Vector of tables that need their constraints cleared after execution.
   std::map<std::string, std::shared_ptr<VirtualTableContent>> affected_tables_;
 
+  /// Prepared statements, created on first use if the cache is enabled.
+  std::unique_ptr<StatementCache> statements_;
+
+  /// True while preparing a statement that may be cached.
+  bool planning_{false};
+
+  /// Constraint indexes selected while planning.
+  PlannedIndexes planned_;
+
  private:
   friend class SQLiteDBManager;
   friend class SQLInternal;
@@ -253,6 +344,16 @@ class SQLiteDBManager : private boost::noncopyable {
    */
   static bool isDisabled(const std::string& table_name);
 
+  /**
+   * @brief Finalize the primary connection's cached prepared statements.
+   *
+   * This waits for the primary connection to be released.
+   */
+  static void clearStatementCache();
+
+  /// Read the prepared statement cache hit counters.
+  static StatementCacheStats getStatementCacheStats();
+
  protected:
   SQLiteDBManager();
   virtual ~SQLiteDBManager();
@@ -429,8 +530,13 @@ class SQLInternal : private only_movable {
    *
    * @param query An osquery SQL query.
    * @param use_cache [optional] Set true to use the query cache.
+   * @param cache_step [optional] The schedule step of the query.
+   * @param cache_interval [optional] The scheduled interval of the query.
    */
-  explicit SQLInternal(const std::string& query, bool use_cache = false);
+  explicit SQLInternal(const std::string& query,
+                       bool use_cache = false,
+                       uint64_t cache_step = 0,
+                       uint64_t cache_interval = 0);
 
  public:
   /**
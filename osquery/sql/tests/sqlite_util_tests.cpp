@@ -124,6 +124,53 @@ TEST_F(SQLiteUtilTests, test_direct_query_execution) {
   EXPECT_EQ(results, getTestDBExpectedResults());
 }
 
+TEST_F(SQLiteUtilTests, test_statement_cache) {
+  Flag::updateValue("sql_statement_cache_size", "8");
+  auto dbc = getTestDBC();
+  auto stats = SQLiteDBManager::getStatementCacheStats();
+
+  QueryDataTyped results;
+  auto status = queryInternal(kTestQuery, results, dbc);
+  EXPECT_TRUE(status.ok());
+  results.clear();
+  status = queryInternal(" " + kTestQuery + ";", results, dbc);
+  EXPECT_TRUE(status.ok());
+  EXPECT_EQ(results, getTestDBExpectedResults());
+
+  auto cached = SQLiteDBManager::getStatementCacheStats();
+  EXPECT_EQ(cached.hits, stats.hits + 1);
+  EXPECT_EQ(cached.misses, stats.misses + 1);
+
+  // Constraints planned when preparing must still apply to the cached plan.
+  auto query = "select path from file where path = '/'";
+  for (size_t i = 0; i < 2; i++) {
+    QueryData rows;
+    EXPECT_TRUE(queryInternal(query, rows, dbc).ok());
+    ASSERT_EQ(rows.size(), 1U);
+    EXPECT_EQ(rows[0]["path"], "/");
+    dbc->clearAffectedTables();
+  }
+
+  // Statements that write are always prepared again.
+  stats = SQLiteDBManager::getStatementCacheStats();
+  for (size_t i = 0; i < 2; i++) {
+    results.clear();
+    status = queryInternal(
+        "insert into test_table values ('cached', 1)", results, dbc);
+    EXPECT_TRUE(status.ok());
+  }
+  EXPECT_EQ(SQLiteDBManager::getStatementCacheStats().hits, stats.hits);
+
+  // A cleared cache prepares again.
+  dbc->clearStatementCache();
+  results.clear();
+  status = queryInternal(kTestQuery, results, dbc);
+  EXPECT_TRUE(status.ok());
+  EXPECT_EQ(results.size(), 4U);
+  EXPECT_EQ(SQLiteDBManager::getStatementCacheStats().hits, stats.hits);
+  Flag::updateValue("sql_statement_cache_size", "0");
+}
+
 TEST_F(SQLiteUtilTests, test_aggregate_query) {
   auto dbc = getTestDBC();
   QueryDataTyped results;
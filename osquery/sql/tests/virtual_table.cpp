@@ -7,10 +7,13 @@
  * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
  */
 
+#include <algorithm>
+
 #include <gtest/gtest.h>
 
 #include <osquery/core/core.h>
 #include <osquery/core/system.h>
+#include <osquery/core/table_cache.h>
 #include <osquery/database/database.h>
 #include <osquery/logger/logger.h>
 #include <osquery/registry/registry.h>
@@ -22,6 +25,7 @@
 namespace osquery {
 
 DECLARE_bool(table_exceptions);
+DECLARE_uint64(table_cache_max_rows);
 
 class VirtualTableTests : public testing::Test {
  public:
@@ -516,14 +520,14 @@ class tableCacheTablePlugin : public TablePlugin {
   }
 
   TableRows generate(QueryContext& ctx) override {
-    if (isCached(60, ctx)) {
-      return getCache();
+    TableRows result;
+    if (getCache(60, ctx, result)) {
+      return result;
     }
 
     generates_++;
     auto r = make_table_row();
     r["i"] = "1";
-    TableRows result;
     result.push_back(std::move(r));
     setCache(60, 1, ctx, result);
     return result;
@@ -588,15 +592,56 @@ TEST_F(VirtualTableTests, test_table_results_cache) {
   statement = "SELECT i from table_cache;";
   queryInternal(statement, results, dbc);
   EXPECT_EQ(results.size(), 1U);
-  EXPECT_EQ(cache->generates_, 4U);
+  EXPECT_EQ(cache->generates_, 3U);
 
-  // Now with constraints that invalidate the cache results.
+  // Constraints on other columns are answered by the full scan.
+  results.clear();
+  statement = "SELECT i from table_cache where d = '';";
+  queryInternal(statement, results, dbc);
+  EXPECT_EQ(cache->generates_, 3U);
+
+  // A full scan does not answer constraints on an index column, the table may
+  // generate rows for the constraint that the scan did not list.
   results.clear();
   statement = "SELECT * from table_cache where i = '1';";
   queryInternal(statement, results, dbc);
   EXPECT_EQ(results.size(), 1U);
-  // The table should NOT have used the cache.
+  EXPECT_EQ(cache->generates_, 4U);
+
+  // The results are cached per constraint set.
+  results.clear();
+  queryInternal(statement, results, dbc);
+  EXPECT_EQ(results.size(), 1U);
+  EXPECT_EQ(cache->generates_, 4U);
+
+  results.clear();
+  statement = "SELECT * from table_cache where i = '2';";
+  queryInternal(statement, results, dbc);
+  EXPECT_EQ(results.size(), 0U);
   EXPECT_EQ(cache->generates_, 5U);
+
+  // Constrained results cannot answer a full scan.
+  TableResultCache::instance().clear();
+  results.clear();
+  statement = "SELECT * from table_cache where i = '1';";
+  queryInternal(statement, results, dbc);
+  EXPECT_EQ(cache->generates_, 6U);
+
+  results.clear();
+  statement = "SELECT * from table_cache;";
+  queryInternal(statement, results, dbc);
+  EXPECT_EQ(results.size(), 1U);
+  EXPECT_EQ(cache->generates_, 7U);
+
+  auto stats = TableResultCache::instance().stats();
+  auto table_stats = std::find_if(
+      stats.begin(), stats.end(), [](const TableCacheStats& table_stats) {
+        return table_stats.name == "table_cache";
+      });
+  ASSERT_NE(table_stats, stats.end());
+  EXPECT_EQ(table_stats->hits, 5U);
+  EXPECT_EQ(table_stats->misses, 5U);
+  EXPECT_EQ(table_stats->entries, 2U);
 }
 
 TEST_F(VirtualTableTests, test_table_results_cache_colcheck) {
@@ -636,6 +681,42 @@ TEST_F(VirtualTableTests, test_table_results_cache_colcheck) {
   EXPECT_EQ(cache->generates_, 2U);
 }
 
+TEST_F(VirtualTableTests, test_table_results_cache_eviction) {
+  auto tables = RegistryFactory::get().registry("table");
+  auto cache = std::make_shared<tableCacheTablePlugin>();
+  tables->add("table_cache_evict", cache);
+  auto dbc = SQLiteDBManager::getUnique();
+  attachTableInternal(
+      "table_cache_evict", cache->columnDefinition(false), dbc, false);
+  dbc->useCache(true);
+
+  auto max_rows = FLAGS_table_cache_max_rows;
+  FLAGS_table_cache_max_rows = 1;
+
+  QueryData results;
+  queryInternal(
+      "SELECT * from table_cache_evict where i = '1';", results, dbc);
+  EXPECT_EQ(cache->generates_, 1U);
+
+  // Caching another result set drops the least recently used one.
+  queryInternal(
+      "SELECT * from table_cache_evict where i = '2';", results, dbc);
+  EXPECT_EQ(cache->generates_, 2U);
+
+  queryInternal(
+      "SELECT * from table_cache_evict where i = '1';", results, dbc);
+  EXPECT_EQ(cache->generates_, 3U);
+
+  FLAGS_table_cache_max_rows = max_rows;
+
+  for (const auto& table_stats : TableResultCache::instance().stats()) {
+    if (table_stats.name == "table_cache_evict") {
+      EXPECT_EQ(table_stats.evictions, 2U);
+      EXPECT_EQ(table_stats.entries, 1U);
+    }
+  }
+}
+
 class yieldTablePlugin : public TablePlugin {
  private:
   TableColumns columns() const override {
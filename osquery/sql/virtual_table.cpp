@@ -836,6 +836,7 @@ static int xBestIndex(sqlite3_vtab* tab, sqlite3_index_info* pIdxInfo) {
   pVtab->content->constraints[pIdxInfo->idxNum] = std::move(constraints);
   pVtab->content->colsUsed[pIdxInfo->idxNum] = std::move(colsUsed);
   pVtab->content->colsUsedBitsets[pIdxInfo->idxNum] = colsUsedBitset;
+  pVtab->instance->addPlannedIndex(pVtab->content, pIdxInfo->idxNum);
   pIdxInfo->estimatedCost = cost;
 
   return SQLITE_OK;
@@ -861,6 +862,8 @@ static int xFilter(sqlite3_vtab_cursor* pVtabCursor,
 
   // The SQLite instance communicates to the TablePlugin via the context.
   context.useCache(pVtab->instance->useCache());
+  context.setCacheStep(pVtab->instance->cacheStep(),
+                       pVtab->instance->cacheInterval());
 
   // Track required columns, this is different than the requirements check
   // that occurs within BestIndex because this scan includes a cursor.
@@ -1094,6 +1097,9 @@ Status attachTableInternal(const std::string& name,
   // within xCreate.
   auto lock(instance->attachLock());
 
+  // Cached statements were planned without this table.
+  instance->clearStatementCache();
+
   int rc = sqlite3_create_module(
       instance->db(), name.c_str(), module, (void*)&(*instance));
 
@@ -1114,6 +1120,8 @@ Status attachTableInternal(const std::string& name,
 Status detachTableInternal(const std::string& name,
                            const SQLiteDBInstanceRef& instance) {
   auto lock(instance->attachLock());
+  // Cached statements may reference the table, they must be finalized first.
+  instance->clearStatementCache();
   auto format = "DROP TABLE IF EXISTS temp." + name;
   int rc = sqlite3_exec(instance->db(), format.c_str(), nullptr, nullptr, 0);
   if (rc != SQLITE_OK) {
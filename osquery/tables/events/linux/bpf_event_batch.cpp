@@ -0,0 +1,94 @@
+/**
+ * Copyright (c) 2014-present, The osquery authors
+ *
+ * This source code is licensed as defined by the LICENSE file found in the
+ * root directory of this source tree.
+ *
+ * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
+ */
+
+#include <osquery/core/flags.h>
+#include <osquery/tables/events/linux/bpf_event_batch.h>
+
+#include <iterator>
+
+namespace osquery {
+
+FLAG(uint32,
+     bpf_events_batch_latency,
+     1000U,
+     "Maximum number of milliseconds BPF event rows are held before being "
+     "stored (0 stores them right away)");
+
+HIDDEN_FLAG(uint32,
+            bpf_events_batch_max_rows,
+            4096U,
+            "Maximum number of BPF event rows held before being stored");
+
+BPFEventRowBatch::Limits BPFEventRowBatch::getDefaultLimits() {
+  Limits limits;
+  limits.max_row_count = FLAGS_bpf_events_batch_max_rows;
+  limits.max_latency =
+      std::chrono::milliseconds(FLAGS_bpf_events_batch_latency);
+
+  return limits;
+}
+
+void BPFEventRowBatch::append(std::vector<Row> row_list,
+                              Clock::time_point now) {
+  if (row_list.empty()) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+
+  if (pending_row_list.empty()) {
+    pending_row_list = std::move(row_list);
+    oldest_row_time = now;
+
+  } else {
+    pending_row_list.insert(pending_row_list.end(),
+                            std::make_move_iterator(row_list.begin()),
+                            std::make_move_iterator(row_list.end()));
+  }
+}
+
+bool BPFEventRowBatch::take(std::vector<Row>& row_list,
+                            const Limits& limits,
+                            Clock::time_point now) {
+  std::lock_guard<std::mutex> lock(mutex);
+
+  if (pending_row_list.empty()) {
+    return false;
+  }
+
+  if (pending_row_list.size() < limits.max_row_count &&
+      now - oldest_row_time < limits.max_latency) {
+    return false;
+  }
+
+  row_list = std::move(pending_row_list);
+  pending_row_list = {};
+
+  return true;
+}
+
+bool BPFEventRowBatch::takeAll(std::vector<Row>& row_list) {
+  std::lock_guard<std::mutex> lock(mutex);
+
+  if (pending_row_list.empty()) {
+    return false;
+  }
+
+  row_list = std::move(pending_row_list);
+  pending_row_list = {};
+
+  return true;
+}
+
+std::size_t BPFEventRowBatch::size() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return pending_row_list.size();
+}
+
+} // namespace osquery
@@ -0,0 +1,60 @@
+/**
+ * Copyright (c) 2014-present, The osquery authors
+ *
+ * This source code is licensed as defined by the LICENSE file found in the
+ * root directory of this source tree.
+ *
+ * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
+ */
+
+#pragma once
+
+#include <osquery/core/sql/row.h>
+
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+namespace osquery {
+
+/// \brief Holds the rows generated by a BPF event subscriber
+/// The BPF publisher fires the events it has collected, then calls the
+/// flush callback of its subscribers at every iteration of its loop. The
+/// subscribers append their rows here, and store them with a single
+/// database batch once enough rows are pending or once the oldest pending
+/// row has waited long enough
+class BPFEventRowBatch final {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  /// The bounds of a batch; a zero latency stores the rows right away
+  struct Limits final {
+    std::size_t max_row_count{};
+    std::chrono::milliseconds max_latency{};
+  };
+
+  /// Returns the limits set through the bpf_events_batch_* flags
+  static Limits getDefaultLimits();
+
+  /// Moves the given rows at the end of the batch
+  void append(std::vector<Row> row_list, Clock::time_point now);
+
+  /// Takes the pending rows, if one of the limits has been reached
+  bool take(std::vector<Row>& row_list,
+            const Limits& limits,
+            Clock::time_point now);
+
+  /// Takes the pending rows, regardless of the limits
+  bool takeAll(std::vector<Row>& row_list);
+
+  /// Returns the amount of pending rows
+  std::size_t size() const;
+
+ private:
+  mutable std::mutex mutex;
+
+  std::vector<Row> pending_row_list;
+  Clock::time_point oldest_row_time;
+};
+
+} // namespace osquery
@@ -21,19 +21,37 @@ REGISTER(BPFProcessEventSubscriber, "event_subscriber", "bpf_process_events");
 
 Status BPFProcessEventSubscriber::init() {
   auto subscription_context = createSubscriptionContext();
+  subscription_context->flush_callback = [this]() { storeRows(); };
   subscribe(&BPFProcessEventSubscriber::eventCallback, subscription_context);
 
   return Status::success();
 }
 
+void BPFProcessEventSubscriber::tearDown() {
+  std::vector<Row> row_list;
+  if (row_batch.takeAll(row_list)) {
+    addBatch(row_list);
+  }
+}
+
 Status BPFProcessEventSubscriber::eventCallback(const ECRef& event_context,
                                                 const SCRef&) {
-  auto row_list = generateRowList(event_context->event_list);
-  addBatch(row_list);
+  row_batch.append(generateRowList(event_context->event_list),
+                   BPFEventRowBatch::Clock::now());
 
+  storeRows();
   return Status::success();
 }
 
+void BPFProcessEventSubscriber::storeRows() {
+  std::vector<Row> row_list;
+  if (row_batch.take(row_list,
+                     BPFEventRowBatch::getDefaultLimits(),
+                     BPFEventRowBatch::Clock::now())) {
+    addBatch(row_list);
+  }
+}
+
 bool BPFProcessEventSubscriber::generateRow(
     Row& row, const ISystemStateTracker::Event& event) {
   row = {};
@@ -9,6 +9,7 @@
 
 #include <osquery/events/eventsubscriber.h>
 #include <osquery/events/linux/bpf/bpfeventpublisher.h>
+#include <osquery/tables/events/linux/bpf_event_batch.h>
 
 namespace osquery {
 
@@ -17,6 +18,7 @@ class BPFProcessEventSubscriber final
  public:
   virtual ~BPFProcessEventSubscriber() override = default;
   virtual Status init() override;
+  virtual void tearDown() override;
 
   Status eventCallback(const ECRef& event_context,
                        const SCRef& subscription_context);
@@ -31,6 +33,13 @@ class BPFProcessEventSubscriber final
 
   static std::string generateJsonCmdlineColumn(
       const std::vector<std::string>& argv);
+
+ private:
+  /// Stores the pending rows, once one of the batch limits is reached
+  void storeRows();
+
+  /// Rows waiting to be stored with the next database batch
+  BPFEventRowBatch row_batch;
 };
 
 } // namespace osquery
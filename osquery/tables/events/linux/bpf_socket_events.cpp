@@ -18,19 +18,37 @@ REGISTER(BPFSocketEventSubscriber, "event_subscriber", "bpf_socket_events");
 
 Status BPFSocketEventSubscriber::init() {
   auto subscription_context = createSubscriptionContext();
+  subscription_context->flush_callback = [this]() { storeRows(); };
   subscribe(&BPFSocketEventSubscriber::eventCallback, subscription_context);
 
   return Status::success();
 }
 
+void BPFSocketEventSubscriber::tearDown() {
+  std::vector<Row> row_list;
+  if (row_batch.takeAll(row_list)) {
+    addBatch(row_list);
+  }
+}
+
 Status BPFSocketEventSubscriber::eventCallback(const ECRef& event_context,
                                                const SCRef&) {
-  auto row_list = generateRowList(event_context->event_list);
-  addBatch(row_list);
+  row_batch.append(generateRowList(event_context->event_list),
+                   BPFEventRowBatch::Clock::now());
 
+  storeRows();
   return Status::success();
 }
 
+void BPFSocketEventSubscriber::storeRows() {
+  std::vector<Row> row_list;
+  if (row_batch.take(row_list,
+                     BPFEventRowBatch::getDefaultLimits(),
+                     BPFEventRowBatch::Clock::now())) {
+    addBatch(row_list);
+  }
+}
+
 bool BPFSocketEventSubscriber::generateRow(
     Row& row, const ISystemStateTracker::Event& event) {
   row = {};
@@ -235,7 +235,7 @@ std::string NormalizePath(const std::string& cwd,
 };
 
 bool EmitRowFromSyscallContext(
-    Row& row,
+    EventRowList& row_list,
     const AuditdFimContext& fim_context,
     const AuditdFimSyscallContext& syscall_context) noexcept {
   auto L_IsPathIncluded = [&fim_context](const std::string& path) -> bool {
@@ -244,30 +244,33 @@ bool EmitRowFromSyscallContext(
                       path) != fim_context.included_path_list.end());
   };
 
-  row.clear();
   bool is_write_operation = false;
 
   if (!FLAGS_audit_show_partial_fim_events && syscall_context.partial) {
     return false;
   }
 
+  const char* operation = nullptr;
+  const std::string* path = nullptr;
+  const std::string* dest_path = nullptr;
+
   switch (syscall_context.type) {
   case AuditdFimSyscallContext::Type::Symlink:
   case AuditdFimSyscallContext::Type::Rename:
   case AuditdFimSyscallContext::Type::Link: {
     if (syscall_context.type == AuditdFimSyscallContext::Type::Symlink) {
-      row["operation"] = "symlink";
+      operation = "symlink";
     } else if (syscall_context.type == AuditdFimSyscallContext::Type::Rename) {
-      row["operation"] = "rename";
+      operation = "rename";
     } else {
-      row["operation"] = "link";
+      operation = "link";
     }
 
     const auto& data =
         boost::get<AuditdFimSrcDestData>(syscall_context.syscall_data);
 
-    row["path"] = data.source;
-    row["dest_path"] = data.destination;
+    path = &data.source;
+    dest_path = &data.destination;
 
     is_write_operation = true;
     break;
@@ -289,28 +292,28 @@ bool EmitRowFromSyscallContext(
     }
 
     if (data.type == AuditdFimIOData::Type::Open) {
-      row["operation"] = "open";
+      operation = "open";
 
     } else if (data.type == AuditdFimIOData::Type::OpenTruncate) {
-      row["operation"] = "open+truncate";
+      operation = "open+truncate";
       is_write_operation = true;
 
     } else if (data.type == AuditdFimIOData::Type::Read) {
-      row["operation"] = "read";
+      operation = "read";
 
     } else if (data.type == AuditdFimIOData::Type::Write) {
-      row["operation"] = "write";
+      operation = "write";
       is_write_operation = true;
 
     } else if (data.type == AuditdFimIOData::Type::Unlink) {
-      row["operation"] = "unlink";
+      operation = "unlink";
       is_write_operation = true;
 
     } else {
-      row["operation"] = "close";
+      operation = "close";
     }
 
-    row["path"] = data.target;
+    path = &data.target;
     break;
   }
 
@@ -321,10 +324,10 @@ bool EmitRowFromSyscallContext(
   }
   }
 
-  // Filter the events
-  bool include_event = L_IsPathIncluded(row["path"]);
-  if (!include_event && row.find("dest_path") != row.end()) {
-    include_event = L_IsPathIncluded(row["dest_path"]);
+  // Filter the events before emitting anything
+  bool include_event = L_IsPathIncluded(*path);
+  if (!include_event && dest_path != nullptr) {
+    include_event = L_IsPathIncluded(*dest_path);
   }
 
   if (!include_event) {
@@ -335,43 +338,53 @@ bool EmitRowFromSyscallContext(
     return false;
   }
 
-  row["pid"] =
-      std::to_string(static_cast<std::uint64_t>(syscall_context.process_id));
+  row_list.addRow();
+  row_list.setColumn("operation", operation);
+  row_list.setColumn("path", *path);
+  if (dest_path != nullptr) {
+    row_list.setColumn("dest_path", *dest_path);
+  }
+
+  row_list.setColumn("pid",
+                     static_cast<std::uint64_t>(syscall_context.process_id));
 
-  row["ppid"] = std::to_string(
-      static_cast<std::uint64_t>(syscall_context.parent_process_id));
+  row_list.setColumn(
+      "ppid", static_cast<std::uint64_t>(syscall_context.parent_process_id));
 
-  row["uid"] =
-      std::to_string(static_cast<std::uint64_t>(syscall_context.process_uid));
+  row_list.setColumn("uid",
+                     static_cast<std::uint64_t>(syscall_context.process_uid));
 
-  row["auid"] =
-      std::to_string(static_cast<std::uint64_t>(syscall_context.process_auid));
+  row_list.setColumn("auid",
+                     static_cast<std::uint64_t>(syscall_context.process_auid));
 
-  row["euid"] =
-      std::to_string(static_cast<std::uint64_t>(syscall_context.process_euid));
+  row_list.setColumn("euid",
+                     static_cast<std::uint64_t>(syscall_context.process_euid));
 
-  row["fsuid"] =
-      std::to_string(static_cast<std::uint64_t>(syscall_context.process_fsuid));
+  row_list.setColumn(
+      "fsuid", static_cast<std::uint64_t>(syscall_context.process_fsuid));
 
-  row["suid"] =
-      std::to_string(static_cast<std::uint64_t>(syscall_context.process_suid));
+  row_list.setColumn("suid",
+                     static_cast<std::uint64_t>(syscall_context.process_suid));
 
-  row["gid"] =
-      std::to_string(static_cast<std::uint64_t>(syscall_context.process_gid));
+  row_list.setColumn("gid",
+                     static_cast<std::uint64_t>(syscall_context.process_gid));
 
-  row["egid"] =
-      std::to_string(static_cast<std::uint64_t>(syscall_context.process_egid));
+  row_list.setColumn("egid",
+                     static_cast<std::uint64_t>(syscall_context.process_egid));
 
-  row["fsgid"] =
-      std::to_string(static_cast<std::uint64_t>(syscall_context.process_fsgid));
+  row_list.setColumn(
+      "fsgid", static_cast<std::uint64_t>(syscall_context.process_fsgid));
 
-  row["sgid"] =
-      std::to_string(static_cast<std::uint64_t>(syscall_context.process_sgid));
+  row_list.setColumn("sgid",
+                     static_cast<std::uint64_t>(syscall_context.process_sgid));
 
-  row["executable"] = syscall_context.executable_path;
-  row["partial"] = (syscall_context.partial ? "true" : "false");
-  row["cwd"] = syscall_context.cwd;
-  row["uptime"] = std::to_string(getUptime());
+  row_list.setColumn("executable", syscall_context.executable_path);
+  row_list.setColumn("partial", syscall_context.partial ? "true" : "false");
+  row_list.setColumn("cwd", syscall_context.cwd);
+
+  if (row_list.isStored("uptime")) {
+    row_list.setColumn("uptime", getUptime());
+  }
 
   return true;
 }
@@ -1202,22 +1215,25 @@ void ProcessFileEventSubscriber::configure() {
 
 Status ProcessFileEventSubscriber::Callback(const ECRef& event_context,
                                             const SCRef& subscription_context) {
-  std::vector<Row> emitted_row_list;
-  auto exit_status =
-      ProcessEvents(emitted_row_list, context_, event_context->audit_events);
+  // The row list buffers are reused across callbacks
+  emitted_row_list_.setExcludedColumns(getExcludedColumns());
+
+  auto exit_status = ProcessEvents(
+      emitted_row_list_, context_, event_context->audit_events);
+
+  if (!emitted_row_list_.empty()) {
+    addBatch(emitted_row_list_);
+  }
 
-  addBatch(emitted_row_list);
   return exit_status;
 }
 
 Status ProcessFileEventSubscriber::ProcessEvents(
-    std::vector<Row>& emitted_row_list,
+    EventRowList& emitted_row_list,
     AuditdFimContext& fim_context,
     const std::vector<AuditEvent>& event_list) noexcept {
   emitted_row_list.clear();
 
-  emitted_row_list.reserve(event_list.size());
-
   auto L_ShouldHandle = [](std::uint64_t syscall_number) -> bool {
     const auto& syscall_set = ProcessFileEventSubscriber::GetSyscallSet();
     return (syscall_set.find(static_cast<int>(syscall_number)) !=
@@ -1325,11 +1341,7 @@ Status ProcessFileEventSubscriber::ProcessEvents(
     }
 
     if (!skip_row_emission) {
-      Row row;
-
-      if (EmitRowFromSyscallContext(row, fim_context, syscall_context)) {
-        emitted_row_list.push_back(row);
-      }
+      EmitRowFromSyscallContext(emitted_row_list, fim_context, syscall_context);
     }
   }
 
@@ -295,7 +295,7 @@ class ProcessFileEventSubscriber final
 
   /// Processes the given events, updating the tracing context
   static Status ProcessEvents(
-      std::vector<Row>& emitted_row_list,
+      EventRowList& emitted_row_list,
       AuditdFimContext& fim_context,
       const std::vector<AuditEvent>& event_list) noexcept;
 
@@ -305,5 +305,8 @@ class ProcessFileEventSubscriber final
  private:
   /// This structure holds information like handle and inode maps
   AuditdFimContext context_;
+
+  /// The rows emitted by the last callback, reused to avoid allocations
+  EventRowList emitted_row_list_;
 };
 } // namespace osquery
@@ -0,0 +1,102 @@
+/**
+ * Copyright (c) 2014-present, The osquery authors
+ *
+ * This source code is licensed as defined by the LICENSE file found in the
+ * root directory of this source tree.
+ *
+ * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
+ */
+
+#include <gtest/gtest.h>
+
+#include <osquery/tables/events/linux/bpf_event_batch.h>
+
+namespace osquery {
+
+namespace {
+
+std::vector<Row> generateRowList(std::size_t row_count) {
+  std::vector<Row> row_list;
+
+  for (std::size_t i = 0U; i < row_count; ++i) {
+    Row row;
+    row["pid"] = std::to_string(i);
+
+    row_list.push_back(std::move(row));
+  }
+
+  return row_list;
+}
+
+} // namespace
+
+class BPFEventBatchTests : public testing::Test {};
+
+TEST_F(BPFEventBatchTests, rowCountLimit) {
+  BPFEventRowBatch::Limits limits;
+  limits.max_row_count = 10U;
+  limits.max_latency = std::chrono::milliseconds(1000);
+
+  auto now = BPFEventRowBatch::Clock::now();
+
+  BPFEventRowBatch row_batch;
+  row_batch.append(generateRowList(6U), now);
+
+  std::vector<Row> row_list;
+  EXPECT_FALSE(row_batch.take(row_list, limits, now));
+
+  row_batch.append(generateRowList(6U), now);
+  EXPECT_EQ(row_batch.size(), 12U);
+
+  ASSERT_TRUE(row_batch.take(row_list, limits, now));
+  ASSERT_EQ(row_list.size(), 12U);
+  EXPECT_EQ(row_list.at(0).at("pid"), "0");
+  EXPECT_EQ(row_list.at(6).at("pid"), "0");
+  EXPECT_EQ(row_list.at(11).at("pid"), "5");
+
+  EXPECT_EQ(row_batch.size(), 0U);
+  EXPECT_FALSE(row_batch.take(row_list, limits, now));
+}
+
+TEST_F(BPFEventBatchTests, latencyLimit) {
+  BPFEventRowBatch::Limits limits;
+  limits.max_row_count = 1000U;
+  limits.max_latency = std::chrono::milliseconds(1000);
+
+  auto now = BPFEventRowBatch::Clock::now();
+
+  BPFEventRowBatch row_batch;
+  row_batch.append(generateRowList(1U), now);
+
+  // The latency is measured from the oldest pending row
+  now += std::chrono::milliseconds(600);
+  row_batch.append(generateRowList(1U), now);
+
+  std::vector<Row> row_list;
+  EXPECT_FALSE(row_batch.take(row_list, limits, now));
+
+  now += std::chrono::milliseconds(400);
+  ASSERT_TRUE(row_batch.take(row_list, limits, now));
+  EXPECT_EQ(row_list.size(), 2U);
+
+  // Without a latency, rows are taken right away
+  limits.max_latency = std::chrono::milliseconds(0);
+
+  row_batch.append(generateRowList(1U), now);
+  ASSERT_TRUE(row_batch.take(row_list, limits, now));
+  EXPECT_EQ(row_list.size(), 1U);
+}
+
+TEST_F(BPFEventBatchTests, takeAll) {
+  BPFEventRowBatch row_batch;
+
+  std::vector<Row> row_list;
+  EXPECT_FALSE(row_batch.takeAll(row_list));
+
+  row_batch.append(generateRowList(3U), BPFEventRowBatch::Clock::now());
+  ASSERT_TRUE(row_batch.takeAll(row_list));
+  EXPECT_EQ(row_list.size(), 3U);
+  EXPECT_EQ(row_batch.size(), 0U);
+}
+
+} // namespace osquery
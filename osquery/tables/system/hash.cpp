@@ -16,19 +16,30 @@
 #include <unistd.h>
 #endif
 
+#include <algorithm>
+#include <atomic>
+#include <mutex>
 #include <set>
+#include <system_error>
 #include <thread>
+#include <unordered_map>
+#include <vector>
 
 #include <boost/filesystem.hpp>
 
 #include <osquery/core/flags.h>
+#include <osquery/database/database.h>
 #include <osquery/filesystem/filesystem.h>
 #include <osquery/hashing/hashing.h>
 #include <osquery/logger/logger.h>
+#include <osquery/profiler/resource_usage.h>
 #include <osquery/core/tables.h>
 #include <osquery/sql/dynamic_table_row.h>
+#include <osquery/tables/system/hash.h>
+#include <osquery/utils/json/json.h>
 #include <osquery/utils/mutex.h>
 #include <osquery/utils/info/platform_type.h>
+#include <osquery/utils/system/time.h>
 #include <osquery/worker/ipc/platform_table_container_ipc.h>
 #include <osquery/worker/logging/glog/glog_logger.h>
 #include <osquery/worker/logging/logger.h>
@@ -42,100 +53,182 @@ FLAG(bool,
 
 FLAG(uint32, hash_cache_max, 500, "Size of LRU file hash cache");
 
+FLAG(bool,
+     hash_cache_persist,
+     false,
+     "Store cached file hashes in the database to reuse them after a restart");
+
 HIDDEN_FLAG(uint32,
             hash_delay,
             20,
             "Number of milliseconds to delay after hashing");
 
+FLAG(uint32,
+     hash_threads,
+     1,
+     "Number of threads hashing the files of a hash table query");
+
 DECLARE_uint64(read_max);
 
 namespace tables {
 
-/// Clear this amount of rows every time cache eviction is triggered.
-const size_t kHashCacheEvictSize{5};
+/// Number of independently locked shards of the file hash cache.
+const size_t kHashCacheShards{16};
 
-/**
- * @brief Implements persistent in-memory caching of files' hashes.
- *
- * This cache has LRU eviction policy. The hash is recalculated
- * every time the mtime or size of the file changes.
- */
-struct FileHashCache {
-  /// The file's modification time, changes with a touch.
-  time_t file_mtime;
+const std::string kHashCachePrefix{"hash_cache."};
 
-  /// The file's serial or information number (inode).
-  ino_t file_inode;
+/// Persisted hashes that were not used for a week are removed.
+const std::uint64_t kHashCacheExpiry{604800};
 
-  /// The file's size.
-  off_t file_size;
+/// The last use of persisted hashes is recorded at most once a day.
+const std::uint64_t kHashCacheRefresh{86400};
 
-  /// For eviction, the last time this cache item was used.
-  time_t cache_access_time;
+#if defined(WIN32)
 
-  /// Cache content, the hashes.
-  MultiHashes hashes;
+#define stat _stat
+#define strerror_r(e, buf, sz) strerror_s((buf), (sz), (e))
 
-  /// Cache index, the file path.
-  std::string path;
+#endif
+
+namespace {
 
-  /// Comparison function for organizing the LRU heap.
-  static bool greater(const FileHashCache* l, const FileHashCache* r) {
-    return l->cache_access_time > r->cache_access_time;
+std::string persistedKey(const FileHashIdentity& identity) {
+  return kHashCachePrefix + std::to_string(identity.device) + "." +
+         std::to_string(identity.inode) + "." +
+         std::to_string(identity.mtime) + "." + std::to_string(identity.size);
+}
+
+std::string serializeHashes(const MultiHashes& hashes, std::uint64_t time) {
+  auto doc = JSON::newObject();
+  doc.add("time", time);
+  doc.add("mask", hashes.mask);
+  doc.add("md5", hashes.md5);
+  doc.add("sha1", hashes.sha1);
+  doc.add("sha256", hashes.sha256);
+
+  std::string value;
+  doc.toString(value);
+  return value;
+}
+
+bool deserializeHashes(const std::string& value,
+                       MultiHashes& hashes,
+                       std::uint64_t& time) {
+  JSON doc;
+  if (!doc.fromString(value) || !doc.doc().IsObject()) {
+    return false;
   }
 
-  /**
-   * @brief Do-it-all access function.
-   *
-   * Maintains the cache of hash sums, stats file at path, if it has changed or
-   * it is not present in cache calculates the hashes and caches the result.
-   *
-   * @param path the path of file to hash.
-   * @param out stores the calculated hashes.
-   *
-   * @return true if succeeded, false if something went wrong.
-   */
-  static bool load(const std::string& path, MultiHashes& out, Logger& logger);
-};
+  const auto& obj = doc.doc();
+  if (!obj.HasMember("time") || !obj["time"].IsUint64() ||
+      !obj.HasMember("mask") || !obj["mask"].IsInt()) {
+    return false;
+  }
 
-#if defined(WIN32)
+  time = obj["time"].GetUint64();
+  hashes.mask = obj["mask"].GetInt();
+  for (auto digest : {std::make_pair("md5", &hashes.md5),
+                      std::make_pair("sha1", &hashes.sha1),
+                      std::make_pair("sha256", &hashes.sha256)}) {
+    if (!obj.HasMember(digest.first) || !obj[digest.first].IsString()) {
+      return false;
+    }
+    *digest.second = obj[digest.first].GetString();
+  }
 
-#define stat _stat
-#define strerror_r(e, buf, sz) strerror_s((buf), (sz), (e))
+  return true;
+}
 
-#endif
+} // namespace
 
-/**
- * @brief Checks the current stat output against the cached view.
- *
- * If the modified/altered time or the file's inode has changed then the hash
- * should be recalculated.
- */
-static inline bool statInvalid(const struct stat& st, const FileHashCache& fh) {
-  if (st.st_ino != fh.file_inode || st.st_mtime != fh.file_mtime) {
-    // Most plausible case for modification detection.
-    return true;
+FileHashCache& FileHashCache::instance() {
+  static FileHashCache cache;
+  return cache;
+}
+
+FileHashCache::FileHashCache() {
+  for (size_t i = 0; i < kHashCacheShards; i++) {
+    shards_.push_back(std::make_unique<Shard>());
+  }
+  clear();
+}
+
+void FileHashCache::clear() {
+  auto capacity = std::max<size_t>(1, FLAGS_hash_cache_max / kHashCacheShards);
+  for (auto& shard : shards_) {
+    WriteLock lock(shard->mutex);
+    shard->entries =
+        std::make_unique<caches::LRU<std::string, Entry>>(capacity);
+  }
+}
+
+void FileHashCache::expirePersisted() {
+  std::vector<std::string> keys;
+  scanDatabaseKeys(kPersistentSettings, keys, kHashCachePrefix);
+
+  auto now = getUnixTime();
+  for (const auto& key : keys) {
+    std::string value;
+    MultiHashes hashes;
+    std::uint64_t time = 0;
+    if (getDatabaseValue(kPersistentSettings, key, value).ok() &&
+        deserializeHashes(value, hashes, time) &&
+        time + kHashCacheExpiry > now) {
+      continue;
+    }
+
+    deleteDatabaseValue(kPersistentSettings, key);
+  }
+}
+
+FileHashCache::Shard& FileHashCache::shard(const std::string& path) {
+  return *shards_[std::hash<std::string>()(path) % shards_.size()];
+}
+
+MultiHashes FileHashCache::hash(const std::string& path,
+                                int mask,
+                                const FileHashIdentity& identity) {
+  if (FLAGS_hash_cache_persist) {
+    // Hashes of files changed or removed while not running are collected.
+    static std::once_flag expire_once;
+    std::call_once(expire_once, &FileHashCache::expirePersisted);
+  }
+
+  MultiHashes hashes;
+  std::string value;
+  std::uint64_t time = 0;
+  auto now = getUnixTime();
+  if (FLAGS_hash_cache_persist &&
+      getDatabaseValue(kPersistentSettings, persistedKey(identity), value)
+          .ok() &&
+      deserializeHashes(value, hashes, time)) {
+    if (hasDigests(hashes, mask)) {
+      if (time + kHashCacheRefresh <= now) {
+        setDatabaseValue(kPersistentSettings,
+                         persistedKey(identity),
+                         serializeHashes(hashes, now));
+      }
+      return hashes;
+    }
+
+    // Also compute the stored digests so they are kept.
+    mask |= hashes.mask;
   }
 
-  if (st.st_size != fh.file_size) {
-    // Just in case there's tomfoolery.
-    return true;
+  hashes = hashMultiFromFile(mask, path);
+  if (FLAGS_hash_cache_persist && hashes.mask != 0) {
+    setDatabaseValue(kPersistentSettings,
+                     persistedKey(identity),
+                     serializeHashes(hashes, now));
   }
-  return false;
+
+  return hashes;
 }
 
 bool FileHashCache::load(const std::string& path,
+                         int mask,
                          MultiHashes& out,
                          Logger& logger) {
-  // synchronize the access to cache
-  static Mutex mx;
-  // path => cache entry
-  static std::unordered_map<std::string, FileHashCache> cache;
-  // minheap on cache_access_time
-  static std::vector<FileHashCache*> lru;
-
-  WriteLock guard(mx);
-
   struct stat st;
   if (stat(path.c_str(), &st) != 0) {
     char buf[0x200] = {0};
@@ -144,85 +237,203 @@ bool FileHashCache::load(const std::string& path,
     return false;
   }
 
-  auto entry = cache.find(path);
-  if (entry == cache.end()) { // none, load
-    if (cache.size() >= FLAGS_hash_cache_max) {
-      // too large, evict
-      for (size_t i = 0; i < kHashCacheEvictSize; ++i) {
-        if (lru.empty()) {
-          continue;
-        }
-        std::string key = lru[0]->path;
-        std::pop_heap(lru.begin(), lru.end(), FileHashCache::greater);
-        lru.pop_back();
-        if (cache.find(key) != cache.end()) {
-          cache.erase(key);
-        }
+  FileHashIdentity identity;
+  identity.device = static_cast<std::uint64_t>(st.st_dev);
+  identity.inode = static_cast<std::uint64_t>(st.st_ino);
+  identity.mtime = static_cast<std::int64_t>(st.st_mtime);
+  identity.size = static_cast<std::int64_t>(st.st_size);
+
+  auto& cache = shard(path);
+  std::promise<MultiHashes> promise;
+  FileHashIdentity replaced;
+  bool replacing{false};
+  {
+    WriteLock lock(cache.mutex);
+    auto entry = cache.entries->get(path);
+    if (entry != nullptr && entry->identity == identity) {
+      if (hasDigests(entry->hashes, mask)) {
+        out = entry->hashes;
+        return true;
       }
+
+      // Keep the cached digests when adding the requested ones.
+      mask |= entry->hashes.mask;
+    } else if (entry != nullptr) {
+      replaced = entry->identity;
+      replacing = true;
+    }
+
+    auto in_flight = cache.in_flight.find(path);
+    if (in_flight != cache.in_flight.end() &&
+        in_flight->second.identity == identity &&
+        (in_flight->second.mask & mask) == mask) {
+      auto hashes = in_flight->second.hashes;
+      lock.unlock();
+      out = hashes.get();
+      return true;
     }
 
-    auto hashes = hashMultiFromFile(
-        HASH_TYPE_MD5 | HASH_TYPE_SHA1 | HASH_TYPE_SHA256, path);
-    FileHashCache rec = {st.st_mtime, // .file_mtime
-                         st.st_ino, // .file_inode
-                         st.st_size, // .file_size
-                         time(nullptr), // .cache_access_time
-                         std::move(hashes), // .hashes
-                         path}; // .path
-    cache[path] = std::move(rec);
-    lru.push_back(&cache[path]);
-    std::push_heap(lru.begin(), lru.end(), FileHashCache::greater);
-    out = cache[path].hashes;
-  } else if (statInvalid(st, entry->second)) { // changed, update
-    auto hashes = hashMultiFromFile(
-        HASH_TYPE_MD5 | HASH_TYPE_SHA1 | HASH_TYPE_SHA256, path);
-    entry->second.cache_access_time = time(nullptr);
-    entry->second.file_inode = st.st_ino;
-    entry->second.file_mtime = st.st_mtime;
-    entry->second.file_size = st.st_size;
-    entry->second.hashes = std::move(hashes);
-    std::make_heap(lru.begin(), lru.end(), FileHashCache::greater);
-    out = entry->second.hashes;
-  } else { // ok, got it
-    out = entry->second.hashes;
-    entry->second.cache_access_time = time(nullptr);
-    std::make_heap(lru.begin(), lru.end(), FileHashCache::greater);
+    // Nothing is hashing this version of the file with the digests needed.
+    cache.in_flight[path] = {identity, mask, promise.get_future().share()};
+  }
+
+  // Hash without holding the shard lock.
+  out = hash(path, mask, identity);
+  if (replacing && FLAGS_hash_cache_persist) {
+    deleteDatabaseValue(kPersistentSettings, persistedKey(replaced));
   }
+
+  WriteLock lock(cache.mutex);
+  cache.entries->insert(path, {identity, out});
+  auto in_flight = cache.in_flight.find(path);
+  if (in_flight != cache.in_flight.end() &&
+      in_flight->second.identity == identity &&
+      in_flight->second.mask == mask) {
+    cache.in_flight.erase(in_flight);
+  }
+  promise.set_value(out);
   return true;
 }
 
-void genHashForFile(const std::string& path,
-                    const std::string& dir,
+/// Serializes the messages logged by the hashing threads.
+class SynchronizedLogger : public Logger {
+ public:
+  explicit SynchronizedLogger(Logger& logger) : logger_(logger) {}
+
+  void log(int severity, const std::string& message) override {
+    WriteLock lock(mutex_);
+    logger_.log(severity, message);
+  }
+
+  void vlog(int severity, const std::string& message) override {
+    WriteLock lock(mutex_);
+    logger_.vlog(severity, message);
+  }
+
+ private:
+  Logger& logger_;
+  Mutex mutex_;
+};
+
+/// A file to hash, targets are kept in the order rows are generated.
+struct HashTarget {
+  std::string path;
+  std::string directory;
+  MultiHashes hashes{};
+};
+
+/// Return the digests of the hash columns used by the query.
+int usedDigests(const QueryContext& context) {
+  int mask = 0;
+  if (context.isColumnUsed("md5")) {
+    mask |= HASH_TYPE_MD5;
+  }
+  if (context.isColumnUsed("sha1")) {
+    mask |= HASH_TYPE_SHA1;
+  }
+  if (context.isColumnUsed("sha256")) {
+    mask |= HASH_TYPE_SHA256;
+  }
+  return mask;
+}
+
+/**
+ * @brief Hash every target, using up to --hash_threads threads.
+ *
+ * A path listed more than once is hashed once. If the global hash cache is
+ * disabled, the inner-query cache is used instead. This protects against
+ * hashing the same content twice in the same query.
+ */
+void hashTargets(std::vector<HashTarget>& targets,
+                 int mask,
+                 QueryContext& context,
+                 Logger& logger) {
+  if (mask == 0) {
+    return;
+  }
+
+  std::vector<size_t> pending;
+  std::unordered_map<std::string, size_t> first_targets;
+  for (size_t i = 0; i < targets.size(); i++) {
+    auto& target = targets[i];
+    if (FLAGS_disable_hash_cache && context.isCached(target.path)) {
+      auto tr = context.getCache(target.path);
+      auto& r = *dynamic_cast<DynamicTableRow*>(tr.get());
+      target.hashes.md5 = r["md5"];
+      target.hashes.sha1 = r["sha1"];
+      target.hashes.sha256 = r["sha256"];
+    } else if (first_targets.emplace(target.path, i).second) {
+      pending.push_back(i);
+    }
+  }
+
+  SynchronizedLogger synchronized_logger(logger);
+  std::atomic<size_t> next_target{0};
+  auto worker = [&]() {
+    while (true) {
+      auto i = next_target++;
+      if (i >= pending.size()) {
+        break;
+      }
+
+      auto& target = targets[pending[i]];
+      if (!FLAGS_disable_hash_cache) {
+        FileHashCache::instance().load(
+            target.path, mask, target.hashes, synchronized_logger);
+      } else {
+        target.hashes = hashMultiFromFile(mask, target.path);
+        std::this_thread::sleep_for(
+            std::chrono::milliseconds(FLAGS_hash_delay));
+      }
+    }
+  };
+
+  auto thread_count = std::min<size_t>(FLAGS_hash_threads, pending.size());
+  // The CPU time of the helper threads is part of the query's cost.
+  auto helper_cpu_time = getHelperCpuTime();
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < thread_count; i++) {
+    try {
+      threads.emplace_back([&worker, helper_cpu_time]() {
+        ScopedHelperCpuTime scoped_cpu_time(helper_cpu_time);
+        worker();
+      });
+    } catch (const std::system_error& e) {
+      // The calling thread hashes the remaining files.
+      VLOG(1) << "Cannot start a hashing thread: " << e.what();
+      break;
+    }
+  }
+
+  worker();
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  // Copy the hashes of the paths listed more than once.
+  for (size_t i = 0; i < targets.size(); i++) {
+    auto first = first_targets.find(targets[i].path);
+    if (first != first_targets.end() && first->second != i) {
+      targets[i].hashes = targets[first->second].hashes;
+    }
+  }
+}
+
+void genHashForFile(HashTarget& target,
                     QueryContext& context,
-                    QueryData& results,
-                    Logger& logger) {
+                    QueryData& results) {
   // Must provide the path, filename, directory separate from boost path->string
   // helpers to match any explicit (query-parsed) predicate constraints.
   auto tr = TableRowHolder(new DynamicTableRow());
-  MultiHashes hashes;
-  if (!FLAGS_disable_hash_cache) {
-    FileHashCache::load(path, hashes, logger);
-  } else {
-    if (context.isCached(path)) {
-      // Use the inner-query cache if the global hash cache is disabled.
-      // This protects against hashing the same content twice in the same query.
-      tr = context.getCache(path);
-    } else {
-      hashes = hashMultiFromFile(
-          HASH_TYPE_MD5 | HASH_TYPE_SHA1 | HASH_TYPE_SHA256, path);
-      std::this_thread::sleep_for(std::chrono::milliseconds(FLAGS_hash_delay));
-    }
-  }
-
   DynamicTableRow& r = *dynamic_cast<DynamicTableRow*>(tr.get());
-  r["path"] = path;
-  r["directory"] = dir;
-  r["md5"] = std::move(hashes.md5);
-  r["sha1"] = std::move(hashes.sha1);
-  r["sha256"] = std::move(hashes.sha256);
+  r["path"] = target.path;
+  r["directory"] = target.directory;
+  r["md5"] = std::move(target.hashes.md5);
+  r["sha1"] = std::move(target.hashes.sha1);
+  r["sha256"] = std::move(target.hashes.sha256);
 
   if (FLAGS_disable_hash_cache) {
-    context.setCache(path, tr);
+    context.setCache(target.path, tr);
   }
 
   r["pid_with_namespace"] = "0";
@@ -260,15 +471,15 @@ QueryData genHashImpl(QueryContext& context, Logger& logger) {
   auto paths = context.constraints["path"].getAll(EQUALS);
   expandFSPathConstraints(context, "path", paths);
 
-  // Iterate through the file paths, adding the hash results
+  // Iterate through the file paths, adding the hash targets
+  std::vector<HashTarget> targets;
   for (const auto& path_string : paths) {
     boost::filesystem::path path = path_string;
     if (!boost::filesystem::is_regular_file(path, ec)) {
       continue;
     }
 
-    genHashForFile(
-        path_string, path.parent_path().string(), context, results, logger);
+    targets.push_back({path_string, path.parent_path().string()});
   }
 
   // Now loop through constraints using the directory column constraint.
@@ -287,12 +498,17 @@ QueryData genHashImpl(QueryContext& context, Logger& logger) {
     boost::filesystem::directory_iterator begin(directory), end;
     for (; begin != end; ++begin) {
       if (boost::filesystem::is_regular_file(begin->path(), ec)) {
-        genHashForFile(
-            begin->path().string(), directory_string, context, results, logger);
+        targets.push_back({begin->path().string(), directory_string});
       }
     }
   }
 
+  // Only compute the digests of the used columns.
+  hashTargets(targets, usedDigests(context), context, logger);
+  for (auto& target : targets) {
+    genHashForFile(target, context, results);
+  }
+
   return results;
 }
 
@@ -0,0 +1,128 @@
+/**
+ * Copyright (c) 2014-present, The osquery authors
+ *
+ * This source code is licensed as defined by the LICENSE file found in the
+ * root directory of this source tree.
+ *
+ * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+
+#include <osquery/hashing/hashing.h>
+#include <osquery/utils/caches/lru.h>
+#include <osquery/utils/mutex.h>
+#include <osquery/worker/logging/logger.h>
+
+namespace osquery {
+namespace tables {
+
+/// Key prefix for file hashes persisted by the hash cache.
+extern const std::string kHashCachePrefix;
+
+/// Return true if the hashes include every digest of a HashType mask.
+inline bool hasDigests(const MultiHashes& hashes, int mask) {
+  return (hashes.mask & mask) == mask;
+}
+
+/// The stat details of a file, its hashes are computed again if any changes.
+struct FileHashIdentity {
+  std::uint64_t device{0};
+  std::uint64_t inode{0};
+  std::int64_t mtime{0};
+  std::int64_t size{0};
+
+  bool operator==(const FileHashIdentity& other) const {
+    return device == other.device && inode == other.inode &&
+           mtime == other.mtime && size == other.size;
+  }
+
+  bool operator!=(const FileHashIdentity& other) const {
+    return !(*this == other);
+  }
+};
+
+/**
+ * @brief Implements persistent in-memory caching of files' hashes.
+ *
+ * Paths are spread over shards, each an LRU cache with its own lock. Files
+ * are hashed without holding a lock, concurrent loads of the same file wait
+ * for the first one to complete. The hash is recalculated every time the
+ * device, inode, mtime or size of the file changes, or when a digest missing
+ * from the cached hashes is requested.
+ *
+ * If --hash_cache_persist is set, hashes are also stored in the database,
+ * keyed by the file's identity, so they survive a restart.
+ */
+class FileHashCache : private boost::noncopyable {
+ public:
+  /// Get the process-wide file hash cache.
+  static FileHashCache& instance();
+
+  /**
+   * @brief Do-it-all access function.
+   *
+   * Stats the file at path, if it has changed or it is not present in cache
+   * calculates the hashes and caches the result.
+   *
+   * @param path the path of file to hash.
+   * @param mask the requested HashType digests.
+   * @param out stores the calculated hashes, it may include other digests.
+   *
+   * @return true if succeeded, false if something went wrong.
+   */
+  bool load(const std::string& path,
+            int mask,
+            MultiHashes& out,
+            Logger& logger);
+
+  /// Drop every cached hash and resize the shards to --hash_cache_max.
+  void clear();
+
+  /// Remove the persisted hashes that were not used recently.
+  static void expirePersisted();
+
+ private:
+  FileHashCache();
+
+  struct Entry {
+    FileHashIdentity identity;
+    MultiHashes hashes;
+  };
+
+  /// A file being hashed, other loads of the same file wait for its result.
+  struct InFlight {
+    FileHashIdentity identity;
+    int mask{0};
+    std::shared_future<MultiHashes> hashes;
+  };
+
+  struct Shard {
+    Mutex mutex;
+    std::unique_ptr<caches::LRU<std::string, Entry>> entries;
+    std::unordered_map<std::string, InFlight> in_flight;
+  };
+
+  /// Get the shard holding a path.
+  Shard& shard(const std::string& path);
+
+  /// Compute or read the persisted hashes of a file.
+  MultiHashes hash(const std::string& path,
+                   int mask,
+                   const FileHashIdentity& identity);
+
+ private:
+  std::vector<std::unique_ptr<Shard>> shards_;
+};
+
+} // namespace tables
+} // namespace osquery
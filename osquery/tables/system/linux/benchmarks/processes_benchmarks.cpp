@@ -0,0 +1,54 @@
+/**
+ * Copyright (c) 2014-present, The osquery authors
+ *
+ * This source code is licensed as defined by the LICENSE file found in the
+ * root directory of this source tree.
+ *
+ * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <osquery/core/tables.h>
+
+namespace osquery {
+namespace tables {
+
+TableRows genProcesses(QueryContext& context);
+
+} // namespace tables
+
+static void PROCESSES_generate_all_columns(benchmark::State& state) {
+  // Used columns are not known, every /proc source is read.
+  QueryContext context;
+  while (state.KeepRunning()) {
+    auto results = tables::genProcesses(context);
+    benchmark::DoNotOptimize(results);
+  }
+}
+
+BENCHMARK(PROCESSES_generate_all_columns);
+
+static void PROCESSES_generate_pid_name(benchmark::State& state) {
+  // SELECT pid, name FROM processes only reads the status of each process.
+  QueryContext context;
+  context.colsUsed = UsedColumns({"pid", "name"});
+  while (state.KeepRunning()) {
+    auto results = tables::genProcesses(context);
+    benchmark::DoNotOptimize(results);
+  }
+}
+
+BENCHMARK(PROCESSES_generate_pid_name);
+
+static void PROCESSES_generate_cmdline(benchmark::State& state) {
+  QueryContext context;
+  context.colsUsed = UsedColumns({"pid", "name", "cmdline"});
+  while (state.KeepRunning()) {
+    auto results = tables::genProcesses(context);
+    benchmark::DoNotOptimize(results);
+  }
+}
+
+BENCHMARK(PROCESSES_generate_cmdline);
+} // namespace osquery
@@ -7,9 +7,14 @@
  * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
  */
 
+#include <algorithm>
+#include <atomic>
 #include <map>
 #include <regex>
 #include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
 
 #include <stdlib.h>
 #include <sys/stat.h>
@@ -19,11 +24,14 @@
 #include <boost/algorithm/string/trim.hpp>
 #include <boost/noncopyable.hpp>
 
+#include <osquery/core/column_sources.h>
 #include <osquery/core/core.h>
+#include <osquery/core/flags.h>
 #include <osquery/core/tables.h>
 #include <osquery/filesystem/filesystem.h>
 #include <osquery/filesystem/linux/proc.h>
 #include <osquery/logger/logger.h>
+#include <osquery/profiler/resource_usage.h>
 #include <osquery/sql/dynamic_table_row.h>
 
 #include <osquery/utils/conversions/split.h>
@@ -32,20 +40,32 @@
 #include <ctime>
 
 namespace osquery {
+
+FLAG(uint32,
+     processes_threads,
+     1,
+     "Number of threads reading /proc for the processes table (linux)");
+
 namespace tables {
 
 const int kMSIn1CLKTCK = (1000 / sysconf(_SC_CLK_TCK));
 
+/// Minimum number of processes read by each thread of the processes table.
+const size_t kProcessesPerThread{128};
+
+/// Number of processes a thread claims at once.
+const size_t kProcessesChunkSize{32};
+
 inline std::string getProcAttr(const std::string& attr,
                                const std::string& pid) {
   return "/proc/" + pid + "/" + attr;
 }
 
-inline std::string readProcCMDLine(const std::string& pid) {
+inline std::string readProcCMDLine(const std::string& pid,
+                                   std::string& content) {
   auto attr = getProcAttr("cmdline", pid);
 
-  std::string content;
-  readFile(attr, content);
+  procReadFile(attr, content);
   // Remove \0 delimiters.
   std::replace_if(content.begin(),
                   content.end(),
@@ -227,12 +247,19 @@ struct SimpleProcStat : private boost::noncopyable {
   /// For errors processing proc data.
   Status status;
 
-  explicit SimpleProcStat(const std::string& pid);
+  /**
+   * @brief Parse the stat and status of a process.
+   *
+   * @param content A reusable read buffer.
+   * @param read_stat Skip reading the stat if false, the status is required.
+   */
+  SimpleProcStat(const std::string& pid, std::string& content, bool read_stat);
 };
 
-SimpleProcStat::SimpleProcStat(const std::string& pid) {
-  std::string content;
-  if (readFile(getProcAttr("stat", pid), content).ok()) {
+SimpleProcStat::SimpleProcStat(const std::string& pid,
+                               std::string& content,
+                               bool read_stat) {
+  if (read_stat && procReadFile(getProcAttr("stat", pid), content).ok()) {
     auto start = content.find_last_of(")");
     // Start parsing stats from ") <MODE>..."
     if (start == std::string::npos || content.size() <= start + 2) {
@@ -257,7 +284,7 @@ SimpleProcStat::SimpleProcStat(const std::string& pid) {
   }
 
   // /proc/N/status may be not available, or readable by this user.
-  if (!readFile(getProcAttr("status", pid), content).ok()) {
+  if (!procReadFile(getProcAttr("status", pid), content).ok()) {
     status = Status(1, "Cannot read /proc/status");
     return;
   }
@@ -311,12 +338,12 @@ struct SimpleProcIo : private boost::noncopyable {
   /// For errors processing proc data.
   Status status;
 
-  explicit SimpleProcIo(const std::string& pid);
+  /// Parse the io of a process, content is a read buffer.
+  SimpleProcIo(const std::string& pid, std::string& content);
 };
 
-SimpleProcIo::SimpleProcIo(const std::string& pid) {
-  std::string content;
-  if (!readFile(getProcAttr("io", pid), content).ok()) {
+SimpleProcIo::SimpleProcIo(const std::string& pid, std::string& content) {
+  if (!procReadFile(getProcAttr("io", pid), content).ok()) {
     status = Status(
         1, "Cannot read /proc/" + pid + "/io (is osquery running as root?)");
     return;
@@ -392,13 +419,41 @@ int getOnDisk(const std::string& pid, std::string& path) {
   }
 }
 
+/// The optional /proc sources of the processes table.
+enum ProcessSource : ColumnSources::Source {
+  kProcessStat,
+  kProcessExe,
+  kProcessCmdline,
+  kProcessCwd,
+  kProcessRoot,
+  kProcessIo,
+};
+
+/// The status is always read, a process without a status is not reported.
+const ColumnSources kProcessSources = {
+    {kProcessStat,
+     {"parent",
+      "pgroup",
+      "state",
+      "nice",
+      "threads",
+      "user_time",
+      "system_time",
+      "start_time"}},
+    {kProcessExe, {"path", "on_disk"}},
+    {kProcessCmdline, {"cmdline"}},
+    {kProcessCwd, {"cwd"}},
+    {kProcessRoot, {"root"}},
+    {kProcessIo, {"disk_bytes_read", "disk_bytes_written"}},
+};
+
 void genProcess(const std::string& pid,
                 long system_boot_time,
-                TableRows& results) {
+                const ColumnSourceSet& sources,
+                std::string& buffer,
+                TableRowHolder& row) {
   // Parse the process stat and status.
-  SimpleProcStat proc_stat(pid);
-  // Parse the process io
-  SimpleProcIo proc_io(pid);
+  SimpleProcStat proc_stat(pid, buffer, sources[kProcessStat]);
 
   if (!proc_stat.status.ok()) {
     VLOG(1) << proc_stat.status.getMessage() << " for pid " << pid;
@@ -407,17 +462,21 @@ void genProcess(const std::string& pid,
 
   auto r = make_table_row();
   r["pid"] = pid;
-  r["parent"] = proc_stat.parent;
-  r["path"] = readProcLink("exe", pid);
   r["name"] = proc_stat.name;
-  r["pgroup"] = proc_stat.group;
-  r["state"] = proc_stat.state;
-  r["nice"] = proc_stat.nice;
-  r["threads"] = proc_stat.threads;
-  // Read/parse cmdline arguments.
-  r["cmdline"] = readProcCMDLine(pid);
-  r["cwd"] = readProcLink("cwd", pid);
-  r["root"] = readProcLink("root", pid);
+  if (sources[kProcessExe]) {
+    r["path"] = readProcLink("exe", pid);
+    r["on_disk"] = INTEGER(getOnDisk(pid, r["path"]));
+  }
+  if (sources[kProcessCmdline]) {
+    // Read/parse cmdline arguments.
+    r["cmdline"] = readProcCMDLine(pid, buffer);
+  }
+  if (sources[kProcessCwd]) {
+    r["cwd"] = readProcLink("cwd", pid);
+  }
+  if (sources[kProcessRoot]) {
+    r["root"] = readProcLink("root", pid);
+  }
   r["uid"] = proc_stat.real_uid;
   r["euid"] = proc_stat.effective_uid;
   r["suid"] = proc_stat.saved_uid;
@@ -425,51 +484,70 @@ void genProcess(const std::string& pid,
   r["egid"] = proc_stat.effective_gid;
   r["sgid"] = proc_stat.saved_gid;
 
-  r["on_disk"] = INTEGER(getOnDisk(pid, r["path"]));
-
   // size/memory information
   r["wired_size"] = "0"; // No support for unpagable counters in linux.
   r["resident_size"] = proc_stat.resident_size;
   r["total_size"] = proc_stat.total_size;
 
-  // time information
-  auto usr_time = std::strtoull(proc_stat.user_time.data(), nullptr, 10);
-  r["user_time"] = std::to_string(usr_time * kMSIn1CLKTCK);
-  auto sys_time = std::strtoull(proc_stat.system_time.data(), nullptr, 10);
-  r["system_time"] = std::to_string(sys_time * kMSIn1CLKTCK);
-
-  auto proc_start_time_exp = tryTo<long>(proc_stat.start_time);
-  if (proc_start_time_exp.isValue() && system_boot_time > 0) {
-    r["start_time"] = INTEGER(system_boot_time + proc_start_time_exp.take() /
-                                                     sysconf(_SC_CLK_TCK));
-  } else {
-    r["start_time"] = "-1";
+  if (sources[kProcessStat]) {
+    r["parent"] = proc_stat.parent;
+    r["pgroup"] = proc_stat.group;
+    r["state"] = proc_stat.state;
+    r["nice"] = proc_stat.nice;
+    r["threads"] = proc_stat.threads;
+
+    // time information
+    auto usr_time = std::strtoull(proc_stat.user_time.data(), nullptr, 10);
+    r["user_time"] = std::to_string(usr_time * kMSIn1CLKTCK);
+    auto sys_time = std::strtoull(proc_stat.system_time.data(), nullptr, 10);
+    r["system_time"] = std::to_string(sys_time * kMSIn1CLKTCK);
+
+    auto proc_start_time_exp = tryTo<long>(proc_stat.start_time);
+    if (proc_start_time_exp.isValue() && system_boot_time > 0) {
+      r["start_time"] = INTEGER(system_boot_time + proc_start_time_exp.take() /
+                                                       sysconf(_SC_CLK_TCK));
+    } else {
+      r["start_time"] = "-1";
+    }
   }
 
-  if (!proc_io.status.ok()) {
-    // /proc/<pid>/io can require root to access, so don't fail if we can't
-    VLOG(1) << proc_io.status.getMessage();
-  } else {
-    r["disk_bytes_read"] = proc_io.read_bytes;
-    long long write_bytes = tryTo<long long>(proc_io.write_bytes).takeOr(0ll);
-    long long cancelled_write_bytes =
-        tryTo<long long>(proc_io.cancelled_write_bytes).takeOr(0ll);
-
-    r["disk_bytes_written"] =
-        std::to_string(write_bytes - cancelled_write_bytes);
+  if (sources[kProcessIo]) {
+    // Parse the process io
+    SimpleProcIo proc_io(pid, buffer);
+    if (!proc_io.status.ok()) {
+      // /proc/<pid>/io can require root to access, so don't fail if we can't
+      VLOG(1) << proc_io.status.getMessage();
+    } else {
+      r["disk_bytes_read"] = proc_io.read_bytes;
+      long long write_bytes = tryTo<long long>(proc_io.write_bytes).takeOr(0ll);
+      long long cancelled_write_bytes =
+          tryTo<long long>(proc_io.cancelled_write_bytes).takeOr(0ll);
+
+      r["disk_bytes_written"] =
+          std::to_string(write_bytes - cancelled_write_bytes);
+    }
   }
 
-  results.push_back(r);
+  row = r;
 }
 
-void genNamespaces(const std::string& pid, QueryData& results) {
+/// The namespaces of the process_namespaces table, one column each.
+const std::vector<std::string> kProcessNamespaces = {
+    "cgroup", "ipc", "mnt", "net", "pid", "user", "uts"};
+
+void genNamespaces(const std::string& pid,
+                   const std::vector<std::string>& namespaces,
+                   QueryData& results) {
   Row r;
 
+  // An empty list would read every namespace.
   ProcessNamespaceList proc_ns;
-  Status status = procGetProcessNamespaces(pid, proc_ns);
-  if (!status.ok()) {
-    VLOG(1) << "Namespaces for pid " << pid
-            << " are incomplete: " << status.what();
+  if (!namespaces.empty()) {
+    Status status = procGetProcessNamespaces(pid, proc_ns, namespaces);
+    if (!status.ok()) {
+      VLOG(1) << "Namespaces for pid " << pid
+              << " are incomplete: " << status.what();
+    }
   }
 
   r["pid"] = pid;
@@ -481,15 +559,63 @@ void genNamespaces(const std::string& pid, QueryData& results) {
 }
 
 TableRows genProcesses(QueryContext& context) {
-  TableRows results;
   auto system_boot_time = getUptime();
   if (system_boot_time > 0) {
     system_boot_time = std::time(nullptr) - system_boot_time;
   }
 
   auto pidlist = getProcList(context);
-  for (const auto& pid : pidlist) {
-    genProcess(pid, system_boot_time, results);
+  std::vector<std::string> pids(pidlist.begin(), pidlist.end());
+  auto sources = kProcessSources.used(context);
+
+  // Each process fills its own slot, so rows keep the order of the pid list.
+  std::vector<TableRowHolder> rows(pids.size());
+  std::atomic<size_t> next_pid{0};
+  auto worker = [&]() {
+    // The read buffer is reused for every /proc file read by this thread.
+    std::string buffer;
+    while (true) {
+      auto begin = next_pid.fetch_add(kProcessesChunkSize);
+      if (begin >= pids.size()) {
+        break;
+      }
+
+      auto end = std::min(begin + kProcessesChunkSize, pids.size());
+      for (auto i = begin; i < end; i++) {
+        genProcess(pids[i], system_boot_time, sources, buffer, rows[i]);
+      }
+    }
+  };
+
+  size_t thread_count = std::min<size_t>(FLAGS_processes_threads,
+                                         pids.size() / kProcessesPerThread);
+  // The CPU time of the helper threads is part of the query's cost.
+  auto helper_cpu_time = getHelperCpuTime();
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < thread_count; i++) {
+    try {
+      threads.emplace_back([&worker, helper_cpu_time]() {
+        ScopedHelperCpuTime scoped_cpu_time(helper_cpu_time);
+        worker();
+      });
+    } catch (const std::system_error& e) {
+      // The calling thread reads the remaining processes.
+      VLOG(1) << "Cannot start a processes thread: " << e.what();
+      break;
+    }
+  }
+
+  worker();
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  TableRows results;
+  results.reserve(rows.size());
+  for (auto& row : rows) {
+    if (row != nullptr) {
+      results.push_back(std::move(row));
+    }
   }
 
   return results;
@@ -520,9 +646,17 @@ QueryData genProcessMemoryMap(QueryContext& context) {
 QueryData genProcessNamespaces(QueryContext& context) {
   QueryData results;
 
+  // Each namespace is a /proc/<pid>/ns link, only read the used ones.
+  std::vector<std::string> namespaces;
+  for (const auto& name : kProcessNamespaces) {
+    if (context.isColumnUsed(name + "_namespace")) {
+      namespaces.push_back(name);
+    }
+  }
+
   const auto pidlist = getProcList(context);
   for (const auto& pid : pidlist) {
-    genNamespaces(pid, results);
+    genNamespaces(pid, namespaces, results);
   }
 
   return results;
@@ -0,0 +1,177 @@
+/**
+ * Copyright (c) 2014-present, The osquery authors
+ *
+ * This source code is licensed as defined by the LICENSE file found in the
+ * root directory of this source tree.
+ *
+ * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
+ */
+
+#include <thread>
+#include <vector>
+
+#include <gflags/gflags.h>
+#include <gtest/gtest.h>
+
+#include <boost/filesystem.hpp>
+
+#include <osquery/core/query.h>
+#include <osquery/core/system.h>
+#include <osquery/database/database.h>
+#include <osquery/filesystem/filesystem.h>
+#include <osquery/registry/registry.h>
+#include <osquery/tables/system/hash.h>
+#include <osquery/utils/system/time.h>
+#include <osquery/worker/logging/glog/glog_logger.h>
+
+namespace fs = boost::filesystem;
+
+namespace osquery {
+
+DECLARE_bool(hash_cache_persist);
+
+namespace tables {
+
+const int kAllDigests{HASH_TYPE_MD5 | HASH_TYPE_SHA1 | HASH_TYPE_SHA256};
+
+const std::string kHelloSHA256{
+    "2cf24dba5fb0a30e26e83b2ac5b9e29e1b161e5c1fa7425e73043362938b9824"};
+
+class HashTests : public testing::Test {
+ protected:
+  void SetUp() override {
+    platformSetup();
+    registryAndPluginInit();
+    initDatabasePluginForTesting();
+
+    path_ = fs::temp_directory_path() /
+            fs::unique_path("osquery.hash_tests.%%%%.%%%%");
+    write("hello");
+    FileHashCache::instance().clear();
+  }
+
+  void TearDown() override {
+    FLAGS_hash_cache_persist = false;
+    FileHashCache::instance().clear();
+
+    boost::system::error_code ec;
+    fs::remove(path_, ec);
+  }
+
+  void write(const std::string& content) {
+    ASSERT_TRUE(
+        writeTextFile(path_, content, 0660, PF_CREATE_ALWAYS | PF_WRITE).ok());
+  }
+
+ protected:
+  fs::path path_;
+};
+
+TEST_F(HashTests, test_file_hash_cache) {
+  auto& cache = FileHashCache::instance();
+
+  MultiHashes hashes;
+  ASSERT_TRUE(cache.load(
+      path_.string(), kAllDigests, hashes, GLOGLogger::instance()));
+  EXPECT_EQ("5d41402abc4b2a76b9719d911017c592", hashes.md5);
+  EXPECT_EQ(kHelloSHA256, hashes.sha256);
+
+  // A changed size is hashed again.
+  write("hello world");
+  ASSERT_TRUE(cache.load(
+      path_.string(), kAllDigests, hashes, GLOGLogger::instance()));
+  EXPECT_EQ("5eb63bbbe01eeed093cb22bb8f5acdc3", hashes.md5);
+
+  EXPECT_FALSE(cache.load((path_ / "missing").string(),
+                          kAllDigests,
+                          hashes,
+                          GLOGLogger::instance()));
+}
+
+TEST_F(HashTests, test_file_hash_cache_digests) {
+  auto& cache = FileHashCache::instance();
+
+  MultiHashes hashes;
+  ASSERT_TRUE(cache.load(
+      path_.string(), HASH_TYPE_SHA256, hashes, GLOGLogger::instance()));
+  EXPECT_EQ(kHelloSHA256, hashes.sha256);
+  EXPECT_TRUE(hashes.md5.empty());
+
+  // A missing digest is added to the cached ones.
+  ASSERT_TRUE(cache.load(
+      path_.string(), HASH_TYPE_MD5, hashes, GLOGLogger::instance()));
+  EXPECT_EQ("5d41402abc4b2a76b9719d911017c592", hashes.md5);
+  EXPECT_EQ(kHelloSHA256, hashes.sha256);
+  EXPECT_TRUE(hashes.sha1.empty());
+}
+
+TEST_F(HashTests, test_file_hash_cache_concurrent) {
+  auto& cache = FileHashCache::instance();
+
+  std::vector<MultiHashes> hashes(8);
+  std::vector<std::thread> threads;
+  for (auto& thread_hashes : hashes) {
+    threads.emplace_back([&]() {
+      cache.load(
+          path_.string(), kAllDigests, thread_hashes, GLOGLogger::instance());
+    });
+  }
+
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  for (const auto& thread_hashes : hashes) {
+    EXPECT_EQ(kHelloSHA256, thread_hashes.sha256);
+  }
+}
+
+TEST_F(HashTests, test_file_hash_cache_persist) {
+  FLAGS_hash_cache_persist = true;
+  auto& cache = FileHashCache::instance();
+
+  MultiHashes hashes;
+  ASSERT_TRUE(cache.load(
+      path_.string(), kAllDigests, hashes, GLOGLogger::instance()));
+
+  std::vector<std::string> keys;
+  scanDatabaseKeys(kPersistentSettings, keys, kHashCachePrefix);
+  ASSERT_EQ(1U, keys.size());
+
+  // A restarted cache uses the stored hashes instead of reading the file.
+  auto stored = "{\"time\":" + std::to_string(getUnixTime()) +
+                ",\"mask\":8,\"md5\":\"\",\"sha1\":\"\","
+                "\"sha256\":\"stored\"}";
+  ASSERT_TRUE(setDatabaseValue(kPersistentSettings, keys[0], stored).ok());
+  cache.clear();
+  ASSERT_TRUE(cache.load(
+      path_.string(), kAllDigests, hashes, GLOGLogger::instance()));
+  EXPECT_EQ("stored", hashes.sha256);
+
+  // The stored hashes of the previous content are removed on change.
+  write("hello world");
+  ASSERT_TRUE(cache.load(
+      path_.string(), kAllDigests, hashes, GLOGLogger::instance()));
+  EXPECT_EQ("5eb63bbbe01eeed093cb22bb8f5acdc3", hashes.md5);
+
+  std::string value;
+  EXPECT_FALSE(getDatabaseValue(kPersistentSettings, keys[0], value).ok());
+  keys.clear();
+  scanDatabaseKeys(kPersistentSettings, keys, kHashCachePrefix);
+  EXPECT_EQ(1U, keys.size());
+
+  // Stored hashes that were not used for a week are expired.
+  ASSERT_TRUE(setDatabaseValue(kPersistentSettings,
+                               kHashCachePrefix + "0.0.0.0",
+                               "{\"time\":1,\"mask\":8,\"md5\":\"\","
+                               "\"sha1\":\"\",\"sha256\":\"old\"}")
+                  .ok());
+  FileHashCache::expirePersisted();
+  keys.clear();
+  scanDatabaseKeys(kPersistentSettings, keys, kHashCachePrefix);
+  ASSERT_EQ(1U, keys.size());
+  EXPECT_NE(kHashCachePrefix + "0.0.0.0", keys[0]);
+}
+
+} // namespace tables
+} // namespace osquery
@@ -12,6 +12,7 @@
 #include <osquery/core/core.h>
 #include <osquery/core/flags.h>
 #include <osquery/core/system.h>
+#include <osquery/core/table_cache.h>
 #include <osquery/core/tables.h>
 #include <osquery/events/eventfactory.h>
 #include <osquery/events/eventpublisher.h>
@@ -231,6 +232,23 @@ QueryData genOsqueryInfo(QueryContext& context) {
   return results;
 }
 
+QueryData genOsqueryTableCache(QueryContext& context) {
+  QueryData results;
+
+  for (const auto& stats : TableResultCache::instance().stats()) {
+    Row r;
+    r["name"] = stats.name;
+    r["entries"] = INTEGER(stats.entries);
+    r["rows"] = BIGINT(stats.rows);
+    r["hits"] = BIGINT(stats.hits);
+    r["misses"] = BIGINT(stats.misses);
+    r["evictions"] = BIGINT(stats.evictions);
+    results.push_back(r);
+  }
+
+  return results;
+}
+
 QueryData genOsquerySchedule(QueryContext& context) {
   QueryData results;
 
@@ -254,6 +272,12 @@ QueryData genOsquerySchedule(QueryContext& context) {
         r["average_memory"] = "0";
         r["last_memory"] = "0";
         r["last_executed"] = "0";
+        r["wall_time_p50"] = "0";
+        r["wall_time_p95"] = "0";
+        r["cpu_time_p50"] = "0";
+        r["cpu_time_p95"] = "0";
+        r["memory_p50"] = "0";
+        r["memory_p95"] = "0";
 
         // Report optional performance information.
         Config::get().getPerformanceStats(
@@ -270,6 +294,16 @@ QueryData genOsquerySchedule(QueryContext& context) {
               r["last_system_time"] = BIGINT(perf.last_system_time);
               r["average_memory"] = BIGINT(perf.average_memory);
               r["last_memory"] = BIGINT(perf.last_memory);
+              r["wall_time_p50"] =
+                  BIGINT(perf.wall_time_histogram.percentile(50));
+              r["wall_time_p95"] =
+                  BIGINT(perf.wall_time_histogram.percentile(95));
+              r["cpu_time_p50"] =
+                  BIGINT(perf.cpu_time_histogram.percentile(50));
+              r["cpu_time_p95"] =
+                  BIGINT(perf.cpu_time_histogram.percentile(95));
+              r["memory_p50"] = BIGINT(perf.memory_histogram.percentile(50));
+              r["memory_p95"] = BIGINT(perf.memory_histogram.percentile(95));
             });
 
         results.push_back(r);
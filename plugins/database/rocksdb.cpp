@@ -420,17 +420,57 @@ Status RocksDBDatabasePlugin::scan(const std::string& domain,
     return Status(1, "Could not get iterator for " + domain);
   }
 
+  // Keys are ordered, all keys with the prefix follow the first match.
   size_t count = 0;
-  for (it->SeekToFirst(); it->Valid(); it->Next()) {
-    auto key = it->key().ToString();
-    if (key.find(prefix) == 0) {
-      results.push_back(std::move(key));
-      if (max > 0 && ++count >= max) {
-        break;
-      }
+  for (it->Seek(prefix); it->Valid() && it->key().starts_with(prefix);
+       it->Next()) {
+    results.push_back(it->key().ToString());
+    if (max > 0 && ++count >= max) {
+      break;
     }
   }
   delete it;
   return Status::success();
 }
+
+Status RocksDBDatabasePlugin::scanRange(
+    const std::string& domain,
+    const std::string& low,
+    const std::string& high,
+    const DatabaseRangeCallback& callback) const {
+  if (getDB() == nullptr) {
+    return Status(1, "Database not opened");
+  }
+
+  auto cfh = getHandleForColumnFamily(domain);
+  if (cfh == nullptr) {
+    return Status(1, "Could not get column family for " + domain);
+  }
+
+  // Reads are bounded so the iterator can skip deleted keys past the range.
+  auto upper_bound = high + '\0';
+  rocksdb::Slice upper_bound_slice(upper_bound);
+  auto options = rocksdb::ReadOptions();
+  options.verify_checksums = false;
+  options.fill_cache = false;
+  options.iterate_upper_bound = &upper_bound_slice;
+
+  // The callback may yield rows to a generator that is never resumed, the
+  // iterator must be released while unwinding.
+  std::unique_ptr<rocksdb::Iterator> it(getDB()->NewIterator(options, cfh));
+  if (it == nullptr) {
+    return Status(1, "Could not get iterator for " + domain);
+  }
+
+  for (it->Seek(low); it->Valid(); it->Next()) {
+    if (!callback(it->key().ToString(), it->value().ToString())) {
+      break;
+    }
+  }
+
+  if (!it->status().ok()) {
+    return Status::failure(it->status().ToString());
+  }
+  return Status::success();
+}
 } // namespace osquery
@@ -71,6 +71,12 @@ class RocksDBDatabasePlugin : public DatabasePlugin {
               const std::string& prefix,
               uint64_t max) const override;
 
+  /// Ordered key and value iteration using a single iterator.
+  Status scanRange(const std::string& domain,
+                   const std::string& low,
+                   const std::string& high,
+                   const DatabaseRangeCallback& callback) const override;
+
  public:
   /// Database workflow: open and setup.
   Status setUp() override;
@@ -21,6 +21,7 @@
 #include <osquery/database/database.h>
 #include <osquery/logger/logger.h>
 #include <osquery/registry/registry.h>
+#include <osquery/utils/conversions/tryto.h>
 #include <osquery/utils/info/version.h>
 #include <osquery/utils/json/json.h>
 #include <osquery/utils/system/time.h>
@@ -35,10 +36,31 @@ FLAG(uint64,
      1000000,
      "Maximum number of logs in buffered output plugins (0 = unlimited)");
 
+FLAG(uint32,
+     buffered_log_max_inflight,
+     1,
+     "Maximum number of buffered log batches sent at once, above 1 batches "
+     "are sent until the buffer is drained");
+
+FLAG(uint32,
+     buffered_log_target_latency,
+     2000,
+     "Milliseconds to send a batch that buffered log batches are sized for, "
+     "when sending several at once");
+
+FLAG(uint64,
+     buffered_log_max_batch_bytes,
+     4 * 1024 * 1024,
+     "Maximum size in bytes of a buffered log batch, when sending several at "
+     "once (0 = unlimited)");
+
 const std::chrono::seconds BufferedLogForwarder::kLogPeriod{
     std::chrono::seconds(4)};
 const uint64_t BufferedLogForwarder::kMaxLogLines{1024};
 
+/// Number of digits of the counter in an index, enough for any size_t.
+const size_t kIndexCounterWidth{20};
+
 Status BufferedLogForwarder::setUp() {
   // initialize buffer_count_ by scanning the DB
   std::vector<std::string> indexes;
@@ -48,123 +70,245 @@ Status BufferedLogForwarder::setUp() {
     return Status(1, "Error scanning for buffered log count");
   }
 
-  RecursiveLock lock(count_mutex_);
   buffer_count_ = indexes.size();
+
+  // Continue after the buffered indexes, so that a log stored after a
+  // restart neither overwrites nor sorts before a log that was not sent.
+  std::lock_guard<std::mutex> lock(index_mutex_);
+  bool legacy_index{false};
+  for (const auto& index : indexes) {
+    auto counter_pos = index.rfind('_');
+    auto time_pos = counter_pos == std::string::npos || counter_pos == 0
+                        ? std::string::npos
+                        : index.rfind('_', counter_pos - 1);
+    if (time_pos == std::string::npos) {
+      continue;
+    }
+
+    auto time = tryTo<uint64_t>(
+        index.substr(time_pos + 1, counter_pos - time_pos - 1), 10);
+    auto counter = tryTo<uint64_t>(index.substr(counter_pos + 1), 10);
+    if (time.isError() || counter.isError()) {
+      continue;
+    }
+
+    index_time_ = std::max(index_time_, time.get());
+    log_index_ = std::max(log_index_, static_cast<size_t>(counter.get()));
+    if (index.size() - counter_pos - 1 != kIndexCounterWidth) {
+      legacy_index = true;
+    }
+  }
+
+  // Unpadded counters of older versions sort after padded ones of the same
+  // second, new indexes start at the next second instead.
+  if (legacy_index) {
+    index_time_++;
+  }
+
   return Status(0);
 }
 
 void BufferedLogForwarder::check() {
-  // Get a list of all the buffered log items, with a max of 1024 lines.
-  std::vector<std::string> indexes;
-  auto status = scanDatabaseKeys(kLogs, indexes, index_name_, max_log_lines_);
-
-  // For each index, accumulate the log line into the result or status set.
-  std::vector<std::string> results, statuses;
-  iterate(indexes, ([&results, &statuses, this](std::string& index) {
-            std::string value;
-            auto& target = isResultIndex(index) ? results : statuses;
-            if (getDatabaseValue(kLogs, index, value)) {
-              target.emplace_back(std::move(value));
-            }
-          }));
-
-  // If any results/statuses were found in the flushed buffer, send.
-  if (results.size() > 0) {
-    status = send(results, "result");
-    if (!status.ok()) {
-      VLOG(1) << "Error sending results to logger: " << status.getMessage();
-    } else {
-      // Clear the results logs once they were sent.
-      iterate(indexes, ([this](std::string& index) {
-                if (!isResultIndex(index)) {
-                  return;
-                }
-                deleteValueWithCount(kLogs, index);
-              }));
+  if (FLAGS_buffered_log_max_inflight > 1) {
+    // Keep sending while every batch is filled, to drain a backlog.
+    while (sendBatches(FLAGS_buffered_log_max_inflight) && !interrupted()) {
+    }
+  } else {
+    sendBatches(1);
+  }
+
+  // Purge any logs exceeding the max after our send attempt
+  if (FLAGS_buffered_log_max > 0) {
+    purge();
+  }
+}
+
+bool BufferedLogForwarder::sendBatches(size_t max_batches) {
+  // A single batch is limited to max_log_lines_, shared by results and
+  // statuses. Several batches are sized according to the last ones sent.
+  uint64_t max_lines = max_log_lines_;
+  uint64_t max_bytes = 0;
+  if (max_batches > 1) {
+    if (batch_lines_ == 0) {
+      batch_lines_ = (max_log_lines_ == 0) ? kMaxLogLines : max_log_lines_;
     }
+
+    max_lines = batch_lines_;
+    max_bytes = FLAGS_buffered_log_max_batch_bytes;
   }
 
-  if (statuses.size() > 0) {
-    status = send(statuses, "status");
+  // Get the oldest buffered log items, results first.
+  std::vector<LogBatch> batches;
+
+  {
+    WriteLock lock(buffer_mutex_);
+
+    auto status =
+        readBatches(true, max_batches, max_lines, max_bytes, batches);
+    if (status.ok() && max_batches == 1) {
+      auto result_count = batches.empty() ? 0 : batches.front().count;
+      if (max_lines == 0 || result_count < max_lines) {
+        auto max_statuses = (max_lines == 0) ? 0 : max_lines - result_count;
+        status = readBatches(false, 1, max_statuses, max_bytes, batches);
+      }
+    } else if (status.ok() && batches.size() < max_batches) {
+      status = readBatches(
+          false, max_batches - batches.size(), max_lines, max_bytes, batches);
+    }
+
     if (!status.ok()) {
-      VLOG(1) << "Error sending status to logger: " << status.getMessage();
-    } else {
-      // Clear the status logs once they were sent.
-      iterate(indexes, ([this](std::string& index) {
-                if (!isStatusIndex(index)) {
-                  return;
-                }
-                deleteValueWithCount(kLogs, index);
-              }));
+      VLOG(1) << "Error reading buffered logs: " << status.getMessage();
     }
   }
 
-  // Purge any logs exceeding the max after our send attempt
-  if (FLAGS_buffered_log_max > 0) {
-    purge();
+  if (batches.empty()) {
+    return false;
+  }
+
+  if (max_batches == 1) {
+    for (auto& batch : batches) {
+      sendBatch(batch);
+    }
+  } else {
+    std::vector<std::thread> threads;
+    for (auto& batch : batches) {
+      threads.emplace_back([this, &batch]() { sendBatch(batch); });
+    }
+
+    for (auto& thread : threads) {
+      thread.join();
+    }
+
+    adaptBatchLines(batches);
+  }
+
+  bool sent = true;
+  for (const auto& batch : batches) {
+    if (!batch.status.ok()) {
+      VLOG(1) << "Error sending " << (batch.results ? "results" : "status")
+              << " to logger: " << batch.status.getMessage();
+      sent = false;
+      continue;
+    }
+
+    // Clear the logs once they were sent, the others are sent again later.
+    deleteLogs(batch.first_index, batch.last_index, batch.count);
+  }
+
+  return sent && batches.size() == max_batches;
+}
+
+void BufferedLogForwarder::sendBatch(LogBatch& batch) {
+  auto start = std::chrono::steady_clock::now();
+  batch.status = send(batch.log_data, batch.results ? "result" : "status");
+  batch.latency = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - start);
+}
+
+void BufferedLogForwarder::adaptBatchLines(
+    const std::vector<LogBatch>& batches) {
+  auto target_latency =
+      std::chrono::milliseconds(FLAGS_buffered_log_target_latency);
+
+  bool failed = false;
+  bool filled = false;
+  std::chrono::milliseconds latency{0};
+  for (const auto& batch : batches) {
+    failed = failed || !batch.status.ok();
+    filled = filled || batch.count >= batch_lines_;
+    latency = std::max(latency, batch.latency);
+  }
+
+  if (failed || latency > target_latency) {
+    // Smaller batches are faster to send, and more likely to be accepted.
+    batch_lines_ = std::max<uint64_t>(batch_lines_ / 2, 1);
+
+  } else if (filled && latency < target_latency / 2) {
+    // Batches that are limited by their number of lines may grow.
+    batch_lines_ *= 2;
+    if (max_log_lines_ != 0) {
+      batch_lines_ = std::min(batch_lines_, max_log_lines_);
+    }
   }
 }
 
 void BufferedLogForwarder::purge() {
-  RecursiveLock lock(count_mutex_);
-  if (buffer_count_ <= FLAGS_buffered_log_max) {
+  uint64_t buffer_count = buffer_count_;
+  if (buffer_count <= FLAGS_buffered_log_max) {
     return;
   }
 
-  unsigned long long int purge_count = buffer_count_ - FLAGS_buffered_log_max;
+  uint64_t purge_count = buffer_count - FLAGS_buffered_log_max;
 
   // Collect purge_count indexes of each type (result/status) before
-  // partitioning to find the oldest. Note this assumes that the indexes are
+  // merging them to find the oldest. Note this assumes that the indexes are
   // returned in ascending lexicographic order (true for RocksDB).
-  std::vector<std::string> indexes;
-  auto status =
-      scanDatabaseKeys(kLogs, indexes, genIndexPrefix(true), purge_count);
-  if (!status.ok()) {
-    LOG(ERROR) << "Error scanning DB during buffered log purge";
-    return;
-  }
+  std::vector<std::string> result_indexes, status_indexes;
 
-  LOG(WARNING) << "Purging buffered logs limit (" << FLAGS_buffered_log_max
-               << ") exceeded: " << buffer_count_;
+  {
+    WriteLock lock(buffer_mutex_);
 
-  std::vector<std::string> status_indexes;
-  status = scanDatabaseKeys(
-      kLogs, status_indexes, genIndexPrefix(false), purge_count);
-  if (!status.ok()) {
-    LOG(ERROR) << "Error scanning DB during buffered log purge";
-    return;
+    auto status = scanDatabaseKeys(
+        kLogs, result_indexes, genIndexPrefix(true), purge_count);
+    if (status.ok()) {
+      status = scanDatabaseKeys(
+          kLogs, status_indexes, genIndexPrefix(false), purge_count);
+    }
+
+    if (!status.ok()) {
+      LOG(ERROR) << "Error scanning DB during buffered log purge";
+      return;
+    }
   }
 
-  indexes.insert(indexes.end(), status_indexes.begin(), status_indexes.end());
+  LOG(WARNING) << "Purging buffered logs limit (" << FLAGS_buffered_log_max
+               << ") exceeded: " << buffer_count;
 
-  if (indexes.size() < purge_count) {
+  if (result_indexes.size() + status_indexes.size() < purge_count) {
     LOG(ERROR) << "Trying to purge " << purge_count << " logs but only found "
-               << indexes.size();
+               << result_indexes.size() + status_indexes.size();
     return;
   }
 
   size_t prefix_size = genIndexPrefix(true).size();
-  // Partition the indexes so that the first purge_count elements are the
-  // oldest indexes (the ones to be purged)
-  std::nth_element(indexes.begin(),
-                   indexes.begin() + (unsigned int)purge_count - 1,
-                   indexes.end(),
-                   [&](const std::string& a, const std::string& b) {
-                     // Skip the prefix when doing comparisons
-                     return a.compare(prefix_size,
-                                      std::string::npos,
-                                      b,
-                                      prefix_size,
-                                      std::string::npos) < 0;
-                   });
-  indexes.erase(indexes.begin() + (unsigned int)purge_count, indexes.end());
-
-  // Now only indexes of logs to be deleted remain
-  iterate(indexes, [this](const std::string& index) {
-    if (!deleteValueWithCount(kLogs, index).ok()) {
-      LOG(ERROR) << "Error deleting value during buffered log purge";
+  auto is_older = [prefix_size](const std::string& a, const std::string& b) {
+    // Skip the prefix when doing comparisons
+    return a.compare(prefix_size,
+                     std::string::npos,
+                     b,
+                     prefix_size,
+                     std::string::npos) < 0;
+  };
+
+  // Merge the ordered indexes, counting the oldest of each type to purge
+  size_t result_count = 0;
+  size_t status_count = 0;
+  while (result_count + status_count < purge_count) {
+    if (status_count == status_indexes.size() ||
+        (result_count < result_indexes.size() &&
+         is_older(result_indexes[result_count],
+                  status_indexes[status_count]))) {
+      ++result_count;
+    } else {
+      ++status_count;
     }
-  });
+  }
+
+  // Now only the oldest indexes of each type are deleted
+  Status status;
+  if (result_count > 0) {
+    status = deleteLogs(
+        genIndexPrefix(true), result_indexes[result_count - 1], result_count);
+  }
+
+  if (status.ok() && status_count > 0) {
+    status = deleteLogs(
+        genIndexPrefix(false), status_indexes[status_count - 1], status_count);
+  }
+
+  if (!status.ok()) {
+    LOG(ERROR) << "Error deleting values during buffered log purge";
+  }
 }
 
 void BufferedLogForwarder::start() {
@@ -177,6 +321,7 @@ void BufferedLogForwarder::start() {
 }
 
 Status BufferedLogForwarder::logString(const std::string& s, uint64_t time) {
+  ReadLock lock(buffer_mutex_);
   std::string index = genResultIndex(time);
   return addValueWithCount(kLogs, index, s);
 }
@@ -222,6 +367,7 @@ Status BufferedLogForwarder::logStatus(const std::vector<StatusLogLine>& log,
     if (!json.empty()) {
       json.pop_back();
     }
+    ReadLock lock(buffer_mutex_);
     std::string index = genStatusIndex(time);
     Status status = addValueWithCount(kLogs, index, json);
     if (!status.ok()) {
@@ -262,8 +408,22 @@ std::string BufferedLogForwarder::genIndex(bool results, uint64_t time) {
   if (time == 0) {
     time = getUnixTime();
   }
-  return genIndexPrefix(results) + std::to_string(time) + '_' +
-         std::to_string(++log_index_);
+
+  std::string counter;
+
+  {
+    std::lock_guard<std::mutex> lock(index_mutex_);
+
+    // Keep the indexes in ascending order, even if the clock goes back.
+    index_time_ = std::max(index_time_, time);
+    time = index_time_;
+
+    counter = std::to_string(++log_index_);
+  }
+
+  // The counter is padded so indexes of the same second sort in order.
+  counter.insert(0, kIndexCounterWidth - counter.size(), '0');
+  return genIndexPrefix(results) + std::to_string(time) + '_' + counter;
 }
 
 Status BufferedLogForwarder::addValueWithCount(const std::string& domain,
@@ -271,19 +431,58 @@ Status BufferedLogForwarder::addValueWithCount(const std::string& domain,
                                                const std::string& value) {
   Status status = setDatabaseValue(domain, key, value);
   if (status.ok()) {
-    RecursiveLock lock(count_mutex_);
     buffer_count_++;
   }
   return status;
 }
 
-Status BufferedLogForwarder::deleteValueWithCount(const std::string& domain,
-                                                  const std::string& key) {
-  Status status = deleteDatabaseValue(domain, key);
+Status BufferedLogForwarder::readBatches(bool results,
+                                         size_t max_batches,
+                                         uint64_t max_lines,
+                                         uint64_t max_bytes,
+                                         std::vector<LogBatch>& batches) {
+  auto first_batch = batches.size();
+  auto is_full = [max_lines](const LogBatch& batch) {
+    return max_lines != 0 && batch.count >= max_lines;
+  };
+
+  // Indexes of a type share a prefix, and are followed by digits.
+  auto prefix = genIndexPrefix(results);
+  return scanDatabaseRange(
+      kLogs,
+      prefix,
+      prefix + '\x7f',
+      [&](const std::string& key, const std::string& value) {
+        if (batches.size() == first_batch || is_full(batches.back()) ||
+            (max_bytes != 0 &&
+             batches.back().size + value.size() > max_bytes)) {
+          if (batches.size() - first_batch == max_batches) {
+            return false;
+          }
+
+          batches.emplace_back();
+          batches.back().results = results;
+          batches.back().first_index = key;
+        }
+
+        auto& batch = batches.back();
+        batch.log_data.push_back(value);
+        batch.last_index = key;
+        batch.count++;
+        batch.size += value.size();
+
+        return batches.size() - first_batch < max_batches || !is_full(batch);
+      });
+}
+
+Status BufferedLogForwarder::deleteLogs(const std::string& first_index,
+                                        const std::string& last_index,
+                                        size_t count) {
+  Status status = deleteDatabaseRange(kLogs, first_index, last_index);
   if (status.ok()) {
-    RecursiveLock lock(count_mutex_);
-    if (buffer_count_ > 0) {
-      buffer_count_--;
+    auto buffer_count = buffer_count_.load();
+    while (!buffer_count_.compare_exchange_weak(
+        buffer_count, (buffer_count > count) ? buffer_count - count : 0)) {
     }
   }
   return status;
@@ -9,6 +9,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <chrono>
 #include <functional>
 #include <mutex>
@@ -126,6 +127,9 @@ class BufferedLogForwarder : public InternalRunnable {
    * The log_data provided to send must be mutable.
    * To optimize for smaller memory, this will be moved into place within the
    * constructed property tree before sending.
+   *
+   * When buffered_log_max_inflight is above 1, several batches are sent at
+   * once from different threads, and send must be thread safe.
    */
   virtual Status send(std::vector<std::string>& log_data,
                       const std::string& log_type) = 0;
@@ -133,9 +137,15 @@ class BufferedLogForwarder : public InternalRunnable {
   /**
    * @brief Check for new logs and send.
    *
-   * Scan the logs domain for up to max_log_lines_ log lines.
-   * Sort those lines into status and request types then forward (send) each
-   * set. On success, clear the data and indexes. Calls purge upon completion.
+   * Read up to max_log_lines_ log lines from the logs domain, the oldest
+   * result lines first, then the oldest status lines. Each type is read with
+   * a single ordered range scan, then forwarded (sent). On success, the sent
+   * lines are deleted with a single range deletion. Calls purge upon
+   * completion.
+   *
+   * When buffered_log_max_inflight is above 1, up to that many batches are
+   * sent at once, and batches are sent until the buffer is drained. Their
+   * size adapts to the time taken to send them.
    */
   void check();
 
@@ -144,7 +154,7 @@ class BufferedLogForwarder : public InternalRunnable {
    *
    * Uses the buffered_log_max flag to determine the maximum number of buffered
    * logs. If this number is exceeded, the logs with the oldest timestamp are
-   * purged. Order of purging for logs with the same timestamp is undefined.
+   * purged, in the order they were buffered.
    */
   void purge();
 
@@ -179,12 +189,70 @@ class BufferedLogForwarder : public InternalRunnable {
                            const std::string& key,
                            const std::string& value);
 
+  /// A batch of logs of a type, read from a range of indexes.
+  struct LogBatch {
+    /// True for result logs, false for status logs
+    bool results{true};
+
+    /// The log lines, which send may consume
+    std::vector<std::string> log_data;
+
+    /// The indexes of the first and last log lines
+    std::string first_index;
+    std::string last_index;
+
+    /// Number of log lines, and their size in bytes
+    size_t count{0};
+    size_t size{0};
+
+    /// Outcome of sending the batch, and the time it took
+    Status status;
+    std::chrono::milliseconds latency{0};
+  };
+
+  /**
+   * @brief Read and send batches of the oldest logs.
+   *
+   * Each batch that was sent is deleted, batches that failed are sent again
+   * by the next check.
+   *
+   * @param max_batches the maximum number of batches, sent at once if above 1
+   * @return true if every batch was sent and more logs may be buffered
+   */
+  bool sendBatches(size_t max_batches);
+
   /**
-   * @brief Delete a database value while maintaining count
+   * @brief Read the oldest logs of a type into batches, in order.
    *
+   * @param results true to read result logs, false for status logs
+   * @param max_batches the maximum number of batches to read
+   * @param max_lines the maximum number of lines per batch, 0 for no limit
+   * @param max_bytes the maximum size of a batch, 0 for no limit. A batch
+   * holds at least one line.
+   * @param batches [output] the batches that were read are appended
    */
-  Status deleteValueWithCount(const std::string& domain,
-                              const std::string& key);
+  Status readBatches(bool results,
+                     size_t max_batches,
+                     uint64_t max_lines,
+                     uint64_t max_bytes,
+                     std::vector<LogBatch>& batches);
+
+  /// Send a batch, recording the outcome and the time it took.
+  void sendBatch(LogBatch& batch);
+
+  /// Resize the batches according to the outcome of the last ones sent.
+  void adaptBatchLines(const std::vector<LogBatch>& batches);
+
+  /**
+   * @brief Delete a range of logs while maintaining count
+   *
+   * @param first_index the index of the first log to delete, or a prefix
+   * @param last_index the index of the last log to delete
+   * @param count the number of logs in the range
+   */
+  Status deleteLogs(const std::string& first_index,
+                    const std::string& last_index,
+                    size_t count);
 
  protected:
   /// Seconds between flushing logs
@@ -204,12 +272,26 @@ class BufferedLogForwarder : public InternalRunnable {
 
  private:
   /// Hold an incrementing index for buffering logs
-  std::atomic<size_t> log_index_{0};
+  size_t log_index_{0};
+
+  /// Time of the last index, indexes never go back in time
+  uint64_t index_time_{0};
+
+  /// Protects the generation of indexes, which are kept in ascending order
+  std::mutex index_mutex_;
+
+  /**
+   * @brief Held shared while a log is stored, exclusively while logs are read
+   *
+   * Once logs are read, any log stored afterwards has a greater index than
+   * the last one read, which allows deleting the read logs as a range.
+   */
+  Mutex buffer_mutex_;
 
   /// Stores the count of buffered logs
-  unsigned long long int buffer_count_{0};
+  std::atomic<uint64_t> buffer_count_{0};
 
-  /// Protects the count of buffered logs
-  RecursiveMutex count_mutex_;
+  /// Number of lines per batch when sending several at once, 0 until set
+  uint64_t batch_lines_{0};
 };
 }
@@ -7,6 +7,7 @@
  * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
  */
 
+#include <algorithm>
 #include <chrono>
 #include <thread>
 
@@ -98,11 +99,14 @@ class MockBufferedLogForwarder : public BufferedLogForwarder {
                Status(std::vector<std::string>& log_data,
                       const std::string& log_type));
   FRIEND_TEST(BufferedLogForwarderTests, test_index);
+  FRIEND_TEST(BufferedLogForwarderTests, test_index_restart);
+  FRIEND_TEST(BufferedLogForwarderTests, test_index_restart_legacy);
   FRIEND_TEST(BufferedLogForwarderTests, test_basic);
   FRIEND_TEST(BufferedLogForwarderTests, test_retry);
   FRIEND_TEST(BufferedLogForwarderTests, test_multiple);
   FRIEND_TEST(BufferedLogForwarderTests, test_async);
   FRIEND_TEST(BufferedLogForwarderTests, test_split);
+  FRIEND_TEST(BufferedLogForwarderTests, test_order);
   FRIEND_TEST(BufferedLogForwarderTests, test_purge);
   FRIEND_TEST(BufferedLogForwarderTests, test_purge_max);
 
@@ -113,10 +117,10 @@ class MockBufferedLogForwarder : public BufferedLogForwarder {
 TEST_F(BufferedLogForwarderTests, test_index) {
   MockBufferedLogForwarder runner;
   if (!isPlatform(PlatformType::TYPE_WINDOWS)) {
-    EXPECT_THAT(runner.genResultIndex(), ContainsRegex("mock_r_[0-9]+_1"));
-    EXPECT_THAT(runner.genStatusIndex(), ContainsRegex("mock_s_[0-9]+_2"));
-    EXPECT_THAT(runner.genResultIndex(), ContainsRegex("mock_r_[0-9]+_3"));
-    EXPECT_THAT(runner.genStatusIndex(), ContainsRegex("mock_s_[0-9]+_4"));
+    EXPECT_THAT(runner.genResultIndex(), MatchesRegex("mock_r_[0-9]+_0+1"));
+    EXPECT_THAT(runner.genStatusIndex(), MatchesRegex("mock_s_[0-9]+_0+2"));
+    EXPECT_THAT(runner.genResultIndex(), MatchesRegex("mock_r_[0-9]+_0+3"));
+    EXPECT_THAT(runner.genStatusIndex(), MatchesRegex("mock_s_[0-9]+_0+4"));
   }
 
   EXPECT_TRUE(runner.isResultIndex(runner.genResultIndex()));
@@ -128,6 +132,45 @@ TEST_F(BufferedLogForwarderTests, test_index) {
   EXPECT_FALSE(runner.isStatusIndex("foo"));
 }
 
+// A restarted forwarder generates indexes after the buffered ones
+TEST_F(BufferedLogForwarderTests, test_index_restart) {
+  StrictMock<MockBufferedLogForwarder> runner;
+  uint64_t time = getUnixTime() + 60;
+  runner.logString("foo", time);
+  runner.logString("bar", time);
+
+  std::vector<std::string> indexes;
+  scanDatabaseKeys(kLogs, indexes, runner.genIndexPrefix(true));
+  ASSERT_EQ(2U, indexes.size());
+  auto last_index = *std::max_element(indexes.begin(), indexes.end());
+
+  StrictMock<MockBufferedLogForwarder> restarted;
+  ASSERT_TRUE(restarted.setUp().ok());
+  EXPECT_EQ(2U, restarted.buffer_count_.load());
+
+  auto index = restarted.genResultIndex();
+  EXPECT_GT(index, last_index);
+  EXPECT_EQ(0U, index.find(restarted.genIndexPrefix(true) +
+                           std::to_string(time) + "_"));
+}
+
+// Indexes of older versions have an unpadded counter
+TEST_F(BufferedLogForwarderTests, test_index_restart_legacy) {
+  StrictMock<MockBufferedLogForwarder> runner;
+  uint64_t time = getUnixTime() + 60;
+  auto legacy_index = runner.genIndexPrefix(true) + std::to_string(time) + "_5";
+  setDatabaseValue(kLogs, legacy_index, "foo");
+
+  StrictMock<MockBufferedLogForwarder> restarted;
+  ASSERT_TRUE(restarted.setUp().ok());
+  EXPECT_EQ(1U, restarted.buffer_count_.load());
+
+  auto index = restarted.genResultIndex();
+  EXPECT_GT(index, legacy_index);
+  EXPECT_EQ(0U, index.find(restarted.genIndexPrefix(true) +
+                           std::to_string(time + 1) + "_"));
+}
+
 TEST_F(BufferedLogForwarderTests, test_basic) {
   StrictMock<MockBufferedLogForwarder> runner;
   runner.logString("foo");
@@ -300,6 +343,34 @@ TEST_F(BufferedLogForwarderTests, test_split) {
   runner2.check();
 }
 
+// Verify that logs are sent in the order they were buffered, and that only
+// the logs that were sent are deleted
+TEST_F(BufferedLogForwarderTests, test_order) {
+  StrictMock<MockBufferedLogForwarder> runner("mock", kLogPeriod, 12);
+  uint64_t time = getUnixTime();
+
+  std::vector<std::string> expected;
+  for (size_t i = 0; i < 12; ++i) {
+    expected.push_back(std::to_string(i));
+    runner.logString(expected.back(), time);
+  }
+
+  // A log buffered later is sent later, even with an older time
+  runner.logString("late", time - 1);
+  runner.logString("next", time);
+
+  EXPECT_CALL(runner, send(ElementsAreArray(expected), "result"))
+      .WillOnce(Return(Status(0)));
+  runner.check();
+
+  EXPECT_CALL(runner, send(ElementsAre("late", "next"), "result"))
+      .WillOnce(Return(Status(0)));
+  runner.check();
+
+  // This call should not result in sending again
+  runner.check();
+}
+
 // Test the purge() function independently of check()
 TEST_F(BufferedLogForwarderTests, test_purge) {
   FLAGS_buffered_log_max = 3;
@@ -7,18 +7,27 @@
  * SPDX-License-Identifier: (Apache-2.0 OR GPL-2.0-only)
  */
 
+#include <algorithm>
+
 #include <gtest/gtest.h>
 
 #include <osquery/core/flags.h>
 #include <osquery/core/system.h>
 #include <osquery/database/database.h>
 #include <osquery/registry/registry_interface.h>
+#include <osquery/remote/requests.h>
+#include <osquery/remote/serializers/json.h>
 #include <osquery/remote/tests/test_utils.h>
+#include <osquery/remote/transports/tls.h>
 
 #include "plugins/logger/tls_logger.h"
 
 namespace osquery {
 DECLARE_bool(disable_database);
+DECLARE_uint64(logger_tls_max_linesize);
+DECLARE_bool(logger_tls_splice);
+DECLARE_uint64(logger_tls_max_lines);
+DECLARE_uint32(buffered_log_max_inflight);
 
 class TLSLoggerTests : public testing::Test {
  protected:
@@ -32,6 +41,13 @@ class TLSLoggerTests : public testing::Test {
   void runCheck(const std::shared_ptr<TLSLogForwarder>& runner) {
     runner->check();
   }
+
+  Status serializeRequest(std::vector<std::string> log_data,
+                          bool compress,
+                          std::string& body) {
+    return TLSLogForwarder::serializeRequest(
+        "node_key", "result", log_data, compress, body);
+  }
 };
 
 TEST_F(TLSLoggerTests, test_database) {
@@ -83,4 +99,111 @@ TEST_F(TLSLoggerTests, test_send) {
   TLSServerRunner::unsetClientConfig();
   TLSServerRunner::stop();
 }
+
+TEST_F(TLSLoggerTests, test_serialize_request) {
+  auto max_linesize = FLAGS_logger_tls_max_linesize;
+  auto splice = FLAGS_logger_tls_splice;
+  FLAGS_logger_tls_max_linesize = 64;
+
+  std::vector<std::string> log_data = {
+      "{\"name\": \"first\", \"numbers\": [1, 2, 3]}",
+      "not json",
+      "{\"padding\": \"" + std::string(64, 'a') + "\"}",
+      "{\"name\": \"\\\"last\\\"\"} ",
+  };
+
+  // Splicing the lines produces the same request as parsing them.
+  FLAGS_logger_tls_splice = false;
+  std::string expected_body;
+  ASSERT_TRUE(serializeRequest(log_data, false, expected_body).ok());
+
+  FLAGS_logger_tls_splice = true;
+  std::string body;
+  ASSERT_TRUE(serializeRequest(log_data, false, body).ok());
+
+  JSON expected_request;
+  ASSERT_TRUE(expected_request.fromString(expected_body).ok());
+
+  JSON request;
+  ASSERT_TRUE(request.fromString(body).ok());
+  EXPECT_EQ(request.doc(), expected_request.doc());
+
+  const auto& data = request.doc()["data"];
+  ASSERT_TRUE(data.IsArray());
+  ASSERT_EQ(data.Size(), 2U);
+  EXPECT_EQ(std::string(data[0]["name"].GetString()), "first");
+  EXPECT_EQ(std::string(data[1]["name"].GetString()), "\"last\"");
+
+  // The body is compressed while it is written.
+  std::string compressed_body;
+  ASSERT_TRUE(serializeRequest(log_data, true, compressed_body).ok());
+  EXPECT_EQ(compressed_body, compressString(body));
+
+  FLAGS_logger_tls_max_linesize = max_linesize;
+  FLAGS_logger_tls_splice = splice;
+}
+
+TEST_F(TLSLoggerTests, test_send_pipelined) {
+  // Start a server.
+  ASSERT_TRUE(TLSServerRunner::start());
+  TLSServerRunner::setClientConfig();
+
+  auto endpoint = Flag::getValue("logger_tls_endpoint");
+  auto max_lines = FLAGS_logger_tls_max_lines;
+  auto max_inflight = FLAGS_buffered_log_max_inflight;
+  Flag::updateValue("logger_tls_endpoint", "/log");
+  FLAGS_logger_tls_max_lines = 10;
+  FLAGS_buffered_log_max_inflight = 4;
+
+  // Forget the logs buffered by the other tests.
+  deleteDatabaseRange(kLogs, "tls_", "tls_\x7f");
+
+  auto forwarder = std::make_shared<TLSLogForwarder>();
+  for (size_t i = 0; i < 100; i++) {
+    forwarder->logString("{\"line\": " + std::to_string(i) + "}");
+  }
+
+  // Batches of 10 lines are sent 4 at a time, until every line was sent.
+  runCheck(forwarder);
+
+  std::vector<std::string> indexes;
+  scanDatabaseKeys(kLogs, indexes, "tls_");
+  EXPECT_TRUE(indexes.empty());
+
+  // Every line was received by the server once.
+  Request<TLSTransport, JSONSerializer> request(
+      "https://" + Flag::getValue("tls_hostname") + "/test_read_requests");
+  request.setOption("hostname", Flag::getValue("tls_hostname"));
+  ASSERT_TRUE(request.call(JSON()).ok());
+
+  JSON response;
+  ASSERT_TRUE(request.getResponse(response).ok());
+  ASSERT_TRUE(response.doc().IsArray());
+
+  std::vector<int> lines;
+  for (const auto& received : response.doc().GetArray()) {
+    if (std::string(received["command"].GetString()) != "log") {
+      continue;
+    }
+
+    EXPECT_LE(received["data"].Size(), 10U);
+    for (const auto& line : received["data"].GetArray()) {
+      lines.push_back(line["line"].GetInt());
+    }
+  }
+
+  std::sort(lines.begin(), lines.end());
+  ASSERT_EQ(lines.size(), 100U);
+  for (size_t i = 0; i < lines.size(); i++) {
+    EXPECT_EQ(lines[i], static_cast<int>(i));
+  }
+
+  Flag::updateValue("logger_tls_endpoint", endpoint);
+  FLAGS_logger_tls_max_lines = max_lines;
+  FLAGS_buffered_log_max_inflight = max_inflight;
+
+  // Stop the server.
+  TLSServerRunner::unsetClientConfig();
+  TLSServerRunner::stop();
+}
 } // namespace osquery
@@ -15,6 +15,8 @@
 
 #include "tls_logger.h"
 
+#include <memory>
+
 #include <boost/property_tree/ptree.hpp>
 
 #include <osquery/remote/enroll/enroll.h>
@@ -22,6 +24,7 @@
 #include <osquery/core/flagalias.h>
 #include <osquery/registry/registry.h>
 
+#include <osquery/remote/requests.h>
 #include <osquery/remote/serializers/json.h>
 
 #include <plugins/config/parsers/decorators.h>
@@ -53,8 +56,151 @@ FLAG_ALIAS(google::uint64, logger_tls_max, logger_tls_max_linesize);
 
 FLAG(bool, logger_tls_compress, false, "GZip compress TLS/HTTPS request body");
 
+FLAG(bool,
+     logger_tls_splice,
+     true,
+     "Copy log lines into TLS/HTTPS requests without parsing them again");
+
 REGISTER(TLSLoggerPlugin, "logger", "tls");
 
+namespace rj = rapidjson;
+
+namespace {
+
+/// Size of the request chunks written to the compressor.
+const std::size_t kCompressChunkSize = 64 * 1024;
+
+/// Check that a log line is a single JSON value, without building it.
+bool isValidLogLine(const std::string& line) {
+  rj::Reader reader;
+  rj::BaseReaderHandler<> handler;
+  rj::StringStream stream(line.c_str());
+
+  if (!reader.Parse<rj::kParseIterativeFlag>(stream, handler)) {
+    return false;
+  }
+
+  // A line with an embedded NUL would be copied beyond the parsed value.
+  return stream.Tell() == line.size();
+}
+
+bool isLogLineTooLarge(const std::string& line) {
+  if (line.size() > FLAGS_logger_tls_max_linesize) {
+    LOG(WARNING) << "Linesize exceeds TLS logger maximum: " << line.size();
+    return true;
+  }
+
+  return false;
+}
+
+Status serializeLogLines(const std::string& node_key,
+                         const std::string& log_type,
+                         std::vector<std::string>& log_data,
+                         bool compress,
+                         std::string& body) {
+  rj::StringBuffer buffer;
+  rj::Writer<rj::StringBuffer> writer(buffer);
+
+  writer.StartObject();
+  writer.Key("node_key");
+  writer.String(node_key.c_str(), static_cast<rj::SizeType>(node_key.size()));
+  writer.Key("log_type");
+  writer.String(log_type.c_str(), static_cast<rj::SizeType>(log_type.size()));
+
+  // The result list will use the 'data' key.
+  writer.Key("data");
+  writer.StartArray();
+
+  // When compressing, the body is written to the compressor in chunks.
+  std::unique_ptr<GzipCompressor> compressor;
+  if (compress) {
+    compressor = std::make_unique<GzipCompressor>();
+  }
+
+  auto flush = [&compressor, &buffer]() -> Status {
+    auto s = compressor->append(buffer.GetString(), buffer.GetSize());
+    buffer.Clear();
+    return s;
+  };
+
+  for (auto& item : log_data) {
+    if (isLogLineTooLarge(item) || !isValidLogLine(item)) {
+      continue;
+    }
+
+    writer.RawValue(item.c_str(), item.size(), rj::kObjectType);
+    std::string().swap(item);
+
+    if (compress && buffer.GetSize() >= kCompressChunkSize) {
+      auto s = flush();
+      if (!s.ok()) {
+        return s;
+      }
+    }
+  }
+
+  writer.EndArray();
+  writer.EndObject();
+
+  if (!compress) {
+    body.assign(buffer.GetString(), buffer.GetSize());
+    return Status::success();
+  }
+
+  auto s = flush();
+  if (!s.ok()) {
+    return s;
+  }
+
+  return compressor->finish(body);
+}
+
+Status serializeLogDocument(const std::string& node_key,
+                            const std::string& log_type,
+                            std::vector<std::string>& log_data,
+                            bool compress,
+                            std::string& body) {
+  JSON params;
+  params.add("node_key", node_key);
+  params.add("log_type", log_type);
+
+  {
+    // Read each logged line into JSON and populate a list of lines.
+    // The result list will use the 'data' key.
+    auto children = params.newArray();
+    iterate(log_data, ([&params, &children](std::string& item) {
+              // Enforce a max log line size for TLS logging.
+              if (isLogLineTooLarge(item)) {
+                return;
+              }
+
+              JSON child;
+              Status s = child.fromString(item);
+              if (!s.ok()) {
+                // The log line entered was not valid JSON, skip it.
+                return;
+              }
+              std::string().swap(item);
+              params.push(child.doc(), children.doc());
+            }));
+    params.add("data", children.doc());
+  }
+
+  auto s = params.toString(body);
+  if (!s.ok() || !compress) {
+    return s;
+  }
+
+  body = compressString(body);
+  if (body.empty()) {
+    return Status::failure("Failed to compress the TLS logger request");
+  }
+
+  return Status::success();
+}
+
+} // namespace
+
 TLSLogForwarder::TLSLogForwarder()
     : BufferedLogForwarder("TLSLogForwarder",
                            "tls",
@@ -103,40 +249,32 @@ Status TLSLogForwarder::send(std::vector<std::string>& log_data,
     return Status::success();
   }
 
-  JSON params;
-  params.add("node_key", getNodeKey("tls"));
-  params.add("log_type", log_type);
-
-  {
-    // Read each logged line into JSON and populate a list of lines.
-    // The result list will use the 'data' key.
-    auto children = params.newArray();
-    iterate(log_data, ([&params, &children](std::string& item) {
-              // Enforce a max log line size for TLS logging.
-              if (item.size() > FLAGS_logger_tls_max_linesize) {
-                LOG(WARNING)
-                    << "Linesize exceeds TLS logger maximum: " << item.size();
-                return;
-              }
-
-              JSON child;
-              Status s = child.fromString(item);
-              if (!s.ok()) {
-                // The log line entered was not valid JSON, skip it.
-                return;
-              }
-              std::string().swap(item);
-              params.push(child.doc(), children.doc());
-            }));
-    params.add("data", children.doc());
+  std::string body;
+  auto s = serializeRequest(getNodeKey("tls"),
+                            log_type,
+                            log_data,
+                            FLAGS_logger_tls_compress,
+                            body);
+  if (!s.ok()) {
+    return s;
   }
 
   // The response body is ignored (status is set appropriately by
-  // TLSRequestHelper::go())
+  // TLSRequestHelper::goSerialized())
   std::string response;
-  if (FLAGS_logger_tls_compress) {
-    params.add("_compress", true);
+  return TLSRequestHelper::goSerialized<JSONSerializer>(
+      uri_, body, FLAGS_logger_tls_compress, response);
+}
+
+Status TLSLogForwarder::serializeRequest(const std::string& node_key,
+                                         const std::string& log_type,
+                                         std::vector<std::string>& log_data,
+                                         bool compress,
+                                         std::string& body) {
+  if (FLAGS_logger_tls_splice) {
+    return serializeLogLines(node_key, log_type, log_data, compress, body);
   }
-  return TLSRequestHelper::go<JSONSerializer>(uri_, params, response);
+
+  return serializeLogDocument(node_key, log_type, log_data, compress, body);
 }
 } // namespace osquery
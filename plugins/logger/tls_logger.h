@@ -31,6 +31,29 @@ class TLSLogForwarder : public BufferedLogForwarder {
   Status send(std::vector<std::string>& log_data,
               const std::string& log_type) override;
 
+  /**
+   * @brief Serialize the request body sent for a list of log lines.
+   *
+   * The log lines are already serialized JSON. With `logger_tls_splice` they
+   * are validated and copied into the body as they are, and the body is
+   * compressed while it is written. Otherwise each line is parsed into a
+   * JSON document, which is then serialized.
+   *
+   * Lines larger than `logger_tls_max_linesize` or that are not valid JSON
+   * are skipped, the others are released once serialized.
+   *
+   * @param node_key the node key included in the body
+   * @param log_type the type of the log lines, "result" or "status"
+   * @param log_data the log lines
+   * @param compress true to compress the body using GZip
+   * @param body [output] the request body
+   */
+  static Status serializeRequest(const std::string& node_key,
+                                 const std::string& log_type,
+                                 std::vector<std::string>& log_data,
+                                 bool compress,
+                                 std::string& body);
+
   /// Endpoint URI
   std::string uri_;
 
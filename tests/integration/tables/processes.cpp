@@ -16,6 +16,10 @@
 #include <osquery/utils/info/platform_type.h>
 #include <osquery/utils/system/uptime.h>
 
+#ifdef OSQUERY_LINUX
+#include <unistd.h>
+#endif
+
 namespace osquery {
 namespace table_tests {
 
@@ -108,5 +112,30 @@ TEST_F(ProcessesTest, test_sanity) {
   validate_rows(data, row_map);
 }
 
+#ifdef OSQUERY_LINUX
+TEST_F(ProcessesTest, test_selected_columns) {
+  // Processes are read concurrently but reported in the order of their pids.
+  auto const data = execute_query("select pid, name from processes");
+  ASSERT_GE(data.size(), 2ul);
+  for (size_t i = 1; i < data.size(); i++) {
+    EXPECT_LT(data[i - 1].at("pid"), data[i].at("pid"));
+  }
+
+  ValidationMap row_map = {
+      {"pid", IntType},
+      {"name", NormalType},
+  };
+  validate_rows(data, row_map);
+
+  auto const self = execute_query(
+      "select cmdline, path, on_disk from processes where pid = " +
+      std::to_string(getpid()));
+  ASSERT_EQ(self.size(), 1ul);
+  EXPECT_FALSE(self[0].at("cmdline").empty());
+  EXPECT_FALSE(self[0].at("path").empty());
+  EXPECT_EQ(self[0].at("on_disk"), "1");
+}
+#endif
+
 } // namespace table_tests
 } // namespace osquery
@@ -262,6 +262,7 @@ class RealSimpleHandler(BaseHTTPRequestHandler):
         self._reply({})
 
     def log(self, request):
+        self._push_request('log', request)
         self._reply({})
 
     def test_read_requests(self):